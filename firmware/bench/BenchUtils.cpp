@@ -0,0 +1,63 @@
+#include "BenchUtils.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocatedBytes{0};
+volatile uint64_t sink = 0;
+
+inline void countAllocation(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+
+// Interpose the C allocator; operator new goes through malloc as well
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+  countAllocation(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  countAllocation(count * size);
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  countAllocation(size);
+  return __libc_realloc(ptr, size);
+}
+}
+
+bool AllocCounter::isSupported() { return true; }
+
+#else
+
+bool AllocCounter::isSupported() { return false; }
+
+#endif
+
+AllocCount AllocCounter::snapshot() {
+  AllocCount count;
+  count.allocations = allocations.load(std::memory_order_relaxed);
+  count.bytes = allocatedBytes.load(std::memory_order_relaxed);
+  return count;
+}
+
+void printSection(const char *title) {
+  printf("\n== %s ==\n", title);
+}
+
+void consume(uint64_t value) { sink = sink + value; }
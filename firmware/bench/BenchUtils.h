@@ -0,0 +1,72 @@
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+/**
+ * @file BenchUtils.h
+ * @brief Timing, allocation counting and report helpers for the native benchmarks
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @struct AllocCount
+ * @brief Heap activity between two snapshots
+ */
+struct AllocCount {
+    uint64_t allocations = 0;   //< malloc/calloc/realloc/new calls
+    uint64_t bytes = 0;         //< Bytes requested by those calls
+
+    AllocCount operator-(const AllocCount &rhs) const {
+        AllocCount diff;
+        diff.allocations = allocations - rhs.allocations;
+        diff.bytes = bytes - rhs.bytes;
+        return diff;
+    }
+};
+
+/**
+ * @class AllocCounter
+ * @brief Process-wide heap allocation counter
+ *
+ * Counts through malloc interposition on glibc; elsewhere the counts stay zero.
+ */
+class AllocCounter {
+public:
+    static AllocCount snapshot();
+    static bool isSupported();
+};
+
+/**
+ * @class Stopwatch
+ * @brief Wall-clock timer independent of the simulated Arduino clock
+ */
+class Stopwatch {
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+    void restart() { start = std::chrono::steady_clock::now(); }
+
+    uint64_t elapsedUs() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;    //< Start of the measurement
+};
+
+/**
+ * @brief Print a section title for a group of results
+ * @param title Section title
+ */
+void printSection(const char *title);
+
+/**
+ * @brief Keep the optimiser from discarding a computed value
+ * @param value Value to consume
+ */
+void consume(uint64_t value);
+
+#endif // BENCH_UTILS_H
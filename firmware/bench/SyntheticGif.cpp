@@ -0,0 +1,220 @@
+#include "SyntheticGif.h"
+
+#include <cmath>
+
+namespace {
+
+/** @brief Literal codes between clear codes, keeping LZW codes at 9 bits */
+const int CODES_PER_CLEAR = 250;
+
+const uint16_t CLEAR_CODE = 256;
+const uint16_t END_CODE = 257;
+
+/**
+ * @brief Red, green and blue of a palette entry: a smooth hue ramp so
+ *        neighbouring indices have neighbouring colours
+ */
+void paletteEntry(int i, uint8_t rgb[3]) {
+  rgb[0] = 128 + 127 * sin(i * 0.0245);
+  rgb[1] = 128 + 127 * sin(i * 0.0245 + 2.094);
+  rgb[2] = 128 + 127 * sin(i * 0.0245 + 4.189);
+}
+
+void put16(std::vector<uint8_t> &out, uint16_t value) {
+  out.push_back(value & 0xFF);
+  out.push_back(value >> 8);
+}
+
+/**
+ * @class BitPacker
+ * @brief Packs LZW codes LSB-first into 255-byte data sub-blocks
+ */
+class BitPacker {
+public:
+  explicit BitPacker(std::vector<uint8_t> &output) : out(output) {}
+
+  void put(uint16_t code, uint8_t bits) {
+    accumulator |= (uint32_t)code << pending;
+    pending += bits;
+    while (pending >= 8) {
+      pushByte(accumulator & 0xFF);
+      accumulator >>= 8;
+      pending -= 8;
+    }
+  }
+
+  void finish() {
+    if (pending > 0) pushByte(accumulator & 0xFF);
+    flushBlock();
+    out.push_back(0);
+  }
+
+private:
+  void pushByte(uint8_t byte) {
+    block.push_back(byte);
+    if (block.size() == 255) flushBlock();
+  }
+
+  void flushBlock() {
+    if (block.empty()) return;
+    out.push_back(block.size());
+    out.insert(out.end(), block.begin(), block.end());
+    block.clear();
+  }
+
+  std::vector<uint8_t> &out;
+  std::vector<uint8_t> block;
+  uint32_t accumulator = 0;
+  uint8_t pending = 0;
+};
+
+void writeImage(std::vector<uint8_t> &out, const SyntheticGif &spec, uint16_t frame,
+                uint16_t x0, uint16_t y0, uint16_t w, uint16_t h) {
+  out.push_back(0x2C);
+  put16(out, x0);
+  put16(out, y0);
+  put16(out, w);
+  put16(out, h);
+  out.push_back(0x00);  // No local colour table, not interlaced
+
+  out.push_back(8);     // Minimum code size
+  BitPacker packer(out);
+  int sinceClear = CODES_PER_CLEAR;
+  for (uint16_t y = 0; y < h; y++) {
+    for (uint16_t x = 0; x < w; x++) {
+      if (sinceClear == CODES_PER_CLEAR) {
+        packer.put(CLEAR_CODE, 9);
+        sinceClear = 0;
+      }
+      packer.put(spec.pixel(frame, x0 + x, y0 + y), 9);
+      sinceClear++;
+    }
+  }
+  packer.put(END_CODE, 9);
+  packer.finish();
+}
+
+} // namespace
+
+std::vector<uint8_t> encodeSyntheticGif(const SyntheticGif &spec) {
+  std::vector<uint8_t> out;
+  for (const char *header = "GIF89a"; *header; header++) {
+    out.push_back(*header);
+  }
+
+  // Logical screen with a 256-entry global colour table
+  put16(out, spec.width);
+  put16(out, spec.height);
+  out.push_back(0xF7);
+  out.push_back(0);
+  out.push_back(0);
+  for (int i = 0; i < 256; i++) {
+    uint8_t rgb[3];
+    paletteEntry(i, rgb);
+    out.insert(out.end(), rgb, rgb + 3);
+  }
+
+  // Loop forever
+  const uint8_t netscape[] = {0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E',
+                              '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00};
+  out.insert(out.end(), netscape, netscape + sizeof(netscape));
+
+  for (uint16_t frame = 0; frame < spec.frames; frame++) {
+    bool partial = frame > 0 && spec.frameWidth > 0 && spec.frameHeight > 0;
+    bool transparent = frame > 0 && spec.transparent >= 0;
+
+    out.push_back(0x21);
+    out.push_back(0xF9);
+    out.push_back(4);
+    uint8_t disposal = frame > 0 ? spec.disposal : 1;  // The first frame stays
+    out.push_back((disposal << 2) | (transparent ? 1 : 0));
+    put16(out, spec.delayMs / 10);
+    out.push_back(transparent ? spec.transparent : 0);
+    out.push_back(0);
+
+    if (partial) {
+      writeImage(out, spec, frame, spec.frameX, spec.frameY, spec.frameWidth, spec.frameHeight);
+    } else {
+      writeImage(out, spec, frame, 0, 0, spec.width, spec.height);
+    }
+  }
+
+  out.push_back(0x3B);
+  return out;
+}
+
+uint16_t syntheticColor565(uint8_t index) {
+  uint8_t rgb[3];
+  paletteEntry(index, rgb);
+  return ((rgb[0] & 0xF8) << 8) | ((rgb[1] & 0xFC) << 3) | (rgb[2] >> 3);
+}
+
+std::vector<SyntheticGif> syntheticCorpus() {
+  std::vector<SyntheticGif> corpus;
+
+  SyntheticGif gradient;
+  gradient.name = "gradient.gif";
+  gradient.frames = 24;
+  gradient.pixel = [](uint16_t f, uint16_t x, uint16_t y) -> uint8_t {
+    return (x * 2 + y + f * 8) & 0xFF;
+  };
+  corpus.push_back(gradient);
+
+  SyntheticGif noise;
+  noise.name = "noise.gif";
+  noise.frames = 16;
+  noise.delayMs = 40;
+  noise.pixel = [](uint16_t f, uint16_t x, uint16_t y) -> uint8_t {
+    uint32_t h = (f * 73856093u) ^ (x * 19349663u) ^ (y * 83492791u);
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    return (h >> 15) & 0xFF;
+  };
+  corpus.push_back(noise);
+
+  SyntheticGif sprite;
+  sprite.name = "sprite.gif";
+  sprite.frames = 30;
+  sprite.delayMs = 33;
+  sprite.frameX = 16;
+  sprite.frameY = 16;
+  sprite.frameWidth = 32;
+  sprite.frameHeight = 32;
+  sprite.transparent = 0;
+  sprite.pixel = [](uint16_t f, uint16_t x, uint16_t y) -> uint8_t {
+    if (f == 0) return 16 + (y & 0x1F);
+    int dx = (int)x - 32;
+    int dy = (int)y - 32;
+    int r = 6 + (f % 10);
+    return dx * dx + dy * dy <= r * r ? 128 + f : 0;
+  };
+  corpus.push_back(sprite);
+
+  // The same sprite, its rectangle cleared or put back after every frame
+  sprite.name = "dispose-bg.gif";
+  sprite.disposal = 2;
+  corpus.push_back(sprite);
+
+  sprite.name = "dispose-prev.gif";
+  sprite.disposal = 3;
+  corpus.push_back(sprite);
+
+  SyntheticGif oversized;
+  oversized.name = "oversized128.gif";
+  oversized.width = 128;
+  oversized.height = 128;
+  oversized.frames = 12;
+  oversized.delayMs = 80;
+  oversized.pixel = [](uint16_t f, uint16_t x, uint16_t y) -> uint8_t {
+    return ((x ^ y) + f * 4) & 0xFF;
+  };
+  corpus.push_back(oversized);
+
+  oversized.name = "oversized256.gif";
+  oversized.width = 256;
+  oversized.height = 256;
+  oversized.frames = 8;
+  corpus.push_back(oversized);
+
+  return corpus;
+}
@@ -0,0 +1,60 @@
+#ifndef SYNTHETIC_GIF_H
+#define SYNTHETIC_GIF_H
+
+/**
+ * @file SyntheticGif.h
+ * @brief Generated animated GIFs for the benchmark corpus
+ *
+ * Image data is written as literal-only LZW (a clear code every few hundred
+ * codes), which keeps the generator trivial and decodes through the normal
+ * LZW path with one code per pixel. Real files compress better, so the
+ * benchmark also plays any GIFs found in $BENCH_CORPUS.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @struct SyntheticGif
+ * @brief Description of one generated GIF
+ */
+struct SyntheticGif {
+    std::string name;               //< File name in the corpus
+    uint16_t width = 64;            //< Logical screen width
+    uint16_t height = 64;           //< Logical screen height
+    uint16_t frames = 16;           //< Number of frames
+    uint16_t delayMs = 50;          //< Delay of every frame
+    uint16_t frameX = 0;            //< Left of frames after the first
+    uint16_t frameY = 0;            //< Top of frames after the first
+    uint16_t frameWidth = 0;        //< Width of frames after the first, 0 for full frame
+    uint16_t frameHeight = 0;       //< Height of frames after the first, 0 for full frame
+    int16_t transparent = -1;       //< Transparent index of frames after the first, -1 for none
+    uint8_t disposal = 1;           //< Disposal method of frames after the first
+
+    /** Palette index of a pixel, in logical screen coordinates */
+    std::function<uint8_t(uint16_t frame, uint16_t x, uint16_t y)> pixel;
+};
+
+/**
+ * @brief Encode a GIF89a file
+ * @param spec GIF description
+ * @return File contents
+ */
+std::vector<uint8_t> encodeSyntheticGif(const SyntheticGif &spec);
+
+/**
+ * @brief Palette entry of every generated GIF as RGB565
+ * @param index Palette index
+ * @return Color the decoder produces for the index
+ */
+uint16_t syntheticColor565(uint8_t index);
+
+/**
+ * @brief The built-in benchmark corpus
+ * @return GIF descriptions covering full-frame, noisy, sparse, disposing and oversized content
+ */
+std::vector<SyntheticGif> syntheticCorpus();
+
+#endif // SYNTHETIC_GIF_H
@@ -0,0 +1,1520 @@
+/**
+ * @file main.cpp
+ * @brief Host benchmarks for panel drawing, tiled canvases, dirty tracking, effects, configuration,
+ *        filesystem helpers, GIF playback and disposal, palette line conversion, uploads, transcoding and the category index
+ *
+ * Build and run from the project root:
+ *   pio run -e native && .pio/build/native/program
+ *
+ * Environment:
+ *   NATIVE_FS_ROOT  host directory holding the littlefs/ and sd/ trees (default ./native_fs)
+ *   BENCH_CONFIG    configuration to start from (default firmware/data/config.example.json)
+ *   BENCH_CORPUS    directory of extra .gif files to play after the generated corpus
+ *   BENCH_REPEAT    plays per GIF (default 3)
+ *   BENCH_LIBRARY   GIFs in the synthetic library for the category index and lists (default 2000)
+ *
+ * Timings are host wall-clock and only meaningful relative to each other.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnimatedGIFPanel.h"
+#include "BenchUtils.h"
+#include "ConfigManager.h"
+#include "DisplayService.h"
+#include "FSUtils.h"
+#include "GIFCategoryIndex.h"
+#include "GIFCategoryList.h"
+#include "GIFCompositor.h"
+#include "GIFTranscoder.h"
+#include "GIFUploadWriter.h"
+#include "GIFValidator.h"
+#include "Logger.h"
+#include "PlasmaEffect.h"
+#include "SyntheticGif.h"
+#include "constants.h"
+
+namespace {
+
+/** @brief Frames drawn per blit and plasma measurement */
+const int BENCH_FRAMES = 500;
+
+/** @brief Configuration loads per measurement */
+const int CONFIG_LOADS = 200;
+
+/** @brief Upload chunk size fed to the validator, one TCP segment */
+const size_t UPLOAD_CHUNK_BYTES = 1436;
+
+/** @brief SD directory streamed uploads are stored in */
+const char *UPLOAD_DIR = GIFS_BASE_PATH "/bench";
+
+/** @brief SD directory the synthetic library for the category index is written to */
+const char *LIBRARY_DIR = "/bench-library";
+
+/** @brief Categories the synthetic library is spread over */
+const int LIBRARY_CATEGORIES = 20;
+
+/** @brief GIFs stepped through per category list measurement */
+const int LIBRARY_STEPS = 10000;
+
+/** @brief Calls per FSUtils measurement */
+const int FS_CALLS = 50;
+
+/** @brief Size of the file FSUtils writes, reads and copies */
+const size_t FS_FILE_BYTES = 16 * 1024;
+
+/** @brief SD directory the FSUtils measurements work in */
+const char *FS_BENCH_DIR = "/bench-fs";
+
+/** @brief GIF switches timed per pipeline playback measurement */
+const uint32_t PIPELINE_SWITCHES = 6;
+
+/** @brief Category the generated stills are uploaded into */
+const char *STILL_CATEGORY = "bench-stills";
+
+/** @brief LittleFS directory the corpus is installed into */
+const char *CORPUS_DIR = "/bench";
+
+/**
+ * @struct CorpusEntry
+ * @brief GIF installed on LittleFS for playback
+ */
+struct CorpusEntry {
+  String path;          //< LittleFS path
+  String label;         //< Name shown in the report
+  uint16_t width = 0;   //< Logical screen width from the header
+  uint16_t height = 0;  //< Logical screen height from the header
+  size_t bytes = 0;     //< File size
+};
+
+const char *envOr(const char *name, const char *fallback) {
+  const char *value = getenv(name);
+  return value && value[0] ? value : fallback;
+}
+
+bool readHostFile(const std::string &path, std::vector<uint8_t> &data) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) return false;
+  uint8_t buffer[4096];
+  size_t got;
+  data.clear();
+  while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + got);
+  }
+  fclose(file);
+  return true;
+}
+
+bool installCorpusFile(const String &name, const std::vector<uint8_t> &data,
+                       std::vector<CorpusEntry> &corpus) {
+  CorpusEntry entry;
+  entry.path = FSUtils::buildPath(CORPUS_DIR, name.c_str(), nullptr);
+  entry.label = name;
+  entry.bytes = data.size();
+  if (data.size() >= 10) {
+    entry.width = data[6] | (data[7] << 8);
+    entry.height = data[8] | (data[9] << 8);
+  }
+  if (!FSUtils::writeFile(FSType::LITTLEFS, entry.path.c_str(), data.data(), data.size())) {
+    return false;
+  }
+  corpus.push_back(entry);
+  return true;
+}
+
+// =============================================================================
+// Environment Setup
+// =============================================================================
+
+/**
+ * @brief Load the configuration and tune it for repeatable measurements
+ * @return true if the configuration was loaded
+ */
+bool setupConfig() {
+  std::vector<uint8_t> config;
+  const char *configPath = envOr("BENCH_CONFIG", "firmware/data/config.example.json");
+  if (!readHostFile(configPath, config)) {
+    printf("Cannot read configuration %s\n", configPath);
+    return false;
+  }
+  if (!FSUtils::writeFile(FSType::LITTLEFS, CONFIG_FILE, config.data(), config.size()) ||
+      !ConfigManager::getInstance().loadConfiguration()) {
+    return false;
+  }
+
+  JsonDocument &doc = ConfigManager::getInstance().getConfig();
+  doc[PLAYBACK][FRAME_CACHE_BYTES] = 0;   // Decode on every play
+  doc[PLAYBACK][PIPELINE_DEPTH] = DEFAULT_PIPELINE_DEPTH; // Driven only by the pipeline section
+  doc[STATE][IS_POWER_ON] = true;
+  doc[STATE][CATEGORY_PLAYBACK] = false;
+  return true;
+}
+
+/**
+ * @brief Bring up filesystems, configuration, display and GIF panel
+ * @return true if everything initialised
+ */
+bool setupEnvironment() {
+  Logger::setLogLevel(Logger::WARNING);
+
+  if (!FSUtils::begin(FSType::LITTLEFS) || !setupConfig()) {
+    printf("Failed to prepare LittleFS under %s\n", LittleFS.getRoot().c_str());
+    return false;
+  }
+  if (!FSUtils::begin(FSType::SD) || !FSUtils::createDir(FSType::SD, GIFS_BASE_PATH)) {
+    printf("Failed to prepare SD under %s\n", SD.getRoot().c_str());
+    return false;
+  }
+  if (!DisplayService::getInstance().initialize() ||
+      !AnimatedGIFPanel::getInstance().initialize()) {
+    printf("Failed to initialise display or GIF panel\n");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Write the generated GIFs and any $BENCH_CORPUS files to LittleFS
+ * @return Installed GIFs
+ */
+std::vector<CorpusEntry> installCorpus() {
+  std::vector<CorpusEntry> corpus;
+  FSUtils::createDir(FSType::LITTLEFS, CORPUS_DIR);
+
+  for (const SyntheticGif &spec : syntheticCorpus()) {
+    installCorpusFile(String(spec.name), encodeSyntheticGif(spec), corpus);
+  }
+
+  const char *extra = getenv("BENCH_CORPUS");
+  DIR *dir = extra ? opendir(extra) : nullptr;
+  if (dir) {
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      String name(entry->d_name);
+      std::vector<uint8_t> data;
+      if (AnimatedGIFPanel::isGifFile(name) &&
+          readHostFile(std::string(extra) + "/" + entry->d_name, data)) {
+        installCorpusFile(name, data, corpus);
+      }
+    }
+    closedir(dir);
+  }
+  return corpus;
+}
+
+// =============================================================================
+// Blit Benchmark
+// =============================================================================
+
+/**
+ * @brief The per-pixel line drawing GIFDraw used before SpanBlitter
+ */
+void legacyDrawLine(MatrixPanel_I2S_DMA *display, int y, const uint8_t *pixels,
+                    const uint16_t *palette, int width, int16_t transparent) {
+  if (transparent >= 0) {
+    uint16_t tempBuffer[320];
+    int x = 0;
+    while (x < width) {
+      int runLength = 0;
+      while (x + runLength < width && pixels[x + runLength] != transparent) {
+        runLength++;
+      }
+      if (runLength > 0) {
+        for (int i = 0; i < runLength; i++) {
+          tempBuffer[i] = palette[pixels[x + i]];
+        }
+        for (int i = 0; i < runLength; i++) {
+          display->drawPixel(x + i, y, tempBuffer[i]);
+        }
+        x += runLength;
+      }
+      runLength = 0;
+      while (x + runLength < width && pixels[x + runLength] == transparent) {
+        runLength++;
+      }
+      x += runLength;
+    }
+  } else {
+    for (int x = 0; x < width; x++) {
+      display->drawPixel(x, y, palette[pixels[x]]);
+    }
+  }
+}
+
+void reportDraw(const char *content, const char *path, uint64_t us,
+                const MatrixPanel_I2S_DMA &display, int pixelsPerFrame) {
+  printf("%-12s %-10s %10.0f %10.2f %14.0f %12.0f\n", content, path,
+         BENCH_FRAMES * 1e6 / (us ? us : 1),
+         us * 1000.0 / ((double)BENCH_FRAMES * pixelsPerFrame),
+         (double)display.getPixelWrites() / BENCH_FRAMES,
+         (double)display.getDrawCalls() / BENCH_FRAMES);
+}
+
+void benchBlit() {
+  MatrixPanel_I2S_DMA *display = DisplayService::getInstance().getDisplay();
+  SpanBlitter &blitter = DisplayService::getInstance().getBlitter();
+  int width = display->width();
+  int height = display->height();
+
+  uint16_t palette[256];
+  for (int i = 0; i < 256; i++) {
+    palette[i] = MatrixPanel_I2S_DMA::color565(i, 255 - i, i * 3);
+  }
+
+  // Opaque content, runs of eight transparent pixels every sixteen, and
+  // flat areas of sixteen pixels in one color
+  std::vector<uint8_t> opaque(width * height);
+  std::vector<uint8_t> sparse(width * height);
+  std::vector<uint8_t> flat(width * height);
+  for (int i = 0; i < width * height; i++) {
+    opaque[i] = 1 + i % 255;
+    sparse[i] = (i & 8) ? 0 : 1 + i % 255;
+    flat[i] = 1 + (i / 16) % 255;
+  }
+
+  // Every frame below is the same, so compare the raw write paths without change tracking
+  bool tracking = blitter.isTracking();
+  blitter.setTracking(false);
+
+  // Frames go through the compositor the way the firmware draws GIFs: lines onto
+  // the canvas, then the changed rectangle to the panel in spans
+  GIFCompositor compositor;
+  compositor.begin(width, height);
+
+  printSection("Panel drawing: per-pixel drawPixel vs compositor and SpanBlitter");
+  printf("%-12s %-10s %10s %10s %14s %12s\n", "content", "path", "frames/s", "ns/pixel",
+         "writes/frame", "calls/frame");
+
+  struct Variant {
+    const char *name;
+    const std::vector<uint8_t> *pixels;
+    int16_t transparent;
+  } variants[] = {{"opaque", &opaque, -1}, {"sparse", &sparse, 0}, {"flat", &flat, -1}};
+
+  for (const Variant &variant : variants) {
+    const uint8_t *pixels = variant.pixels->data();
+
+    display->resetPixelWrites();
+    Stopwatch legacyTime;
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      for (int y = 0; y < height; y++) {
+        legacyDrawLine(display, y, pixels + y * width, palette, width, variant.transparent);
+      }
+    }
+    reportDraw(variant.name, "per-pixel", legacyTime.elapsedUs(), *display, width * height);
+
+    compositor.reset();
+    display->resetPixelWrites();
+    Stopwatch spanTime;
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      blitter.beginFrame();
+      compositor.beginFrame(0, 0, width, height, GIFCompositor::DISPOSE_NONE);
+      for (int y = 0; y < height; y++) {
+        compositor.drawIndexedLine(0, y, pixels + y * width, palette, width, variant.transparent);
+      }
+      compositor.present(blitter);
+    }
+    reportDraw(variant.name, "span", spanTime.elapsedUs(), *display, width * height);
+  }
+  blitter.setTracking(tracking);
+}
+
+/**
+ * @brief Fill a frame with a static gradient and an 8x8 block at a position that moves per frame
+ */
+void spriteFrame(std::vector<uint16_t> &frame, int width, int height, int f) {
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      frame[y * width + x] = MatrixPanel_I2S_DMA::color565(x * 4, y * 4, 64);
+    }
+  }
+  int spriteX = (f * 3) % (width - 8);
+  int spriteY = (f * 2) % (height - 8);
+  for (int y = spriteY; y < spriteY + 8; y++) {
+    for (int x = spriteX; x < spriteX + 8; x++) {
+      frame[y * width + x] = 0xFFFF;
+    }
+  }
+}
+
+void benchDirty() {
+  MatrixPanel_I2S_DMA *display = DisplayService::getInstance().getDisplay();
+  int width = display->width();
+  int height = display->height();
+
+  // A few frames of a small sprite moving over a static background, presented whole
+  // like pipeline and frame cache frames
+  const int variants = 16;
+  std::vector<std::vector<uint16_t>> frames(variants, std::vector<uint16_t>(width * height));
+  for (int f = 0; f < variants; f++) {
+    spriteFrame(frames[f], width, height, f);
+  }
+
+  printSection("Dirty tracking: whole frames with a moving 8x8 sprite");
+  printf("%-12s %-10s %10s %10s %14s %14s\n", "content", "path", "frames/s", "ns/pixel",
+         "writes/frame", "skipped/frame");
+
+  for (bool track : {false, true}) {
+    SpanBlitter blitter;
+    blitter.setDisplay(display);
+    blitter.setTracking(track);
+
+    display->resetPixelWrites();
+    Stopwatch time;
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      const uint16_t *pixels = frames[f % variants].data();
+      blitter.beginFrame();
+      for (int y = 0; y < height; y++) {
+        blitter.blitSpan(0, y, pixels + y * width, width);
+      }
+    }
+    uint64_t us = time.elapsedUs();
+    printf("%-12s %-10s %10.0f %10.2f %14.0f %14.0f\n", "sprite", track ? "tracked" : "full",
+           BENCH_FRAMES * 1e6 / (us ? us : 1),
+           us * 1000.0 / ((double)BENCH_FRAMES * width * height),
+           (double)display->getPixelWrites() / BENCH_FRAMES,
+           (double)blitter.getStats().skippedPixels / BENCH_FRAMES);
+  }
+
+  // The panel changed behind the playback blitter's back
+  DisplayService::getInstance().getBlitter().invalidate();
+}
+
+/**
+ * @brief Frame drawn on a tiled wall by mapping every pixel with the tiling arithmetic
+ */
+void locateFrame(MatrixPanel_I2S_DMA *display, const CanvasMapper &mapper, const uint16_t *pixels) {
+  for (int y = 0; y < mapper.height(); y++) {
+    for (int x = 0; x < mapper.width(); x++) {
+      int16_t chainX, chainY;
+      mapper.locate(x, y, chainX, chainY);
+      display->drawPixelRGB565(chainX, chainY, pixels[y * mapper.width() + x]);
+    }
+  }
+}
+
+void benchCanvas() {
+  printSection("Tiled canvas: per-pixel mapping vs row tables");
+  printf("%-12s %-10s %10s %10s %14s %12s\n", "layout", "path", "frames/s", "ns/pixel",
+         "writes/frame", "calls/frame");
+
+  // 2x2 wall of the configured panels, chained in a snake from the top left
+  CanvasLayout layout;
+  layout.panelsAcross = 2;
+  layout.panelsDown = 2;
+  layout.chainStart = ChainStart::TOP_LEFT;
+  layout.serpentine = true;
+
+  for (uint8_t rotation : {0, 1}) {
+    layout.rotation = rotation;
+    CanvasMapper mapper;
+    if (!mapper.configure(layout)) return;
+
+    HUB75_I2S_CFG config(layout.panelWidth, layout.panelHeight, layout.chainLength());
+    MatrixPanel_I2S_DMA wall(config);
+    wall.begin();
+    SpanBlitter blitter;
+    blitter.setDisplay(&wall, &mapper);
+
+    int width = mapper.width();
+    int height = mapper.height();
+    std::vector<uint16_t> pixels(width * height);
+    for (int i = 0; i < width * height; i++) {
+      pixels[i] = (uint16_t)(i * 2654435761u >> 16);
+    }
+    const char *name = rotation ? "2x2 snake 90" : "2x2 snake";
+
+    wall.resetPixelWrites();
+    Stopwatch locateTime;
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      locateFrame(&wall, mapper, pixels.data());
+    }
+    reportDraw(name, "per-pixel", locateTime.elapsedUs(), wall, width * height);
+
+    wall.resetPixelWrites();
+    Stopwatch tableTime;
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      blitter.beginFrame();
+      for (int y = 0; y < height; y++) {
+        blitter.blitSpan(0, y, pixels.data() + y * width, width);
+      }
+    }
+    reportDraw(name, "tables", tableTime.elapsedUs(), wall, width * height);
+  }
+}
+
+// =============================================================================
+// Plasma Benchmark
+// =============================================================================
+
+/**
+ * @brief The per-pixel plasma loop PlasmaEffect used before its lookup tables
+ */
+void legacyPlasmaFrame(MatrixPanel_I2S_DMA *display, const CRGBPalette16 &palette,
+                       uint16_t time_counter) {
+  for (int x = 0; x < display->width(); x++) {
+    for (int y = 0; y < display->height(); y++) {
+      int16_t v = 128;
+      uint8_t wibble = sin8(time_counter);
+      v += sin16(x * wibble * 3 + time_counter);
+      v += cos16(y * (128 - wibble) + time_counter);
+      v += sin16(y * x * cos8(-time_counter) / 8);
+
+      CRGB color = ColorFromPalette(palette, (v >> 8));
+      display->drawPixelRGB888(x, y, color.r, color.g, color.b);
+    }
+  }
+}
+
+void reportPlasma(const char *path, uint64_t us, const AllocCount &allocs, const char *output) {
+  printf("%-10s %10.0f %10.1f %12.2f %8s\n", path, BENCH_FRAMES * 1e6 / (us ? us : 1),
+         (double)us / BENCH_FRAMES, (double)allocs.allocations / BENCH_FRAMES, output);
+}
+
+void benchPlasma() {
+  MatrixPanel_I2S_DMA *display = DisplayService::getInstance().getDisplay();
+  size_t pixels = (size_t)display->width() * display->height();
+  PlasmaEffect plasma;
+  plasma.setup();
+
+  printSection("Plasma effect: per-pixel vs lookup tables");
+  printf("%-10s %10s %10s %12s %8s\n", "path", "frames/s", "us/frame", "allocs/frame", "output");
+
+  // Both paths start from time 0 on HeatColors_p and stay below the palette change at 1024
+  AllocCount before = AllocCounter::snapshot();
+  Stopwatch legacyTime;
+  for (int f = 0; f < BENCH_FRAMES; f++) {
+    legacyPlasmaFrame(display, HeatColors_p, f);
+  }
+  uint64_t legacyUs = legacyTime.elapsedUs();
+  reportPlasma("per-pixel", legacyUs, AllocCounter::snapshot() - before, "-");
+  // Compared at 8 bits per channel, the depth both paths hand to the driver
+  std::vector<uint32_t> reference(display->getFramebufferRGB888(),
+                                  display->getFramebufferRGB888() + pixels);
+
+  display->clearScreen();
+  before = AllocCounter::snapshot();
+  Stopwatch lutTime;
+  for (int f = 0; f < BENCH_FRAMES; f++) {
+    plasma.loop(display);
+  }
+  uint64_t lutUs = lutTime.elapsedUs();
+  bool same = std::equal(reference.begin(), reference.end(), display->getFramebufferRGB888());
+  reportPlasma("lut", lutUs, AllocCounter::snapshot() - before, same ? "same" : "DIFFERS");
+}
+
+// =============================================================================
+// Configuration Benchmark
+// =============================================================================
+
+void benchConfig() {
+  printSection("Configuration load");
+  printf("%10s %12s %12s\n", "us/load", "allocs/load", "bytes/load");
+
+  AllocCount before = AllocCounter::snapshot();
+  Stopwatch time;
+  for (int i = 0; i < CONFIG_LOADS; i++) {
+    ConfigManager::getInstance().loadConfiguration();
+  }
+  uint64_t us = time.elapsedUs();
+  AllocCount allocs = AllocCounter::snapshot() - before;
+
+  printf("%10.1f %12.1f %12.0f\n", (double)us / CONFIG_LOADS,
+         (double)allocs.allocations / CONFIG_LOADS, (double)allocs.bytes / CONFIG_LOADS);
+
+  // Reapply the benchmark overrides on the reloaded document
+  setupConfig();
+}
+
+// =============================================================================
+// Filesystem Helper Benchmark
+// =============================================================================
+
+/**
+ * @brief Time FS_CALLS calls of an FSUtils helper and print one row
+ * @param name Helper measured
+ * @param bytes Bytes each call moves, 0 for none
+ * @param call Runs the helper once, returning false on failure
+ */
+template <typename Call>
+void timeFSUtils(const char *name, size_t bytes, Call call) {
+  bool ok = true;
+  AllocCount before = AllocCounter::snapshot();
+  Stopwatch time;
+  for (int i = 0; i < FS_CALLS && ok; i++) {
+    ok = call();
+  }
+  uint64_t us = time.elapsedUs();
+  AllocCount allocs = AllocCounter::snapshot() - before;
+
+  if (!ok) {
+    printf("%-26s failed\n", name);
+    return;
+  }
+  printf("%-26s %10.1f %12.1f %10.0f\n", name, (double)us / FS_CALLS,
+         (double)allocs.allocations / FS_CALLS,
+         bytes && us ? bytes * (double)FS_CALLS / 1024.0 / (us / 1e6) : 0.0);
+}
+
+void benchFSUtils() {
+  FSUtils::createDir(FSType::SD, FS_BENCH_DIR);
+  String path = FSUtils::buildPath(FS_BENCH_DIR, "file.txt", nullptr);
+  String copyPath = FSUtils::buildPath(FS_BENCH_DIR, "copy.txt", nullptr);
+  const char *flashPath = "/bench-copy.txt";
+  std::vector<uint8_t> data(FS_FILE_BYTES);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = 'a' + i % 26;
+  }
+  std::vector<uint8_t> buffer(FS_FILE_BYTES);
+
+  printSection("Filesystem helpers (FSUtils, 16 KB file on SD)");
+  printf("%-26s %10s %12s %10s\n", "call", "us/call", "allocs/call", "KB/s");
+
+  timeFSUtils("writeFile", data.size(), [&] {
+    return FSUtils::writeFile(FSType::SD, path.c_str(), data.data(), data.size());
+  });
+  timeFSUtils("readFile into buffer", data.size(), [&] {
+    return FSUtils::readFile(FSType::SD, path.c_str(), buffer.data(), buffer.size()) ==
+           data.size();
+  });
+  timeFSUtils("readFile as String", data.size(), [&] {
+    return FSUtils::readFile(FSType::SD, path.c_str()).length() == data.size();
+  });
+  timeFSUtils("copyFile SD to LittleFS", data.size(), [&] {
+    return FSUtils::copyFile(FSType::SD, path.c_str(), FSType::LITTLEFS, flashPath);
+  });
+  timeFSUtils("copyFile SD to SD", data.size(), [&] {
+    return FSUtils::copyFile(FSType::SD, path.c_str(), FSType::SD, copyPath.c_str());
+  });
+  timeFSUtils("fileSize", 0, [&] {
+    return FSUtils::fileSize(FSType::SD, path.c_str()) == data.size();
+  });
+  timeFSUtils("exists", 0, [&] { return FSUtils::exists(FSType::SD, path.c_str()); });
+  timeFSUtils("_listDir", 0, [&] {
+    return FSUtils::_listDir(FSType::SD, FS_BENCH_DIR, false, false).size() == 2;
+  });
+  timeFSUtils("buildPath", 0, [&] {
+    return FSUtils::buildPath(GIFS_BASE_PATH, "category", "file.gif", nullptr).length() > 0;
+  });
+
+  FSUtils::deleteFile(FSType::LITTLEFS, flashPath);
+  FSUtils::deleteFile(FSType::SD, copyPath.c_str());
+  FSUtils::deleteFile(FSType::SD, path.c_str());
+  FSUtils::removeDir(FSType::SD, FS_BENCH_DIR);
+}
+
+// =============================================================================
+// GIF Playback Benchmark
+// =============================================================================
+
+/**
+ * @struct PlayResult
+ * @brief Cost of playing one GIF a number of times
+ */
+struct PlayResult {
+  bool ok = true;             //< Every play succeeded
+  uint64_t us = 0;            //< Wall-clock time
+  uint32_t frames = 0;        //< Frames drawn
+  uint64_t animatedMs = 0;    //< Display time the GIF asked for
+  AllocCount allocs;          //< Heap activity
+};
+
+PlayResult playTimed(const CorpusEntry &entry, int repeat) {
+  AnimatedGIFPanel &panel = AnimatedGIFPanel::getInstance();
+  const BlitStats &blitStats = DisplayService::getInstance().getBlitter().getStats();
+
+  PlayResult result;
+  uint32_t framesBefore = blitStats.frames;
+  uint64_t animatedBefore = native::simulatedDelayMs();
+  AllocCount allocsBefore = AllocCounter::snapshot();
+  Stopwatch time;
+
+  for (int r = 0; r < repeat && result.ok; r++) {
+    result.ok = panel.ShowGIF(entry.path);
+  }
+
+  result.us = time.elapsedUs();
+  result.allocs = AllocCounter::snapshot() - allocsBefore;
+  result.frames = blitStats.frames - framesBefore;
+  result.animatedMs = native::simulatedDelayMs() - animatedBefore;
+  return result;
+}
+
+int benchRepeat() {
+  int repeat = atoi(envOr("BENCH_REPEAT", "3"));
+  return repeat < 1 ? 1 : repeat;
+}
+
+void benchGifs(const std::vector<CorpusEntry> &corpus) {
+  AnimatedGIFPanel &panel = AnimatedGIFPanel::getInstance();
+  int repeat = benchRepeat();
+
+  printSection("GIF playback (frame cache off, decode on the calling thread)");
+  printf("%-20s %9s %8s %7s %9s %9s %9s %11s %9s %7s\n", "gif", "size", "bytes",
+         "frames", "frames/s", "us/frame", "realtime", "allocs/play", "KB/play", "source");
+
+  for (const CorpusEntry &entry : corpus) {
+    PlayResult play = playTimed(entry, repeat);
+    if (!play.ok) {
+      printf("%-20s failed to play\n", entry.label.c_str());
+      continue;
+    }
+
+    JsonDocument status;
+    String statusJson = panel.getStatusJson();
+    deserializeJson(status, statusJson);
+    String source = status["sources"]["current"].as<String>();
+
+    char size[16];
+    snprintf(size, sizeof(size), "%ux%u", entry.width, entry.height);
+    printf("%-20s %9s %8u %7u %9.0f %9.1f %8.0fx %11.1f %9.1f %7s\n", entry.label.c_str(),
+           size, (unsigned)entry.bytes, play.frames / repeat,
+           play.frames * 1e6 / (play.us ? play.us : 1),
+           play.frames ? (double)play.us / play.frames : 0.0,
+           play.us ? play.animatedMs * 1000.0 / play.us : 0.0,
+           (double)play.allocs.allocations / repeat, play.allocs.bytes / 1024.0 / repeat,
+           source.c_str());
+  }
+}
+
+/**
+ * @brief Compose a generated GIF by the GIF specification, one frame after another
+ * @param spec GIF description
+ * @return RGB565 logical screen after the last frame
+ */
+std::vector<uint16_t> referenceLastFrame(const SyntheticGif &spec) {
+  std::vector<uint16_t> screen(spec.width * spec.height, 0);
+  std::vector<uint16_t> saved;
+  int rectX = 0, rectY = 0, rectW = 0, rectH = 0;
+  uint8_t pendingDisposal = 0;
+
+  for (uint16_t f = 0; f < spec.frames; f++) {
+    for (int y = rectY; y < rectY + rectH; y++) {
+      for (int x = rectX; x < rectX + rectW; x++) {
+        if (pendingDisposal == 2) screen[y * spec.width + x] = 0;
+        if (pendingDisposal == 3) screen[y * spec.width + x] = saved[y * spec.width + x];
+      }
+    }
+
+    bool partial = f > 0 && spec.frameWidth > 0 && spec.frameHeight > 0;
+    rectX = partial ? spec.frameX : 0;
+    rectY = partial ? spec.frameY : 0;
+    rectW = partial ? spec.frameWidth : spec.width;
+    rectH = partial ? spec.frameHeight : spec.height;
+    pendingDisposal = f > 0 ? spec.disposal : 1;
+    if (pendingDisposal == 3) saved = screen;
+
+    int transparent = f > 0 ? spec.transparent : -1;
+    for (int y = rectY; y < rectY + rectH; y++) {
+      for (int x = rectX; x < rectX + rectW; x++) {
+        uint8_t index = spec.pixel(f, x, y);
+        if (index != transparent) screen[y * spec.width + x] = syntheticColor565(index);
+      }
+    }
+  }
+  return screen;
+}
+
+void benchDisposal(const std::vector<CorpusEntry> &corpus) {
+  MatrixPanel_I2S_DMA *display = DisplayService::getInstance().getDisplay();
+
+  printSection("GIF disposal: composed frames against the GIF specification");
+  printf("%-20s %8s %9s %14s %9s\n", "gif", "disposal", "frames/s", "writes/frame", "output");
+
+  for (const SyntheticGif &spec : syntheticCorpus()) {
+    // Partial frames over a full first frame, shown uncropped
+    if (spec.frameWidth == 0 || spec.width > display->width() || spec.height > display->height()) {
+      continue;
+    }
+    auto entry = std::find_if(corpus.begin(), corpus.end(), [&](const CorpusEntry &e) {
+      return e.label == spec.name.c_str();
+    });
+    if (entry == corpus.end()) continue;
+
+    display->resetPixelWrites();
+    PlayResult play = playTimed(*entry, 1);
+    uint64_t writes = display->getPixelWrites();
+
+    std::vector<uint16_t> expected = referenceLastFrame(spec);
+    bool same = play.ok;
+    for (int y = 0; y < spec.height && same; y++) {
+      for (int x = 0; x < spec.width && same; x++) {
+        same = display->getPixel(x, y) == expected[y * spec.width + x];
+      }
+    }
+
+    printf("%-20s %8u %9.0f %14.0f %9s\n", entry->label.c_str(), spec.disposal,
+           play.frames * 1e6 / (play.us ? play.us : 1),
+           play.frames ? (double)writes / play.frames : 0.0, same ? "same" : "DIFFERS");
+  }
+}
+
+// =============================================================================
+// Pipeline Playback Benchmark
+// =============================================================================
+
+uint32_t statusCounter(const char *section, const char *key) {
+  JsonDocument status;
+  String statusJson = AnimatedGIFPanel::getInstance().getStatusJson();
+  deserializeJson(status, statusJson);
+  return status[section][key] | 0u;
+}
+
+/**
+ * @struct SwitchTiming
+ * @brief Time between GIF switches in pipeline playback
+ */
+struct SwitchTiming {
+  bool finished = false;      //< Every switch was seen
+  double msPerGif = 0;        //< Simulated time from the first switch to the last, per GIF
+  uint32_t dropped = 0;       //< Frames dropped instead of shown
+  uint32_t switches = 0;      //< GIF switches seen
+  uint32_t gapless = 0;       //< Switches shown on their deadline
+};
+
+/**
+ * @brief Play the selected GIFs through the frame pipeline
+ *
+ * Decodes on a second thread and presents on this one, like the decoder and
+ * display tasks. The time between GIF switches is simulated, so stills held
+ * for an update interval show up as that interval.
+ */
+SwitchTiming playPipelined() {
+  AnimatedGIFPanel &panel = AnimatedGIFPanel::getInstance();
+  std::atomic<bool> running{true};
+  std::thread decoder([&] {
+    while (running) {
+      if (!panel.decodeTask()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  });
+
+  SwitchTiming timing;
+  uint32_t switchesBefore = statusCounter("transitions", "switches");
+  uint32_t droppedBefore = statusCounter("pacing", "dropped");
+  uint32_t gaplessBefore = statusCounter("transitions", "gapless");
+  uint32_t firstMs = 0;
+  for (uint32_t call = 0; call < PIPELINE_SWITCHES * 64; call++) {
+    panel.presentTask();
+    uint32_t switches = statusCounter("transitions", "switches") - switchesBefore;
+    if (switches == 1 && firstMs == 0) {
+      firstMs = millis();
+    } else if (switches > PIPELINE_SWITCHES) {
+      timing.finished = true;
+      timing.msPerGif = (double)(millis() - firstMs) / PIPELINE_SWITCHES;
+      break;
+    }
+  }
+  timing.dropped = statusCounter("pacing", "dropped") - droppedBefore;
+  timing.switches = statusCounter("transitions", "switches") - switchesBefore;
+  timing.gapless = statusCounter("transitions", "gapless") - gaplessBefore;
+
+  // Switching off releases a decoder waiting for a free slot; the ring is then drained
+  running = false;
+  panel.setPowerState(false);
+  decoder.join();
+  while (statusCounter("pipeline", "queued") > 0) {
+    panel.presentTask();
+  }
+  panel.setPowerState(true);
+  return timing;
+}
+
+/**
+ * @brief Print one pipeline playback and whether it was held as expected
+ *
+ * A switch is timed from the deadline the last frame was shown for, so held
+ * GIFs count the hold as switch latency; every other switch must be gapless.
+ *
+ * @param stills Every GIF played is a single frame, which must never be dropped
+ */
+void reportPipelined(const char *playing, const SwitchTiming &timing, bool held, bool stills) {
+  bool ok = timing.finished && (!stills || timing.dropped == 0) &&
+            (held || timing.gapless == timing.switches) &&
+            held == (timing.msPerGif >= DISPLAY_UPDATE_INTERVAL_MS - FRAME_LATE_TOLERANCE_MS);
+  char gapless[16];
+  snprintf(gapless, sizeof(gapless), "%u/%u", (unsigned)timing.gapless,
+           (unsigned)timing.switches);
+  printf("%-24s %10.0f %8u %9s %6s %9s\n", playing, timing.msPerGif, (unsigned)timing.dropped,
+         gapless, held ? "yes" : "no", !timing.finished ? "STALLED" : ok ? "ok" : "WRONG");
+}
+
+void benchPipelineHold() {
+  AnimatedGIFPanel &panel = AnimatedGIFPanel::getInstance();
+  if (!panel.isPipelineEnabled()) {
+    return;
+  }
+
+  SyntheticGif still;
+  still.frames = 1;
+  still.delayMs = 0;
+  still.pixel = [](uint16_t, uint16_t x, uint16_t y) { return (uint8_t)(x ^ y); };
+  SyntheticGif zeroDelay = still;
+  zeroDelay.frames = 4;
+  zeroDelay.pixel = [](uint16_t frame, uint16_t x, uint16_t y) {
+    return (uint8_t)(x + y + frame * 16);
+  };
+  SyntheticGif animated = zeroDelay;
+  animated.delayMs = 50;
+
+  printSection("Pipeline playback: stills and zero-delay GIFs held between GIFs");
+  printf("%-24s %10s %8s %9s %6s %9s\n", "playing", "ms/gif", "dropped", "gapless", "held",
+         "output");
+
+  // current.gif, replayed for as long as nothing else is selected
+  panel.setCategoryPlayback(false);
+  struct CurrentCase {
+    const char *name;
+    const SyntheticGif *spec;
+    bool held;
+  } cases[] = {{"still current.gif", &still, true},
+               {"zero-delay current.gif", &zeroDelay, true},
+               {"animated current.gif", &animated, false}};
+  for (const CurrentCase &current : cases) {
+    std::vector<uint8_t> data = encodeSyntheticGif(*current.spec);
+    if (!FSUtils::writeFile(FSType::SD, GIF_DEFAULT_PATH, data.data(), data.size())) {
+      continue;
+    }
+    reportPipelined(current.name, playPipelined(), current.held, current.spec->frames == 1);
+  }
+
+  // A category made only of stills, uploaded like the web interface does
+  std::vector<uint8_t> data = encodeSyntheticGif(still);
+  bool stored = true;
+  for (int i = 0; i < 3 && stored; i++) {
+    GIFUploadWriter upload;
+    String filename = "still-" + String(i) + ".gif";
+    stored = panel.beginUpload(upload, STILL_CATEGORY, filename) &&
+             upload.write(data.data(), data.size()) &&
+             panel.finishUpload(upload, STILL_CATEGORY);
+  }
+  if (stored && panel.setCategory(STILL_CATEGORY)) {
+    panel.setCategoryPlayback(true);
+    reportPipelined("category of stills", playPipelined(), true, true);
+    panel.setCategoryPlayback(false);
+  }
+}
+
+/**
+ * @brief Line of palette indices with a run of transparent pixels
+ */
+void indexedLine(std::vector<uint8_t> &line, int y) {
+  for (size_t x = 0; x < line.size(); x++) {
+    line[x] = (uint8_t)(x * 7 + y * 13);
+  }
+  for (size_t x = line.size() / 4; x < line.size() / 2; x++) {
+    line[x] = 0;
+  }
+}
+
+void benchPaletteLines() {
+  const int width = MAX_LINE_WIDTH;
+  const int height = 64;
+  const int frames = BENCH_FRAMES / 5;
+
+  uint16_t palette[256];
+  for (int i = 0; i < 256; i++) {
+    palette[i] = syntheticColor565((uint8_t)i);
+  }
+  std::vector<std::vector<uint8_t>> lines(height, std::vector<uint8_t>(width));
+  for (int y = 0; y < height; y++) {
+    indexedLine(lines[y], y);
+  }
+
+  // Gamma and a warmer white point, so the per-pixel path has work to do
+  ColorTransform transform;
+  ColorSettings settings;
+  settings.gamma = 2.2f;
+  settings.correction[2] = 200;
+  transform.configure(settings);
+
+  printSection("Palette lines: indexed GIF lines to color corrected RGB565");
+  printf("%-12s %-10s %12s %10s %9s\n", "content", "path", "Mpixel/s", "ns/pixel", "output");
+
+  // A row of four 64x64 panels, the second along the chain with its own gain
+  CanvasLayout layout;
+  layout.panelWidth = width / 4;
+  layout.panelHeight = height;
+  layout.panelsAcross = 4;
+  CanvasMapper mapper;
+  mapper.configure(layout);
+  CalibrationSettings calibrationSettings;
+  calibrationSettings.color = settings;
+  calibrationSettings.panelCount = 2;
+  const uint8_t gains[2][3] = {{255, 255, 255}, {230, 255, 210}};
+  memcpy(calibrationSettings.panelGain, gains, sizeof(gains));
+  ColorCalibration calibration;
+  calibration.configure(calibrationSettings, &mapper);
+
+  GIFCompositor reference;
+  GIFCompositor expanded;
+  GIFCompositor zonedReference;
+  GIFCompositor zoned;
+  reference.begin(width, height);
+  expanded.begin(width, height);
+  zonedReference.begin(width, height);
+  zoned.begin(width, height);
+
+  for (int16_t transparent : {-1, 0}) {
+    // Palette lookup, then correcting every pixel
+    Stopwatch perPixelTime;
+    uint16_t *canvas = reference.getCanvas();
+    for (int f = 0; f < frames; f++) {
+      for (int y = 0; y < height; y++) {
+        const uint8_t *indices = lines[y].data();
+        uint16_t *row = canvas + y * width;
+        for (int x = 0; x < width; x++) {
+          if (indices[x] != transparent) row[x] = transform.apply(palette[indices[x]]);
+        }
+      }
+    }
+    uint64_t perPixelUs = perPixelTime.elapsedUs();
+
+    // Corrected palette built once per frame, one table load per pixel
+    uint16_t output[256];
+    Stopwatch expandedTime;
+    for (int f = 0; f < frames; f++) {
+      transform.convertPalette(palette, output);
+      for (int y = 0; y < height; y++) {
+        expanded.drawIndexedLine(0, y, lines[y].data(), output, width, transparent);
+      }
+    }
+    uint64_t expandedUs = expandedTime.elapsedUs();
+
+    // A palette per calibration zone, switched where the line crosses panels
+    uint16_t zonePalettes[MAX_COLOR_ZONES * 256];
+    Stopwatch zonedTime;
+    for (int f = 0; f < frames; f++) {
+      calibration.convertPalette(palette, zonePalettes);
+      for (int y = 0; y < height; y++) {
+        for (int16_t x = 0; x < width;) {
+          int16_t runEnd;
+          const uint16_t *zonePalette = calibration.paletteAt(zonePalettes, x, y, runEnd);
+          int16_t length = min((int)runEnd, width) - x;
+          zoned.drawIndexedLine(x, y, lines[y].data() + x, zonePalette, length, transparent);
+          x += length;
+        }
+      }
+    }
+    uint64_t zonedUs = zonedTime.elapsedUs();
+
+    uint16_t *zonedCanvas = zonedReference.getCanvas();
+    for (int y = 0; y < height; y++) {
+      for (int16_t x = 0; x < width; x++) {
+        int16_t runEnd;
+        uint8_t zone = calibration.zoneAt(x, y, runEnd);
+        uint8_t index = lines[y][x];
+        if (index != transparent) zonedCanvas[y * width + x] = calibration.apply(palette[index], zone);
+      }
+    }
+
+    size_t canvasBytes = (size_t)width * height * sizeof(uint16_t);
+    bool same = memcmp(reference.getCanvas(), expanded.getCanvas(), canvasBytes) == 0;
+    bool zonedSame = memcmp(zonedReference.getCanvas(), zoned.getCanvas(), canvasBytes) == 0;
+    double pixels = (double)frames * width * height;
+    const char *content = transparent < 0 ? "opaque" : "transparent";
+    printf("%-12s %-10s %12.1f %10.2f %9s\n", content, "per-pixel",
+           pixels / (perPixelUs ? perPixelUs : 1), perPixelUs * 1000.0 / pixels, "");
+    printf("%-12s %-10s %12.1f %10.2f %9s\n", content, "expanded",
+           pixels / (expandedUs ? expandedUs : 1), expandedUs * 1000.0 / pixels,
+           same ? "same" : "DIFFERS");
+    printf("%-12s %-10s %12.1f %10.2f %9s\n", content, "zoned",
+           pixels / (zonedUs ? zonedUs : 1), zonedUs * 1000.0 / pixels,
+           zonedSame ? "same" : "DIFFERS");
+  }
+}
+
+void benchScaling(const std::vector<CorpusEntry> &corpus) {
+  AnimatedGIFPanel &panel = AnimatedGIFPanel::getInstance();
+  MatrixPanel_I2S_DMA *display = DisplayService::getInstance().getDisplay();
+  ScaleMode configured = panel.getScaleMode();
+  int repeat = benchRepeat();
+
+  printSection("Oversized GIFs: crop vs decode-time scaling");
+  printf("%-20s %9s %-8s %9s %9s %12s %14s\n", "gif", "size", "mode", "frames/s",
+         "us/frame", "source Mpx/s", "writes/frame");
+
+  const ScaleMode modes[] = {ScaleMode::CROP, ScaleMode::NEAREST, ScaleMode::BOX};
+  for (const CorpusEntry &entry : corpus) {
+    if (entry.width <= display->width() && entry.height <= display->height()) {
+      continue;
+    }
+
+    char size[16];
+    snprintf(size, sizeof(size), "%ux%u", entry.width, entry.height);
+    for (ScaleMode mode : modes) {
+      panel.setScaleMode(mode);
+      display->resetPixelWrites();
+      PlayResult play = playTimed(entry, repeat);
+      if (!play.ok) {
+        printf("%-20s %9s %-8s failed to play\n", entry.label.c_str(), size,
+               GIFScaler::getModeName(mode));
+        continue;
+      }
+
+      double sourcePixels = (double)play.frames * entry.width * entry.height;
+      printf("%-20s %9s %-8s %9.0f %9.1f %12.1f %14.0f\n", entry.label.c_str(), size,
+             GIFScaler::getModeName(mode), play.frames * 1e6 / (play.us ? play.us : 1),
+             play.frames ? (double)play.us / play.frames : 0.0,
+             play.us ? sourcePixels / play.us : 0.0,
+             play.frames ? (double)display->getPixelWrites() / play.frames : 0.0);
+    }
+  }
+  panel.setScaleMode(configured);
+}
+
+// =============================================================================
+// Upload Benchmarks
+// =============================================================================
+
+void benchValidate(const std::vector<CorpusEntry> &corpus) {
+  int repeat = benchRepeat() * 10;
+
+  printSection("Streaming upload validation (1436-byte chunks)");
+  printf("%-20s %9s %8s %7s %9s %5s %10s %8s %7s\n", "gif", "size", "bytes", "frames",
+         "duration", "lzw", "us/upload", "MB/s", "allocs");
+
+  for (const CorpusEntry &entry : corpus) {
+    std::vector<uint8_t> input(entry.bytes);
+    if (FSUtils::readFile(FSType::LITTLEFS, entry.path.c_str(), input.data(), input.size()) !=
+        input.size()) {
+      continue;
+    }
+
+    GIFValidator validator;
+    bool ok = true;
+    AllocCount allocsBefore = AllocCounter::snapshot();
+    Stopwatch time;
+    for (int r = 0; r < repeat && ok; r++) {
+      validator.begin();
+      for (size_t offset = 0; offset < input.size() && ok; offset += UPLOAD_CHUNK_BYTES) {
+        ok = validator.feed(&input[offset], min(UPLOAD_CHUNK_BYTES, input.size() - offset));
+      }
+      ok = ok && validator.finish();
+    }
+    uint64_t us = time.elapsedUs();
+    AllocCount allocs = AllocCounter::snapshot() - allocsBefore;
+    if (!ok) {
+      printf("%-20s rejected: %s\n", entry.label.c_str(), validator.getError());
+      continue;
+    }
+
+    const GIFInfo &info = validator.getInfo();
+    char size[16];
+    snprintf(size, sizeof(size), "%ux%u", info.width, info.height);
+    printf("%-20s %9s %8u %7u %7ums %5u %10.1f %8.0f %7u\n", entry.label.c_str(), size,
+           (unsigned)entry.bytes, (unsigned)info.frames, (unsigned)info.durationMs,
+           info.maxCodeSize, (double)us / repeat,
+           us ? (double)entry.bytes * repeat / us : 0.0, (unsigned)allocs.allocations);
+  }
+}
+
+void benchUpload(const std::vector<CorpusEntry> &corpus) {
+  MatrixPanel_I2S_DMA *display = DisplayService::getInstance().getDisplay();
+  FSUtils::createDir(FSType::SD, UPLOAD_DIR);
+
+  printSection("Streaming upload to SD (1436-byte chunks)");
+  printf("%-20s %9s %8s %8s %10s %8s %10s %12s\n", "gif", "size", "bytes", "stored",
+         "transcoded", "KB/s", "peak heap", "buffered old");
+
+  for (const CorpusEntry &entry : corpus) {
+    std::vector<uint8_t> input(entry.bytes);
+    if (FSUtils::readFile(FSType::LITTLEFS, entry.path.c_str(), input.data(), input.size()) !=
+        input.size()) {
+      continue;
+    }
+
+    GIFUploadWriter upload;
+    String path = String(UPLOAD_DIR) + "/" + entry.label;
+    bool ok = upload.begin(SD, path, display->width(), display->height());
+    for (size_t offset = 0; offset < input.size() && ok; offset += UPLOAD_CHUNK_BYTES) {
+      ok = upload.write(&input[offset], min(UPLOAD_CHUNK_BYTES, input.size() - offset));
+    }
+    ok = ok && upload.finish();
+    if (!ok) {
+      printf("%-20s rejected: %s\n", entry.label.c_str(), upload.getError());
+      continue;
+    }
+
+    // The old path read the whole temp file into one heap buffer
+    const UploadStats &stats = upload.getStats();
+    char size[16];
+    snprintf(size, sizeof(size), "%ux%u", entry.width, entry.height);
+    printf("%-20s %9s %8u %8u %10s %8.0f %9.1fK %11.1fK\n", entry.label.c_str(), size,
+           (unsigned)stats.bytes, (unsigned)stats.storedBytes, stats.transcoded ? "yes" : "no",
+           stats.kbPerSecond(), stats.peakHeapBytes / 1024.0, entry.bytes / 1024.0);
+    SD.remove(path);
+  }
+}
+
+// =============================================================================
+// Transcode Benchmark
+// =============================================================================
+
+void benchTranscode(const std::vector<CorpusEntry> &corpus) {
+  MatrixPanel_I2S_DMA *display = DisplayService::getInstance().getDisplay();
+  int repeat = benchRepeat();
+
+  printSection("Transcoding to panel resolution (box filter, 6x7x6 palette)");
+  printf("%-20s %9s %9s %8s %8s %7s %7s %12s %11s %9s\n", "gif", "size", "out size", "bytes",
+         "out", "ratio", "frames", "ms/transcode", "decode us/f", "output");
+
+  for (const CorpusEntry &entry : corpus) {
+    std::vector<uint8_t> input(entry.bytes);
+    if (FSUtils::readFile(FSType::LITTLEFS, entry.path.c_str(), input.data(), input.size()) !=
+        input.size()) {
+      continue;
+    }
+
+    GIFTranscoder transcoder;
+    std::vector<uint8_t> output;
+    bool ok = true;
+    Stopwatch time;
+    for (int r = 0; r < repeat && ok; r++) {
+      ok = transcoder.transcode(input.data(), input.size(), output, display->width(),
+                                display->height());
+    }
+    uint64_t us = time.elapsedUs();
+    if (!ok) {
+      printf("%-20s failed to transcode\n", entry.label.c_str());
+      continue;
+    }
+
+    const TranscodeStats &stats = transcoder.getStats();
+    bool scaled = stats.width != stats.sourceWidth || stats.height != stats.sourceHeight;
+
+    // The last frame of the original as playback shows it
+    std::vector<uint16_t> original;
+    if (!scaled && playTimed(entry, 1).ok) {
+      for (int y = 0; y < stats.height; y++) {
+        for (int x = 0; x < stats.width; x++) {
+          original.push_back(display->getPixel(x, y));
+        }
+      }
+    }
+
+    // Play the result to compare its decode cost and last frame with the original's
+    std::vector<CorpusEntry> transcoded;
+    PlayResult play;
+    if (installCorpusFile("transcoded-" + entry.label, output, transcoded)) {
+      play = playTimed(transcoded.back(), repeat);
+    }
+
+    const char *result = "-";
+    if (!original.empty()) {
+      bool same = play.ok;
+      for (int y = 0; y < stats.height && same; y++) {
+        for (int x = 0; x < stats.width && same; x++) {
+          same = transcoder.quantize(display->getPixel(x, y)) ==
+                 transcoder.quantize(original[y * stats.width + x]);
+        }
+      }
+      result = same ? "same" : "DIFFERS";
+    }
+
+    char size[16], outSize[16];
+    snprintf(size, sizeof(size), "%ux%u", stats.sourceWidth, stats.sourceHeight);
+    snprintf(outSize, sizeof(outSize), "%ux%u", stats.width, stats.height);
+    printf("%-20s %9s %9s %8u %8u %6.2fx %7u %12.1f %11.1f %9s\n", entry.label.c_str(), size,
+           outSize, (unsigned)stats.inputBytes, (unsigned)stats.outputBytes,
+           stats.inputBytes ? (double)stats.outputBytes / stats.inputBytes : 0.0,
+           (unsigned)stats.frames, us / 1000.0 / repeat,
+           play.ok && play.frames ? (double)play.us / play.frames : 0.0, result);
+  }
+}
+
+/**
+ * @brief Transcode the disposal GIFs, play the result and compare its last frame
+ *
+ * The transcoder writes every frame as a change over the previous one, so
+ * the output is only right if it composed method 2 and 3 frames the way the
+ * GIF specification does. Colors are compared after quantizing both sides.
+ */
+void benchTranscodeDisposal() {
+  MatrixPanel_I2S_DMA *display = DisplayService::getInstance().getDisplay();
+
+  printSection("Transcoding disposal: played output against the GIF specification");
+  printf("%-20s %8s %8s %7s %9s\n", "gif", "disposal", "bytes", "frames", "output");
+
+  for (const SyntheticGif &spec : syntheticCorpus()) {
+    if (spec.disposal < 2 || spec.width > display->width() || spec.height > display->height()) {
+      continue;
+    }
+
+    std::vector<uint8_t> input = encodeSyntheticGif(spec);
+    GIFTranscoder transcoder;
+    std::vector<uint8_t> output;
+    std::vector<CorpusEntry> transcoded;
+    PlayResult play;
+    if (transcoder.transcode(input.data(), input.size(), output, display->width(),
+                             display->height()) &&
+        installCorpusFile("roundtrip-" + String(spec.name), output, transcoded)) {
+      play = playTimed(transcoded.back(), 1);
+    }
+
+    std::vector<uint16_t> expected = referenceLastFrame(spec);
+    bool same = play.ok;
+    for (int y = 0; y < spec.height && same; y++) {
+      for (int x = 0; x < spec.width && same; x++) {
+        same = transcoder.quantize(display->getPixel(x, y)) ==
+               transcoder.quantize(expected[y * spec.width + x]);
+      }
+    }
+
+    printf("%-20s %8u %8u %7u %9s\n", spec.name.c_str(), spec.disposal,
+           (unsigned)output.size(), (unsigned)transcoder.getStats().frames,
+           same ? "same" : "DIFFERS");
+  }
+}
+
+// =============================================================================
+// Category Index Benchmark
+// =============================================================================
+
+/**
+ * @brief Boot-time category scan as done before the index: open every entry
+ * @return Number of GIFs found
+ */
+size_t legacyScanCategories(const char *basePath) {
+  size_t found = 0;
+  File root = SD.open(basePath);
+  File dir = root.openNextFile();
+  while (dir) {
+    if (dir.isDirectory()) {
+      std::vector<String> files;
+      File gifFile = dir.openNextFile();
+      while (gifFile) {
+        if (!gifFile.isDirectory() && AnimatedGIFPanel::isGifFile(gifFile.name())) {
+          files.push_back(gifFile.name());
+        }
+        gifFile = dir.openNextFile();
+      }
+      found += files.size();
+    }
+    dir = root.openNextFile();
+  }
+  return found;
+}
+
+void reportIndex(const char *step, uint64_t us, size_t gifs, const AllocCount &allocs) {
+  printf("%-28s %10.1f %8u %8u %10u\n", step, us / 1000.0, (unsigned)gifs,
+         (unsigned)allocs.allocations, (unsigned)allocs.bytes);
+}
+
+void benchIndex() {
+  int gifs = atoi(envOr("BENCH_LIBRARY", "2000"));
+  SyntheticGif spec;
+  spec.width = 32;
+  spec.height = 32;
+  spec.frames = 4;
+  spec.pixel = [](uint16_t frame, uint16_t x, uint16_t y) {
+    return (uint8_t)((x + y + frame) & 7);
+  };
+  std::vector<uint8_t> data = encodeSyntheticGif(spec);
+
+  FSUtils::createDir(FSType::SD, LIBRARY_DIR);
+  for (int c = 0; c < LIBRARY_CATEGORIES; c++) {
+    String dir = String(LIBRARY_DIR) + "/category-" + String(c);
+    FSUtils::createDir(FSType::SD, dir.c_str());
+    for (int i = c; i < gifs; i += LIBRARY_CATEGORIES) {
+      String path = dir + "/gif-" + String(i) + ".gif";
+      if (!SD.exists(path)) {
+        FSUtils::writeFile(FSType::SD, path.c_str(), data.data(), data.size());
+      }
+    }
+  }
+  String indexPath = String(LIBRARY_DIR) + "/.index.bin";
+
+  char title[96];
+  snprintf(title, sizeof(title), "Category index (%d GIFs in %d categories on SD)", gifs,
+           LIBRARY_CATEGORIES);
+  printSection(title);
+  printf("%-28s %10s %8s %8s %10s\n", "step", "ms", "gifs", "allocs", "alloc bytes");
+
+  AllocCount before = AllocCounter::snapshot();
+  Stopwatch time;
+  size_t found = legacyScanCategories(LIBRARY_DIR);
+  reportIndex("directory walk (old boot)", time.elapsedUs(), found,
+              AllocCounter::snapshot() - before);
+
+  GIFCategoryIndex built;
+  before = AllocCounter::snapshot();
+  time.restart();
+  built.scan(SD, LIBRARY_DIR);
+  reportIndex("full build (parse all)", time.elapsedUs(), built.getGifCount(),
+              AllocCounter::snapshot() - before);
+
+  before = AllocCounter::snapshot();
+  time.restart();
+  built.save(SD, indexPath.c_str());
+  reportIndex("save", time.elapsedUs(), built.getGifCount(), AllocCounter::snapshot() - before);
+
+  GIFCategoryIndex loaded;
+  before = AllocCounter::snapshot();
+  time.restart();
+  loaded.load(SD, indexPath.c_str());
+  reportIndex("load (new boot)", time.elapsedUs(), loaded.getGifCount(),
+              AllocCounter::snapshot() - before);
+
+  GIFCategoryIndex validated;
+  before = AllocCounter::snapshot();
+  time.restart();
+  validated.scan(SD, LIBRARY_DIR, &loaded);
+  reportIndex("background check", time.elapsedUs(), validated.getGifCount(),
+              AllocCounter::snapshot() - before);
+
+  File index = SD.open(indexPath);
+  printf("index file %u bytes, %u GIFs parsed by the check, unchanged %s\n",
+         (unsigned)index.size(), (unsigned)validated.getScanStats().parsed,
+         validated.matches(loaded) ? "yes" : "no");
+  index.close();
+}
+
+/**
+ * @struct LegacyCategory
+ * @brief Category as held before GIFCategoryList: one String per filename
+ */
+struct LegacyCategory {
+  String name;
+  std::vector<String> files;
+  size_t currentIndex = 0;
+};
+
+/**
+ * @brief Heap bytes held by a String, nothing if it fits the inline buffer
+ */
+size_t stringHeapBytes(const String &value) {
+  const char *data = value.c_str();
+  const char *object = reinterpret_cast<const char *>(&value);
+  bool inBuffer = data >= object && data < object + sizeof(String);
+  return inBuffer ? 0 : value.length() + 1;
+}
+
+size_t legacyHeldBytes(const std::vector<LegacyCategory> &legacy) {
+  size_t bytes = legacy.capacity() * sizeof(LegacyCategory);
+  for (const LegacyCategory &category : legacy) {
+    bytes += stringHeapBytes(category.name) + category.files.capacity() * sizeof(String);
+    for (const String &file : category.files) {
+      bytes += stringHeapBytes(file);
+    }
+  }
+  return bytes;
+}
+
+void reportList(const char *layout, const AllocCount &build, size_t heldBytes,
+                const AllocCount &steps) {
+  printf("%-22s %8u %10.1fK %10.1fK %12.2f\n", layout, (unsigned)build.allocations,
+         build.bytes / 1024.0, heldBytes / 1024.0, (double)steps.allocations / LIBRARY_STEPS);
+}
+
+void benchCategoryList() {
+  int gifs = atoi(envOr("BENCH_LIBRARY", "2000"));
+  char name[64];
+
+  char title[96];
+  snprintf(title, sizeof(title), "Category lists (%d GIFs in %d categories)", gifs,
+           LIBRARY_CATEGORIES);
+  printSection(title);
+  printf("%-22s %8s %11s %11s %12s\n", "layout", "allocs", "alloc bytes", "held",
+         "allocs/step");
+
+  // Names longer than the host String's inline buffer, like real uploads
+  AllocCount before = AllocCounter::snapshot();
+  std::vector<LegacyCategory> legacy;
+  for (int c = 0; c < LIBRARY_CATEGORIES; c++) {
+    LegacyCategory category;
+    snprintf(name, sizeof(name), "category-%02d", c);
+    category.name = name;
+    for (int i = c; i < gifs; i += LIBRARY_CATEGORIES) {
+      snprintf(name, sizeof(name), "animation-%05d-loop.gif", i);
+      category.files.push_back(name);
+    }
+    legacy.push_back(category);
+  }
+  AllocCount legacyBuild = AllocCounter::snapshot() - before;
+
+  // Old hot path: filename returned by value, path joined by FSUtils::buildPath()
+  before = AllocCounter::snapshot();
+  for (int step = 0; step < LIBRARY_STEPS; step++) {
+    LegacyCategory &category = legacy[step % LIBRARY_CATEGORIES];
+    category.currentIndex = (category.currentIndex + 1) % category.files.size();
+    String file = category.files[category.currentIndex];
+    String path = FSUtils::buildPath(GIFS_BASE_PATH, category.name.c_str(), file.c_str(), nullptr);
+    consume(path.length());
+  }
+  AllocCount legacySteps = AllocCounter::snapshot() - before;
+  reportList("String per file", legacyBuild, legacyHeldBytes(legacy), legacySteps);
+
+  before = AllocCounter::snapshot();
+  GIFCategoryList list;
+  for (int c = 0; c < LIBRARY_CATEGORIES; c++) {
+    snprintf(name, sizeof(name), "category-%02d", c);
+    size_t category = list.addCategory(name);
+    for (int i = c; i < gifs; i += LIBRARY_CATEGORIES) {
+      snprintf(name, sizeof(name), "animation-%05d-loop.gif", i);
+      list.addFile(category, name);
+    }
+  }
+  AllocCount listBuild = AllocCounter::snapshot() - before;
+
+  // New hot path: both strings keep their capacity from one GIF to the next
+  std::vector<uint32_t> positions(list.size(), 0);
+  String file;
+  String path;
+  before = AllocCounter::snapshot();
+  for (int step = 0; step < LIBRARY_STEPS; step++) {
+    size_t category = step % LIBRARY_CATEGORIES;
+    positions[category] = (positions[category] + 1) % list.getFileCount(category);
+    file = list.getFile(category, positions[category]);
+    path = GIFS_BASE_PATH;
+    path += '/';
+    path += list.getName(category);
+    path += '/';
+    path += file;
+    consume(path.length());
+  }
+  AllocCount listSteps = AllocCounter::snapshot() - before;
+  reportList("GIFCategoryList", listBuild, list.getMemoryBytes(), listSteps);
+}
+
+} // namespace
+
+int main() {
+  if (!setupEnvironment()) {
+    return 1;
+  }
+  std::vector<CorpusEntry> corpus = installCorpus();
+
+  printf("Native benchmarks: panel %dx%d, PSRAM %s, allocation counting %s\n",
+         DisplayService::getInstance().getDisplay()->width(),
+         DisplayService::getInstance().getDisplay()->height(),
+         psramFound() ? "on" : "off", AllocCounter::isSupported() ? "on" : "off");
+
+  benchBlit();
+  benchCanvas();
+  benchDirty();
+  benchPlasma();
+  benchConfig();
+  benchFSUtils();
+  benchGifs(corpus);
+  benchDisposal(corpus);
+  benchPipelineHold();
+  benchPaletteLines();
+  benchScaling(corpus);
+  benchValidate(corpus);
+  benchUpload(corpus);
+  benchTranscode(corpus);
+  benchTranscodeDisposal();
+  benchIndex();
+  benchCategoryList();
+  return 0;
+}
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include "ConfigManager.h"
+#include "GIFMemory.h"
+#include "GIFTranscoder.h"
 #include "Logger.h"
 
 // Static instance
@@ -55,17 +57,47 @@ bool AnimatedGIFPanel::initialize() {
 
    gif.begin(LITTLE_ENDIAN_PIXELS);
 
+   // Frames are composed on a canvas the size of the panel and copied out from there
+   canvasWidth = displayService.getBlitter().width();
+   canvasHeight = displayService.getBlitter().height();
+   if (!compositor.begin(canvasWidth, canvasHeight)) {
+     return false;
+   }
+   loadPlaybackConfig();
+
+   if (pipelineDepth >= 2 && !pipeline.begin(pipelineDepth, canvasWidth, canvasHeight)) {
+     LOG_WARNING("AnimatedGIFPanel: Frame pipeline unavailable, decoding on the display task");
+   }
+
   // Initialize SD card using FSUtils if not already done
   if (!FSUtils::begin(FSType::SD)) {
     LOG_ERROR("Failed to initialize SD card");
     return false;
   }
 
-  // Scan for categories
-  if (!scanCategories()) {
+  // The index lists every category in one read; walk the card only without one
+  if (!loadCategoryIndex() && !scanCategories()) {
     LOG_ERROR("Failed to scan categories");
     return false;
   }
+  // Shuffles resume where they stopped if their category did not change
+  playlist.rebuild(categories);
+  size_t restored = playlist.load(fs, categories);
+  LOG_INFO("AnimatedGIFPanel: Restored %u of %u playlist decks", (unsigned)restored,
+           (unsigned)categories.size());
+
+  // Frequently played GIFs are read from copies in flash
+  if (FSUtils::isInitialized(FSType::LITTLEFS)) {
+    size_t staged = staging.begin(FSUtils::getFS(FSType::LITTLEFS), fs);
+    if (staging.isEnabled()) {
+      LOG_INFO("AnimatedGIFPanel: %u GIFs staged in flash, budget %u bytes", (unsigned)staged,
+               (unsigned)staging.getBudget());
+    }
+  }
+
+  // The index task checks the loaded categories against the card after boot
+  requestRescan();
+
   // Load last state from file
   loadStateFromFile();
 
@@ -97,6 +129,64 @@ bool AnimatedGIFPanel::loadStateFromFile() {
     return true;
 }
 
+/**
+ * @brief Apply playback tuning from the "playback" section of the configuration
+ */
+void AnimatedGIFPanel::loadPlaybackConfig() {
+    JsonDocument& configDoc = ConfigManager::getInstance().getConfig();
+    JsonVariant playback = configDoc[PLAYBACK];
+
+    size_t defaultCacheBytes = psramFound() ? DEFAULT_FRAME_CACHE_PSRAM_BYTES
+                                            : DEFAULT_FRAME_CACHE_BYTES;
+    frameCache.setBudget(playback[FRAME_CACHE_BYTES] | defaultCacheBytes);
+
+    readAheadBytes = playback[READ_AHEAD_BYTES] | (size_t)DEFAULT_READ_AHEAD_BYTES;
+    if (readAheadBytes < MIN_READ_AHEAD_BYTES) readAheadBytes = MIN_READ_AHEAD_BYTES;
+
+    size_t defaultMemoryBytes = psramFound() ? DEFAULT_MEMORY_PLAYBACK_PSRAM_BYTES
+                                             : DEFAULT_MEMORY_PLAYBACK_BYTES;
+    memoryPlaybackBytes = playback[MEMORY_PLAYBACK_BYTES] | defaultMemoryBytes;
+
+    pipelineDepth = playback[PIPELINE_DEPTH] | DEFAULT_PIPELINE_DEPTH;
+
+    const char *scaleName = playback[SCALE_MODE] | DEFAULT_SCALE_MODE;
+    ScaleMode scaleMode = ScaleMode::NEAREST;
+    if (!GIFScaler::parseMode(scaleName, scaleMode)) {
+      LOG_WARNING("AnimatedGIFPanel: Unknown scale mode '%s', using %s", scaleName,
+                  GIFScaler::getModeName(scaleMode));
+    }
+    scaler.setMode(scaleMode);
+
+    targetPlayTimeMs = playback[TARGET_PLAY_TIME_MS] | (uint32_t)MAX_GIF_PLAY_TIME;
+    maxPlayTimeMs = playback[MAX_PLAY_TIME_MS] | (uint32_t)DEFAULT_MAX_PLAY_TIME_MS;
+    playlist.configure(playback[PLAYLISTS]);
+    SpanBlitter &blitter = DisplayService::getInstance().getBlitter();
+    blitter.setTracking(playback[DIRTY_TRACKING] | true);
+    staging.configure(playback[STAGING_CACHE_BYTES] | (size_t)DEFAULT_STAGING_CACHE_BYTES,
+                      playback[STAGING_WRITE_BYTES_PER_HOUR] |
+                          (uint32_t)DEFAULT_STAGING_WRITE_BYTES_PER_HOUR);
+
+    LOG_INFO("AnimatedGIFPanel: Frame cache budget %u bytes, read-ahead %u bytes, memory playback up to %u bytes, pipeline depth %u, scale mode %s, play time %u ms (at most %u ms), dirty tracking %s",
+             (unsigned)frameCache.getBudget(), (unsigned)readAheadBytes,
+             (unsigned)memoryPlaybackBytes, pipelineDepth,
+             GIFScaler::getModeName(scaleMode), (unsigned)targetPlayTimeMs,
+             (unsigned)maxPlayTimeMs, blitter.isTracking() ? "on" : "off");
+}
+
+/**
+ * @brief Choose how GIFs larger than the panel are fitted to it
+ *
+ * Cached and prepared frames were produced with the previous mode, so they
+ * are dropped before the next GIF.
+ *
+ * @param mode Scale mode
+ */
+void AnimatedGIFPanel::setScaleMode(ScaleMode mode) {
+    if (scaler.getMode() == mode) return;
+    scaler.setMode(mode);
+    categoryChanged = true;
+}
+
 /**
  * @brief Update state in ConfigManager when values are modified
  */
@@ -119,7 +209,7 @@ void AnimatedGIFPanel::updateState() {
  */
 void AnimatedGIFPanel::stop() {
    // Reset state
-   gif.close();
+   closeGif();
    currentGifFile = "";
    currentCategoryIndex = 0;
    categoryPlayback = false;
@@ -129,18 +219,153 @@ void AnimatedGIFPanel::stop() {
 // =============================================================================
 // Playback Task for Current or Category GIF
 // =============================================================================
- void AnimatedGIFPanel::playbackTask() {
-   String gifPath = String(GIF_DEFAULT_PATH);
+/**
+ * @brief Play the next GIF and prepare the one after it
+ *
+ * GIFs are chained back to back: while the last frame of one GIF is on
+ * screen the next is opened and its first frame decoded, so it replaces
+ * the last frame on its deadline.
+ *
+ * @return true if a GIF was played, false if there was nothing to do
+ */
+bool AnimatedGIFPanel::playbackTask() {
+  if (!powerOn) {
+    discardNext();
+    scheduler.reset();
+    switchPending = false;
+    return false;
+  }
+
+  if (categoryChanged) {
+    // The prepared GIF belongs to the previous category
+    discardNext();
+  }
+
+  // ShowGIF() clears nextPath, so the path is copied into a buffer that keeps its capacity
+  if (nextPath.length() > 0) {
+    playingPath = nextPath;
+    playPlan = nextPlan;
+  } else {
+    playingPath = nextPlaybackPath();
+    playPlan = pickedPlan;
+  }
+  uint32_t dueMs = scheduler.isAnchored() ? scheduler.getDeadline() : millis();
+
+  if (!ShowGIF(playingPath)) {
+    LOG_ERROR("AnimatedGIFPanel: Failed to display GIF");
+    scheduler.reset();
+    switchPending = false;
+    return false;
+  }
+  if (!powerOn) {
+    // Switched off mid-GIF; nothing is prepared until it is switched on again
+    return true;
+  }
+
+  // The switch is measured against the GIF's own timing, before any hold
+  markGifEnd();
+  if (holdLastFrame) {
+    holdAfterGif(dueMs);
+  }
+  prepareNext();
+  return true;
+}
+
+/**
+ * @brief Pick the GIF to play next and apply deferred cache maintenance
+ *
+ * The path is assembled in place in playbackPath instead of with
+ * FSUtils::buildPath(), so picking a GIF does not allocate.
+ *
+ * @return Path of the next GIF, valid until the next call
+ */
+const String &AnimatedGIFPanel::nextPlaybackPath() {
+   // Categories rebuilt by the index task are swapped in between GIFs
+   applyPendingCategories();
+   applyPendingSelection();
+
+   // Only the playback task touches cached frames, so a category change from
+   // the web task is applied here between GIFs
+   if (categoryChanged) {
+     categoryChanged = false;
+     frameCache.clear();
+   }
 
-   if (isCategoryPlayback()) {
-     gifPath = FSUtils::buildPath(GIFS_BASE_PATH, getCurrentCategory().c_str(), getNextGif().c_str(), nullptr);
+   // Uploads, deletions and rescans mark the GIFs whose cached frames are out of date
+   dropStaleFrames();
+
+   // Cached frames hold the colors of the calibration they were decoded with
+   uint32_t calibrationVersion = DisplayService::getInstance().getCalibration().getVersion();
+   if (calibrationVersion != cacheCalibrationVersion) {
+     cacheCalibrationVersion = calibrationVersion;
+     frameCache.clear();
+   }
+
+   // Deck positions are written now and then, so a reboot repeats at most a few GIFs
+   if (playlist.isDirty() && millis() - playlistSavedMs >= PLAYLIST_SAVE_INTERVAL_MS) {
+     playlistSavedMs = millis();
+     std::lock_guard<std::mutex> lock(indexMutex);
+     playlist.save(fs, categories);
+   }
+
+   pickedPlayTimeMs = targetPlayTimeMs;
+   pickedPlan = PlayPlan();
+   if (!isCategoryPlayback()) {
+     playbackPath = GIF_DEFAULT_PATH;
+     return playbackPath;
    }
 
-   if (!ShowGIF(gifPath)) {
-     LOG_ERROR("AnimatedGIFPanel: Failed to display GIF");
+   const String &file = getNextGif();
+   playbackPath = GIFS_BASE_PATH;
+   if (file.length() > 0) {
+     playbackPath += '/';
+     playbackPath += categories.getName(currentCategoryIndex);
+     playbackPath += '/';
+     playbackPath += file;
+     pickedPlan = planPlayback(categories.getName(currentCategoryIndex), file.c_str(),
+                               pickedPlayTimeMs);
    }
+   return playbackPath;
  }
 
+/**
+ * @brief Work out how many loops of a GIF to play
+ *
+ * GIFs play as many whole loops as fit in the target time, at least one,
+ * so they always end on their last frame. A loop longer than the target
+ * plays once in full, up to maxPlayTimeMs. GIFs without a known loop
+ * length, and single frames, are cut at the target time.
+ *
+ * @param category Category name
+ * @param filename GIF filename
+ * @param targetMs Play time to aim for
+ * @return Loops and time limit for the GIF
+ */
+PlayPlan AnimatedGIFPanel::planPlayback(const char *category, const char *filename,
+                                        uint32_t targetMs) {
+  PlayPlan plan;
+  uint32_t loopMs = 0;
+  {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    const GIFMetadata *metadata = categoryIndex.find(category, filename);
+    if (metadata) {
+      // Lets the frame cache tell up front whether the whole GIF fits
+      plan.frames = metadata->frames;
+    }
+    if (metadata && metadata->frames > 1) {
+      loopMs = metadata->durationMs;
+    }
+  }
+
+  if (loopMs == 0) {
+    plan.limitMs = targetMs;
+    return plan;
+  }
+  plan.loops = min(max(targetMs / loopMs, (uint32_t)1), (uint32_t)UINT16_MAX);
+  plan.limitMs = max(targetMs, maxPlayTimeMs);
+  return plan;
+}
+
 // =============================================================================
 // Playback Control Implementation
 // =============================================================================
@@ -185,7 +410,8 @@ bool AnimatedGIFPanel::scanCategories() {
       String catName = file.name();
       if (!catName.startsWith(".")) {  // skip hidden dirs
         String categoryPath = "/" + gifsPath + "/" + catName;
-        GifCategory category(catName);
+        // Only categories with GIFs are listed, so one is added on its first GIF
+        size_t category = GIFCategoryList::NOT_FOUND;
 
         File categoryDir = FSUtils::getFS(FSType::SD).open(categoryPath);
         if (categoryDir) {
@@ -194,7 +420,10 @@ bool AnimatedGIFPanel::scanCategories() {
             if (!gifFile.isDirectory()) {
               String fname = gifFile.name();
               if (AnimatedGIFPanel::isGifFile(fname)) {
-                category.files.push_back(fname);
+                if (category == GIFCategoryList::NOT_FOUND) {
+                  category = categories.addCategory(catName.c_str());
+                }
+                categories.addFile(category, fname.c_str());
               }
             }
             gifFile = categoryDir.openNextFile();
@@ -203,10 +432,6 @@ bool AnimatedGIFPanel::scanCategories() {
         } else {
           LOG_ERROR("Failed to open category directory: %s", categoryPath.c_str());
         }
-
-        if (!category.files.empty()) {
-          categories.push_back(category);
-        }
       }
     }
     file = root.openNextFile();
@@ -217,25 +442,467 @@ bool AnimatedGIFPanel::scanCategories() {
 }
 
 
+/**
+ * @brief Load the categories from the index file
+ * @return true if the index was loaded; false if the card must be scanned
+ */
+bool AnimatedGIFPanel::loadCategoryIndex() {
+  std::lock_guard<std::mutex> lock(indexMutex);
+  uint32_t startMs = millis();
+
+  if (!categoryIndex.load(fs)) {
+    LOG_INFO("AnimatedGIFPanel: No usable category index, scanning %s", GIFS_BASE_PATH);
+    return false;
+  }
+  buildCategories(categoryIndex, categories);
+  indexComplete = true;
+
+  LOG_INFO("AnimatedGIFPanel: Loaded %u GIFs in %u categories from the index in %u ms",
+           (unsigned)categoryIndex.getGifCount(), (unsigned)categories.size(),
+           (unsigned)(millis() - startMs));
+  return true;
+}
+
+/**
+ * @brief Queue a rescan of the card
+ * @return Id of the job that will pick up the request
+ */
+uint32_t AnimatedGIFPanel::requestRescan() {
+  std::lock_guard<std::mutex> lock(indexMutex);
+  if (rescanJob.state == RescanState::QUEUED) {
+    return rescanJob.id;
+  }
+  if (rescanJob.state == RescanState::RUNNING) {
+    if (queuedRescanId == 0) {
+      queuedRescanId = ++lastRescanId;
+      rescanRequested.notify_one();
+    }
+    return queuedRescanId;
+  }
+
+  rescanJob = RescanJob();
+  rescanJob.id = ++lastRescanId;
+  rescanJob.state = RescanState::QUEUED;
+  rescanRequested.notify_one();
+  return rescanJob.id;
+}
+
+/**
+ * @brief Wait for a queued rescan and start it (index task)
+ */
+void AnimatedGIFPanel::waitForRescan() {
+  std::unique_lock<std::mutex> lock(indexMutex);
+  rescanRequested.wait(lock, [this] {
+    return rescanJob.state == RescanState::QUEUED || queuedRescanId != 0;
+  });
+
+  if (rescanJob.state != RescanState::QUEUED) {
+    rescanJob = RescanJob();
+    rescanJob.id = queuedRescanId;
+  }
+  queuedRescanId = 0;
+  rescanJob.state = RescanState::RUNNING;
+  rescanJob.startedMs = millis();
+}
+
+/**
+ * @brief Describe a rescan job
+ * @param jobId Job to describe, 0 for the latest
+ * @return JSON with the job id, state and progress counters, or "{}" if the
+ *         job is no longer tracked
+ */
+String AnimatedGIFPanel::getRescanJson(uint32_t jobId) const {
+  JsonDocument doc;
+  {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    if (jobId == 0) {
+      jobId = queuedRescanId != 0 ? queuedRescanId : rescanJob.id;
+    }
+
+    if (jobId == queuedRescanId && jobId != 0) {
+      // Waiting behind the running job, which is reported alongside
+      doc["job_id"] = jobId;
+      doc["state"] = getRescanStateName(RescanState::QUEUED);
+      doc["progress"] = 0;
+      doc["running_job_id"] = rescanJob.id;
+    } else if (jobId == rescanJob.id) {
+      const RescanJob &job = rescanJob;
+      uint32_t files = job.progress.files;
+
+      doc["job_id"] = job.id;
+      doc["state"] = getRescanStateName(job.state);
+      doc["directories"] = job.progress.directories;
+      doc["files"] = files;
+      doc["parsed"] = job.progress.parsed;
+      doc["expected_files"] = job.expectedFiles;
+
+      // The previous GIF count is only an estimate, so a running job stays below 100
+      uint32_t percent = 0;
+      if (job.state == RescanState::DONE) {
+        percent = 100;
+      } else if (job.state == RescanState::RUNNING && job.expectedFiles > 0) {
+        uint64_t scaled = files * 100ULL / job.expectedFiles;
+        percent = scaled < 99 ? scaled : 99;
+      }
+      doc["progress"] = percent;
+
+      if (job.state == RescanState::RUNNING) {
+        doc["elapsed_ms"] = millis() - job.startedMs;
+      } else if (job.state == RescanState::DONE || job.state == RescanState::FAILED) {
+        doc["elapsed_ms"] = job.finishedMs - job.startedMs;
+        doc["changed"] = job.changed;
+      }
+    } else {
+      return "{}";
+    }
+  }
+
+  String output;
+  serializeJson(doc, output);
+  return output;
+}
+
+/**
+ * @brief Check the category index against the card (index task)
+ *
+ * Runs the job started by waitForRescan(). The scan builds a new index off
+ * to the side; the playback categories are only replaced between GIFs.
+ *
+ * @return false if GIFs changed during the check and it should be repeated
+ */
+bool AnimatedGIFPanel::maintainIndex() {
+  GIFCategoryIndex previous;
+  uint32_t generation;
+  {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    previous = categoryIndex;
+    generation = indexGeneration;
+    rescanJob.expectedFiles = previous.getGifCount();
+    rescanJob.progress = IndexScanProgress();
+  }
+
+  // The scan reads the card for seconds, so it runs without the lock and
+  // hands its counters over under it
+  GIFCategoryIndex scanned;
+  bool opened = scanned.scan(fs, GIFS_BASE_PATH, &previous, reportScanProgress);
+
+  std::lock_guard<std::mutex> lock(indexMutex);
+  if (!opened) {
+    rescanJob.state = RescanState::FAILED;
+    rescanJob.finishedMs = millis();
+    return true;
+  }
+  if (generation != indexGeneration) {
+    LOG_INFO("AnimatedGIFPanel: GIFs changed during the index check, repeating it");
+    return false;
+  }
+
+  rescanJob.state = RescanState::DONE;
+  rescanJob.finishedMs = millis();
+  // GIFs changed by hand on the card must not be played from old copies
+  staging.validate(scanned);
+  if (indexComplete && scanned.matches(categoryIndex)) {
+    LOG_INFO("AnimatedGIFPanel: Category index is up to date");
+    return true;
+  }
+
+  categoryIndex = std::move(scanned);
+  indexComplete = true;
+  categoryIndex.save(fs);
+  // The scan does not say which GIFs changed, so no cached frames are trusted
+  cacheStaleAll = true;
+  cacheStale = true;
+  buildCategories(categoryIndex, pendingCategories);
+  categoriesPending = true;
+  rescanJob.changed = true;
+  LOG_INFO("AnimatedGIFPanel: Category index rebuilt with %u GIFs",
+           (unsigned)categoryIndex.getGifCount());
+  return true;
+}
+
+/**
+ * @brief Publish the counters of the running scan to getRescanJson() (index task)
+ * @param progress Counters after the latest GIF or directory
+ * @param user Unused
+ */
+void AnimatedGIFPanel::reportScanProgress(const IndexScanProgress &progress, void *user) {
+  std::lock_guard<std::mutex> lock(instance.indexMutex);
+  instance.rescanJob.progress = progress;
+}
+
+/**
+ * @brief Copy a frequently played GIF into flash (staging task)
+ * @return true if it should run again right away, false if there is nothing to do for now
+ */
+bool AnimatedGIFPanel::maintainStaging() {
+  return staging.maintain(fs);
+}
+
+/**
+ * @brief Replace the categories with the pending ones
+ *
+ * Called from the playback task only, so nothing is reading the list while
+ * it is swapped. Playlists of unchanged categories keep their place.
+ */
+void AnimatedGIFPanel::applyPendingCategories() {
+  if (!categoriesPending) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(indexMutex);
+
+  playlist.rebuild(pendingCategories, &categories);
+
+  const char *selected = currentCategoryIndex < categories.size()
+                             ? categories.getName(currentCategoryIndex)
+                             : "";
+  size_t current = pendingCategories.findCategory(selected);
+  std::swap(categories, pendingCategories);
+  pendingCategories.clear();
+  categoriesPending = false;
+
+  if (current == GIFCategoryList::NOT_FOUND) {
+    currentCategoryIndex = 0;
+    categoryChanged = true;
+  } else {
+    currentCategoryIndex = current;
+  }
+}
+
+/**
+ * @brief Switch to the category selected through setCategory()
+ *
+ * Called from the playback task only, after the categories are swapped in,
+ * so the selection is looked up in the list the next GIF is picked from and
+ * only this task moves through the decks.
+ */
+void AnimatedGIFPanel::applyPendingSelection() {
+  std::lock_guard<std::mutex> lock(indexMutex);
+  if (pendingSelection.length() == 0) {
+    return;
+  }
+
+  size_t selected = categories.findCategory(pendingSelection.c_str());
+  if (selected == GIFCategoryList::NOT_FOUND) {
+    LOG_WARNING("AnimatedGIFPanel: Selected category %s is gone", pendingSelection.c_str());
+  } else {
+    currentCategoryIndex = selected;
+  }
+  pendingSelection = "";
+}
+
+/**
+ * @brief Get the pending categories for a change, copying the current ones first
+ *
+ * The playing list is never changed in place; edits go to a copy that the
+ * playback task swaps in between GIFs. Must be called with indexMutex held.
+ *
+ * @return Categories to change
+ */
+GIFCategoryList &AnimatedGIFPanel::editCategories() {
+  if (!categoriesPending) {
+    pendingCategories = categories;
+    categoriesPending = true;
+  }
+  return pendingCategories;
+}
+
+/**
+ * @brief Get the categories including changes not swapped in yet
+ *
+ * Must be called with indexMutex held.
+ */
+const GIFCategoryList &AnimatedGIFPanel::latestCategories() const {
+  return categoriesPending ? pendingCategories : categories;
+}
+
+/**
+ * @brief Add a stored GIF to the index and its category
+ * @param categoryName Category the GIF was stored in
+ * @param path Path of the GIF on the SD card
+ * @param info Parse result of the GIF, nullptr to parse the stored file
+ * @return false if the GIF could not be read or the index could not be saved
+ */
+bool AnimatedGIFPanel::indexGif(const String &categoryName, const String &path,
+                                const GIFInfo *info) {
+  GIFMetadata metadata;
+  if (!GIFCategoryIndex::describe(fs, path, metadata, info)) {
+    return false;
+  }
+  String filename = path.substring(path.lastIndexOf('/') + 1);
+
+  // The staged copy and cached frames, if any, are of the file this one replaced
+  staging.invalidate(path);
+
+  std::lock_guard<std::mutex> lock(indexMutex);
+  markStale(path);
+  categoryIndex.put(categoryName, filename, metadata);
+  indexGeneration++;
+  addCategoryFile(editCategories(), categoryName, filename);
+
+  // A patched partial index would hide the rest of the card on the next boot
+  return !indexComplete || categoryIndex.save(fs);
+}
+
+/**
+ * @brief Remove a deleted GIF from the index and its category
+ * @param categoryName Category the GIF was in
+ * @param filename Filename of the GIF
+ */
+void AnimatedGIFPanel::unindexGif(const String &categoryName, const String &filename) {
+  String path = FSUtils::buildPath(GIFS_BASE_PATH, categoryName.c_str(), filename.c_str(), nullptr);
+  staging.invalidate(path);
+
+  std::lock_guard<std::mutex> lock(indexMutex);
+  markStale(path);
+  categoryIndex.remove(categoryName, filename);
+  indexGeneration++;
+  removeCategoryFile(editCategories(), categoryName, filename);
+  if (indexComplete) {
+    categoryIndex.save(fs);
+  }
+}
+
+/**
+ * @brief Note that the cached frames of a GIF are out of date
+ *
+ * Only the playback task touches the frame cache, so the path is queued for
+ * dropStaleFrames(). Must be called with indexMutex held.
+ *
+ * @param path Path of the GIF on the SD card
+ */
+void AnimatedGIFPanel::markStale(const String &path) {
+  if (stalePaths.size() < MAX_STALE_CACHE_PATHS) {
+    stalePaths.push_back(path);
+  } else {
+    cacheStaleAll = true;
+  }
+  cacheStale = true;
+}
+
+/**
+ * @brief Drop cached frames of GIFs changed on the card (playback task)
+ */
+void AnimatedGIFPanel::dropStaleFrames() {
+  if (!cacheStale) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(indexMutex);
+  if (cacheStaleAll) {
+    frameCache.clear();
+  } else {
+    for (const String &path : stalePaths) {
+      frameCache.invalidate(path);
+    }
+  }
+  stalePaths.clear();
+  cacheStaleAll = false;
+  cacheStale = false;
+}
+
+/**
+ * @brief Build the playback categories from an index
+ * @param index Index to read
+ * @param list Categories to replace; empty categories are left out
+ */
+void AnimatedGIFPanel::buildCategories(const GIFCategoryIndex &index, GIFCategoryList &list) {
+  const GIFCategoryList &indexed = index.getList();
+  list.clear();
+  list.reserve(indexed.size(), indexed.getFileCount(), indexed.getMemoryBytes());
+  for (size_t c = 0; c < indexed.size(); c++) {
+    if (indexed.getFileCount(c) == 0) {
+      continue;
+    }
+    size_t category = list.addCategory(indexed.getName(c));
+    for (size_t i = 0; i < indexed.getFileCount(c); i++) {
+      list.addFile(category, indexed.getFile(c, i));
+    }
+  }
+}
+
+/**
+ * @brief Append a file to a category, creating the category if needed
+ * @param list Categories to change
+ * @param categoryName Category name
+ * @param filename Filename
+ */
+void AnimatedGIFPanel::addCategoryFile(GIFCategoryList &list, const String &categoryName,
+                                       const String &filename) {
+  size_t category = list.findCategory(categoryName.c_str());
+  if (category == GIFCategoryList::NOT_FOUND) {
+    category = list.addCategory(categoryName.c_str());
+  }
+  if (list.findFile(category, filename.c_str()) == GIFCategoryList::NOT_FOUND) {
+    list.addFile(category, filename.c_str());
+  }
+}
+
+/**
+ * @brief Remove a file from a category
+ * @param list Categories to change
+ * @param categoryName Category name
+ * @param filename Filename
+ */
+void AnimatedGIFPanel::removeCategoryFile(GIFCategoryList &list, const String &categoryName,
+                                          const String &filename) {
+  size_t category = list.findCategory(categoryName.c_str());
+  if (category == GIFCategoryList::NOT_FOUND) {
+    return;
+  }
+  size_t index = list.findFile(category, filename.c_str());
+  if (index != GIFCategoryList::NOT_FOUND) {
+    list.removeFile(category, index);
+  }
+}
+
+const char *AnimatedGIFPanel::getRescanStateName(RescanState state) {
+  switch (state) {
+    case RescanState::QUEUED:
+      return "queued";
+    case RescanState::RUNNING:
+      return "running";
+    case RescanState::DONE:
+      return "done";
+    case RescanState::FAILED:
+      return "failed";
+    case RescanState::IDLE:
+    default:
+      return "idle";
+  }
+}
+
 /**
  * @brief Set the current category by name
  * @param categoryName Name of category to set
  * @return true if category was found and set
  */
 bool AnimatedGIFPanel::setCategory(const String &categoryName) {
-   for (size_t i = 0; i < categories.size(); i++) {
-     if (categories[i].name.equalsIgnoreCase(categoryName)) {
-       currentCategoryIndex = i;
-       currentGifFile = getNextGif();
-
-       // Update state in ConfigManager
-       updateState();
+   {
+     std::lock_guard<std::mutex> lock(indexMutex);
+     // Categories created by an upload that is not swapped in yet can be selected too
+     const GIFCategoryList &latest = latestCategories();
+     size_t i = latest.findCategory(categoryName.c_str());
+     if (i == GIFCategoryList::NOT_FOUND) {
+       LOG_WARNING("AnimatedGIFPanel: Category not found: %s", categoryName.c_str());
+       return false;
+     }
 
-       return true;
+     const char *current = pendingSelection.length() > 0 ? pendingSelection.c_str()
+                           : currentCategoryIndex < categories.size()
+                               ? categories.getName(currentCategoryIndex)
+                               : "";
+     if (strcmp(current, latest.getName(i)) != 0) {
+       // Cached and prepared GIFs belong to the previous category's rotation
+       categoryChanged = true;
      }
+     // The decks and currentGifFile belong to the playback task, which picks
+     // the selection up between GIFs
+     pendingSelection = latest.getName(i);
    }
-   LOG_WARNING("AnimatedGIFPanel: Category not found: %s", categoryName.c_str());
-   return false;
+
+   // Update state in ConfigManager
+   updateState();
+
+   return true;
  }
 
 /**
@@ -243,20 +910,35 @@ bool AnimatedGIFPanel::setCategory(const String &categoryName) {
  * @return Name of current category or empty string if none
  */
 String AnimatedGIFPanel::getCurrentCategory() const {
+  std::lock_guard<std::mutex> lock(indexMutex);
+  if (pendingSelection.length() > 0) {
+    return pendingSelection;
+  }
   if (currentCategoryIndex < categories.size()) {
-    return categories[currentCategoryIndex].name;
+    return categories.getName(currentCategoryIndex);
   }
   return "";
 }
 
+/**
+ * @brief Get the number of categories, including ones not swapped in yet
+ */
+size_t AnimatedGIFPanel::getCategoryCount() const {
+  std::lock_guard<std::mutex> lock(indexMutex);
+  return latestCategories().size();
+}
+
 /**
  * @brief Get a list of all category names
  * @return Vector of category names
  */
 std::vector<String> AnimatedGIFPanel::getCategoryList() const {
+  std::lock_guard<std::mutex> lock(indexMutex);
+  const GIFCategoryList &latest = latestCategories();
   std::vector<String> list;
-  for (const auto &category : categories) {
-    list.push_back(category.name);
+  list.reserve(latest.size());
+  for (size_t category = 0; category < latest.size(); category++) {
+    list.push_back(latest.getName(category));
   }
   return list;
 }
@@ -267,15 +949,17 @@ std::vector<String> AnimatedGIFPanel::getCategoryList() const {
  * @return JSON string with category information
  */
 String AnimatedGIFPanel::getCategoryInfo(const String &categoryName) const {
-    for (const auto &category : categories) {
-      if (category.name.equalsIgnoreCase(categoryName)) {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    const GIFCategoryList &latest = latestCategories();
+    size_t category = latest.findCategory(categoryName.c_str());
+    if (category != GIFCategoryList::NOT_FOUND) {
         JsonDocument doc;
-        doc["name"] = category.name;
-        doc["file_count"] = category.files.size();
+        doc["name"] = latest.getName(category);
+        doc["file_count"] = latest.getFileCount(category);
 
         JsonArray files = doc["files"].to<JsonArray>();
-        for (const auto &file : category.files) {
-          files.add(file);
+        for (size_t i = 0; i < latest.getFileCount(category); i++) {
+          files.add(latest.getFile(category, i));
         }
 
         String output;
@@ -283,7 +967,6 @@ String AnimatedGIFPanel::getCategoryInfo(const String &categoryName) const {
           return "{\"error\":\"Failed to serialize JSON\"}";
         }
         return output;
-      }
     }
     return "{}";
   }
@@ -307,16 +990,25 @@ bool AnimatedGIFPanel::isGifFile(const String& filename) {
 
 /**
  * @brief Get the next GIF in the current category
+ *
+ * The name is copied into currentGifFile, which keeps its capacity, so
+ * stepping through a category does not allocate.
+ *
  * @return Filename of next GIF or empty string if none
  */
-String AnimatedGIFPanel::getNextGif() {
-  if (currentCategoryIndex >= categories.size()) return "";
+const String &AnimatedGIFPanel::getNextGif() {
+  static const String none;
+  if (currentCategoryIndex >= categories.size()) return none;
+
+  size_t count = categories.getFileCount(currentCategoryIndex);
+  if (count == 0) return none;
 
-  GifCategory &category = categories[currentCategoryIndex];
-  if (category.files.empty()) return "";
+  size_t index = playlist.next(currentCategoryIndex);
+  if (index >= count) return none;
 
-  category.currentIndex = (category.currentIndex + 1) % category.files.size();
-  currentGifFile = category.files[category.currentIndex];
+  currentGifFile = categories.getFile(currentCategoryIndex, index);
+  uint32_t configured = playlist.getPlayTime(currentCategoryIndex, index);
+  pickedPlayTimeMs = configured > 0 ? configured : targetPlayTimeMs;
   return currentGifFile;
 }
 
@@ -324,15 +1016,19 @@ String AnimatedGIFPanel::getNextGif() {
  * @brief Get the previous GIF in the current category
  * @return Filename of previous GIF or empty string if none
  */
-String AnimatedGIFPanel::getPreviousGif() {
-  if (currentCategoryIndex >= categories.size()) return "";
+const String &AnimatedGIFPanel::getPreviousGif() {
+  static const String none;
+  if (currentCategoryIndex >= categories.size()) return none;
+
+  size_t count = categories.getFileCount(currentCategoryIndex);
+  if (count == 0) return none;
 
-  GifCategory &category = categories[currentCategoryIndex];
-  if (category.files.empty()) return "";
+  size_t index = playlist.previous(currentCategoryIndex);
+  if (index >= count) return none;
 
-  category.currentIndex = (category.currentIndex + category.files.size() - 1) %
-                          category.files.size();
-  currentGifFile = category.files[category.currentIndex];
+  currentGifFile = categories.getFile(currentCategoryIndex, index);
+  uint32_t configured = playlist.getPlayTime(currentCategoryIndex, index);
+  pickedPlayTimeMs = configured > 0 ? configured : targetPlayTimeMs;
   return currentGifFile;
 }
 
@@ -350,14 +1046,113 @@ String AnimatedGIFPanel::getStatusJson() const {
      doc["category_playback_enabled"] = categoryPlayback;
      doc["current_category"] = getCurrentCategory();
      doc["current_gif"] = currentGifFile;
-     doc["category_count"] = categories.size();
+     doc["category_count"] = getCategoryCount();
      doc["power_on"] = powerOn;
 
+     const BlitStats &blitStats = DisplayService::getInstance().getBlitter().getStats();
+     JsonObject render = doc["render"].to<JsonObject>();
+     render["frames"] = blitStats.frames;
+     render["spans_per_frame"] = blitStats.lastFrameSpans;
+     render["pixels_per_frame"] = blitStats.lastFramePixels;
+     render["dirty_tracking"] = DisplayService::getInstance().getBlitter().isTracking();
+     render["skipped_pixels_per_frame"] = blitStats.lastFrameSkippedPixels;
+     JsonObject dirty = render["dirty_rect"].to<JsonObject>();
+     dirty["x"] = blitStats.lastFrameDirty.x0;
+     dirty["y"] = blitStats.lastFrameDirty.y0;
+     dirty["width"] = blitStats.lastFrameDirty.width();
+     dirty["height"] = blitStats.lastFrameDirty.height();
+     const CompositorStats &compositorStats = compositor.getStats();
+     render["disposals_cleared"] = compositorStats.cleared;
+     render["disposals_restored"] = compositorStats.restored;
+     render["palette_builds"] = paletteBuilds;
+
+     const FrameCacheStats &cacheStats = frameCache.getStats();
+     JsonObject cache = doc["frame_cache"].to<JsonObject>();
+     cache["budget"] = frameCache.getBudget();
+     cache["used"] = frameCache.getUsedBytes();
+     cache["entries"] = frameCache.getEntryCount();
+     cache["hits"] = cacheStats.hits;
+     cache["misses"] = cacheStats.misses;
+     cache["evictions"] = cacheStats.evictions;
+     cache["aborted"] = cacheStats.aborted;
+     cache["rejected"] = cacheStats.rejected;
+
+     JsonObject reads = doc["read_ahead"].to<JsonObject>();
+     reads["window"] = readAheadBytes;
+     reads["requests"] = readStats.requests;
+     reads["hit_rate"] = readStats.hitRate();
+     reads["bytes_requested"] = readStats.bytesRequested;
+     reads["bytes_read"] = readStats.bytesRead;
+     reads["fs_reads"] = readStats.fsReads;
+     reads["fs_seeks"] = readStats.fsSeeks;
+
+     JsonObject sources = doc["sources"].to<JsonObject>();
+     sources["current"] = getSourceName(currentSource);
+     sources["cache"] = sourceStats.cachePlays;
+     sources["memory"] = sourceStats.memoryPlays;
+     sources["stream"] = sourceStats.streamPlays;
+     sources["memory_fallbacks"] = sourceStats.memoryFallbacks;
+
+     StagingStats stagingStats = staging.getStats();
+     JsonObject staged = doc["staging"].to<JsonObject>();
+     staged["enabled"] = staging.isEnabled();
+     staged["budget_bytes"] = staging.getBudget();
+     staged["used_bytes"] = staging.getUsedBytes();
+     staged["files"] = staging.getStagedCount();
+     staged["hits"] = stagingStats.hits;
+     staged["misses"] = stagingStats.misses;
+     staged["staged"] = stagingStats.staged;
+     staged["evictions"] = stagingStats.evictions;
+     staged["invalidated"] = stagingStats.invalidated;
+     staged["bytes_staged"] = stagingStats.bytesStaged;
+
+     JsonObject scaling = doc["scaling"].to<JsonObject>();
+     scaling["mode"] = GIFScaler::getModeName(scaler.getMode());
+     scaling["active"] = scaler.isActive();
+     if (scaler.isActive()) {
+       scaling["width"] = scaler.getOutputWidth();
+       scaling["height"] = scaler.getOutputHeight();
+     }
+
+     const PacingStats &pacingStats = scheduler.getStats();
+     JsonObject pacing = doc["pacing"].to<JsonObject>();
+     pacing["presented"] = pacingStats.presented;
+     pacing["dropped"] = pacingStats.dropped;
+     pacing["late"] = pacingStats.late;
+     pacing["resyncs"] = pacingStats.resyncs;
+     pacing["drift_ms"] = pacingStats.lastDriftMs;
+     pacing["max_drift_ms"] = pacingStats.maxDriftMs;
+     pacing["avg_abs_drift_ms"] = pacingStats.avgAbsDriftMs();
+     pacing["decode_lead_ms"] = scheduler.getDecodeLeadMs();
+
+     JsonObject transitions = doc["transitions"].to<JsonObject>();
+     transitions["switches"] = switchStats.switches;
+     transitions["gapless"] = switchStats.gapless;
+     transitions["last_ms"] = switchStats.lastMs;
+     transitions["max_ms"] = switchStats.maxMs;
+     transitions["avg_ms"] = switchStats.avgMs();
+
+     if (pipeline.isActive()) {
+       PipelineStats pipeStats = pipeline.getStats();
+       JsonObject pipe = doc["pipeline"].to<JsonObject>();
+       pipe["depth"] = pipeline.getDepth();
+       pipe["queued"] = pipeline.queued();
+       pipe["produced"] = pipeStats.produced;
+       pipe["presented"] = pipeStats.presented;
+       pipe["late_frames"] = pipeStats.lateFrames;
+       pipe["max_lateness_ms"] = pipeStats.maxLatenessMs;
+       pipe["underruns"] = pipeStats.underruns;
+       pipe["avg_decode_us"] = pipeStats.avgDecodeUs();
+       pipe["max_decode_us"] = pipeStats.decodeUsMax;
+       pipe["avg_present_us"] = pipeStats.avgPresentUs();
+       pipe["max_present_us"] = pipeStats.presentUsMax;
+     }
+
      JsonArray categoryArray = doc["categories"].to<JsonArray>();
-     for (const auto &category : categories) {
+     for (size_t category = 0; category < categories.size(); category++) {
        JsonObject c = categoryArray.add<JsonObject>();
-       c["name"] = category.name;
-       c["file_count"] = category.files.size();
+       c["name"] = categories.getName(category);
+       c["file_count"] = categories.getFileCount(category);
      }
 
      String output;
@@ -377,28 +1172,599 @@ String AnimatedGIFPanel::getStatusJson() const {
  * @return true if GIF was shown successfully
  */
 bool AnimatedGIFPanel::ShowGIF(const String &path) {
-   int start_tick = millis();
-
-   if (gif.open(path.c_str(), GIFOpenFile, GIFCloseFile, GIFReadFile,
-                GIFSeekFile, GIFDraw)) {
-     int xOffset = (display->width() - gif.getCanvasWidth()) / 2;
-     if (xOffset < 0) xOffset = 0;
-     int yOffset = (display->height() - gif.getCanvasHeight()) / 2;
-     if (yOffset < 0) yOffset = 0;
-    LOG_DEBUG("Successfully opened GIF; Canvas size = %d x %d",
-              gif.getCanvasWidth(), gif.getCanvasHeight());
-
-    while (gif.playFrame(true, NULL)) {
-      if (categoryPlayback &&
-          (millis() - start_tick) > MAX_GIF_PLAY_TIME) {
-        break;
+  bool prepared = nextPrepared && nextPath == path;
+  if (!prepared) {
+    discardNext();
+  }
+  nextPath = "";
+  nextPrepared = false;
+
+  if (!prepared && frameCache.isEnabled()) {
+    const CachedGif *cached = frameCache.find(path);
+    if (cached) {
+      currentSource = GifSource::CACHE;
+      sourceStats.cachePlays++;
+      return playCachedGif(*cached);
+    }
+  }
+
+  if (!prepared && !prepareGif(path, playPlan.frames)) {
+    return false;
+  }
+
+  unsigned long startTick = millis();
+  SpanBlitter &blitter = DisplayService::getInstance().getBlitter();
+  if (!scheduler.isAnchored()) {
+    scheduler.anchor(startTick);
+  }
+
+  // The first frame is already composed in the canvas; show it on its deadline
+  int32_t wait = scheduler.timeUntil(millis());
+  if (wait > 0) {
+    delay(wait);
+  }
+  blitCanvas();
+  uint32_t shownMs = millis();
+  recordSwitch(shownMs);
+  scheduler.presented(shownMs, preparedDelayMs);
+
+  int delayMs = 0;
+  int result = preparedResult;
+  uint32_t frames = 1;
+  uint32_t playedMs = preparedDelayMs;
+  uint16_t loopsLeft = categoryPlayback ? playPlan.loops : 1;
+  // playFrame() returns 0 at the end of each loop and starts over on the next call
+  while (result > 0 || (result == 0 && --loopsLeft > 0)) {
+    if (!powerOn || (categoryPlayback && (millis() - startTick) > playPlan.limitMs)) {
+      break;
+    }
+
+    // Start decoding early enough for the frame to be complete on its deadline
+    wait = scheduler.timeUntil(millis(), scheduler.getDecodeLeadMs());
+    if (wait > 0) {
+      delay(wait);
+    }
+
+    blitter.beginFrame();
+    uint32_t startUs = micros();
+    result = gif.playFrame(false, &delayMs);
+    scheduler.recordDecode(micros() - startUs);
+    if (result < 0) {
+      break;
+    }
+    compositor.present(blitter);
+    scheduler.presented(millis(), delayMs);
+    frames++;
+    playedMs += delayMs;
+
+    if (frameCache.isCapturing() &&
+        frameCache.captureFrame(compositor.getCanvas(), delayMs) && result == 0) {
+      frameCache.commitCapture();
+    }
+  }
+
+  // Stopped before the end of the first loop
+  frameCache.abortCapture();
+  closeGif();
+  holdLastFrame = needsHold(frames, playedMs);
+  return true;
+}
+
+/**
+ * @brief Open a GIF and decode its first frame into the canvas
+ *
+ * Nothing is drawn, so this can run while the previous GIF's last frame is
+ * still on screen. GIFs that fit on the panel start being captured into the
+ * frame cache.
+ *
+ * @param path Path to GIF file
+ * @param frames Frames in the GIF from the index, 0 if unknown
+ * @return true if the GIF is open and its first frame is in the canvas
+ */
+bool AnimatedGIFPanel::prepareGif(const String &path, uint16_t frames) {
+  if (!openGif(path)) {
+    return false;
+  }
+  LOG_DEBUG("Successfully opened GIF; Canvas size = %d x %d",
+            gif.getCanvasWidth(), gif.getCanvasHeight());
+
+  compositor.reset();
+
+  // Capture the first loop of GIFs that fit on the panel
+  if (frameCache.isEnabled() && fitsCanvas()) {
+    frameCache.beginCapture(path, canvasWidth, canvasHeight, frames);
+  }
+
+  uint32_t startUs = micros();
+  preparedResult = gif.playFrame(false, &preparedDelayMs);
+  scheduler.recordDecode(micros() - startUs);
+
+  if (preparedResult < 0) {
+    frameCache.abortCapture();
+    closeGif();
+    return false;
+  }
+
+  if (frameCache.isCapturing() &&
+      frameCache.captureFrame(compositor.getCanvas(), preparedDelayMs) && preparedResult == 0) {
+    frameCache.commitCapture();
+  }
+  return true;
+}
+
+/**
+ * @brief Pick the next GIF and prepare it while the current frame is shown
+ */
+void AnimatedGIFPanel::prepareNext() {
+  nextPath = nextPlaybackPath();
+  nextPlan = pickedPlan;
+
+  // Cached GIFs start straight from decoded frames
+  if (frameCache.isEnabled() && frameCache.contains(nextPath)) {
+    nextPrepared = false;
+    return;
+  }
+
+  nextPrepared = prepareGif(nextPath, nextPlan.frames);
+  if (!nextPrepared) {
+    LOG_WARNING("AnimatedGIFPanel: Failed to prepare %s", nextPath.c_str());
+  }
+}
+
+/**
+ * @brief Forget the GIF picked by prepareNext() and close it if it was opened
+ */
+void AnimatedGIFPanel::discardNext() {
+  if (nextPrepared) {
+    frameCache.abortCapture();
+    closeGif();
+  }
+  nextPath = "";
+  nextPrepared = false;
+}
+
+/**
+ * @brief Draw the whole canvas to the panel as one frame
+ */
+void AnimatedGIFPanel::blitCanvas() {
+  SpanBlitter &blitter = DisplayService::getInstance().getBlitter();
+  blitter.beginFrame();
+  const uint16_t *canvas = compositor.getCanvas();
+  for (int16_t y = 0; y < canvasHeight; y++) {
+    blitter.blitSpan(0, y, canvas + y * canvasWidth, canvasWidth);
+  }
+}
+
+/**
+ * @brief Check whether a GIF's last frame is held before the next GIF
+ *
+ * Stills and GIFs without frame delays would otherwise be replaced as soon
+ * as they are shown, and a still current.gif would be decoded and drawn
+ * again in a tight loop.
+ *
+ * @param frames Frames shown
+ * @param playedMs Sum of their delays
+ */
+bool AnimatedGIFPanel::needsHold(uint32_t frames, uint32_t playedMs) {
+  return frames <= 1 || playedMs == 0;
+}
+
+/**
+ * @brief Keep the last frame up for an update interval after it was due
+ * @param dueMs Deadline the frame was shown for
+ */
+void AnimatedGIFPanel::holdAfterGif(uint32_t dueMs) {
+  scheduler.holdUntil(dueMs + DISPLAY_UPDATE_INTERVAL_MS);
+}
+
+/**
+ * @brief Note that the current GIF is done and the next one is due on the schedule
+ */
+void AnimatedGIFPanel::markGifEnd() {
+  switchDueMs = scheduler.getDeadline();
+  switchPending = true;
+}
+
+/**
+ * @brief Record the transition latency once the next GIF's first frame is visible
+ * @param nowMs Time the frame became visible
+ */
+void AnimatedGIFPanel::recordSwitch(uint32_t nowMs) {
+  if (!switchPending) return;
+  switchPending = false;
+
+  int32_t latency = (int32_t)(nowMs - switchDueMs);
+  if (latency < 0) latency = 0;
+
+  switchStats.switches++;
+  switchStats.lastMs = latency;
+  switchStats.totalMs += latency;
+  if ((uint32_t)latency > switchStats.maxMs) switchStats.maxMs = latency;
+  if (latency <= FRAME_LATE_TOLERANCE_MS) switchStats.gapless++;
+}
+
+/**
+ * @brief Open a GIF from memory when it is small enough, else stream it
+ * @param path Path to GIF file
+ * @return true if the GIF was opened
+ */
+bool AnimatedGIFPanel::openGif(const String &path) {
+  // GIFs played often enough have a copy in flash
+  if (staging.acquire(path, openPath)) {
+    stagedSource = path;
+    openFS = &staging.getFS();
+  } else {
+    openPath = path;
+    openFS = &fs;
+  }
+
+  if (openGifFromMemory(openPath)) {
+    currentSource = GifSource::MEMORY;
+    sourceStats.memoryPlays++;
+  } else if (gif.open(openPath.c_str(), GIFOpenFile, GIFCloseFile, GIFReadFile,
+                      GIFSeekFile, GIFDraw)) {
+    currentSource = GifSource::STREAM;
+    sourceStats.streamPlays++;
+  } else {
+    releaseStaged();
+    return false;
+  }
+
+  // The global palette of the new GIF may sit where the last one was
+  outputSource = nullptr;
+  frameCalibration = &DisplayService::getInstance().acquireCalibration();
+
+  if (scaler.begin(gif.getCanvasWidth(), gif.getCanvasHeight(), canvasWidth, canvasHeight)) {
+    LOG_DEBUG("AnimatedGIFPanel: Scaling %s from %d x %d to %d x %d (%s)", path.c_str(),
+              gif.getCanvasWidth(), gif.getCanvasHeight(), scaler.getOutputWidth(),
+              scaler.getOutputHeight(), GIFScaler::getModeName(scaler.getMode()));
+  }
+  return true;
+}
+
+/**
+ * @brief Check if the open GIF's frames fit on the canvas once scaled
+ * @return true if every decoded pixel lands on the canvas
+ */
+bool AnimatedGIFPanel::fitsCanvas() {
+  return scaler.isActive() ||
+         (gif.getCanvasWidth() <= canvasWidth && gif.getCanvasHeight() <= canvasHeight);
+}
+
+/**
+ * @brief Load a whole GIF into memory and open it from there
+ *
+ * Frame decoding then needs no filesystem calls at all. Any failure leaves
+ * nothing allocated so the caller can fall back to streaming.
+ *
+ * @param path Path to GIF file
+ * @return true if the GIF was opened from memory
+ */
+bool AnimatedGIFPanel::openGifFromMemory(const String &path) {
+  File file = openFS->open(path, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  size_t size = file.size();
+  if (size == 0 || size > memoryPlaybackBytes) {
+    file.close();
+    return false;
+  }
+
+  memoryGif = static_cast<uint8_t *>(GIFMemory::allocate(size));
+  if (!memoryGif) {
+    file.close();
+    LOG_DEBUG("AnimatedGIFPanel: No memory to load %s, streaming instead", path.c_str());
+    sourceStats.memoryFallbacks++;
+    return false;
+  }
+
+  bool loaded = file.read(memoryGif, size) == size;
+  file.close();
+  loaded = loaded && gif.open(memoryGif, size, GIFDraw);
+  if (!loaded) {
+    LOG_DEBUG("AnimatedGIFPanel: Failed to load %s into memory, streaming instead", path.c_str());
+    GIFMemory::release(memoryGif);
+    memoryGif = nullptr;
+    sourceStats.memoryFallbacks++;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Close the open GIF and release its in-memory copy
+ */
+void AnimatedGIFPanel::closeGif() {
+  nextPrepared = false;
+  gif.close();
+  if (memoryGif) {
+    GIFMemory::release(memoryGif);
+    memoryGif = nullptr;
+  }
+  releaseStaged();
+}
+
+/**
+ * @brief Let the staged copy of the GIF that was open be evicted again
+ */
+void AnimatedGIFPanel::releaseStaged() {
+  if (stagedSource.length() > 0) {
+    staging.release(stagedSource);
+    stagedSource = "";
+  }
+}
+
+/**
+ * @brief Get a printable name for a GIF source
+ * @param source GIF source
+ * @return Source name
+ */
+const char *AnimatedGIFPanel::getSourceName(GifSource source) {
+  switch (source) {
+    case GifSource::CACHE:
+      return "cache";
+    case GifSource::MEMORY:
+      return "memory";
+    case GifSource::STREAM:
+      return "stream";
+    case GifSource::NONE:
+    default:
+      return "none";
+  }
+}
+
+/**
+ * @brief Replay a GIF from decoded frames held in the frame cache
+ * @param cached Cached frames to show
+ * @return true once the frames were shown
+ */
+bool AnimatedGIFPanel::playCachedGif(const CachedGif &cached) {
+  SpanBlitter &blitter = DisplayService::getInstance().getBlitter();
+  unsigned long startTick = millis();
+  if (!scheduler.isAnchored()) {
+    scheduler.anchor(startTick);
+  }
+
+  uint32_t loopMs = 0;
+  for (const CachedFrame &frame : cached.frames) {
+    loopMs += frame.delayMs;
+  }
+  holdLastFrame = needsHold(cached.frames.size(), loopMs);
+
+  uint16_t loops = categoryPlayback ? playPlan.loops : 1;
+  for (uint16_t loop = 0; loop < loops; loop++) {
+    for (const CachedFrame &frame : cached.frames) {
+      if (!powerOn) {
+        return true;
+      }
+      uint32_t now = millis();
+      if (scheduler.shouldDrop(now, frame.delayMs)) {
+        scheduler.dropped(frame.delayMs);
+        continue;
+      }
+
+      int32_t wait = scheduler.timeUntil(now);
+      if (wait > 0) {
+        delay(wait);
+      }
+
+      blitter.beginFrame();
+      for (uint16_t y = 0; y < cached.height; y++) {
+        blitter.blitSpan(0, y, frame.pixels + y * cached.width, cached.width);
+      }
+      uint32_t shownMs = millis();
+      recordSwitch(shownMs);
+      scheduler.presented(shownMs, frame.delayMs);
+
+      if (categoryPlayback && (millis() - startTick) > playPlan.limitMs) {
+        return true;
       }
     }
+  }
+  return true;
+}
 
-    gif.close();
-    return true;
+// =============================================================================
+// Decode-Ahead Pipeline
+// =============================================================================
+
+/**
+ * @brief Decode the next GIF into the frame pipeline
+ *
+ * Runs on the decoder task. Blocks while the pipeline is full, so the
+ * decoder stays at most the pipeline depth ahead of the panel.
+ *
+ * @return true if a GIF was decoded, false if there was nothing to do
+ */
+bool AnimatedGIFPanel::decodeTask() {
+  if (!pipeline.isActive() || !powerOn) {
+    return false;
+  }
+
+  const String &gifPath = nextPlaybackPath();
+  playPlan = pickedPlan;
+  if (!decodeGIF(gifPath)) {
+    LOG_ERROR("AnimatedGIFPanel: Failed to decode GIF %s", gifPath.c_str());
+    return false;
   }
-  return false;
+  return true;
+}
+
+/**
+ * @brief Wait for a free pipeline slot while the display stays on
+ * @return Free slot or nullptr if the display was switched off
+ */
+PipelineFrame *AnimatedGIFPanel::waitForFreeSlot() {
+  while (powerOn) {
+    PipelineFrame *slot = pipeline.acquireWrite(PIPELINE_WAIT_MS);
+    if (slot) return slot;
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Decode all frames of a GIF into the pipeline
+ * @param path Path to GIF file
+ * @return true if at least one frame was queued
+ */
+bool AnimatedGIFPanel::decodeGIF(const String &path) {
+  if (frameCache.isEnabled()) {
+    const CachedGif *cached = frameCache.find(path);
+    if (cached) {
+      currentSource = GifSource::CACHE;
+      sourceStats.cachePlays++;
+      return decodeCachedGif(*cached);
+    }
+  }
+
+  if (!openGif(path)) {
+    return false;
+  }
+
+  size_t frameBytes = canvasWidth * canvasHeight * sizeof(uint16_t);
+  compositor.reset();
+
+  if (frameCache.isEnabled() && fitsCanvas()) {
+    frameCache.beginCapture(path, canvasWidth, canvasHeight, playPlan.frames);
+  }
+
+  uint32_t frames = 0;
+  uint32_t playedMs = 0;
+  uint16_t loopsLeft = categoryPlayback ? playPlan.loops : 1;
+  bool produced = false;
+  while (true) {
+    PipelineFrame *slot = waitForFreeSlot();
+    if (!slot) break;
+
+    int delayMs = 0;
+    uint32_t startUs = micros();
+    int result = gif.playFrame(false, &delayMs);
+    if (result < 0) break;
+
+    if (frameCache.isCapturing() &&
+        frameCache.captureFrame(compositor.getCanvas(), delayMs) && result == 0) {
+      frameCache.commitCapture();
+    }
+
+    memcpy(slot->pixels, compositor.getCanvas(), frameBytes);
+    frames++;
+    playedMs += delayMs;
+    slot->delayMs = delayMs;
+    slot->decodeUs = micros() - startUs;
+    // playFrame() returns 0 at the end of each loop and starts over on the next call
+    slot->lastOfGif = (result == 0 && --loopsLeft == 0) ||
+                      (categoryPlayback && playedMs > playPlan.limitMs);
+    slot->holdAfter = slot->lastOfGif && needsHold(frames, playedMs);
+    bool last = slot->lastOfGif;
+    pipeline.commitWrite();
+    produced = true;
+
+    if (last) break;
+  }
+
+  frameCache.abortCapture();
+  closeGif();
+  return produced;
+}
+
+/**
+ * @brief Feed cached frames into the pipeline without decoding
+ * @param cached Cached frames of the GIF
+ * @return true once the frames were queued
+ */
+bool AnimatedGIFPanel::decodeCachedGif(const CachedGif &cached) {
+  size_t frameBytes = cached.width * cached.height * sizeof(uint16_t);
+  uint32_t loopMs = 0;
+  for (const CachedFrame &frame : cached.frames) {
+    loopMs += frame.delayMs;
+  }
+  bool hold = needsHold(cached.frames.size(), loopMs);
+
+  uint32_t playedMs = 0;
+  uint16_t loopsLeft = categoryPlayback ? playPlan.loops : 1;
+  size_t i = 0;
+  while (true) {
+    PipelineFrame *slot = waitForFreeSlot();
+    if (!slot) break;
+
+    uint32_t startUs = micros();
+    memcpy(slot->pixels, cached.frames[i].pixels, frameBytes);
+    playedMs += cached.frames[i].delayMs;
+    slot->delayMs = cached.frames[i].delayMs;
+    slot->decodeUs = micros() - startUs;
+    bool loopEnded = ++i == cached.frames.size();
+    if (loopEnded) {
+      i = 0;
+    }
+    slot->lastOfGif = (loopEnded && --loopsLeft == 0) ||
+                      (categoryPlayback && playedMs > playPlan.limitMs);
+    slot->holdAfter = slot->lastOfGif && hold;
+    bool last = slot->lastOfGif;
+    pipeline.commitWrite();
+
+    if (last) break;
+  }
+  return true;
+}
+
+/**
+ * @brief Show the next decoded frame at its deadline
+ *
+ * Runs on the presenter task. The schedule restarts when the ring runs dry,
+ * and frames whose display interval has already passed are dropped instead
+ * of being flashed on screen. The last frame of a still or zero-delay GIF
+ * is always shown and held like on the single-task path.
+ */
+void AnimatedGIFPanel::presentTask() {
+  PipelineFrame *frame = pipeline.acquireRead(PIPELINE_WAIT_MS);
+  if (!frame) {
+    scheduler.reset();
+    return;
+  }
+
+  uint32_t now = millis();
+  if (!scheduler.isAnchored()) {
+    scheduler.anchor(now);
+  }
+
+  if (!frame->holdAfter && scheduler.shouldDrop(now, frame->delayMs)) {
+    uint32_t lateness = now - scheduler.getDeadline();
+    scheduler.dropped(frame->delayMs);
+    if (frame->lastOfGif) {
+      markGifEnd();
+    }
+    pipeline.releaseRead(0, lateness);
+    return;
+  }
+
+  int32_t wait = scheduler.timeUntil(now);
+  if (wait > 0) {
+    delay(wait);
+  }
+
+  uint32_t dueMs = scheduler.getDeadline();
+  uint32_t startUs = micros();
+  if (powerOn) {
+    SpanBlitter &blitter = DisplayService::getInstance().getBlitter();
+    blitter.beginFrame();
+    for (uint16_t y = 0; y < pipeline.getHeight(); y++) {
+      blitter.blitSpan(0, y, frame->pixels + y * pipeline.getWidth(), pipeline.getWidth());
+    }
+  }
+  uint32_t presentUs = micros() - startUs;
+
+  uint32_t shownMs = millis();
+  recordSwitch(shownMs);
+  scheduler.presented(shownMs, frame->delayMs);
+  if (frame->lastOfGif) {
+    markGifEnd();
+  }
+  if (frame->holdAfter) {
+    holdAfterGif(dueMs);
+  }
+  int32_t drift = scheduler.getStats().lastDriftMs;
+  pipeline.releaseRead(presentUs, drift > FRAME_LATE_TOLERANCE_MS ? drift : 0);
 }
 
 // =============================================================================
@@ -407,14 +1773,18 @@ bool AnimatedGIFPanel::ShowGIF(const String &path) {
 
 /**
  * @brief Open a GIF file for reading
+ *
+ * Reads from the filesystem openGif() chose: the SD card, or LittleFS for
+ * staged copies.
+ *
  * @param fname Filename to open
  * @param pSize Pointer to store file size
  * @return File handle or NULL if failed
  */
 void *AnimatedGIFPanel::GIFOpenFile(const char *fname, int32_t *pSize) {
    LOG_DEBUG("Playing gif: %s", fname);
-   instance.currentFile = FSUtils::getFS(FSType::LITTLEFS).open(fname);
-   if (instance.currentFile) {
+   if (instance.currentFile.open(*instance.openFS, fname,
+                                 instance.readAheadBytes, instance.readStats)) {
      *pSize = instance.currentFile.size();
      return (void *)&instance.currentFile;
    }
@@ -427,14 +1797,13 @@ void *AnimatedGIFPanel::GIFOpenFile(const char *fname, int32_t *pSize) {
  */
 void AnimatedGIFPanel::GIFCloseFile(void *pHandle) {
   if (pHandle) {
-    File *file = static_cast<File *>(pHandle);
+    GIFReadAhead *file = static_cast<GIFReadAhead *>(pHandle);
     file->close();
-    instance.currentFile = File();  // Reset the file handle
   }
 }
 
 /**
- * @brief Read data from a GIF file
+ * @brief Read data from a GIF file through the read-ahead window
  * @param pFile File handle
  * @param pBuf Buffer to read into
  * @param iLen Number of bytes to read
@@ -442,8 +1811,10 @@ void AnimatedGIFPanel::GIFCloseFile(void *pHandle) {
  */
 int32_t AnimatedGIFPanel::GIFReadFile(GIFFILE *pFile, uint8_t *pBuf,
                                       int32_t iLen) {
-  File *file = static_cast<File *>(pFile->fHandle);
-  return file->read(pBuf, iLen);
+  GIFReadAhead *file = static_cast<GIFReadAhead *>(pFile->fHandle);
+  int32_t bytesRead = file->read(pBuf, iLen);
+  pFile->iPos = file->position();
+  return bytesRead;
 }
 
 /**
@@ -453,65 +1824,91 @@ int32_t AnimatedGIFPanel::GIFReadFile(GIFFILE *pFile, uint8_t *pBuf,
  * @return New position
  */
 int32_t AnimatedGIFPanel::GIFSeekFile(GIFFILE *pFile, int32_t iPosition) {
-  File *file = static_cast<File *>(pFile->fHandle);
-  return file->seek(iPosition);
+  GIFReadAhead *file = static_cast<GIFReadAhead *>(pFile->fHandle);
+  pFile->iPos = file->seek(iPosition);
+  return pFile->iPos;
 }
 
 /**
  * @brief GIF draw callback function
+ *
+ * Composes each decoded line onto the canvas. The first line of a frame
+ * disposes of the previous frame. Nothing reaches the panel until the whole
+ * frame is composed.
+ *
  * @param pDraw Pointer to GIF draw structure
  */
 void AnimatedGIFPanel::GIFDraw(GIFDRAW *pDraw) {
-  uint8_t *pixels = pDraw->pPixels;
-  uint16_t *palette = pDraw->pPalette;
-  int width = pDraw->iWidth;
-
-  int maxWidth = instance.display->width();
-  if (width > maxWidth) width = maxWidth;
-
-  int y = pDraw->iY + pDraw->y;
+  GIFCompositor &compositor = instance.compositor;
+  GIFScaler &scaler = instance.scaler;
 
-  if (pDraw->ucDisposalMethod == 2) {
-    for (int x = 0; x < width; x++) {
-      if (pixels[x] == pDraw->ucTransparent) {
-        pixels[x] = pDraw->ucBackground;
-      }
+  if (pDraw->y == 0) {
+    int16_t x = pDraw->iX, y = pDraw->iY, width = pDraw->iWidth, height = pDraw->iHeight;
+    if (scaler.isActive()) {
+      scaler.mapRect(pDraw->iX, pDraw->iY, pDraw->iWidth, pDraw->iHeight, x, y, width, height);
     }
-    pDraw->ucHasTransparency = 0;
+    compositor.beginFrame(x, y, width, height, pDraw->ucDisposalMethod);
+    instance.updateOutputPalette(pDraw);
   }
 
-  if (pDraw->ucHasTransparency) {
-    const uint8_t transparent = pDraw->ucTransparent;
-    uint16_t tempBuffer[320];
-    int x = 0;
-    while (x < width) {
-      int runLength = 0;
+  const ColorCalibration &calibration = *instance.frameCalibration;
+  const uint16_t *palettes = instance.outputPalettes;
+  int16_t transparent = pDraw->ucHasTransparency ? pDraw->ucTransparent : -1;
+  int y = pDraw->iY + pDraw->y;
 
-      while (x + runLength < width && pixels[x + runLength] != transparent) {
-        runLength++;
-      }
+  if (scaler.isActive()) {
+    scaler.scaleLine(pDraw->pPixels, calibration, palettes, transparent, pDraw->iX, y,
+                     pDraw->iWidth, pDraw->y == pDraw->iHeight - 1, drawScaledLine);
+    return;
+  }
 
-      if (runLength > 0) {
-        for (int i = 0; i < runLength; i++) {
-          tempBuffer[i] = palette[pixels[x + i]];
-        }
-        for (int i = 0; i < runLength; i++) {
-          instance.display->drawPixel(x + i, y, tempBuffer[i]);
-        }
-        x += runLength;
-      }
+  // One run per stretch of panels sharing a calibration, usually the whole line
+  int16_t end = pDraw->iX + pDraw->iWidth;
+  for (int16_t x = pDraw->iX; x < end;) {
+    int16_t runEnd;
+    const uint16_t *palette = calibration.paletteAt(palettes, x, y, runEnd);
+    int16_t length = min(runEnd, end) - x;
+    compositor.drawIndexedLine(x, y, pDraw->pPixels + (x - pDraw->iX), palette, length,
+                               transparent);
+    x += length;
+  }
+}
 
-      runLength = 0;
-      while (x + runLength < width && pixels[x + runLength] == transparent) {
-        runLength++;
-      }
-      x += runLength;
-    }
-  } else {
-    for (int x = 0; x < width; x++) {
-      instance.display->drawPixel(x, y, palette[pixels[x]]);
-    }
+/**
+ * @brief Build the calibrated palettes of the frame about to be drawn
+ *
+ * A GIF with only a global color table keeps the same palette for every
+ * frame, so it is converted once per GIF. Frames with a local color table
+ * are converted each time, as the decoder reuses one buffer for all of them.
+ * The calibration is held for the whole frame, so an update takes effect at
+ * the next frame.
+ *
+ * @param pDraw First line of the frame
+ */
+void AnimatedGIFPanel::updateOutputPalette(const GIFDRAW *pDraw) {
+  frameCalibration = &DisplayService::getInstance().acquireCalibration();
+  if (pDraw->ucIsGlobalPalette && pDraw->pPalette == outputSource &&
+      frameCalibration->getVersion() == outputVersion) {
+    return;
   }
+  frameCalibration->convertPalette(pDraw->pPalette, outputPalettes);
+  outputSource = pDraw->ucIsGlobalPalette ? pDraw->pPalette : nullptr;
+  outputVersion = frameCalibration->getVersion();
+  paletteBuilds++;
+}
+
+/**
+ * @brief Compose a row produced by the scaler onto the canvas
+ * @param x Panel column of the first pixel
+ * @param y Panel row
+ * @param colors RGB565 pixels
+ * @param opaque Non-zero for pixels to write
+ * @param length Number of pixels
+ * @param user Unused
+ */
+void AnimatedGIFPanel::drawScaledLine(int16_t x, int16_t y, const uint16_t *colors,
+                                      const uint8_t *opaque, int16_t length, void *user) {
+  instance.compositor.drawLine(x, y, colors, opaque, length);
 }
 
 // =============================================================================
@@ -528,17 +1925,20 @@ void AnimatedGIFPanel::setPowerState(bool state) {
     // Update state in ConfigManager
     updateState();
 
+    // The panel is redrawn past the blitter, so the next frame is written in full
+    DisplayService::getInstance().getBlitter().invalidate();
+
     if (powerOn) {
       // Turn on the display
+      // The display or decoder task resumes playback on its next pass
       display->begin();
-      playbackTask();
     } else {
       // Turn off the display
       display->clearScreen();
       display->fillScreenRGB888(0, 0, 0);
 
-      // Stop any ongoing playback
-      gif.close();
+      // The task playing the GIF sees powerOn and closes it, as the decoder may be using it
+      switchPending = false;
     }
   }
 
@@ -582,13 +1982,64 @@ bool AnimatedGIFPanel::saveUploadedGif(const String &categoryName,
     return false;
   }
 
-  // Refresh the category files list
-  refreshCategoryFiles(categoryName);
+  // Add it to the index without rescanning the category
+  GIFInfo info;
+  bool parsed = GIFValidator::validate(data, size, info);
+  indexGif(categoryName, filePath, parsed ? &info : nullptr);
 
   LOG_INFO("Successfully saved GIF to %s (%u bytes)", filePath.c_str(), bytesWritten);
   return true;
 }
 
+/**
+ * @brief Start streaming an upload into a category
+ *
+ * The upload is written next to its final path and moved into place by
+ * finishUpload(); GIFs larger than the panel are transcoded on the way.
+ *
+ * @param upload Writer to start
+ * @param categoryName Category to store the GIF in
+ * @param filename Filename to use
+ * @return true if the upload was started
+ */
+bool AnimatedGIFPanel::beginUpload(GIFUploadWriter &upload, const String &categoryName,
+                                   const String &filename) {
+  if (!createCategoryIfNotExists(categoryName)) {
+    LOG_ERROR("AnimatedGIFPanel: Failed to create category directory");
+    return false;
+  }
+
+  return upload.begin(FSUtils::getFS(FSType::SD), getUploadPath(categoryName, filename),
+                      canvasWidth, canvasHeight);
+}
+
+/**
+ * @brief Path an upload to a category is stored at
+ * @param categoryName Category name
+ * @param filename Filename
+ * @return Path on the SD card
+ */
+String AnimatedGIFPanel::getUploadPath(const String &categoryName, const String &filename) const {
+  return FSUtils::buildPath(GIFS_BASE_PATH, categoryName.c_str(), filename.c_str(), nullptr);
+}
+
+/**
+ * @brief Store a completed upload and add it to its category
+ * @param upload Writer started with beginUpload()
+ * @param categoryName Category the upload was started in
+ * @return true if the GIF was stored
+ */
+bool AnimatedGIFPanel::finishUpload(GIFUploadWriter &upload, const String &categoryName) {
+  if (!upload.finish()) {
+    return false;
+  }
+
+  // A transcoded GIF no longer matches what the validator saw, so it is parsed again
+  indexGif(categoryName, upload.getPath(),
+           upload.getStats().transcoded ? nullptr : &upload.getInfo());
+  return true;
+}
+
 /**
  * @brief Create a category directory if it doesn't exist
  * @param categoryName Name of category to create
@@ -627,8 +2078,7 @@ bool AnimatedGIFPanel::deleteUploadedGif(const String &categoryName,
     return false;
   }
 
-  // Refresh the category files list
-  refreshCategoryFiles(categoryName);
+  unindexGif(categoryName, filename);
 
   LOG_INFO("Successfully deleted GIF: %s", filePath.c_str());
   return true;
@@ -636,43 +2086,24 @@ bool AnimatedGIFPanel::deleteUploadedGif(const String &categoryName,
 
 /**
  * @brief Refresh the list of files in a category
+ *
+ * Queues a background rescan of the card; the category is updated between
+ * GIFs once it finishes. Only files whose size or modification time changed
+ * are parsed, so refreshing the whole card costs little more than one category.
+ *
  * @param categoryName Name of category to refresh
- * @return true if refresh was successful
+ * @return true if the category exists and a rescan was queued
  */
 bool AnimatedGIFPanel::refreshCategoryFiles(const String &categoryName) {
-  // Find the category
-  for (auto &category : categories) {
-    if (category.name.equalsIgnoreCase(categoryName)) {
-      // Clear existing files
-      category.files.clear();
-
-      // Scan the directory for GIF files
-      String categoryPath = FSUtils::buildPath(GIFS_BASE_PATH, category.name.c_str(), nullptr);
-      File categoryDir = FSUtils::getFS(FSType::SD).open(categoryPath);
-      if (!categoryDir) {
-        LOG_ERROR("Failed to open category directory: %s", categoryPath.c_str());
-        return false;
-      }
-
-      File gifFile = categoryDir.openNextFile();
-      while (gifFile) {
-        if (!gifFile.isDirectory()) {
-          String fname = gifFile.name();
-          if (AnimatedGIFPanel::isGifFile(fname)) {
-            category.files.push_back(fname);
-          }
-        }
-        gifFile = categoryDir.openNextFile();
-      }
-      categoryDir.close();
-
-      LOG_INFO("Refreshed category %s - found %u files", category.name.c_str(), category.files.size());
-      return true;
-    }
+  if (!FSUtils::exists(FSType::SD,
+                       FSUtils::buildPath(GIFS_BASE_PATH, categoryName.c_str(), nullptr).c_str())) {
+    LOG_ERROR("Category not found: %s", categoryName.c_str());
+    return false;
   }
 
-  LOG_ERROR("Category not found: %s", categoryName.c_str());
-  return false;
+  uint32_t job = requestRescan();
+  LOG_INFO("Refreshing category %s in rescan job %u", categoryName.c_str(), (unsigned)job);
+  return true;
 }
 
 // =============================================================================
@@ -697,80 +2128,55 @@ bool AnimatedGIFPanel::processAndSaveGif(const String &categoryName,
     return false;
   }
 
-  // Check if resizing is needed (target is 64x64)
-  if (width == 64 && height == 64) {
-    // No resizing needed, save directly
+  // GIFs that fit on the panel are stored as uploaded
+  if (width <= canvasWidth && height <= canvasHeight) {
     return saveUploadedGif(categoryName, filename, data, size);
   }
 
-  // Calculate required buffer size for resized GIF
-  // This is a simplified approach - in a real implementation, you would need
-  // a proper GIF resizing library or algorithm
-  size_t resizedSize = size;  // Placeholder - actual size would be calculated
-
-  // Allocate buffer for resized GIF
-  uint8_t *resizedData = new uint8_t[resizedSize];
-  if (!resizedData) {
-    LOG_ERROR("Failed to allocate memory for resized GIF");
-    return false;
-  }
-
-  // Resize the GIF
-  if (!resizeGif(data, size, resizedData, resizedSize, 64, 64)) {
+  std::vector<uint8_t> resized;
+  if (!resizeGif(data, size, resized, canvasWidth, canvasHeight)) {
     LOG_ERROR("Failed to resize GIF");
-    delete[] resizedData;
     return false;
   }
 
-  // Save the resized GIF
-  bool success =
-      saveUploadedGif(categoryName, filename, resizedData, resizedSize);
-
-  // Clean up
-  delete[] resizedData;
-
-  return success;
+  return saveUploadedGif(categoryName, filename, resized.data(), resized.size());
 }
 
 /**
  * @brief Resize a GIF to target dimensions
+ *
+ * Every frame is decoded, box-filtered down to fit the target, quantized to
+ * a fixed palette and re-encoded, so the stored file decodes at panel
+ * resolution.
+ *
  * @param inputData Input GIF data
  * @param inputSize Size of input data
- * @param outputData Buffer for output GIF data
- * @param outputSize Size of output data (will be updated)
+ * @param output Receives the resized GIF
  * @param targetWidth Target width
  * @param targetHeight Target height
  * @return true if resizing was successful
  */
 bool AnimatedGIFPanel::resizeGif(const uint8_t *inputData, size_t inputSize,
-                                 uint8_t *outputData, size_t &outputSize,
+                                 std::vector<uint8_t> &output,
                                  int targetWidth, int targetHeight) {
-  // Note: This is a simplified placeholder implementation
-  // In a real implementation, you would use a proper GIF decoding/encoding
-  // library to properly resize each frame while maintaining animation
-  // properties
-
-  LOG_INFO("Resizing GIF from %dx%d to %dx%d", targetWidth * 2, targetHeight * 2, targetWidth, targetHeight);
-
-  // For this example, we'll just copy the data as-is
-  // In a real implementation, you would:
-  // 1. Decode the GIF to extract frames
-  // 2. Resize each frame to target dimensions
-  // 3. Re-encode the GIF with the resized frames
-
-  if (inputSize > outputSize) {
-    LOG_ERROR("Output buffer too small for resized GIF");
+  GIFTranscoder transcoder;
+  if (!transcoder.transcode(inputData, inputSize, output, targetWidth, targetHeight)) {
     return false;
   }
 
-  memcpy(outputData, inputData, inputSize);
-  outputSize = inputSize;
-
+  const TranscodeStats &stats = transcoder.getStats();
+  LOG_INFO("Resized GIF from %dx%d to %dx%d (%u -> %u bytes)", stats.sourceWidth,
+           stats.sourceHeight, stats.width, stats.height, (unsigned)stats.inputBytes,
+           (unsigned)stats.outputBytes);
   return true;
 }
 
 /**
  * @brief Validate GIF data and get dimensions
+ *
+ * Walks the whole block structure, so truncated or malformed files are
+ * rejected before they reach the decoder.
+ *
  * @param data GIF data
  * @param size Size of data
  * @param width Output parameter for width
@@ -779,32 +2185,17 @@ bool AnimatedGIFPanel::resizeGif(const uint8_t *inputData, size_t inputSize,
  */
 bool AnimatedGIFPanel::validateGif(const uint8_t *data, size_t size, int &width,
                                    int &height) {
-  // Basic GIF signature check
-  if (size < 6 || memcmp(data, "GIF", 3) != 0) {
-    LOG_ERROR("Invalid GIF signature");
+  GIFInfo info;
+  const char *error;
+  if (!GIFValidator::validate(data, size, info, &error)) {
+    LOG_ERROR("Invalid GIF: %s", error);
     return false;
   }
+  width = info.width;
+  height = info.height;
 
-  // Check version (either 87a or 89a)
-  if (memcmp(data + 3, "87a", 3) != 0 && memcmp(data + 3, "89a", 3) != 0) {
-    LOG_ERROR("Unsupported GIF version");
-    return false;
-  }
-
-  // For this example, we'll assume the GIF is valid and return fixed dimensions
-  // In a real implementation, you would parse the GIF header to get actual
-  // dimensions
-  width = 64;   // Placeholder
-  height = 64;  // Placeholder
-
-  // Note: In a real implementation, you would:
-  // 1. Parse the GIF header to get actual width/height (bytes 6-9 in the
-  // header)
-  // 2. Validate the logical screen descriptor
-  // 3. Check for global color table if present
-  // 4. Verify the file structure
-
-  LOG_DEBUG("GIF validation completed for %dx%d", width, height);
+  LOG_DEBUG("GIF validation completed for %dx%d, %u frames, %u ms", width, height,
+            (unsigned)info.frames, (unsigned)info.durationMs);
   return true;
 }
 
@@ -10,6 +10,8 @@
  */
 
 #include <Arduino.h>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -19,20 +21,97 @@
 
 #include "FSUtils.h"
 #include "DisplayService.h"
+#include "FramePipeline.h"
+#include "FrameScheduler.h"
+#include "GIFCategoryIndex.h"
+#include "GIFCategoryList.h"
+#include "GIFCompositor.h"
+#include "GIFFrameCache.h"
+#include "GIFPlaylist.h"
+#include "GIFReadAhead.h"
+#include "GIFScaler.h"
+#include "GIFStagingCache.h"
+#include "GIFUploadWriter.h"
+#include "GIFValidator.h"
 
 
 /**
- * @struct GifCategory
- * @brief Represents a GIF category containing multiple GIF files
+ * @enum GifSource
+ * @brief Where the frames of the playing GIF come from
  */
-struct GifCategory {
-     String name;                    //< Category name
-     std::vector<String> files;      //< GIF files in category
-     size_t currentIndex = 0;        //< Current playback index
+enum class GifSource {
+    NONE,       //< Nothing played yet
+    CACHE,      //< Decoded frames from the frame cache
+    MEMORY,     //< Whole file loaded into memory
+    STREAM      //< Streamed from the filesystem through read-ahead
+};
+
+/**
+ * @struct SourceStats
+ * @brief Count of GIF plays per source
+ */
+struct SourceStats {
+    uint32_t cachePlays = 0;        //< Plays served by the frame cache
+    uint32_t memoryPlays = 0;       //< Plays decoded from a memory copy
+    uint32_t streamPlays = 0;       //< Plays decoded from the filesystem
+    uint32_t memoryFallbacks = 0;   //< Memory plays that fell back to streaming
+};
+
+/**
+ * @struct SwitchStats
+ * @brief Latency of transitions from one GIF to the next
+ *
+ * Measured from the time the outgoing GIF's last frame was due to be
+ * replaced to the time the incoming GIF's first frame became visible.
+ */
+struct SwitchStats {
+    uint32_t switches = 0;          //< Transitions measured
+    uint32_t gapless = 0;           //< Transitions within the late-frame tolerance
+    uint32_t lastMs = 0;            //< Latency of the last transition
+    uint32_t maxMs = 0;             //< Slowest transition
+    uint64_t totalMs = 0;           //< Sum of latencies
 
-     GifCategory() = default;
-     GifCategory(const String &n) : name(n) {}
- };
+    uint32_t avgMs() const { return switches ? totalMs / switches : 0; }
+};
+
+/**
+ * @struct PlayPlan
+ * @brief How long a GIF plays in category playback
+ *
+ * GIFs whose loop length is known play whole loops; the limit only cuts
+ * a GIF short if playing them takes far longer than planned.
+ */
+struct PlayPlan {
+    uint16_t loops = 1;                     //< Whole loops to play
+    uint32_t limitMs = MAX_GIF_PLAY_TIME;   //< Stop after this long even mid-loop
+    uint16_t frames = 0;                    //< Frames in the GIF from the index, 0 if unknown
+};
+
+/**
+ * @enum RescanState
+ * @brief Stage of a category rescan job
+ */
+enum class RescanState {
+    IDLE,       //< No rescan requested yet
+    QUEUED,     //< Waiting for the index task
+    RUNNING,    //< Walking the card
+    DONE,       //< Finished; changed categories are swapped in between GIFs
+    FAILED      //< The GIF directory could not be opened
+};
+
+/**
+ * @struct RescanJob
+ * @brief The latest category rescan and its progress
+ */
+struct RescanJob {
+    uint32_t id = 0;                        //< Job id, 0 before the first request
+    RescanState state = RescanState::IDLE;  //< Stage of the job
+    uint32_t startedMs = 0;                 //< millis() when the scan started
+    uint32_t finishedMs = 0;                //< millis() when it finished
+    uint32_t expectedFiles = 0;             //< GIFs indexed before the scan, for progress
+    bool changed = false;                   //< The scan found changes and replaced the categories
+    IndexScanProgress progress;             //< Counters of the running scan
+};
 
 /**
  * @class AnimatedGIFPanel
@@ -41,7 +120,8 @@ struct GifCategory {
  * Provides:
  * - GIF rendering on LED matrix
  * - GIF file callbacks for AnimatedGIF library
- * - SD card scanning for categories
+ * - SD card scanning for categories, backed by a persistent index
+ * - Background rescans whose categories are swapped in between GIFs
  * - Category and file playback management
  * - Copying files from SD to LittleFS
  */
@@ -70,7 +150,50 @@ public:
     String getCurrentCategory() const;
     std::vector<String> getCategoryList() const;
     String getCategoryInfo(const String &categoryName) const;
-    size_t getCategoryCount() const { return categories.size(); }
+    size_t getCategoryCount() const;
+
+    /**
+     * @brief Queue a rescan of the card for the index task
+     *
+     * A request made while a job is queued joins it; one made while a job
+     * runs queues another, since the card may have changed behind the scan.
+     *
+     * @return Id of the job that will pick up the request
+     */
+    uint32_t requestRescan();
+
+    /**
+     * @brief Describe a rescan job as JSON
+     * @param jobId Job to describe, 0 for the latest
+     * @return The job's state and progress, or "{}" if it is no longer tracked
+     */
+    String getRescanJson(uint32_t jobId = 0) const;
+
+    /**
+     * @brief Block until a rescan is queued, then mark it running (index task)
+     */
+    void waitForRescan();
+
+    /**
+     * @brief Check the category index against the card and apply changes (index task)
+     *
+     * Only GIFs whose size or modification time changed are parsed. A changed
+     * index is saved and its categories replace the current ones between GIFs.
+     *
+     * @return false if GIFs were uploaded or deleted during the check and it should be repeated
+     */
+    bool maintainIndex();
+
+    /**
+     * @brief Check if frequently played GIFs are copied into flash
+     */
+    bool isStagingEnabled() const { return staging.isEnabled(); }
+
+    /**
+     * @brief Copy the most played GIF that is not staged yet into flash (staging task)
+     * @return true if it should run again right away, false if there is nothing to do for now
+     */
+    bool maintainStaging();
 
     // =============================================================================
     // File Management
@@ -92,13 +215,38 @@ public:
     bool deleteUploadedGif(const String &categoryName, const String &filename);
     bool refreshCategoryFiles(const String &categoryName);
 
+    /**
+     * @brief Start streaming an upload into a category
+     * @param upload Writer to start
+     * @param categoryName Category to store the GIF in, created if needed
+     * @param filename Filename to use
+     * @return false if the upload could not be started
+     */
+    bool beginUpload(GIFUploadWriter &upload, const String &categoryName, const String &filename);
+
+    /**
+     * @brief Store a completed upload and add it to its category
+     * @param upload Writer started with beginUpload()
+     * @param categoryName Category passed to beginUpload()
+     * @return false if the upload was rejected or could not be stored
+     */
+    bool finishUpload(GIFUploadWriter &upload, const String &categoryName);
+    String getUploadPath(const String &categoryName, const String &filename) const;
+
     // =============================================================================
     // GIF Processing and Resizing
     // =============================================================================
     bool processAndSaveGif(const String &categoryName, const String &filename, const uint8_t *data, size_t size);
-    bool resizeGif(const uint8_t *inputData, size_t inputSize, uint8_t *outputData, size_t &outputSize, int targetWidth, int targetHeight);
+    bool resizeGif(const uint8_t *inputData, size_t inputSize, std::vector<uint8_t> &output, int targetWidth, int targetHeight);
     bool validateGif(const uint8_t *data, size_t size, int &width, int &height);
 
+    /**
+     * @brief Choose how GIFs larger than the panel are fitted to it
+     * @param mode Scale mode, applied from the next GIF opened
+     */
+    void setScaleMode(ScaleMode mode);
+    ScaleMode getScaleMode() const { return scaler.getMode(); }
+
     // =============================================================================
     // Playback Control
     // =============================================================================
@@ -106,13 +254,38 @@ public:
     void setCategoryPlayback(bool playback);
     void playCategory();
     void playCurrentGif();
-    void playbackTask();
+
+    /**
+     * @brief Play the next GIF and prepare the one after it
+     * @return true if a GIF was played, false if there was nothing to do
+     */
+    bool playbackTask();
+
+    // =============================================================================
+    // Decode-Ahead Pipeline
+    // =============================================================================
+    /**
+     * @brief Check if decoding and presentation run as separate tasks
+     * @return true if the frame pipeline is active
+     */
+    bool isPipelineEnabled() const { return pipeline.isActive(); }
+
+    /**
+     * @brief Decode the next GIF into the frame pipeline (decoder task)
+     * @return true if a GIF was decoded, false if there was nothing to do
+     */
+    bool decodeTask();
+
+    /**
+     * @brief Show the next decoded frame at its deadline (presenter task)
+     */
+    void presentTask();
 
     // =============================================================================
     // Navigation
     // =============================================================================
-    String getNextGif();
-    String getPreviousGif();
+    const String &getNextGif();
+    const String &getPreviousGif();
 
     // =============================================================================
     // Status and Information
@@ -139,6 +312,10 @@ public:
     static int32_t GIFReadFile(GIFFILE *pFile, uint8_t *pBuf, int32_t iLen);
     static int32_t GIFSeekFile(GIFFILE *pFile, int32_t iPosition);
     static void *GIFOpenFile(const char *szFilename, int32_t *pSize);
+    static void drawScaledLine(int16_t x, int16_t y, const uint16_t *colors,
+                               const uint8_t *opaque, int16_t length, void *user);
+    void updateOutputPalette(const GIFDRAW *pDraw);
+    static void reportScanProgress(const IndexScanProgress &progress, void *user);
 
 private:
     // =============================================================================
@@ -156,23 +333,128 @@ private:
     AnimatedGIF gif; //< AnimatedGIF instance for GIF handling
 
     // Category management
-    std::vector<GifCategory> categories; //< List of GIF categories
+    GIFCategoryList categories;          //< Categories and their GIF files
+    GIFPlaylist playlist;                //< Order and play times within each category
+    uint32_t playlistSavedMs = 0;        //< millis() of the last playlist save
     size_t currentCategoryIndex = 0;     //< Currently selected category index
 
 
     // Playback state
     String currentGifFile;                //< Name of the current GIF file (for tracking)
+    PlayPlan playPlan;                     //< Play time of the GIF being shown or decoded
+    PlayPlan pickedPlan;                   //< Play time of the GIF last picked
+    uint32_t pickedPlayTimeMs = MAX_GIF_PLAY_TIME; //< Target play time of the GIF last picked
+    uint32_t targetPlayTimeMs = MAX_GIF_PLAY_TIME; //< Play time GIFs are rounded to whole loops of
+    uint32_t maxPlayTimeMs = DEFAULT_MAX_PLAY_TIME_MS; //< Longest a GIF plays to finish its loops
     bool categoryPlayback = false;         //< Is category playback active?
     bool powerOn = true;                   //< Power state of the display
 
+    // Decoded frame cache
+    GIFFrameCache frameCache;             //< Decoded frames of recently played GIFs
+    GIFCompositor compositor;             //< Panel-sized canvas every GIF frame is composed on
+    int16_t canvasWidth = 0;              //< Canvas width in pixels
+    int16_t canvasHeight = 0;             //< Canvas height in pixels
+    volatile bool categoryChanged = false; //< Drop cached and prepared GIFs before the next one
+    std::vector<String> stalePaths;       //< GIFs replaced or deleted on the card, guarded by indexMutex
+    bool cacheStaleAll = false;           //< Too many or unknown GIFs changed, guarded by indexMutex
+    volatile bool cacheStale = false;     //< Cached frames must be dropped before the next GIF
+
+    // Decode-ahead pipeline
+    FramePipeline pipeline;               //< Decoded frames waiting for the presenter
+    uint8_t pipelineDepth = DEFAULT_PIPELINE_DEPTH; //< Ring depth, 0 disables the pipeline
+    FrameScheduler scheduler;             //< Presentation deadlines of the playing GIF
+    GIFScaler scaler;                     //< Fits GIFs larger than the panel while decoding
+    uint16_t outputPalettes[MAX_COLOR_ZONES * 256]; //< Frame palette calibrated for each zone
+    const uint16_t *outputSource = nullptr; //< Global palette outputPalettes were built from
+    uint32_t outputVersion = 0;           //< Calibration version outputPalettes were built with
+    const ColorCalibration *frameCalibration = nullptr; //< Calibration of the frame being decoded
+    uint32_t cacheCalibrationVersion = 0; //< Calibration version of the cached frames
+    uint32_t paletteBuilds = 0;           //< Output palettes built
+
+    // Gapless transitions
+    String playbackPath;                  //< Path built by nextPlaybackPath()
+    String playingPath;                   //< Path of the GIF playbackTask() is showing
+    String nextPath;                      //< GIF picked to play next, empty if none
+    PlayPlan nextPlan;                    //< Play time of nextPath
+    bool nextPrepared = false;            //< nextPath is open with its first frame in the canvas
+    int preparedDelayMs = 0;              //< Display time of the prepared first frame
+    int preparedResult = 0;               //< playFrame() result of the prepared first frame
+    uint32_t switchDueMs = 0;             //< Time the next GIF's first frame is due
+    volatile bool switchPending = false;  //< A GIF ended and the next first frame is awaited
+    bool holdLastFrame = false;           //< The GIF just shown was a still or had no frame delays
+    SwitchStats switchStats;              //< Transition latency counters
+
+    // Category index
+    GIFCategoryIndex categoryIndex;       //< Metadata of every GIF on the card
+    bool indexComplete = false;           //< categoryIndex was loaded or scanned, not just patched
+    uint32_t indexGeneration = 0;         //< Incremented by every indexed upload or deletion
+    mutable std::mutex indexMutex;        //< Guards the index, pendingCategories, the rescan job and the swap
+    GIFCategoryList pendingCategories;    //< Next categories, swapped in by the playback task
+    volatile bool categoriesPending = false; //< pendingCategories waits to replace categories
+    String pendingSelection;              //< Category selected but not switched to by the playback task yet
+    RescanJob rescanJob;                  //< Latest rescan job
+    uint32_t queuedRescanId = 0;          //< Job waiting behind a running one, 0 if none
+    uint32_t lastRescanId = 0;            //< Last job id handed out
+    std::condition_variable rescanRequested; //< Wakes the index task for a queued job
+
     // File handling
-    File currentFile; //< Current file handle for GIF operations
+    GIFReadAhead currentFile;             //< Buffered reader for the open GIF
+    size_t readAheadBytes = DEFAULT_READ_AHEAD_BYTES; //< Read-ahead window size
+    ReadAheadStats readStats;             //< Read-ahead counters across all GIFs
+
+    // Whole-file playback
+    uint8_t *memoryGif = nullptr;         //< In-memory copy of the open GIF
+    size_t memoryPlaybackBytes = DEFAULT_MEMORY_PLAYBACK_BYTES; //< Largest GIF loaded whole
+    GifSource currentSource = GifSource::NONE; //< Source of the current GIF
+    SourceStats sourceStats;              //< Plays per source
     fs::FS &fs = FSUtils::getFS(FSType::SD); //< Filesystem reference for SD card
 
+    // Staged copies in flash
+    GIFStagingCache staging;              //< Copies of frequently played GIFs in LittleFS
+    fs::FS *openFS = &fs;                 //< Filesystem the open GIF is read from
+    String openPath;                      //< Path of the open GIF on openFS
+    String stagedSource;                  //< SD path of the staged GIF that is open, empty if none
+
     // =============================================================================
     // Private Methods
     // =============================================================================
     bool scanCategories();
+    bool loadCategoryIndex();
+    void applyPendingCategories();
+    void applyPendingSelection();
+    GIFCategoryList &editCategories();
+    const GIFCategoryList &latestCategories() const;
+    bool indexGif(const String &categoryName, const String &path, const GIFInfo *info);
+    void unindexGif(const String &categoryName, const String &filename);
+    void markStale(const String &path);
+    void dropStaleFrames();
+    static void buildCategories(const GIFCategoryIndex &index, GIFCategoryList &list);
+    static void addCategoryFile(GIFCategoryList &list, const String &categoryName,
+                                const String &filename);
+    static void removeCategoryFile(GIFCategoryList &list, const String &categoryName,
+                                   const String &filename);
+    static const char *getRescanStateName(RescanState state);
+    void loadPlaybackConfig();
+    PlayPlan planPlayback(const char *category, const char *filename, uint32_t targetMs);
+    bool playCachedGif(const CachedGif &cached);
+    const String &nextPlaybackPath();
+    bool prepareGif(const String &path, uint16_t frames);
+    void prepareNext();
+    void discardNext();
+    void blitCanvas();
+    static bool needsHold(uint32_t frames, uint32_t playedMs);
+    void holdAfterGif(uint32_t dueMs);
+    void markGifEnd();
+    void recordSwitch(uint32_t nowMs);
+    bool decodeGIF(const String &path);
+    bool decodeCachedGif(const CachedGif &cached);
+    PipelineFrame *waitForFreeSlot();
+    bool openGif(const String &path);
+    bool fitsCanvas();
+    bool openGifFromMemory(const String &path);
+    void closeGif();
+    void releaseStaged();
+    static const char *getSourceName(GifSource source);
 };
 
 #endif // ANIMATED_GIF_PANEL_H
@@ -0,0 +1,123 @@
+#include "FramePipeline.h"
+#include "GIFMemory.h"
+#include "Logger.h"
+
+FramePipeline::~FramePipeline() {
+  end();
+}
+
+// =============================================================================
+// Lifecycle
+// =============================================================================
+
+bool FramePipeline::begin(uint8_t slotCount, uint16_t frameWidth,
+                          uint16_t frameHeight) {
+  end();
+  if (slotCount < 2 || frameWidth == 0 || frameHeight == 0) {
+    return false;
+  }
+
+  size_t frameBytes = (size_t)frameWidth * frameHeight * sizeof(uint16_t);
+  slots = new PipelineFrame[slotCount];
+  depth = slotCount;
+  width = frameWidth;
+  height = frameHeight;
+
+  for (uint8_t i = 0; i < depth; i++) {
+    slots[i].pixels = static_cast<uint16_t *>(GIFMemory::allocate(frameBytes));
+    if (!slots[i].pixels) {
+      LOG_ERROR("FramePipeline: Failed to allocate %u frame slots", depth);
+      end();
+      return false;
+    }
+  }
+
+  head = tail = count = 0;
+  stats = PipelineStats();
+  return true;
+}
+
+void FramePipeline::end() {
+  if (!slots) return;
+
+  for (uint8_t i = 0; i < depth; i++) {
+    GIFMemory::release(slots[i].pixels);
+  }
+  delete[] slots;
+  slots = nullptr;
+  depth = 0;
+}
+
+// =============================================================================
+// Producer Side
+// =============================================================================
+
+PipelineFrame *FramePipeline::acquireWrite(uint32_t timeoutMs) {
+  std::unique_lock<std::mutex> guard(lock);
+  if (!notFull.wait_for(guard, std::chrono::milliseconds(timeoutMs),
+                        [this] { return count < depth; })) {
+    return nullptr;
+  }
+  return &slots[head];
+}
+
+void FramePipeline::commitWrite() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    PipelineFrame &frame = slots[head];
+    stats.produced++;
+    stats.decodeUsTotal += frame.decodeUs;
+    if (frame.decodeUs > stats.decodeUsMax) stats.decodeUsMax = frame.decodeUs;
+
+    head = (head + 1) % depth;
+    count++;
+  }
+  notEmpty.notify_one();
+}
+
+// =============================================================================
+// Consumer Side
+// =============================================================================
+
+PipelineFrame *FramePipeline::acquireRead(uint32_t timeoutMs) {
+  std::unique_lock<std::mutex> guard(lock);
+  if (count == 0) {
+    stats.underruns++;
+  }
+  if (!notEmpty.wait_for(guard, std::chrono::milliseconds(timeoutMs),
+                         [this] { return count > 0; })) {
+    return nullptr;
+  }
+  return &slots[tail];
+}
+
+void FramePipeline::releaseRead(uint32_t presentUs, uint32_t latenessMs) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stats.presented++;
+    stats.presentUsTotal += presentUs;
+    if (presentUs > stats.presentUsMax) stats.presentUsMax = presentUs;
+    if (latenessMs > 0) {
+      stats.lateFrames++;
+      if (latenessMs > stats.maxLatenessMs) stats.maxLatenessMs = latenessMs;
+    }
+
+    tail = (tail + 1) % depth;
+    count--;
+  }
+  notFull.notify_one();
+}
+
+// =============================================================================
+// Statistics
+// =============================================================================
+
+uint8_t FramePipeline::queued() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return count;
+}
+
+PipelineStats FramePipeline::getStats() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return stats;
+}
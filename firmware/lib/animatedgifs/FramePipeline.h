@@ -0,0 +1,146 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+/**
+ * @file FramePipeline.h
+ * @brief Ring of decoded frames between the GIF decoder and the panel presenter
+ *
+ * A decoder task fills free slots with complete RGB565 frames while a
+ * presenter task on the other core takes ready slots and shows them at their
+ * deadline. Only one producer and one consumer are supported.
+ */
+
+#include <Arduino.h>
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * @struct PipelineFrame
+ * @brief One slot of the ring
+ */
+struct PipelineFrame {
+    uint16_t *pixels = nullptr;     //< Complete RGB565 frame, width * height
+    uint16_t delayMs = 0;           //< Time the frame stays on screen
+    uint32_t decodeUs = 0;          //< Time spent producing the frame
+    bool lastOfGif = false;         //< Last frame the decoder produces for this GIF
+    bool holdAfter = false;         //< Last frame of a still or zero-delay GIF, held before the next
+};
+
+/**
+ * @struct PipelineStats
+ * @brief Pipeline counters and per-stage timings
+ */
+struct PipelineStats {
+    uint32_t produced = 0;          //< Frames committed by the decoder
+    uint32_t presented = 0;         //< Frames shown by the presenter
+    uint32_t lateFrames = 0;        //< Frames shown after their deadline
+    uint32_t underruns = 0;         //< Presenter waits that found the ring empty
+    uint32_t maxLatenessMs = 0;     //< Worst deadline miss
+    uint64_t decodeUsTotal = 0;     //< Sum of decode times
+    uint32_t decodeUsMax = 0;       //< Slowest decode
+    uint64_t presentUsTotal = 0;    //< Sum of blit times
+    uint32_t presentUsMax = 0;      //< Slowest blit
+
+    uint32_t avgDecodeUs() const { return produced ? decodeUsTotal / produced : 0; }
+    uint32_t avgPresentUs() const { return presented ? presentUsTotal / presented : 0; }
+};
+
+/**
+ * @class FramePipeline
+ * @brief Single-producer single-consumer ring of frame buffers
+ */
+class FramePipeline {
+public:
+    FramePipeline() = default;
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // =============================================================================
+    // Lifecycle
+    // =============================================================================
+
+    /**
+     * @brief Allocate the ring
+     * @param depth Number of frame slots (2 or more)
+     * @param width Frame width in pixels
+     * @param height Frame height in pixels
+     * @return true if all slots were allocated
+     */
+    bool begin(uint8_t depth, uint16_t width, uint16_t height);
+
+    /**
+     * @brief Release all slots
+     */
+    void end();
+
+    bool isActive() const { return slots != nullptr; }
+    uint8_t getDepth() const { return depth; }
+    uint16_t getWidth() const { return width; }
+    uint16_t getHeight() const { return height; }
+
+    // =============================================================================
+    // Producer Side
+    // =============================================================================
+
+    /**
+     * @brief Wait for a free slot to decode into
+     * @param timeoutMs Maximum wait in milliseconds
+     * @return Free slot or nullptr on timeout
+     */
+    PipelineFrame *acquireWrite(uint32_t timeoutMs);
+
+    /**
+     * @brief Hand the slot returned by acquireWrite() to the presenter
+     */
+    void commitWrite();
+
+    // =============================================================================
+    // Consumer Side
+    // =============================================================================
+
+    /**
+     * @brief Wait for the next ready frame
+     * @param timeoutMs Maximum wait in milliseconds
+     * @return Ready frame or nullptr on timeout
+     */
+    PipelineFrame *acquireRead(uint32_t timeoutMs);
+
+    /**
+     * @brief Return the slot returned by acquireRead() to the decoder
+     * @param presentUs Time spent presenting the frame
+     * @param latenessMs How far past its deadline the frame was shown
+     */
+    void releaseRead(uint32_t presentUs, uint32_t latenessMs);
+
+    // =============================================================================
+    // Statistics
+    // =============================================================================
+
+    /**
+     * @brief Number of frames waiting to be presented
+     */
+    uint8_t queued() const;
+
+    /**
+     * @brief Copy the counters
+     */
+    PipelineStats getStats() const;
+
+private:
+    PipelineFrame *slots = nullptr;     //< Ring storage
+    uint8_t depth = 0;                  //< Number of slots
+    uint16_t width = 0;                 //< Frame width
+    uint16_t height = 0;                //< Frame height
+    uint8_t head = 0;                   //< Next slot to write
+    uint8_t tail = 0;                   //< Next slot to read
+    uint8_t count = 0;                  //< Ready frames
+
+    mutable std::mutex lock;            //< Guards indices and counters
+    std::condition_variable notFull;    //< Signalled when a slot is released
+    std::condition_variable notEmpty;   //< Signalled when a frame is committed
+    PipelineStats stats;                //< Counters
+};
+
+#endif // FRAME_PIPELINE_H
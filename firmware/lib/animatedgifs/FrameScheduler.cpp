@@ -0,0 +1,55 @@
+#include "FrameScheduler.h"
+#include "constants.h"
+
+void FrameScheduler::anchor(uint32_t nowMs) {
+  deadline = nowMs;
+  anchored = true;
+}
+
+int32_t FrameScheduler::timeUntil(uint32_t nowMs, uint32_t leadMs) const {
+  if (!anchored) return 0;
+  return (int32_t)(deadline - nowMs) - (int32_t)leadMs;
+}
+
+bool FrameScheduler::shouldDrop(uint32_t nowMs, uint16_t delayMs) const {
+  if (!anchored) return false;
+  return (int32_t)(nowMs - deadline) >= (int32_t)delayMs;
+}
+
+void FrameScheduler::presented(uint32_t nowMs, uint16_t delayMs) {
+  if (!anchored) anchor(nowMs);
+
+  int32_t drift = (int32_t)(nowMs - deadline);
+  stats.presented++;
+  stats.lastDriftMs = drift;
+  if (drift > stats.maxDriftMs) stats.maxDriftMs = drift;
+  stats.absDriftTotalMs += drift < 0 ? -drift : drift;
+  if (drift > FRAME_LATE_TOLERANCE_MS) stats.late++;
+
+  if (drift > FRAME_RESYNC_MS) {
+    // Too far behind to catch up without a visible burst
+    deadline = nowMs;
+    stats.resyncs++;
+  }
+  deadline += delayMs;
+}
+
+void FrameScheduler::dropped(uint16_t delayMs) {
+  stats.dropped++;
+  deadline += delayMs;
+}
+
+void FrameScheduler::holdUntil(uint32_t ms) {
+  if (anchored && (int32_t)(ms - deadline) > 0) {
+    deadline = ms;
+  }
+}
+
+void FrameScheduler::recordDecode(uint32_t decodeUs) {
+  // Exponential moving average, 1/8 weight per sample
+  if (decodeLeadUs == 0) {
+    decodeLeadUs = decodeUs;
+  } else {
+    decodeLeadUs += ((int32_t)decodeUs - (int32_t)decodeLeadUs) / 8;
+  }
+}
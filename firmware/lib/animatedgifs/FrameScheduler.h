@@ -0,0 +1,109 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+/**
+ * @file FrameScheduler.h
+ * @brief Absolute-deadline frame pacing for GIF playback
+ *
+ * Each frame's deadline is the previous deadline plus the previous frame's
+ * delay, so decode and draw time never accumulate into the frame period.
+ * Work is started early by the measured decode time so it completes on the
+ * deadline, and frames whose whole display interval has already passed can
+ * be dropped.
+ */
+
+#include <Arduino.h>
+
+/**
+ * @struct PacingStats
+ * @brief Deadline accuracy counters
+ */
+struct PacingStats {
+    uint32_t presented = 0;         //< Frames shown
+    uint32_t dropped = 0;           //< Frames skipped because they were already stale
+    uint32_t late = 0;              //< Frames shown past deadline + tolerance
+    uint32_t resyncs = 0;           //< Times the schedule was re-anchored after falling behind
+    int32_t lastDriftMs = 0;        //< Presentation time minus deadline of the last frame
+    int32_t maxDriftMs = 0;         //< Largest drift seen
+    uint64_t absDriftTotalMs = 0;   //< Sum of absolute drift
+
+    uint32_t avgAbsDriftMs() const { return presented ? absDriftTotalMs / presented : 0; }
+};
+
+/**
+ * @class FrameScheduler
+ * @brief Computes and tracks absolute presentation deadlines
+ */
+class FrameScheduler {
+public:
+    /**
+     * @brief Forget the current schedule; the next frame re-anchors it
+     */
+    void reset() { anchored = false; }
+
+    /**
+     * @brief Start a schedule whose first deadline is now
+     * @param nowMs Current time in milliseconds
+     */
+    void anchor(uint32_t nowMs);
+
+    bool isAnchored() const { return anchored; }
+    uint32_t getDeadline() const { return deadline; }
+
+    /**
+     * @brief Time left before work taking leadMs must start to finish on the deadline
+     * @param nowMs Current time in milliseconds
+     * @param leadMs Expected duration of the work
+     * @return Milliseconds to wait, zero or negative when already due
+     */
+    int32_t timeUntil(uint32_t nowMs, uint32_t leadMs = 0) const;
+
+    /**
+     * @brief Check if a frame would only be shown after its successor is due
+     * @param nowMs Current time in milliseconds
+     * @param delayMs Display time of the frame
+     * @return true if the frame should be dropped
+     */
+    bool shouldDrop(uint32_t nowMs, uint16_t delayMs) const;
+
+    /**
+     * @brief Record that the frame due at the current deadline was shown
+     * @param nowMs Time the frame became visible
+     * @param delayMs Display time of the frame
+     */
+    void presented(uint32_t nowMs, uint16_t delayMs);
+
+    /**
+     * @brief Record that the frame due at the current deadline was dropped
+     * @param delayMs Display time of the frame
+     */
+    void dropped(uint16_t delayMs);
+
+    /**
+     * @brief Push the current deadline back to at least the given time
+     * @param ms Earliest time the next frame may be shown
+     */
+    void holdUntil(uint32_t ms);
+
+    /**
+     * @brief Feed a measured decode time into the lead estimate
+     * @param decodeUs Decode duration in microseconds
+     */
+    void recordDecode(uint32_t decodeUs);
+
+    /**
+     * @brief Expected decode duration used to start work early
+     * @return Lead time in milliseconds
+     */
+    uint32_t getDecodeLeadMs() const { return decodeLeadUs / 1000; }
+
+    const PacingStats &getStats() const { return stats; }
+
+private:
+    bool anchored = false;          //< Whether deadline is valid
+    uint32_t deadline = 0;          //< Absolute deadline of the next frame
+    uint32_t decodeLeadUs = 0;      //< Smoothed decode duration
+    PacingStats stats;              //< Counters
+};
+
+#endif // FRAME_SCHEDULER_H
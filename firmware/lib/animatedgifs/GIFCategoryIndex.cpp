@@ -0,0 +1,352 @@
+#include "GIFCategoryIndex.h"
+#include <string.h>
+
+#include "GIFMemory.h"
+#include "Logger.h"
+#include "RecordIO.h"
+
+namespace {
+
+const uint8_t MAGIC[4] = {'G', 'I', 'D', 'X'};
+
+/** @brief Magic, version, category count and GIF count */
+const size_t HEADER_BYTES = 12;
+
+/** @brief Smallest record of one GIF: empty name and metadata */
+const size_t FILE_RECORD_BYTES = 1 + 18;
+
+/** @brief Bytes read per call while parsing a changed GIF */
+const size_t PARSE_CHUNK_BYTES = 4096;
+
+/** @brief Suffix of the file an index is written to before replacing the old one */
+const char *TEMP_SUFFIX = ".tmp";
+
+} // namespace
+
+bool GIFCategoryIndex::load(fs::FS &fs, const char *path) {
+  clear();
+
+  File file = fs.open(path, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  size_t size = file.size();
+  if (size < HEADER_BYTES + RECORD_CHECKSUM_BYTES) {
+    file.close();
+    LOG_WARNING("GIFCategoryIndex: %s is too short", path);
+    return false;
+  }
+
+  uint8_t *data = static_cast<uint8_t *>(GIFMemory::allocate(size));
+  if (!data) {
+    file.close();
+    LOG_ERROR("GIFCategoryIndex: Cannot allocate %u bytes for %s", (unsigned)size, path);
+    return false;
+  }
+  size_t got = file.read(data, size);
+  file.close();
+
+  if (got != size || !verifyRecordFile(data, size, MAGIC)) {
+    GIFMemory::release(data);
+    LOG_WARNING("GIFCategoryIndex: %s is corrupt", path);
+    return false;
+  }
+
+  size_t payload = size - RECORD_CHECKSUM_BYTES;
+  RecordReader reader(data + sizeof(MAGIC), payload - sizeof(MAGIC));
+  uint16_t version = reader.get16();
+  if (version != VERSION) {
+    GIFMemory::release(data);
+    LOG_WARNING("GIFCategoryIndex: %s has version %u, expected %u", path, version, VERSION);
+    return false;
+  }
+
+  uint16_t categoryCount = reader.get16();
+  uint32_t gifCount = reader.get32();
+  bool valid = gifCount <= payload / FILE_RECORD_BYTES;
+  if (valid) {
+    // Names take at most what the file does, so nothing grows while filling
+    list.reserve(categoryCount, gifCount, payload);
+    metadata.reserve(gifCount);
+  }
+
+  char name[UINT8_MAX + 1];
+  for (uint16_t c = 0; c < categoryCount && valid; c++) {
+    size_t category = list.addCategory(reader.getName(name));
+    uint32_t count = reader.get32();
+    valid = reader.isValid() && count <= gifCount - list.getFileCount();
+    for (uint32_t i = 0; i < count && valid; i++) {
+      list.addFile(category, reader.getName(name));
+      GIFMetadata entry;
+      entry.size = reader.get32();
+      entry.mtime = reader.get32();
+      entry.width = reader.get16();
+      entry.height = reader.get16();
+      entry.frames = reader.get16();
+      entry.durationMs = reader.get32();
+      metadata.push_back(entry);
+      valid = reader.isValid();
+    }
+  }
+  valid = valid && reader.atEnd() && list.getFileCount() == gifCount;
+  GIFMemory::release(data);
+
+  if (!valid) {
+    clear();
+    LOG_WARNING("GIFCategoryIndex: %s does not match its header", path);
+    return false;
+  }
+  return true;
+}
+
+bool GIFCategoryIndex::save(fs::FS &fs, const char *path) const {
+  String tempPath = String(path) + TEMP_SUFFIX;
+  File file = fs.open(tempPath, FILE_WRITE);
+  if (!file) {
+    LOG_ERROR("GIFCategoryIndex: Failed to create %s", tempPath.c_str());
+    return false;
+  }
+
+  RecordWriter writer(file);
+  writer.put(MAGIC, sizeof(MAGIC));
+  writer.put16(VERSION);
+  writer.put16(list.size());
+  writer.put32(list.getFileCount());
+  for (size_t c = 0; c < list.size(); c++) {
+    writer.putName(list.getName(c));
+    writer.put32(list.getFileCount(c));
+    for (size_t i = 0; i < list.getFileCount(c); i++) {
+      const GIFMetadata &entry = getMetadata(c, i);
+      writer.putName(list.getFile(c, i));
+      writer.put32(entry.size);
+      writer.put32(entry.mtime);
+      writer.put16(entry.width);
+      writer.put16(entry.height);
+      writer.put16(entry.frames);
+      writer.put32(entry.durationMs);
+    }
+  }
+  bool ok = writer.finish();
+  file.close();
+
+  if (!ok || !replaceRecordFile(fs, tempPath, path)) {
+    LOG_ERROR("GIFCategoryIndex: Failed to write %s", path);
+    fs.remove(tempPath);
+    return false;
+  }
+  return true;
+}
+
+bool GIFCategoryIndex::scan(fs::FS &fs, const char *basePath, const GIFCategoryIndex *previous,
+                            ProgressSink sink, void *user) {
+  uint32_t startMs = millis();
+  clear();
+  scanStats = IndexScanStats();
+
+  File root = fs.open(basePath);
+  if (!root || !root.isDirectory()) {
+    LOG_ERROR("GIFCategoryIndex: Failed to open %s", basePath);
+    return false;
+  }
+  if (previous) {
+    list.reserve(previous->list.size(), previous->getGifCount(), 0);
+    metadata.reserve(previous->getGifCount());
+  }
+
+  uint8_t *buffer = nullptr;
+  std::vector<uint32_t> order;
+  IndexScanProgress progress;
+  File entry = root.openNextFile();
+  while (entry) {
+    const char *categoryName = entry.name();
+    if (entry.isDirectory() && categoryName[0] != '.') {
+      size_t category = list.addCategory(categoryName);
+      size_t known = previous ? previous->list.findCategory(categoryName)
+                              : GIFCategoryList::NOT_FOUND;
+      scanStats.directories++;
+
+      File gifFile = entry.openNextFile();
+      while (gifFile) {
+        const char *filename = gifFile.name();
+        size_t length = strlen(filename);
+        if (!gifFile.isDirectory() && length > 4 &&
+            (strcmp(filename + length - 4, ".gif") == 0 ||
+             strcmp(filename + length - 4, ".GIF") == 0)) {
+          GIFMetadata found;
+          found.size = gifFile.size();
+          found.mtime = lastWrite(gifFile);
+
+          size_t index = known != GIFCategoryList::NOT_FOUND
+                             ? previous->findFile(known, filename)
+                             : GIFCategoryList::NOT_FOUND;
+          const GIFMetadata *old =
+              index != GIFCategoryList::NOT_FOUND ? &previous->getMetadata(known, index) : nullptr;
+
+          if (old && old->size == found.size && old->mtime == found.mtime) {
+            found = *old;
+            scanStats.reused++;
+          } else {
+            if (!buffer) {
+              buffer = static_cast<uint8_t *>(GIFMemory::allocate(PARSE_CHUNK_BYTES));
+            }
+            if (buffer) {
+              parse(gifFile, buffer, PARSE_CHUNK_BYTES, found);
+            }
+            scanStats.parsed++;
+          }
+          list.addFile(category, filename);
+          metadata.push_back(found);
+          scanStats.files++;
+          if (sink) {
+            progress.files = scanStats.files;
+            progress.parsed = scanStats.parsed;
+            sink(progress, user);
+          }
+        }
+        gifFile = entry.openNextFile();
+      }
+
+      // The category's files are the last slots, so their metadata follows the sort
+      list.sortFiles(category, &order);
+      size_t first = list.getSlot(category, 0);
+      std::vector<GIFMetadata> unsorted(metadata.begin() + first, metadata.end());
+      for (size_t i = 0; i < order.size(); i++) {
+        metadata[first + i] = unsorted[order[i]];
+      }
+      if (sink) {
+        progress.directories = scanStats.directories;
+        sink(progress, user);
+      }
+    }
+    entry = root.openNextFile();
+  }
+  root.close();
+  GIFMemory::release(buffer);
+  list.sortCategories();
+
+  scanStats.elapsedMs = millis() - startMs;
+  LOG_INFO("GIFCategoryIndex: Scanned %u GIFs in %u categories (%u parsed) in %u ms",
+           (unsigned)scanStats.files, (unsigned)scanStats.directories,
+           (unsigned)scanStats.parsed, (unsigned)scanStats.elapsedMs);
+  return true;
+}
+
+bool GIFCategoryIndex::describe(fs::FS &fs, const String &path, GIFMetadata &metadata,
+                                const GIFInfo *info) {
+  File file = fs.open(path, FILE_READ);
+  if (!file) {
+    LOG_ERROR("GIFCategoryIndex: Failed to open %s", path.c_str());
+    return false;
+  }
+
+  metadata = GIFMetadata();
+  metadata.size = file.size();
+  metadata.mtime = lastWrite(file);
+  if (info) {
+    apply(*info, metadata);
+  } else {
+    uint8_t *buffer = static_cast<uint8_t *>(GIFMemory::allocate(PARSE_CHUNK_BYTES));
+    if (buffer) {
+      parse(file, buffer, PARSE_CHUNK_BYTES, metadata);
+      GIFMemory::release(buffer);
+    }
+  }
+  file.close();
+  return true;
+}
+
+void GIFCategoryIndex::put(const String &category, const String &filename,
+                           const GIFMetadata &entry) {
+  size_t target = list.findCategory(category.c_str());
+  if (target == GIFCategoryList::NOT_FOUND) {
+    list.addCategory(category.c_str());
+    list.sortCategories();
+    target = list.findCategory(category.c_str());
+  }
+
+  size_t index = list.lowerBound(target, filename.c_str());
+  if (index < list.getFileCount(target) && filename == list.getFile(target, index)) {
+    metadata[list.getSlot(target, index)] = entry;
+  } else {
+    size_t slot = list.insertFile(target, index, filename.c_str());
+    metadata.insert(metadata.begin() + slot, entry);
+  }
+}
+
+bool GIFCategoryIndex::remove(const String &category, const String &filename) {
+  size_t target = list.findCategory(category.c_str());
+  if (target == GIFCategoryList::NOT_FOUND) {
+    return false;
+  }
+  size_t index = findFile(target, filename.c_str());
+  if (index == GIFCategoryList::NOT_FOUND) {
+    return false;
+  }
+  size_t slot = list.removeFile(target, index);
+  metadata.erase(metadata.begin() + slot);
+  return true;
+}
+
+const GIFMetadata *GIFCategoryIndex::find(const char *category, const char *filename) const {
+  size_t target = list.findCategory(category);
+  if (target == GIFCategoryList::NOT_FOUND) {
+    return nullptr;
+  }
+  size_t index = findFile(target, filename);
+  return index != GIFCategoryList::NOT_FOUND ? &getMetadata(target, index) : nullptr;
+}
+
+bool GIFCategoryIndex::matches(const GIFCategoryIndex &other) const {
+  if (!list.matches(other.list)) {
+    return false;
+  }
+  for (size_t c = 0; c < list.size(); c++) {
+    for (size_t i = 0; i < list.getFileCount(c); i++) {
+      if (getMetadata(c, i) != other.getMetadata(c, i)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void GIFCategoryIndex::clear() {
+  list.clear();
+  metadata.clear();
+}
+
+size_t GIFCategoryIndex::findFile(size_t category, const char *filename) const {
+  // Files are sorted, so a binary search finds them
+  size_t index = list.lowerBound(category, filename);
+  return index < list.getFileCount(category) && strcmp(list.getFile(category, index), filename) == 0
+             ? index
+             : GIFCategoryList::NOT_FOUND;
+}
+
+uint32_t GIFCategoryIndex::lastWrite(File &file) {
+  return (uint32_t)file.getLastWrite();
+}
+
+void GIFCategoryIndex::parse(File &file, uint8_t *buffer, size_t bufferSize,
+                             GIFMetadata &metadata) {
+  // Large GIFs copied onto the card by hand are still listed, so no size limit here
+  GIFValidator validator;
+  validator.begin(UINT16_MAX);
+
+  size_t got;
+  while (!validator.isComplete() && (got = file.read(buffer, bufferSize)) > 0) {
+    if (!validator.feed(buffer, got)) {
+      break;
+    }
+  }
+  if (validator.finish()) {
+    apply(validator.getInfo(), metadata);
+  }
+}
+
+void GIFCategoryIndex::apply(const GIFInfo &info, GIFMetadata &metadata) {
+  metadata.width = info.width;
+  metadata.height = info.height;
+  metadata.frames = min(info.frames, (uint32_t)UINT16_MAX);
+  metadata.durationMs = info.durationMs;
+}
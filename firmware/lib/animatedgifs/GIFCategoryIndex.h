@@ -0,0 +1,208 @@
+#ifndef GIF_CATEGORY_INDEX_H
+#define GIF_CATEGORY_INDEX_H
+
+/**
+ * @file GIFCategoryIndex.h
+ * @brief Persistent index of the GIF categories on the SD card
+ *
+ * Walking every category directory at boot opens each file on the card,
+ * which takes tens of seconds on large libraries. The index keeps the
+ * categories, filenames, sizes, modification times, dimensions and frame
+ * counts in one binary file that is read in a single call. Uploads and
+ * deletions update it in place; a background scan compares it with the
+ * card and only parses GIFs whose size or modification time changed.
+ *
+ * Names live in a GIFCategoryList with the metadata of each file in a
+ * parallel array indexed by slot, so the resident index is a handful of
+ * allocations regardless of the number of GIFs. Categories and the files
+ * within each are kept sorted by name.
+ *
+ * File layout (little-endian):
+ *   "GIDX", version (u16), category count (u16), GIF count (u32)
+ *   per category: name length (u8), name, GIF count (u32)
+ *     per GIF: name length (u8), name, size (u32), mtime (u32),
+ *              width (u16), height (u16), frames (u16), duration ms (u32)
+ *   FNV-1a checksum of everything before it (u32)
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+
+#include "GIFCategoryList.h"
+#include "GIFValidator.h"
+#include "constants.h"
+
+/**
+ * @struct GIFMetadata
+ * @brief What the index records about one GIF besides its name
+ */
+struct GIFMetadata {
+    uint32_t size = 0;              //< File size in bytes
+    uint32_t mtime = 0;             //< Last write time
+    uint16_t width = 0;             //< Logical screen width, 0 if the file did not parse
+    uint16_t height = 0;            //< Logical screen height
+    uint16_t frames = 0;            //< Number of frames
+    uint32_t durationMs = 0;        //< Length of one loop
+
+    bool operator==(const GIFMetadata &other) const {
+        return size == other.size && mtime == other.mtime && width == other.width &&
+               height == other.height && frames == other.frames &&
+               durationMs == other.durationMs;
+    }
+    bool operator!=(const GIFMetadata &other) const { return !(*this == other); }
+};
+
+/**
+ * @struct IndexScanStats
+ * @brief Cost of the last scan
+ */
+struct IndexScanStats {
+    uint32_t directories = 0;       //< Category directories walked
+    uint32_t files = 0;             //< GIFs found
+    uint32_t reused = 0;            //< GIFs whose entry was taken from the previous index
+    uint32_t parsed = 0;            //< GIFs read and parsed
+    uint32_t elapsedMs = 0;         //< Duration of the scan
+};
+
+/**
+ * @struct IndexScanProgress
+ * @brief Counters of a running scan, reported as it goes
+ */
+struct IndexScanProgress {
+    uint32_t directories = 0;       //< Category directories walked so far
+    uint32_t files = 0;             //< GIFs found so far
+    uint32_t parsed = 0;            //< GIFs parsed so far
+};
+
+/**
+ * @class GIFCategoryIndex
+ * @brief In-memory category index with binary load and save
+ */
+class GIFCategoryIndex {
+public:
+    /** @brief Format version written to the file */
+    static const uint16_t VERSION = 1;
+
+    /**
+     * @brief Receives the counters of a running scan
+     * @param progress Counters after the latest GIF or directory
+     * @param user Pointer passed to scan()
+     */
+    typedef void (*ProgressSink)(const IndexScanProgress &progress, void *user);
+
+    /**
+     * @brief Replace the index with the contents of an index file
+     * @param fs Filesystem holding the file
+     * @param path Index file
+     * @return false if the file is missing, from another version or corrupt; the index is cleared
+     */
+    bool load(fs::FS &fs, const char *path = GIF_INDEX_PATH);
+
+    /**
+     * @brief Write the index to a temporary file and move it over the index file
+     * @param fs Filesystem to write to
+     * @param path Index file
+     * @return false if the file could not be written; the previous file is kept
+     */
+    bool save(fs::FS &fs, const char *path = GIF_INDEX_PATH) const;
+
+    /**
+     * @brief Rebuild the index from the category directories on a filesystem
+     *
+     * Entries of @p previous whose size and modification time still match
+     * are reused; every other GIF is parsed.
+     *
+     * @param fs Filesystem to scan
+     * @param basePath Directory holding one directory per category
+     * @param previous Index to take unchanged entries from, may be nullptr
+     * @param sink Called with the counters after every GIF and directory, may be nullptr
+     * @param user Passed through to the sink
+     * @return false if the base directory could not be opened
+     */
+    bool scan(fs::FS &fs, const char *basePath = GIFS_BASE_PATH,
+              const GIFCategoryIndex *previous = nullptr, ProgressSink sink = nullptr,
+              void *user = nullptr);
+
+    /**
+     * @brief Fill an entry from a file on a filesystem
+     * @param fs Filesystem holding the file
+     * @param path Path of the GIF
+     * @param metadata Entry to fill
+     * @param info Parse result of the file if already known, nullptr to parse it
+     * @return false if the file could not be opened
+     */
+    static bool describe(fs::FS &fs, const String &path, GIFMetadata &metadata,
+                         const GIFInfo *info = nullptr);
+
+    /**
+     * @brief Add or replace a GIF, creating its category if needed
+     * @param category Category name, matched ignoring case
+     * @param filename Filename
+     * @param metadata Entry to store
+     */
+    void put(const String &category, const String &filename, const GIFMetadata &metadata);
+
+    /**
+     * @brief Remove a GIF
+     * @param category Category name, matched ignoring case
+     * @param filename Filename to remove
+     * @return true if the GIF was indexed
+     */
+    bool remove(const String &category, const String &filename);
+
+    /**
+     * @brief Find a GIF
+     * @param category Category name, matched ignoring case
+     * @param filename Filename
+     * @return The entry, or nullptr if it is not indexed
+     */
+    const GIFMetadata *find(const char *category, const char *filename) const;
+
+    /**
+     * @brief Check whether two indexes describe the same files
+     */
+    bool matches(const GIFCategoryIndex &other) const;
+
+    void clear();
+    size_t getGifCount() const { return list.getFileCount(); }
+    const GIFCategoryList &getList() const { return list; }
+
+    const GIFMetadata &getMetadata(size_t category, size_t index) const {
+        return metadata[list.getSlot(category, index)];
+    }
+
+    /**
+     * @brief Heap bytes held by the index
+     */
+    size_t getMemoryBytes() const {
+        return list.getMemoryBytes() + metadata.capacity() * sizeof(GIFMetadata);
+    }
+
+    const IndexScanStats &getScanStats() const { return scanStats; }
+
+private:
+    /**
+     * @brief Find a file in a category
+     * @return Index within the category, or GIFCategoryList::NOT_FOUND
+     */
+    size_t findFile(size_t category, const char *filename) const;
+
+    /**
+     * @brief Read the modification time of an open file in index units
+     */
+    static uint32_t lastWrite(File &file);
+
+    /**
+     * @brief Parse an open GIF from its current position to the end
+     */
+    static void parse(File &file, uint8_t *buffer, size_t bufferSize, GIFMetadata &metadata);
+
+    static void apply(const GIFInfo &info, GIFMetadata &metadata);
+
+    GIFCategoryList list;                   //< Category and file names, sorted
+    std::vector<GIFMetadata> metadata;      //< Metadata of each file slot
+    IndexScanStats scanStats;               //< Result of the last scan()
+};
+
+#endif // GIF_CATEGORY_INDEX_H
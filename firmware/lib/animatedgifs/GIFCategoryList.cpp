@@ -0,0 +1,164 @@
+#include "GIFCategoryList.h"
+#include <algorithm>
+#include <string.h>
+
+size_t GIFCategoryList::findCategory(const char *name) const {
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (strcasecmp(getName(i), name) == 0) {
+      return i;
+    }
+  }
+  return NOT_FOUND;
+}
+
+size_t GIFCategoryList::findFile(size_t category, const char *filename) const {
+  const Entry &entry = entries[category];
+  for (size_t i = 0; i < entry.count; i++) {
+    if (strcmp(&names[files[entry.first + i]], filename) == 0) {
+      return i;
+    }
+  }
+  return NOT_FOUND;
+}
+
+size_t GIFCategoryList::lowerBound(size_t category, const char *filename) const {
+  const Entry &entry = entries[category];
+  auto begin = files.begin() + entry.first;
+  auto it = std::lower_bound(begin, begin + entry.count, filename,
+                             [this](uint32_t offset, const char *name) {
+                               return strcmp(&names[offset], name) < 0;
+                             });
+  return it - begin;
+}
+
+size_t GIFCategoryList::addCategory(const char *name) {
+  Entry entry;
+  entry.name = store(name);
+  entry.first = files.size();
+  entry.count = 0;
+  entries.push_back(entry);
+  return entries.size() - 1;
+}
+
+size_t GIFCategoryList::insertFile(size_t category, size_t index, const char *filename) {
+  size_t slot = entries[category].first + index;
+  uint32_t offset = store(filename);
+  files.insert(files.begin() + slot, offset);
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (i != category && entries[i].first >= slot) {
+      entries[i].first++;
+    }
+  }
+  entries[category].count++;
+  return slot;
+}
+
+size_t GIFCategoryList::removeFile(size_t category, size_t index) {
+  size_t slot = entries[category].first + index;
+  unusedBytes += strlen(&names[files[slot]]) + 1;
+  files.erase(files.begin() + slot);
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (i != category && entries[i].first > slot) {
+      entries[i].first--;
+    }
+  }
+  entries[category].count--;
+
+  // Keep removed names from piling up on long-running devices
+  if (unusedBytes > names.size() / 2) {
+    compact();
+  }
+  return slot;
+}
+
+void GIFCategoryList::sortFiles(size_t category, std::vector<uint32_t> *order) {
+  const Entry &entry = entries[category];
+  std::vector<uint32_t> sorted(entry.count);
+  for (uint32_t i = 0; i < entry.count; i++) {
+    sorted[i] = i;
+  }
+  auto begin = files.begin() + entry.first;
+  std::sort(sorted.begin(), sorted.end(), [this, &begin](uint32_t a, uint32_t b) {
+    return strcmp(&names[begin[a]], &names[begin[b]]) < 0;
+  });
+
+  std::vector<uint32_t> offsets(begin, begin + entry.count);
+  for (uint32_t i = 0; i < entry.count; i++) {
+    begin[i] = offsets[sorted[i]];
+  }
+  if (order) {
+    order->swap(sorted);
+  }
+}
+
+void GIFCategoryList::sortCategories() {
+  std::sort(entries.begin(), entries.end(), [this](const Entry &a, const Entry &b) {
+    return strcmp(&names[a.name], &names[b.name]) < 0;
+  });
+}
+
+void GIFCategoryList::reserve(size_t categories, size_t fileCount, size_t nameBytes) {
+  entries.reserve(categories);
+  files.reserve(fileCount);
+  names.reserve(nameBytes);
+}
+
+void GIFCategoryList::compact() {
+  if (unusedBytes == 0) {
+    return;
+  }
+
+  std::vector<char> packed;
+  packed.reserve(names.size() - unusedBytes);
+  auto move = [&](uint32_t &offset) {
+    const char *name = &names[offset];
+    offset = packed.size();
+    packed.insert(packed.end(), name, name + strlen(name) + 1);
+  };
+  for (Entry &entry : entries) {
+    move(entry.name);
+  }
+  for (uint32_t &offset : files) {
+    move(offset);
+  }
+  names.swap(packed);
+  unusedBytes = 0;
+}
+
+void GIFCategoryList::clear() {
+  names.clear();
+  files.clear();
+  entries.clear();
+  unusedBytes = 0;
+}
+
+size_t GIFCategoryList::getMemoryBytes() const {
+  return names.capacity() + files.capacity() * sizeof(uint32_t) +
+         entries.capacity() * sizeof(Entry);
+}
+
+bool GIFCategoryList::matches(const GIFCategoryList &other) const {
+  if (entries.size() != other.entries.size() || files.size() != other.files.size()) {
+    return false;
+  }
+  for (size_t c = 0; c < entries.size(); c++) {
+    if (strcmp(getName(c), other.getName(c)) != 0 ||
+        getFileCount(c) != other.getFileCount(c)) {
+      return false;
+    }
+    for (size_t i = 0; i < getFileCount(c); i++) {
+      if (strcmp(getFile(c, i), other.getFile(c, i)) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+uint32_t GIFCategoryList::store(const char *name) {
+  uint32_t offset = names.size();
+  names.insert(names.end(), name, name + strlen(name) + 1);
+  return offset;
+}
@@ -0,0 +1,169 @@
+#ifndef GIF_CATEGORY_LIST_H
+#define GIF_CATEGORY_LIST_H
+
+/**
+ * @file GIFCategoryList.h
+ * @brief Packed list of categories and their GIF filenames
+ *
+ * A String per filename costs one heap block each, which fragments the
+ * heap on cards with thousands of GIFs. The list instead keeps every name
+ * NUL-terminated in one character table and refers to it by offset: the
+ * files of each category are a contiguous run of offsets in one array, and
+ * each category is a name offset plus the start and length of its run. The
+ * whole list is three allocations however many GIFs it holds, and looking
+ * names up never allocates.
+ *
+ * Each file has a slot, its position in the offset array. Slots let other
+ * tables keep per-file data alongside the list; insertFile() and
+ * removeFile() report the slot they moved so those tables can follow.
+ * Names of removed files stay in the table until compact().
+ */
+
+#include <Arduino.h>
+#include <vector>
+
+/**
+ * @class GIFCategoryList
+ * @brief Category and filename table stored as offsets into one buffer
+ */
+class GIFCategoryList {
+public:
+    /** @brief Returned by the find methods when nothing matches */
+    static const size_t NOT_FOUND = (size_t)-1;
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    /**
+     * @brief Number of files in all categories
+     */
+    size_t getFileCount() const { return files.size(); }
+
+    const char *getName(size_t category) const { return &names[entries[category].name]; }
+    size_t getFileCount(size_t category) const { return entries[category].count; }
+
+    const char *getFile(size_t category, size_t index) const {
+        return &names[files[entries[category].first + index]];
+    }
+
+    /**
+     * @brief Slot of a file, its position across all categories
+     */
+    size_t getSlot(size_t category, size_t index) const { return entries[category].first + index; }
+
+    /**
+     * @brief Find a category
+     * @param name Category name, matched ignoring case
+     * @return Category index, or NOT_FOUND
+     */
+    size_t findCategory(const char *name) const;
+
+    /**
+     * @brief Find a file in a category
+     * @param category Category index
+     * @param filename Filename, matched exactly
+     * @return Index within the category, or NOT_FOUND
+     */
+    size_t findFile(size_t category, const char *filename) const;
+
+    /**
+     * @brief Position a file would be inserted at to keep a category sorted
+     * @param category Category index
+     * @param filename Filename
+     * @return Index within the category of the first file not before @p filename
+     */
+    size_t lowerBound(size_t category, const char *filename) const;
+
+    /**
+     * @brief Add an empty category after the existing ones
+     * @param name Category name
+     * @return Index of the new category
+     */
+    size_t addCategory(const char *name);
+
+    /**
+     * @brief Insert a file into a category
+     * @param category Category index
+     * @param index Position within the category
+     * @param filename Filename
+     * @return Slot of the new file; slots from it onwards moved up by one
+     */
+    size_t insertFile(size_t category, size_t index, const char *filename);
+
+    /**
+     * @brief Add a file at the end of a category
+     * @return Slot of the new file
+     */
+    size_t addFile(size_t category, const char *filename) {
+        return insertFile(category, entries[category].count, filename);
+    }
+
+    /**
+     * @brief Remove a file from a category
+     * @param category Category index
+     * @param index Position within the category
+     * @return Slot the file had; slots after it moved down by one
+     */
+    size_t removeFile(size_t category, size_t index);
+
+    /**
+     * @brief Sort the files of a category by name
+     * @param category Category index
+     * @param order Receives the old index of each file in its new position, may be nullptr
+     */
+    void sortFiles(size_t category, std::vector<uint32_t> *order = nullptr);
+
+    /**
+     * @brief Sort the categories by name; file slots do not move
+     */
+    void sortCategories();
+
+    /**
+     * @brief Reserve room to avoid growing while filling
+     * @param categories Expected categories
+     * @param files Expected files
+     * @param nameBytes Expected bytes of names, terminators included
+     */
+    void reserve(size_t categories, size_t files, size_t nameBytes);
+
+    /**
+     * @brief Drop the names of removed files from the table
+     */
+    void compact();
+
+    void clear();
+
+    /**
+     * @brief Heap bytes held by the list
+     */
+    size_t getMemoryBytes() const;
+
+    /**
+     * @brief Check whether two lists hold the same names in the same order
+     */
+    bool matches(const GIFCategoryList &other) const;
+
+private:
+    /**
+     * @struct Entry
+     * @brief One category: its name and its run of file slots
+     */
+    struct Entry {
+        uint32_t name;      //< Offset of the name in the table
+        uint32_t first;     //< First file slot
+        uint32_t count;     //< Number of files
+    };
+
+    /**
+     * @brief Append a name to the table
+     * @return Offset of the name
+     */
+    uint32_t store(const char *name);
+
+    std::vector<char> names;        //< NUL-terminated names
+    std::vector<uint32_t> files;    //< Name offset of every file, grouped by category
+    std::vector<Entry> entries;     //< Categories
+    size_t unusedBytes = 0;         //< Table bytes of removed files
+};
+
+#endif // GIF_CATEGORY_LIST_H
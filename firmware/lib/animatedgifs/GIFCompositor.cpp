@@ -0,0 +1,170 @@
+#include "GIFCompositor.h"
+#include "GIFMemory.h"
+#include "Logger.h"
+
+GIFCompositor::~GIFCompositor() {
+  end();
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+bool GIFCompositor::begin(int16_t canvasWidth, int16_t canvasHeight) {
+  end();
+  canvas = static_cast<uint16_t *>(
+      GIFMemory::allocate((size_t)canvasWidth * canvasHeight * sizeof(uint16_t)));
+  if (!canvas) {
+    LOG_ERROR("GIFCompositor: Failed to allocate a %dx%d canvas", canvasWidth, canvasHeight);
+    return false;
+  }
+  width = canvasWidth;
+  height = canvasHeight;
+  reset();
+  return true;
+}
+
+void GIFCompositor::end() {
+  GIFMemory::release(canvas);
+  GIFMemory::release(restore);
+  canvas = nullptr;
+  restore = nullptr;
+  width = 0;
+  height = 0;
+}
+
+void GIFCompositor::reset() {
+  if (canvas) {
+    memset(canvas, 0, (size_t)width * height * sizeof(uint16_t));
+  }
+  pendingRect = DirtyRect();
+  pendingDisposal = 0;
+  changed = DirtyRect();
+}
+
+// ============================================================================
+// Composition
+// ============================================================================
+
+/**
+ * @brief Dispose of the previous frame and save what a method 3 frame covers
+ */
+void GIFCompositor::beginFrame(int16_t x, int16_t y, int16_t frameWidth,
+                               int16_t frameHeight, uint8_t disposal) {
+  changed = DirtyRect();
+  if (!canvas) return;
+  stats.frames++;
+
+  if (pendingDisposal == DISPOSE_BACKGROUND) {
+    for (int16_t row = pendingRect.y0; row < pendingRect.y1; row++) {
+      memset(canvas + (size_t)row * width + pendingRect.x0, 0,
+             pendingRect.width() * sizeof(uint16_t));
+    }
+    changed = pendingRect;
+    stats.cleared++;
+  } else if (pendingDisposal == DISPOSE_PREVIOUS && restore) {
+    copyRect(canvas, restore, pendingRect);
+    changed = pendingRect;
+    stats.restored++;
+  }
+
+  DirtyRect rect;
+  rect.x0 = x;
+  rect.y0 = y;
+  rect.x1 = x + frameWidth;
+  rect.y1 = y + frameHeight;
+  if (!clip(rect)) {
+    pendingDisposal = 0;
+    return;
+  }
+
+  if (disposal == DISPOSE_PREVIOUS) {
+    if (!restore) {
+      restore = static_cast<uint16_t *>(
+          GIFMemory::allocate((size_t)width * height * sizeof(uint16_t)));
+      if (!restore) {
+        LOG_WARNING("GIFCompositor: No memory to restore frames, keeping them instead");
+      }
+    }
+    if (restore) {
+      copyRect(restore, canvas, rect);
+    }
+  }
+
+  pendingRect = rect;
+  pendingDisposal = disposal;
+}
+
+void GIFCompositor::drawIndexedLine(int16_t x, int16_t y, const uint8_t *indices,
+                                    const uint16_t *palette, int16_t length,
+                                    int16_t transparent) {
+  if (!canvas || y < 0 || y >= height) return;
+  if (x < 0) {
+    indices -= x;
+    length += x;
+    x = 0;
+  }
+  if (x + length > width) length = width - x;
+  if (length <= 0) return;
+
+  uint16_t *row = canvas + (size_t)y * width + x;
+  if (transparent < 0) {
+    for (int16_t i = 0; i < length; i++) {
+      row[i] = palette[indices[i]];
+    }
+  } else {
+    const uint8_t key = static_cast<uint8_t>(transparent);
+    for (int16_t i = 0; i < length; i++) {
+      if (indices[i] != key) {
+        row[i] = palette[indices[i]];
+      }
+    }
+  }
+  changed.addSpan(x, y, length);
+}
+
+void GIFCompositor::drawLine(int16_t x, int16_t y, const uint16_t *colors,
+                             const uint8_t *opaque, int16_t length) {
+  if (!canvas || y < 0 || y >= height) return;
+  if (x < 0) {
+    colors -= x;
+    opaque -= x;
+    length += x;
+    x = 0;
+  }
+  if (x + length > width) length = width - x;
+  if (length <= 0) return;
+
+  uint16_t *row = canvas + (size_t)y * width + x;
+  for (int16_t i = 0; i < length; i++) {
+    if (opaque[i]) {
+      row[i] = colors[i];
+    }
+  }
+  changed.addSpan(x, y, length);
+}
+
+void GIFCompositor::present(SpanBlitter &blitter) const {
+  for (int16_t y = changed.y0; y < changed.y1; y++) {
+    blitter.blitSpan(changed.x0, y, canvas + (size_t)y * width + changed.x0, changed.width());
+  }
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+bool GIFCompositor::clip(DirtyRect &rect) const {
+  if (rect.x0 < 0) rect.x0 = 0;
+  if (rect.y0 < 0) rect.y0 = 0;
+  if (rect.x1 > width) rect.x1 = width;
+  if (rect.y1 > height) rect.y1 = height;
+  return !rect.isEmpty();
+}
+
+void GIFCompositor::copyRect(uint16_t *to, const uint16_t *from, const DirtyRect &rect) const {
+  for (int16_t row = rect.y0; row < rect.y1; row++) {
+    size_t offset = (size_t)row * width + rect.x0;
+    memcpy(to + offset, from + offset, rect.width() * sizeof(uint16_t));
+  }
+}
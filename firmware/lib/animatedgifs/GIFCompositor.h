@@ -0,0 +1,163 @@
+#ifndef GIF_COMPOSITOR_H
+#define GIF_COMPOSITOR_H
+
+/**
+ * @file GIFCompositor.h
+ * @brief Panel-sized canvas that GIF frames are composed on
+ *
+ * Each GIF frame covers a rectangle of the logical screen and says how it
+ * is to be disposed of once it has been shown:
+ *
+ *   0, 1  leave it in place; the next frame is drawn over it
+ *   2     clear its rectangle before the next frame
+ *   3     put back what its rectangle held before it was drawn
+ *
+ * The compositor applies the previous frame's disposal when the next frame
+ * begins, saving the area under a method 3 frame in a restore buffer that
+ * is only allocated once a GIF uses it. Cleared areas go back to the
+ * canvas's initial black, as browsers treat the background as transparent.
+ * After each frame the rectangle it changed, disposal included, is all
+ * that needs to reach the panel.
+ */
+
+#include <Arduino.h>
+
+#include "SpanBlitter.h"
+
+/**
+ * @struct CompositorStats
+ * @brief Compositor counters
+ */
+struct CompositorStats {
+    uint32_t frames = 0;            //< Frames composed
+    uint32_t cleared = 0;           //< Disposals that cleared a rectangle (method 2)
+    uint32_t restored = 0;          //< Disposals that restored a rectangle (method 3)
+};
+
+/**
+ * @class GIFCompositor
+ * @brief RGB565 canvas with GIF disposal handling
+ */
+class GIFCompositor {
+public:
+    /** @brief GIF disposal methods */
+    static const uint8_t DISPOSE_NONE = 1;
+    static const uint8_t DISPOSE_BACKGROUND = 2;
+    static const uint8_t DISPOSE_PREVIOUS = 3;
+
+    GIFCompositor() = default;
+    ~GIFCompositor();
+
+    GIFCompositor(const GIFCompositor&) = delete;
+    GIFCompositor& operator=(const GIFCompositor&) = delete;
+
+    // =============================================================================
+    // Lifecycle
+    // =============================================================================
+
+    /**
+     * @brief Allocate the canvas
+     * @param width Canvas width in pixels
+     * @param height Canvas height in pixels
+     * @return false if the canvas could not be allocated
+     */
+    bool begin(int16_t width, int16_t height);
+
+    /**
+     * @brief Release the canvas and the restore buffer
+     */
+    void end();
+
+    /**
+     * @brief Clear the canvas for a new GIF and forget pending disposal
+     */
+    void reset();
+
+    uint16_t *getCanvas() const { return canvas; }
+    int16_t getWidth() const { return width; }
+    int16_t getHeight() const { return height; }
+
+    // =============================================================================
+    // Composition
+    // =============================================================================
+
+    /**
+     * @brief Start a frame
+     *
+     * Disposes of the previous frame and, for a method 3 frame, saves the
+     * area it is about to cover. The rectangle is in canvas coordinates and
+     * is clipped to the canvas.
+     *
+     * @param x Left edge of the frame
+     * @param y Top edge of the frame
+     * @param frameWidth Frame width
+     * @param frameHeight Frame height
+     * @param disposal Disposal method of this frame
+     */
+    void beginFrame(int16_t x, int16_t y, int16_t frameWidth, int16_t frameHeight,
+                    uint8_t disposal);
+
+    /**
+     * @brief Convert a line of palette indices onto the canvas
+     * @param x Start column
+     * @param y Row
+     * @param indices Palette indices
+     * @param palette RGB565 palette with 256 entries
+     * @param length Number of pixels
+     * @param transparent Transparent palette index or -1 for none
+     */
+    void drawIndexedLine(int16_t x, int16_t y, const uint8_t *indices,
+                         const uint16_t *palette, int16_t length, int16_t transparent);
+
+    /**
+     * @brief Copy a converted line onto the canvas
+     * @param x Start column
+     * @param y Row
+     * @param colors RGB565 pixels
+     * @param opaque Non-zero for pixels to write
+     * @param length Number of pixels
+     */
+    void drawLine(int16_t x, int16_t y, const uint16_t *colors, const uint8_t *opaque,
+                  int16_t length);
+
+    /**
+     * @brief Area changed since the current frame began, disposal included
+     */
+    const DirtyRect &getChangedRect() const { return changed; }
+
+    /**
+     * @brief Write the changed area of the canvas to the panel
+     * @param blitter Blitter bound to the panel
+     */
+    void present(SpanBlitter &blitter) const;
+
+    const CompositorStats &getStats() const { return stats; }
+
+    /**
+     * @brief Check whether the restore buffer is allocated
+     */
+    bool hasRestoreBuffer() const { return restore != nullptr; }
+
+private:
+    /**
+     * @brief Clip a rectangle to the canvas
+     * @return false if nothing is left
+     */
+    bool clip(DirtyRect &rect) const;
+
+    /**
+     * @brief Copy a rectangle between two canvas-sized buffers
+     */
+    void copyRect(uint16_t *to, const uint16_t *from, const DirtyRect &rect) const;
+
+    uint16_t *canvas = nullptr;         //< Composed frame, width * height
+    uint16_t *restore = nullptr;        //< Area under the last method 3 frame, canvas layout
+    int16_t width = 0;                  //< Canvas width
+    int16_t height = 0;                 //< Canvas height
+    DirtyRect pendingRect;              //< Rectangle of the previous frame
+    uint8_t pendingDisposal = 0;        //< Disposal method of the previous frame
+    DirtyRect changed;                  //< Area changed by the current frame
+    CompositorStats stats;              //< Counters
+};
+
+#endif // GIF_COMPOSITOR_H
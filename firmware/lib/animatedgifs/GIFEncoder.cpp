@@ -0,0 +1,196 @@
+#include "GIFEncoder.h"
+#include "Logger.h"
+
+namespace {
+
+/** @brief Slots in the LZW string table, a prime above 4096 / 0.8 */
+const uint32_t TABLE_SIZE = 5003;
+
+/** @brief Codes with an 8-bit palette */
+const uint8_t MIN_CODE_SIZE = 8;
+const uint16_t CLEAR_CODE = 1 << MIN_CODE_SIZE;
+const uint16_t END_CODE = CLEAR_CODE + 1;
+const uint16_t MAX_CODE = 4095;
+
+} // namespace
+
+GIFEncoder::~GIFEncoder() {
+  end();
+}
+
+bool GIFEncoder::begin(std::vector<uint8_t> &output, uint16_t width, uint16_t height,
+                       const uint8_t *palette, uint16_t loopCount) {
+  end();
+
+  tableKeys = static_cast<uint32_t *>(malloc(TABLE_SIZE * sizeof(uint32_t)));
+  tableCodes = static_cast<uint16_t *>(malloc(TABLE_SIZE * sizeof(uint16_t)));
+  if (!tableKeys || !tableCodes) {
+    LOG_ERROR("GIFEncoder: No memory for the LZW string table");
+    end();
+    return false;
+  }
+
+  out = &output;
+  static const char signature[] = "GIF89a";
+  for (const char *c = signature; *c; c++) {
+    out->push_back(*c);
+  }
+
+  // Logical screen descriptor with a 256-entry global color table
+  put16(width);
+  put16(height);
+  out->push_back(0xF7);
+  out->push_back(0);
+  out->push_back(0);
+  out->insert(out->end(), palette, palette + 256 * 3);
+
+  // NETSCAPE2.0 application extension for looping
+  static const char application[] = "NETSCAPE2.0";
+  out->push_back(0x21);
+  out->push_back(0xFF);
+  out->push_back(11);
+  for (const char *c = application; *c; c++) {
+    out->push_back(*c);
+  }
+  out->push_back(3);
+  out->push_back(1);
+  put16(loopCount);
+  out->push_back(0);
+  return true;
+}
+
+void GIFEncoder::addFrame(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                          const uint8_t *indices, uint16_t delayCs,
+                          int16_t transparent, uint8_t disposal) {
+  if (!out || !tableKeys) {
+    return;
+  }
+
+  // Graphic control extension
+  out->push_back(0x21);
+  out->push_back(0xF9);
+  out->push_back(4);
+  out->push_back((disposal & 0x07) << 2 | (transparent >= 0 ? 1 : 0));
+  put16(delayCs);
+  out->push_back(transparent >= 0 ? transparent : 0);
+  out->push_back(0);
+
+  // Image descriptor without a local color table
+  out->push_back(0x2C);
+  put16(x);
+  put16(y);
+  put16(width);
+  put16(height);
+  out->push_back(0);
+
+  writeImageData(indices, (size_t)width * height);
+}
+
+void GIFEncoder::end() {
+  if (out && tableKeys) {
+    out->push_back(0x3B);
+  }
+  out = nullptr;
+  free(tableKeys);
+  free(tableCodes);
+  tableKeys = nullptr;
+  tableCodes = nullptr;
+}
+
+void GIFEncoder::writeImageData(const uint8_t *indices, size_t count) {
+  out->push_back(MIN_CODE_SIZE);
+  bitBuffer = 0;
+  bitCount = 0;
+  blockLength = 0;
+
+  resetTable();
+  writeCode(CLEAR_CODE);
+
+  if (count > 0) {
+    uint16_t prefix = indices[0];
+    for (size_t i = 1; i < count; i++) {
+      uint8_t suffix = indices[i];
+      uint32_t key = ((uint32_t)suffix << 12 | prefix) + 1;
+
+      // Linear probing; the table is cleared before it is 82% full
+      uint32_t slot = (((uint32_t)suffix << 4) ^ prefix) % TABLE_SIZE;
+      while (tableKeys[slot] != 0 && tableKeys[slot] != key) {
+        if (++slot == TABLE_SIZE) slot = 0;
+      }
+      if (tableKeys[slot] == key) {
+        prefix = tableCodes[slot];
+        continue;
+      }
+
+      writeCode(prefix);
+      uint16_t code = nextCode++;
+      tableKeys[slot] = key;
+      tableCodes[slot] = code;
+
+      // The string just added may be the next code written, so widen now
+      if (code >= (1u << codeSize)) {
+        codeSize++;
+      }
+      if (code == MAX_CODE) {
+        writeCode(CLEAR_CODE);
+        resetTable();
+      }
+      prefix = suffix;
+    }
+    writeCode(prefix);
+
+    // The decoder adds one more string after the last code before reading on
+    if (nextCode <= MAX_CODE && nextCode >= (1u << codeSize)) {
+      codeSize++;
+    }
+  }
+
+  writeCode(END_CODE);
+  flushBits();
+  flushBlock();
+  out->push_back(0);
+}
+
+void GIFEncoder::resetTable() {
+  memset(tableKeys, 0, TABLE_SIZE * sizeof(uint32_t));
+  nextCode = END_CODE + 1;
+  codeSize = MIN_CODE_SIZE + 1;
+}
+
+void GIFEncoder::writeCode(uint16_t code) {
+  bitBuffer |= (uint32_t)code << bitCount;
+  bitCount += codeSize;
+  while (bitCount >= 8) {
+    block[blockLength++] = bitBuffer & 0xFF;
+    if (blockLength == sizeof(block)) {
+      flushBlock();
+    }
+    bitBuffer >>= 8;
+    bitCount -= 8;
+  }
+}
+
+void GIFEncoder::flushBits() {
+  if (bitCount > 0) {
+    block[blockLength++] = bitBuffer & 0xFF;
+    if (blockLength == sizeof(block)) {
+      flushBlock();
+    }
+  }
+  bitBuffer = 0;
+  bitCount = 0;
+}
+
+void GIFEncoder::flushBlock() {
+  if (blockLength == 0) {
+    return;
+  }
+  out->push_back(blockLength);
+  out->insert(out->end(), block, block + blockLength);
+  blockLength = 0;
+}
+
+void GIFEncoder::put16(uint16_t value) {
+  out->push_back(value & 0xFF);
+  out->push_back(value >> 8);
+}
@@ -0,0 +1,84 @@
+#ifndef GIF_ENCODER_H
+#define GIF_ENCODER_H
+
+/**
+ * @file GIFEncoder.h
+ * @brief GIF89a writer with LZW compression
+ *
+ * Writes an animated GIF with one global 256-color palette into a byte
+ * vector. Frames are palette-indexed rectangles; the LZW coder uses an
+ * open-addressing string table, so encoding needs no per-pixel allocation.
+ */
+
+#include <Arduino.h>
+#include <vector>
+
+/**
+ * @class GIFEncoder
+ * @brief Incremental GIF89a encoder
+ */
+class GIFEncoder {
+public:
+    GIFEncoder() = default;
+    ~GIFEncoder();
+
+    // String table ownership makes copies unsafe
+    GIFEncoder(const GIFEncoder&) = delete;
+    GIFEncoder& operator=(const GIFEncoder&) = delete;
+
+    /**
+     * @brief Write the header, global palette and looping extension
+     * @param out Vector the file is appended to
+     * @param width Logical screen width
+     * @param height Logical screen height
+     * @param palette 256 RGB triplets
+     * @param loopCount Number of loops, 0 for forever
+     * @return false if the string table could not be allocated
+     */
+    bool begin(std::vector<uint8_t> &out, uint16_t width, uint16_t height,
+               const uint8_t *palette, uint16_t loopCount = 0);
+
+    /**
+     * @brief Append one frame
+     * @param x Left of the frame on the logical screen
+     * @param y Top of the frame on the logical screen
+     * @param width Frame width
+     * @param height Frame height
+     * @param indices width * height palette indices, row-major
+     * @param delayCs Display time in hundredths of a second
+     * @param transparent Transparent palette index or -1 for none
+     * @param disposal Disposal method (1 keeps the frame for the next one)
+     */
+    void addFrame(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                  const uint8_t *indices, uint16_t delayCs, int16_t transparent,
+                  uint8_t disposal = 1);
+
+    /**
+     * @brief Write the trailer and release the string table
+     */
+    void end();
+
+private:
+    /**
+     * @brief LZW-compress indices into image data sub-blocks
+     */
+    void writeImageData(const uint8_t *indices, size_t count);
+
+    void resetTable();
+    void writeCode(uint16_t code);
+    void flushBits();
+    void flushBlock();
+    void put16(uint16_t value);
+
+    std::vector<uint8_t> *out = nullptr;  //< Destination of the current file
+    uint32_t *tableKeys = nullptr;        //< (suffix << 12 | prefix) + 1 per slot, 0 if empty
+    uint16_t *tableCodes = nullptr;       //< Code of the string in each slot
+    uint16_t nextCode = 0;                //< Next free code
+    uint8_t codeSize = 0;                 //< Current code width in bits
+    uint32_t bitBuffer = 0;               //< Bits not yet written
+    uint8_t bitCount = 0;                 //< Number of bits in bitBuffer
+    uint8_t block[255];                   //< Sub-block being filled
+    uint8_t blockLength = 0;              //< Bytes in block
+};
+
+#endif // GIF_ENCODER_H
@@ -0,0 +1,191 @@
+#include "GIFFrameCache.h"
+#include "GIFMemory.h"
+#include "constants.h"
+#include "Logger.h"
+
+GIFFrameCache::~GIFFrameCache() {
+  abortCapture();
+  clear();
+}
+
+// =============================================================================
+// Configuration
+// =============================================================================
+
+void GIFFrameCache::setBudget(size_t bytes) {
+  budget = bytes;
+  if (budget == 0) {
+    abortCapture();
+    clear();
+    return;
+  }
+  makeRoom(0);
+}
+
+// =============================================================================
+// Lookup
+// =============================================================================
+
+const CachedGif *GIFFrameCache::find(const String &path) {
+  for (CachedGif *entry : entries) {
+    if (entry->path == path) {
+      entry->lastUsed = ++useCounter;
+      stats.hits++;
+      return entry;
+    }
+  }
+  stats.misses++;
+  return nullptr;
+}
+
+bool GIFFrameCache::contains(const String &path) const {
+  for (const CachedGif *entry : entries) {
+    if (entry->path == path) return true;
+  }
+  return false;
+}
+
+// =============================================================================
+// Capture
+// =============================================================================
+
+bool GIFFrameCache::fits(uint16_t width, uint16_t height, uint16_t frames) const {
+  size_t frameBytes = (size_t)width * height * sizeof(uint16_t);
+  return frameBytes > 0 && frames <= GIF_FRAME_CACHE_MAX_FRAMES &&
+         frameBytes * (frames > 0 ? frames : 1) <= budget;
+}
+
+bool GIFFrameCache::beginCapture(const String &path, uint16_t width,
+                                 uint16_t height, uint16_t frames) {
+  abortCapture();
+
+  if (budget == 0) {
+    return false;
+  }
+  if (!fits(width, height, frames)) {
+    LOG_DEBUG("GIFFrameCache: %s is too large to cache", path.c_str());
+    stats.rejected++;
+    return false;
+  }
+  // Evict only now that the whole GIF is known to fit
+  if (frames > 0) {
+    makeRoom((size_t)width * height * sizeof(uint16_t) * frames);
+  }
+
+  captureFrames = frames;
+  capture = new CachedGif();
+  capture->path = path;
+  capture->width = width;
+  capture->height = height;
+  return true;
+}
+
+bool GIFFrameCache::captureFrame(const uint16_t *pixels, uint16_t delayMs) {
+  if (!capture) return false;
+
+  // The index may be out of date, so the announced count is a limit too
+  size_t limit = captureFrames > 0 ? captureFrames : GIF_FRAME_CACHE_MAX_FRAMES;
+  if (capture->frames.size() >= limit) {
+    LOG_DEBUG("GIFFrameCache: %s has too many frames to cache", capture->path.c_str());
+    abortCapture();
+    return false;
+  }
+
+  size_t frameBytes = (size_t)capture->width * capture->height * sizeof(uint16_t);
+  if (usedBytes + frameBytes > budget) {
+    LOG_DEBUG("GIFFrameCache: %s does not fit the budget", capture->path.c_str());
+    abortCapture();
+    return false;
+  }
+
+  CachedFrame frame;
+  frame.pixels = static_cast<uint16_t *>(GIFMemory::allocate(frameBytes));
+  if (!frame.pixels) {
+    LOG_WARNING("GIFFrameCache: Out of memory capturing %s", capture->path.c_str());
+    abortCapture();
+    return false;
+  }
+
+  memcpy(frame.pixels, pixels, frameBytes);
+  frame.delayMs = delayMs;
+  capture->frames.push_back(frame);
+  capture->bytes += frameBytes;
+  usedBytes += frameBytes;
+  return true;
+}
+
+void GIFFrameCache::commitCapture() {
+  if (!capture) return;
+
+  if (capture->frames.empty()) {
+    abortCapture();
+    return;
+  }
+
+  capture->lastUsed = ++useCounter;
+  entries.push_back(capture);
+  LOG_DEBUG("GIFFrameCache: Cached %s (%u frames, %u bytes)", capture->path.c_str(),
+            (unsigned)capture->frames.size(), (unsigned)capture->bytes);
+  capture = nullptr;
+}
+
+void GIFFrameCache::abortCapture() {
+  if (!capture) return;
+
+  stats.aborted++;
+  freeEntry(*capture);
+  delete capture;
+  capture = nullptr;
+}
+
+// =============================================================================
+// Maintenance
+// =============================================================================
+
+void GIFFrameCache::clear() {
+  for (CachedGif *entry : entries) {
+    freeEntry(*entry);
+    delete entry;
+  }
+  entries.clear();
+}
+
+void GIFFrameCache::invalidate(const String &path) {
+  if (capture && capture->path == path) {
+    abortCapture();
+  }
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (entries[i]->path == path) {
+      freeEntry(*entries[i]);
+      delete entries[i];
+      entries.erase(entries.begin() + i);
+      return;
+    }
+  }
+}
+
+bool GIFFrameCache::makeRoom(size_t bytes) {
+  while (usedBytes + bytes > budget) {
+    if (entries.empty()) return false;
+
+    size_t victim = 0;
+    for (size_t i = 1; i < entries.size(); i++) {
+      if (entries[i]->lastUsed < entries[victim]->lastUsed) victim = i;
+    }
+
+    freeEntry(*entries[victim]);
+    delete entries[victim];
+    entries.erase(entries.begin() + victim);
+    stats.evictions++;
+  }
+  return true;
+}
+
+void GIFFrameCache::freeEntry(CachedGif &entry) {
+  for (CachedFrame &frame : entry.frames) {
+    GIFMemory::release(frame.pixels);
+  }
+  entry.frames.clear();
+  usedBytes -= entry.bytes;
+  entry.bytes = 0;
+}
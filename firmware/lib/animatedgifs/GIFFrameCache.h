@@ -0,0 +1,181 @@
+#ifndef GIF_FRAME_CACHE_H
+#define GIF_FRAME_CACHE_H
+
+/**
+ * @file GIFFrameCache.h
+ * @brief Cache of fully decoded GIF frames for looping playback
+ *
+ * The first time a short GIF plays its composited RGB565 frames and delays are
+ * captured. Later plays are served from memory without opening the file or
+ * running the LZW decoder. A GIF whose frame count is known is only captured
+ * if all of its frames fit the budget, and room is made for it up front by
+ * evicting entries least recently used first. Frames of a GIF of unknown
+ * length only fill free room, so a capture never evicts entries and then
+ * fails.
+ */
+
+#include <Arduino.h>
+#include <vector>
+
+/**
+ * @struct CachedFrame
+ * @brief One decoded frame held by the cache
+ */
+struct CachedFrame {
+    uint16_t *pixels = nullptr;  //< RGB565 pixels, width * height
+    uint16_t delayMs = 0;        //< Frame delay in milliseconds
+};
+
+/**
+ * @struct CachedGif
+ * @brief All decoded frames of one GIF
+ */
+struct CachedGif {
+    String path;                        //< Source path of the GIF
+    uint16_t width = 0;                 //< Frame width in pixels
+    uint16_t height = 0;                //< Frame height in pixels
+    std::vector<CachedFrame> frames;    //< Frames in playback order
+    size_t bytes = 0;                   //< Memory held by the frames
+    uint32_t lastUsed = 0;              //< LRU stamp
+};
+
+/**
+ * @struct FrameCacheStats
+ * @brief Frame cache counters
+ */
+struct FrameCacheStats {
+    uint32_t hits = 0;          //< Plays served from the cache
+    uint32_t misses = 0;        //< Plays that had to decode the file
+    uint32_t evictions = 0;     //< Entries evicted to make room
+    uint32_t aborted = 0;       //< Captures abandoned (budget, frame limit, early stop)
+    uint32_t rejected = 0;      //< GIFs not captured because all of their frames cannot fit
+};
+
+/**
+ * @class GIFFrameCache
+ * @brief Byte-budgeted LRU cache of decoded GIF animations
+ */
+class GIFFrameCache {
+public:
+    GIFFrameCache() = default;
+    ~GIFFrameCache();
+
+    // =============================================================================
+    // Configuration
+    // =============================================================================
+
+    /**
+     * @brief Set the memory budget, evicting entries that no longer fit
+     * @param bytes Budget in bytes, 0 disables the cache
+     */
+    void setBudget(size_t bytes);
+    size_t getBudget() const { return budget; }
+    bool isEnabled() const { return budget > 0; }
+
+    // =============================================================================
+    // Lookup
+    // =============================================================================
+
+    /**
+     * @brief Find a completely captured GIF and mark it as recently used
+     * @param path Source path of the GIF
+     * @return Pointer to the cached GIF or nullptr on miss
+     */
+    const CachedGif *find(const String &path);
+
+    /**
+     * @brief Check for a captured GIF without touching LRU order or counters
+     * @param path Source path of the GIF
+     * @return true if the GIF is cached
+     */
+    bool contains(const String &path) const;
+
+    // =============================================================================
+    // Capture
+    // =============================================================================
+
+    /**
+     * @brief Start capturing a GIF as it is decoded
+     *
+     * With a known frame count, GIFs over the frame limit or the budget are
+     * rejected and least recently used entries are evicted until the whole
+     * GIF fits.
+     *
+     * @param path Source path of the GIF
+     * @param width Frame width in pixels
+     * @param height Frame height in pixels
+     * @param frames Frames in the GIF, 0 if unknown
+     * @return true if capture started
+     */
+    bool beginCapture(const String &path, uint16_t width, uint16_t height, uint16_t frames);
+
+    /**
+     * @brief Append the current composited frame to the capture
+     *
+     * Abandons the capture if the frame limit, the announced frame count or
+     * the free room is exceeded. Entries are never evicted here.
+     *
+     * @param pixels RGB565 canvas of width * height pixels
+     * @param delayMs Frame delay in milliseconds
+     * @return true if the frame was stored
+     */
+    bool captureFrame(const uint16_t *pixels, uint16_t delayMs);
+
+    /**
+     * @brief Publish the capture after the last frame of a loop was stored
+     */
+    void commitCapture();
+
+    /**
+     * @brief Drop a capture that did not reach the end of the loop
+     */
+    void abortCapture();
+
+    bool isCapturing() const { return capture != nullptr; }
+
+    /**
+     * @brief Check whether every frame of a GIF can be cached
+     * @param width Frame width in pixels
+     * @param height Frame height in pixels
+     * @param frames Frames in the GIF
+     */
+    bool fits(uint16_t width, uint16_t height, uint16_t frames) const;
+
+    // =============================================================================
+    // Maintenance and Statistics
+    // =============================================================================
+
+    /**
+     * @brief Drop all entries
+     */
+    void clear();
+
+    /**
+     * @brief Drop the frames of a GIF whose file was replaced or deleted
+     * @param path Source path of the GIF
+     */
+    void invalidate(const String &path);
+
+    size_t getUsedBytes() const { return usedBytes; }
+    size_t getEntryCount() const { return entries.size(); }
+    const FrameCacheStats &getStats() const { return stats; }
+
+private:
+    /**
+     * @brief Evict least recently used entries until bytes more fit
+     * @return true if enough room is available
+     */
+    bool makeRoom(size_t bytes);
+
+    void freeEntry(CachedGif &entry);
+
+    std::vector<CachedGif *> entries;   //< Completely captured GIFs
+    CachedGif *capture = nullptr;       //< GIF being captured, not yet visible
+    uint16_t captureFrames = 0;         //< Frames announced for the capture, 0 if unknown
+    size_t budget = 0;                  //< Byte budget
+    size_t usedBytes = 0;               //< Bytes held by entries and capture
+    uint32_t useCounter = 0;            //< Monotonic LRU clock
+    FrameCacheStats stats;              //< Counters
+};
+
+#endif // GIF_FRAME_CACHE_H
@@ -0,0 +1,18 @@
+#include "GIFMemory.h"
+
+void *GIFMemory::allocate(size_t bytes) {
+  if (bytes == 0) return nullptr;
+
+  void *buffer = nullptr;
+  if (psramFound()) {
+    buffer = ps_malloc(bytes);
+  }
+  if (!buffer) {
+    buffer = malloc(bytes);
+  }
+  return buffer;
+}
+
+void GIFMemory::release(void *buffer) {
+  free(buffer);
+}
@@ -0,0 +1,34 @@
+#ifndef GIF_MEMORY_H
+#define GIF_MEMORY_H
+
+/**
+ * @file GIFMemory.h
+ * @brief Large buffer allocation for GIF playback
+ *
+ * Decoded frames and whole-file buffers are too large for internal RAM on
+ * most boards, so they are placed in PSRAM when the module has it and fall
+ * back to the regular heap otherwise.
+ */
+
+#include <Arduino.h>
+
+class GIFMemory {
+public:
+    /**
+     * @brief Allocate a buffer, preferring PSRAM
+     * @param bytes Number of bytes to allocate
+     * @return Pointer to the buffer or nullptr if allocation failed
+     */
+    static void *allocate(size_t bytes);
+
+    /**
+     * @brief Release a buffer obtained from allocate()
+     * @param buffer Buffer to free (nullptr is ignored)
+     */
+    static void release(void *buffer);
+
+private:
+    GIFMemory() = delete;
+};
+
+#endif // GIF_MEMORY_H
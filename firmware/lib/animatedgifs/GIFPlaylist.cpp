@@ -0,0 +1,357 @@
+#include "GIFPlaylist.h"
+#include <algorithm>
+#include <string.h>
+
+#include "GIFMemory.h"
+#include "Logger.h"
+#include "RecordIO.h"
+
+namespace {
+
+const uint8_t MAGIC[4] = {'G', 'P', 'L', 'S'};
+
+/** @brief Magic, version and deck count */
+const size_t HEADER_BYTES = 8;
+
+/** @brief Smallest record of one deck: empty name, signature, position and count */
+const size_t DECK_RECORD_BYTES = 1 + 12;
+
+/** @brief Suffix of the file the state is written to before replacing the old one */
+const char *TEMP_SUFFIX = ".tmp";
+
+} // namespace
+
+void GIFPlaylist::configure(JsonVariantConst playlists) {
+  rules.clear();
+
+  JsonObjectConst categories = playlists.as<JsonObjectConst>();
+  for (JsonPairConst category : categories) {
+    JsonVariantConst config = category.value();
+    CategoryRule rule;
+    rule.category = category.key().c_str();
+
+    const char *modeName = config[PLAYLIST_MODE] | getModeName(PlaylistMode::SEQUENTIAL);
+    if (!parseMode(modeName, rule.mode)) {
+      LOG_WARNING("GIFPlaylist: Unknown mode '%s' for %s, playing in order", modeName,
+                  rule.category.c_str());
+    }
+    rule.playTimeMs = config[PLAY_TIME_MS] | 0;
+
+    for (JsonPairConst item : config[PLAYLIST_ITEMS].as<JsonObjectConst>()) {
+      ItemRule itemRule;
+      itemRule.filename = item.key().c_str();
+      uint32_t weight = item.value()[PLAYLIST_WEIGHT] | 1;
+      itemRule.weight = weight < PLAYLIST_MAX_WEIGHT ? weight : PLAYLIST_MAX_WEIGHT;
+      itemRule.playTimeMs = item.value()[PLAY_TIME_MS] | 0;
+      rule.items.push_back(itemRule);
+    }
+    // Sorted for the binary search in build()
+    std::sort(rule.items.begin(), rule.items.end(), [](const ItemRule &a, const ItemRule &b) {
+      return strcmp(a.filename.c_str(), b.filename.c_str()) < 0;
+    });
+    rules.push_back(rule);
+  }
+}
+
+void GIFPlaylist::rebuild(const GIFCategoryList &categories, const GIFCategoryList *previous) {
+  std::vector<Deck> rebuilt(categories.size());
+  for (size_t c = 0; c < categories.size(); c++) {
+    Deck &deck = rebuilt[c];
+    build(deck, categories, c);
+
+    size_t old = previous ? previous->findCategory(categories.getName(c))
+                          : GIFCategoryList::NOT_FOUND;
+    if (old == GIFCategoryList::NOT_FOUND || old >= decks.size()) {
+      continue;
+    }
+    Deck &oldDeck = decks[old];
+    if (oldDeck.signature == deck.signature) {
+      deck.position = oldDeck.position;
+      deck.entries.swap(oldDeck.entries);
+    } else if (deck.mode == PlaylistMode::SEQUENTIAL &&
+               oldDeck.position < previous->getFileCount(old)) {
+      size_t index = categories.findFile(c, previous->getFile(old, oldDeck.position));
+      if (index != GIFCategoryList::NOT_FOUND) {
+        deck.position = index;
+      }
+    }
+  }
+  decks.swap(rebuilt);
+  dirty = true;
+}
+
+size_t GIFPlaylist::next(size_t category) {
+  if (category >= decks.size() || decks[category].fileCount == 0) {
+    return NONE;
+  }
+  Deck &deck = decks[category];
+  dirty = true;
+
+  if (deck.mode == PlaylistMode::SEQUENTIAL) {
+    deck.position = (deck.position + 1) % deck.fileCount;
+    return deck.position;
+  }
+
+  // A deck is shuffled once per pass, so each pick is a single read
+  if (deck.position >= deck.entries.size()) {
+    size_t last = deck.entries.empty() ? NONE : deck.entries.back();
+    shuffle(deck, last);
+    deck.position = 0;
+  }
+  return deck.entries[deck.position++];
+}
+
+size_t GIFPlaylist::previous(size_t category) {
+  if (category >= decks.size() || decks[category].fileCount == 0) {
+    return NONE;
+  }
+  Deck &deck = decks[category];
+  dirty = true;
+
+  if (deck.mode == PlaylistMode::SEQUENTIAL) {
+    deck.position = (deck.position + deck.fileCount - 1) % deck.fileCount;
+    return deck.position;
+  }
+
+  // Only the current pass is remembered
+  if (deck.position > 1 && deck.position <= deck.entries.size()) {
+    deck.position--;
+  }
+  return deck.position > 0 ? deck.entries[deck.position - 1] : next(category);
+}
+
+uint32_t GIFPlaylist::getPlayTime(size_t category, size_t index) const {
+  if (category >= decks.size()) {
+    return 0;
+  }
+  const Deck &deck = decks[category];
+  if (index < deck.playTimes.size() && deck.playTimes[index] > 0) {
+    return deck.playTimes[index];
+  }
+  return deck.playTimeMs;
+}
+
+PlaylistMode GIFPlaylist::getMode(size_t category) const {
+  return category < decks.size() ? decks[category].mode : PlaylistMode::SEQUENTIAL;
+}
+
+size_t GIFPlaylist::load(fs::FS &fs, const GIFCategoryList &categories, const char *path) {
+  File file = fs.open(path, FILE_READ);
+  if (!file) {
+    return 0;
+  }
+  size_t size = file.size();
+  uint8_t *data = size >= HEADER_BYTES + RECORD_CHECKSUM_BYTES
+                      ? static_cast<uint8_t *>(GIFMemory::allocate(size))
+                      : nullptr;
+  size_t got = data ? file.read(data, size) : 0;
+  file.close();
+
+  if (got != size || !verifyRecordFile(data, size, MAGIC)) {
+    GIFMemory::release(data);
+    LOG_WARNING("GIFPlaylist: %s is corrupt, starting new decks", path);
+    return 0;
+  }
+
+  RecordReader reader(data + sizeof(MAGIC), size - sizeof(MAGIC) - RECORD_CHECKSUM_BYTES);
+  uint16_t version = reader.get16();
+  uint16_t deckCount = reader.get16();
+  bool valid = version == VERSION && deckCount <= reader.remaining() / DECK_RECORD_BYTES;
+
+  size_t restored = 0;
+  char name[UINT8_MAX + 1];
+  std::vector<uint16_t> entries;
+  for (uint16_t d = 0; d < deckCount && valid; d++) {
+    size_t category = categories.findCategory(reader.getName(name));
+    uint32_t signature = reader.get32();
+    uint32_t position = reader.get32();
+    uint32_t count = reader.get32();
+    valid = reader.isValid() && count <= reader.remaining() / sizeof(uint16_t);
+
+    // Decks of changed categories or rules are skipped and dealt afresh
+    Deck *deck = category < decks.size() && decks[category].signature == signature
+                     ? &decks[category]
+                     : nullptr;
+    bool matches = deck && (deck->mode == PlaylistMode::SEQUENTIAL
+                                ? count == 0 && position < deck->fileCount
+                                : count == deck->entries.size() && position <= count);
+    entries.clear();
+    for (uint32_t i = 0; i < count && valid; i++) {
+      uint16_t entry = reader.get16();
+      matches = matches && entry < deck->fileCount;
+      entries.push_back(entry);
+    }
+    if (matches && reader.isValid()) {
+      deck->entries.swap(entries);
+      deck->position = position;
+      restored++;
+    }
+  }
+  GIFMemory::release(data);
+
+  if (!valid) {
+    // Decks restored before the bad record are whole, so they are kept
+    LOG_WARNING("GIFPlaylist: %s does not match its header", path);
+  }
+  dirty = false;
+  return restored;
+}
+
+bool GIFPlaylist::save(fs::FS &fs, const GIFCategoryList &categories, const char *path) {
+  String tempPath = String(path) + TEMP_SUFFIX;
+  File file = fs.open(tempPath, FILE_WRITE);
+  if (!file) {
+    LOG_ERROR("GIFPlaylist: Failed to create %s", tempPath.c_str());
+    return false;
+  }
+
+  size_t count = min(decks.size(), categories.size());
+  RecordWriter writer(file);
+  writer.put(MAGIC, sizeof(MAGIC));
+  writer.put16(VERSION);
+  writer.put16(count);
+  for (size_t c = 0; c < count; c++) {
+    const Deck &deck = decks[c];
+    writer.putName(categories.getName(c));
+    writer.put32(deck.signature);
+    writer.put32(deck.position);
+    writer.put32(deck.entries.size());
+    for (uint16_t entry : deck.entries) {
+      writer.put16(entry);
+    }
+  }
+  bool ok = writer.finish();
+  file.close();
+
+  if (!ok || !replaceRecordFile(fs, tempPath, path)) {
+    LOG_ERROR("GIFPlaylist: Failed to write %s", path);
+    fs.remove(tempPath);
+    return false;
+  }
+  dirty = false;
+  return true;
+}
+
+const char *GIFPlaylist::getModeName(PlaylistMode mode) {
+  switch (mode) {
+    case PlaylistMode::SHUFFLE:
+      return "shuffle";
+    case PlaylistMode::SEQUENTIAL:
+    default:
+      return "sequential";
+  }
+}
+
+bool GIFPlaylist::parseMode(const char *name, PlaylistMode &mode) {
+  if (strcasecmp(name, "sequential") == 0) {
+    mode = PlaylistMode::SEQUENTIAL;
+  } else if (strcasecmp(name, "shuffle") == 0) {
+    mode = PlaylistMode::SHUFFLE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const GIFPlaylist::CategoryRule *GIFPlaylist::findRule(const char *category) const {
+  for (const CategoryRule &rule : rules) {
+    if (strcasecmp(rule.category.c_str(), category) == 0) {
+      return &rule;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Set up a deck for the current files and rules of a category
+ *
+ * Shuffled decks are left fully dealt, so they are shuffled on the first
+ * pick unless load() restores a saved order.
+ */
+void GIFPlaylist::build(Deck &deck, const GIFCategoryList &categories, size_t category) const {
+  const CategoryRule *rule = findRule(categories.getName(category));
+  deck = Deck();
+  deck.mode = rule ? rule->mode : PlaylistMode::SEQUENTIAL;
+  deck.playTimeMs = rule ? rule->playTimeMs : 0;
+  // Deck entries are 16-bit
+  deck.fileCount = min(categories.getFileCount(category), (size_t)UINT16_MAX + 1);
+
+  uint8_t mode = (uint8_t)deck.mode;
+  uint32_t signature = recordChecksum(RECORD_FNV_OFFSET, &mode, 1);
+  for (size_t i = 0; i < deck.fileCount; i++) {
+    const char *filename = categories.getFile(category, i);
+    uint8_t weight = 1;
+
+    if (rule && !rule->items.empty()) {
+      auto item = std::lower_bound(rule->items.begin(), rule->items.end(), filename,
+                                   [](const ItemRule &a, const char *name) {
+                                     return strcmp(a.filename.c_str(), name) < 0;
+                                   });
+      if (item != rule->items.end() && item->filename == filename) {
+        weight = item->weight;
+        if (item->playTimeMs > 0) {
+          if (deck.playTimes.empty()) {
+            deck.playTimes.assign(deck.fileCount, 0);
+          }
+          deck.playTimes[i] = item->playTimeMs;
+        }
+      }
+    }
+
+    signature = recordChecksum(signature, (const uint8_t *)filename, strlen(filename) + 1);
+    signature = recordChecksum(signature, &weight, 1);
+    if (deck.mode == PlaylistMode::SHUFFLE) {
+      deck.entries.insert(deck.entries.end(), weight, (uint16_t)i);
+    }
+  }
+
+  // Every GIF weighted 0 would leave nothing to play
+  if (deck.mode == PlaylistMode::SHUFFLE && deck.entries.empty()) {
+    for (size_t i = 0; i < deck.fileCount; i++) {
+      deck.entries.push_back(i);
+    }
+  }
+  deck.signature = signature;
+  deck.position = deck.entries.size();
+}
+
+void GIFPlaylist::shuffle(Deck &deck, size_t last) {
+  std::vector<uint16_t> &entries = deck.entries;
+  size_t count = entries.size();
+  for (size_t i = count; i > 1; i--) {
+    size_t j = random(i);
+    std::swap(entries[i - 1], entries[j]);
+  }
+
+  // Swap each repeat with the next different GIF
+  for (size_t i = 0; i < count; i++) {
+    size_t before = i > 0 ? entries[i - 1] : last;
+    if (entries[i] != before) {
+      continue;
+    }
+    size_t j = i + 1;
+    while (j < count && entries[j] == before) {
+      j++;
+    }
+    if (j == count) {
+      break;
+    }
+    std::swap(entries[i], entries[j]);
+  }
+
+  // A run of one GIF can be left at the end; move it back into earlier gaps.
+  // Repeats only remain when one GIF outweighs all others together
+  size_t end = count;
+  while (end > 1 && entries[end - 1] == entries[end - 2]) {
+    uint16_t repeated = entries[end - 1];
+    size_t gap = 0;
+    while (gap < end - 1 &&
+           ((gap > 0 ? entries[gap - 1] : last) == repeated || entries[gap] == repeated)) {
+      gap++;
+    }
+    if (gap == end - 1) {
+      break;
+    }
+    std::rotate(entries.begin() + gap, entries.begin() + end - 1, entries.begin() + end);
+  }
+}
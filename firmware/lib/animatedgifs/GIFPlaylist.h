@@ -0,0 +1,185 @@
+#ifndef GIF_PLAYLIST_H
+#define GIF_PLAYLIST_H
+
+/**
+ * @file GIFPlaylist.h
+ * @brief Order and play time of the GIFs in each category
+ *
+ * Every category has a deck. Sequential decks step through the files in
+ * name order. Shuffled decks hold each file once per unit of its weight,
+ * shuffled so the same GIF never plays twice in a row; picking the next GIF
+ * reads the next deck entry, and the deck is reshuffled once it runs out.
+ *
+ * Rules come from the "playlists" object of the playback configuration,
+ * keyed by category name:
+ *
+ *   "characters": {
+ *     "mode": "shuffle",
+ *     "playTimeMs": 6000,
+ *     "items": { "mario.gif": { "weight": 3, "playTimeMs": 12000 } }
+ *   }
+ *
+ * Categories without rules play sequentially for the default play time.
+ * The decks and their positions are saved in a binary file and restored
+ * at boot as long as the category's files and rules are unchanged, so a
+ * shuffle resumes where it stopped.
+ *
+ * File layout (little-endian):
+ *   "GPLS", version (u16), deck count (u16)
+ *   per deck: category name length (u8), name, signature (u32),
+ *             position (u32), entry count (u32), entries (u16 each)
+ *   FNV-1a checksum of everything before it (u32)
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FS.h>
+#include <vector>
+
+#include "GIFCategoryList.h"
+#include "constants.h"
+
+/**
+ * @enum PlaylistMode
+ * @brief How the GIFs of a category are ordered
+ */
+enum class PlaylistMode {
+    SEQUENTIAL,     //< Name order, weights ignored
+    SHUFFLE         //< Weighted shuffle without back-to-back repeats
+};
+
+/**
+ * @class GIFPlaylist
+ * @brief Per-category decks with weighted shuffle and play-time overrides
+ */
+class GIFPlaylist {
+public:
+    /** @brief Format version written to the state file */
+    static const uint16_t VERSION = 1;
+
+    /** @brief Returned by next() and previous() for an empty category */
+    static const size_t NONE = (size_t)-1;
+
+    /**
+     * @brief Read the playlist rules
+     *
+     * Decks built under other rules are rebuilt by the next rebuild().
+     *
+     * @param playlists "playlists" object of the playback configuration, may be null
+     */
+    void configure(JsonVariantConst playlists);
+
+    /**
+     * @brief Bring the decks in line with a new category list
+     *
+     * Decks of categories whose files and rules did not change are kept. A
+     * changed sequential deck keeps its place on the GIF it was at, looked
+     * up by name in @p previous; a changed shuffled deck is dealt afresh.
+     *
+     * @param categories New categories
+     * @param previous Categories the decks were built for, may be nullptr
+     */
+    void rebuild(const GIFCategoryList &categories, const GIFCategoryList *previous = nullptr);
+
+    /**
+     * @brief Pick the next GIF of a category
+     * @return Index of the file within the category, or NONE
+     */
+    size_t next(size_t category);
+
+    /**
+     * @brief Step back to the GIF played before the current one
+     * @return Index of the file within the category, or NONE
+     */
+    size_t previous(size_t category);
+
+    /**
+     * @brief Play time configured for a GIF
+     * @param category Category index
+     * @param index File index within the category
+     * @return Play time in milliseconds, 0 if none is configured
+     */
+    uint32_t getPlayTime(size_t category, size_t index) const;
+
+    PlaylistMode getMode(size_t category) const;
+
+    /**
+     * @brief Restore saved decks whose category and rules still match
+     * @param fs Filesystem holding the state file
+     * @param categories Current categories, as passed to rebuild()
+     * @param path State file
+     * @return Number of decks restored
+     */
+    size_t load(fs::FS &fs, const GIFCategoryList &categories,
+                const char *path = PLAYLIST_STATE_PATH);
+
+    /**
+     * @brief Write the decks to a temporary file and move it over the state file
+     * @param fs Filesystem to write to
+     * @param categories Current categories, as passed to rebuild()
+     * @param path State file
+     * @return false if the file could not be written
+     */
+    bool save(fs::FS &fs, const GIFCategoryList &categories,
+              const char *path = PLAYLIST_STATE_PATH);
+
+    /**
+     * @brief Check whether a deck moved since the last save or load
+     */
+    bool isDirty() const { return dirty; }
+
+    static const char *getModeName(PlaylistMode mode);
+    static bool parseMode(const char *name, PlaylistMode &mode);
+
+private:
+    /**
+     * @struct ItemRule
+     * @brief Configured weight and play time of one GIF
+     */
+    struct ItemRule {
+        String filename;                //< GIF the rule applies to
+        uint8_t weight = 1;             //< Deck entries per shuffle
+        uint32_t playTimeMs = 0;        //< Play time, 0 for the category's
+    };
+
+    /**
+     * @struct CategoryRule
+     * @brief Configured order and play times of one category
+     */
+    struct CategoryRule {
+        String category;                //< Category name, matched ignoring case
+        PlaylistMode mode = PlaylistMode::SEQUENTIAL; //< Order of the GIFs
+        uint32_t playTimeMs = 0;        //< Play time of GIFs without their own, 0 for the default
+        std::vector<ItemRule> items;    //< Per-GIF rules
+    };
+
+    /**
+     * @struct Deck
+     * @brief Play order of one category
+     */
+    struct Deck {
+        uint32_t signature = 0;         //< Hash of the files and rules the deck was built for
+        PlaylistMode mode = PlaylistMode::SEQUENTIAL; //< Order of the GIFs
+        uint32_t fileCount = 0;         //< Files in the category
+        uint32_t position = 0;          //< Sequential: current file; shuffle: entries dealt
+        uint32_t playTimeMs = 0;        //< Category play time, 0 for the default
+        std::vector<uint16_t> entries;  //< Shuffled file indexes, weighted
+        std::vector<uint32_t> playTimes; //< Per-file play times, empty if none are set
+    };
+
+    const CategoryRule *findRule(const char *category) const;
+    void build(Deck &deck, const GIFCategoryList &categories, size_t category) const;
+
+    /**
+     * @brief Shuffle a deck so no GIF follows itself
+     * @param deck Deck to shuffle
+     * @param last File played just before the deck starts, NONE if any may lead
+     */
+    static void shuffle(Deck &deck, size_t last);
+
+    std::vector<CategoryRule> rules;    //< Rules from the configuration
+    std::vector<Deck> decks;            //< One deck per category
+    bool dirty = false;                 //< Decks changed since the last save or load
+};
+
+#endif // GIF_PLAYLIST_H
@@ -0,0 +1,123 @@
+#include "GIFReadAhead.h"
+#include "Logger.h"
+
+GIFReadAhead::~GIFReadAhead() {
+  close();
+}
+
+bool GIFReadAhead::open(fs::FS &fs, const char *path, size_t size,
+                        ReadAheadStats &counters) {
+  close();
+
+  file = fs.open(path);
+  if (!file) {
+    return false;
+  }
+
+  // Internal RAM on purpose: the window is touched on every decoder read
+  window = static_cast<uint8_t *>(malloc(size));
+  if (!window) {
+    LOG_WARNING("GIFReadAhead: No memory for %u byte window, reading unbuffered", (unsigned)size);
+    size = 0;
+  }
+
+  stats = &counters;
+  windowSize = size;
+  windowStart = 0;
+  windowLength = 0;
+  fileSize = file.size();
+  filePos = 0;
+  pos = 0;
+  return true;
+}
+
+void GIFReadAhead::close() {
+  if (file) {
+    file.close();
+  }
+  free(window);
+  window = nullptr;
+  windowSize = 0;
+  windowLength = 0;
+}
+
+int32_t GIFReadAhead::read(uint8_t *dst, int32_t len) {
+  if (!file || len <= 0) return 0;
+
+  if (pos + len > fileSize) len = fileSize - pos;
+  if (len <= 0) return 0;
+
+  uint32_t readsBefore = stats->fsReads;
+  int32_t copied = 0;
+
+  while (copied < len) {
+    int32_t offset = pos - windowStart;
+    if (offset >= 0 && offset < windowLength) {
+      int32_t chunk = windowLength - offset;
+      if (chunk > len - copied) chunk = len - copied;
+      memcpy(dst + copied, window + offset, chunk);
+      copied += chunk;
+      pos += chunk;
+      continue;
+    }
+
+    // Requests at least a window long gain nothing from buffering
+    if ((size_t)(len - copied) >= windowSize) {
+      int32_t got = readDirect(dst + copied, len - copied);
+      if (got <= 0) break;
+      copied += got;
+      continue;
+    }
+
+    if (!fill(pos)) break;
+  }
+
+  stats->requests++;
+  if (stats->fsReads == readsBefore) stats->hits++;
+  stats->bytesRequested += copied;
+  return copied;
+}
+
+int32_t GIFReadAhead::seek(int32_t position) {
+  if (position < 0) position = 0;
+  if (position > fileSize) position = fileSize;
+  pos = position;
+  return pos;
+}
+
+bool GIFReadAhead::fill(int32_t position) {
+  int32_t start = position - (position % (int32_t)windowSize);
+  if (filePos != start) {
+    file.seek(start);
+    stats->fsSeeks++;
+  }
+
+  int32_t got = file.read(window, windowSize);
+  stats->fsReads++;
+  if (got <= 0) {
+    windowLength = 0;
+    return false;
+  }
+
+  stats->bytesRead += got;
+  windowStart = start;
+  windowLength = got;
+  filePos = start + got;
+  return position < filePos;
+}
+
+int32_t GIFReadAhead::readDirect(uint8_t *dst, int32_t len) {
+  if (filePos != pos) {
+    file.seek(pos);
+    stats->fsSeeks++;
+  }
+
+  int32_t got = file.read(dst, len);
+  stats->fsReads++;
+  if (got <= 0) return 0;
+
+  stats->bytesRead += got;
+  filePos = pos + got;
+  pos += got;
+  return got;
+}
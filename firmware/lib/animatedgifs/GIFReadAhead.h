@@ -0,0 +1,105 @@
+#ifndef GIF_READ_AHEAD_H
+#define GIF_READ_AHEAD_H
+
+/**
+ * @file GIFReadAhead.h
+ * @brief Block read-ahead between the AnimatedGIF file callbacks and the filesystem
+ *
+ * The LZW decoder asks for many small reads. This reader serves them from an
+ * aligned window that is refilled with one large filesystem read, and defers
+ * seeks until data outside the window is actually needed.
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+
+/**
+ * @struct ReadAheadStats
+ * @brief Counters shared by all readers of one owner
+ */
+struct ReadAheadStats {
+    uint32_t requests = 0;          //< Read calls from the decoder
+    uint32_t hits = 0;              //< Read calls served without touching the filesystem
+    uint32_t bytesRequested = 0;    //< Bytes returned to the decoder
+    uint32_t bytesRead = 0;         //< Bytes read from the filesystem
+    uint32_t fsReads = 0;           //< File::read() calls issued
+    uint32_t fsSeeks = 0;           //< File::seek() calls issued
+
+    /**
+     * @brief Fraction of read calls served from the window
+     * @return Hit rate between 0 and 1
+     */
+    float hitRate() const { return requests ? (float)hits / requests : 0.0f; }
+};
+
+/**
+ * @class GIFReadAhead
+ * @brief Windowed, seek-aware buffered reader over an fs::File
+ */
+class GIFReadAhead {
+public:
+    GIFReadAhead() = default;
+    ~GIFReadAhead();
+
+    // Buffer ownership makes copies unsafe
+    GIFReadAhead(const GIFReadAhead&) = delete;
+    GIFReadAhead& operator=(const GIFReadAhead&) = delete;
+
+    /**
+     * @brief Open a file for buffered reading
+     * @param fs Filesystem holding the file
+     * @param path File path
+     * @param windowSize Read-ahead window in bytes
+     * @param stats Counters to update
+     * @return true if the file was opened
+     */
+    bool open(fs::FS &fs, const char *path, size_t windowSize, ReadAheadStats &stats);
+
+    /**
+     * @brief Close the file and release the window buffer
+     */
+    void close();
+
+    bool isOpen() const { return (bool)file; }
+    int32_t size() const { return fileSize; }
+    int32_t position() const { return pos; }
+
+    /**
+     * @brief Read bytes at the current position
+     * @param dst Destination buffer
+     * @param len Number of bytes wanted
+     * @return Number of bytes copied
+     */
+    int32_t read(uint8_t *dst, int32_t len);
+
+    /**
+     * @brief Move the read position; no filesystem call is made
+     * @param position Absolute position
+     * @return New position
+     */
+    int32_t seek(int32_t position);
+
+private:
+    /**
+     * @brief Load the aligned window containing position
+     * @return true if the window now holds data at position
+     */
+    bool fill(int32_t position);
+
+    /**
+     * @brief Read straight from the file, bypassing the window
+     */
+    int32_t readDirect(uint8_t *dst, int32_t len);
+
+    File file;                        //< Underlying file
+    ReadAheadStats *stats = nullptr;  //< Counter sink
+    uint8_t *window = nullptr;        //< Window buffer
+    size_t windowSize = 0;            //< Window capacity in bytes
+    int32_t windowStart = 0;          //< File offset of window[0]
+    int32_t windowLength = 0;         //< Valid bytes in the window
+    int32_t fileSize = 0;             //< File size in bytes
+    int32_t filePos = 0;              //< Position of the underlying file
+    int32_t pos = 0;                  //< Logical read position
+};
+
+#endif // GIF_READ_AHEAD_H
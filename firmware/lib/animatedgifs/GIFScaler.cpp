@@ -0,0 +1,229 @@
+#include "GIFScaler.h"
+
+namespace {
+
+/**
+ * @brief First source index of an output box
+ *
+ * Source index s belongs to box s * out / source, so box i starts at
+ * ceil(i * source / out).
+ */
+inline int boxStart(int index, int source, int out) {
+  return ((uint32_t)index * source + out - 1) / out;
+}
+
+} // namespace
+
+bool GIFScaler::parseMode(const char *name, ScaleMode &result) {
+  if (!name) {
+    return false;
+  }
+  if (strcmp(name, "crop") == 0) {
+    result = ScaleMode::CROP;
+  } else if (strcmp(name, "nearest") == 0) {
+    result = ScaleMode::NEAREST;
+  } else if (strcmp(name, "box") == 0) {
+    result = ScaleMode::BOX;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *GIFScaler::getModeName(ScaleMode scaleMode) {
+  switch (scaleMode) {
+    case ScaleMode::NEAREST:
+      return "nearest";
+    case ScaleMode::BOX:
+      return "box";
+    case ScaleMode::CROP:
+    default:
+      return "crop";
+  }
+}
+
+bool GIFScaler::begin(uint16_t width, uint16_t height, int16_t targetWidth,
+                      int16_t targetHeight) {
+  active = false;
+  pendingRow = -1;
+
+  if (mode == ScaleMode::CROP || width == 0 || height == 0 ||
+      targetWidth <= 0 || targetHeight <= 0) {
+    return false;
+  }
+  if (width <= targetWidth && height <= targetHeight) {
+    return false;
+  }
+
+  // One scale factor for both axes; the limiting axis fills the target
+  sourceWidth = width;
+  sourceHeight = height;
+  if ((uint32_t)width * targetHeight >= (uint32_t)height * targetWidth) {
+    outWidth = targetWidth;
+    outHeight = max(1, (int)((uint32_t)height * targetWidth / width));
+  } else {
+    outHeight = targetHeight;
+    outWidth = max(1, (int)((uint32_t)width * targetHeight / height));
+  }
+  offsetX = (targetWidth - outWidth) / 2;
+  offsetY = (targetHeight - outHeight) / 2;
+
+  // Output column dx covers source columns [columnStart[dx], columnStart[dx + 1])
+  // and nearest mode samples the one in the middle
+  columnStart.resize(outWidth + 1);
+  columnPick.resize(outWidth);
+  for (int dx = 0; dx <= outWidth; dx++) {
+    columnStart[dx] = boxStart(dx, sourceWidth, outWidth);
+  }
+  for (int dx = 0; dx < outWidth; dx++) {
+    columnPick[dx] = (columnStart[dx] + columnStart[dx + 1] - 1) / 2;
+  }
+
+  colors.assign(outWidth, 0);
+  opaque.assign(outWidth, 0);
+  if (mode == ScaleMode::BOX) {
+    sumRed.assign(outWidth, 0);
+    sumGreen.assign(outWidth, 0);
+    sumBlue.assign(outWidth, 0);
+    opaqueCount.assign(outWidth, 0);
+    sampleCount.assign(outWidth, 0);
+  }
+
+  active = true;
+  return true;
+}
+
+void GIFScaler::outputColumns(int x, int width, int &first, int &last) const {
+  first = (uint32_t)x * outWidth / sourceWidth;
+  last = (uint32_t)(x + width - 1) * outWidth / sourceWidth + 1;
+  if (last > outWidth) last = outWidth;
+}
+
+void GIFScaler::mapRect(int x, int y, int width, int height,
+                        int16_t &outX, int16_t &outY, int16_t &outW, int16_t &outH) const {
+  outX = outY = outW = outH = 0;
+  if (!active) return;
+
+  // Clip to the logical screen
+  if (x < 0) {
+    width += x;
+    x = 0;
+  }
+  if (y < 0) {
+    height += y;
+    y = 0;
+  }
+  if (x + width > sourceWidth) width = sourceWidth - x;
+  if (y + height > sourceHeight) height = sourceHeight - y;
+  if (width <= 0 || height <= 0) return;
+
+  int first, last;
+  outputColumns(x, width, first, last);
+  int firstRow = (uint32_t)y * outHeight / sourceHeight;
+  int lastRow = (uint32_t)(y + height - 1) * outHeight / sourceHeight + 1;
+  if (lastRow > outHeight) lastRow = outHeight;
+
+  outX = offsetX + first;
+  outY = offsetY + firstRow;
+  outW = last - first;
+  outH = lastRow - firstRow;
+}
+
+void GIFScaler::scaleZonedLine(const uint8_t *pixels, const ColorCalibration *calibration,
+                               const uint16_t *palettes, int16_t transparent, int x, int y,
+                               int width, bool lastLine, LineSink sink, void *user) {
+  if (!active || y < 0 || y >= sourceHeight || x < 0 || x >= sourceWidth) {
+    return;
+  }
+  if (x + width > sourceWidth) width = sourceWidth - x;
+  if (width <= 0) {
+    return;
+  }
+
+  int row = (uint32_t)y * outHeight / sourceHeight;
+  int rowStart = boxStart(row, sourceHeight, outHeight);
+  int nextRowStart = boxStart(row + 1, sourceHeight, outHeight);
+  int first, last;
+  outputColumns(x, width, first, last);
+
+  if (mode == ScaleMode::NEAREST) {
+    // Only the middle line of each row's box is converted
+    if (y != (rowStart + nextRowStart - 1) / 2) {
+      return;
+    }
+    for (int dx = first; dx < last;) {
+      int16_t runEnd = INT16_MAX;
+      const uint16_t *palette = calibration ?
+          calibration->paletteAt(palettes, offsetX + dx, offsetY + row, runEnd) : palettes;
+      int end = min(last, runEnd - offsetX);
+      for (; dx < end; dx++) {
+        int sx = columnPick[dx] - x;
+        if (sx < 0 || sx >= width || pixels[sx] == transparent) {
+          opaque[dx] = 0;
+          continue;
+        }
+        colors[dx] = palette[pixels[sx]];
+        opaque[dx] = 1;
+      }
+    }
+    sink(offsetX + first, offsetY + row, &colors[first], &opaque[first], last - first, user);
+    return;
+  }
+
+  // Lines of one row can arrive apart when the GIF is interlaced
+  if (pendingRow >= 0 && pendingRow != row) {
+    flushBoxRow(sink, user);
+  }
+  if (pendingRow < 0) {
+    pendingRow = row;
+    pendingFirst = first;
+    pendingLast = last;
+  } else {
+    pendingFirst = min(pendingFirst, first);
+    pendingLast = max(pendingLast, last);
+  }
+
+  for (int dx = first; dx < last;) {
+    int16_t runEnd = INT16_MAX;
+    const uint16_t *palette = calibration ?
+        calibration->paletteAt(palettes, offsetX + dx, offsetY + row, runEnd) : palettes;
+    int end = min(last, runEnd - offsetX);
+    for (; dx < end; dx++) {
+      int sxBegin = max((int)columnStart[dx], x) - x;
+      int sxEnd = min((int)columnStart[dx + 1], x + width) - x;
+      for (int sx = sxBegin; sx < sxEnd; sx++) {
+        sampleCount[dx]++;
+        if (pixels[sx] == transparent) continue;
+        uint16_t color = palette[pixels[sx]];
+        sumRed[dx] += color >> 11;
+        sumGreen[dx] += (color >> 5) & 0x3F;
+        sumBlue[dx] += color & 0x1F;
+        opaqueCount[dx]++;
+      }
+    }
+  }
+
+  if (lastLine || y + 1 >= nextRowStart) {
+    flushBoxRow(sink, user);
+  }
+}
+
+void GIFScaler::flushBoxRow(LineSink sink, void *user) {
+  for (int dx = pendingFirst; dx < pendingLast; dx++) {
+    uint32_t n = opaqueCount[dx];
+
+    // Mostly transparent boxes stay transparent
+    opaque[dx] = sampleCount[dx] > 0 && 2 * n >= sampleCount[dx];
+    if (opaque[dx]) {
+      colors[dx] = ((sumRed[dx] + n / 2) / n) << 11 |
+                   ((sumGreen[dx] + n / 2) / n) << 5 |
+                   ((sumBlue[dx] + n / 2) / n);
+    }
+    sumRed[dx] = sumGreen[dx] = sumBlue[dx] = 0;
+    opaqueCount[dx] = sampleCount[dx] = 0;
+  }
+
+  sink(offsetX + pendingFirst, offsetY + pendingRow, &colors[pendingFirst],
+       &opaque[pendingFirst], pendingLast - pendingFirst, user);
+  pendingRow = -1;
+}
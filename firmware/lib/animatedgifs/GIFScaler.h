@@ -0,0 +1,198 @@
+#ifndef GIF_SCALER_H
+#define GIF_SCALER_H
+
+/**
+ * @file GIFScaler.h
+ * @brief Decode-time downscaling of GIFs larger than the panel
+ *
+ * Decoded source lines are mapped straight to panel rows as they arrive
+ * from the decoder, so an oversized GIF is shown whole, keeping its aspect
+ * ratio and centered, without an intermediate full-size frame. Nearest mode
+ * converts only the source pixels that become output pixels; box mode
+ * averages every source pixel of each output pixel's box.
+ */
+
+#include <Arduino.h>
+#include <vector>
+
+#include "ColorCalibration.h"
+
+/**
+ * @enum ScaleMode
+ * @brief How GIFs larger than the panel are fitted to it
+ */
+enum class ScaleMode {
+    CROP,       //< Show the top-left corner at full size
+    NEAREST,    //< Sample one source pixel per output pixel
+    BOX         //< Average all source pixels covered by an output pixel
+};
+
+/**
+ * @class GIFScaler
+ * @brief Maps decoded GIF lines onto a smaller target
+ */
+class GIFScaler {
+public:
+    /**
+     * @brief Receives finished output runs
+     * @param x Target column of the first pixel
+     * @param y Target row
+     * @param colors RGB565 pixels
+     * @param opaque Non-zero for pixels to write, zero for transparent ones
+     * @param length Number of pixels
+     * @param user Pointer passed to scaleLine()
+     */
+    typedef void (*LineSink)(int16_t x, int16_t y, const uint16_t *colors,
+                             const uint8_t *opaque, int16_t length, void *user);
+
+    // =============================================================================
+    // Configuration
+    // =============================================================================
+
+    void setMode(ScaleMode newMode) { mode = newMode; }
+    ScaleMode getMode() const { return mode; }
+
+    /**
+     * @brief Parse a scale mode name ("crop", "nearest" or "box")
+     * @param name Mode name
+     * @param result Parsed mode, unchanged on failure
+     * @return true if the name was recognized
+     */
+    static bool parseMode(const char *name, ScaleMode &result);
+
+    /**
+     * @brief Get a printable name for a scale mode
+     * @param scaleMode Scale mode
+     * @return Mode name
+     */
+    static const char *getModeName(ScaleMode scaleMode);
+
+    // =============================================================================
+    // Per-GIF Setup
+    // =============================================================================
+
+    /**
+     * @brief Set up scaling for a newly opened GIF
+     *
+     * Scaling is only active when the mode is not CROP and the GIF is larger
+     * than the target in at least one dimension.
+     *
+     * @param sourceWidth GIF logical screen width
+     * @param sourceHeight GIF logical screen height
+     * @param targetWidth Panel width
+     * @param targetHeight Panel height
+     * @return true if lines must go through scaleLine()
+     */
+    bool begin(uint16_t sourceWidth, uint16_t sourceHeight,
+               int16_t targetWidth, int16_t targetHeight);
+
+    bool isActive() const { return active; }
+    int16_t getOutputWidth() const { return outWidth; }
+    int16_t getOutputHeight() const { return outHeight; }
+
+    /**
+     * @brief Map a rectangle of the GIF onto the target
+     *
+     * The result covers every target pixel fed by a source pixel of the
+     * rectangle.
+     *
+     * @param x Source column
+     * @param y Source row
+     * @param width Source width
+     * @param height Source height
+     * @param outX Receives the target column
+     * @param outY Receives the target row
+     * @param outW Receives the target width, 0 if nothing is covered
+     * @param outH Receives the target height, 0 if nothing is covered
+     */
+    void mapRect(int x, int y, int width, int height,
+                 int16_t &outX, int16_t &outY, int16_t &outW, int16_t &outH) const;
+
+    // =============================================================================
+    // Scaling
+    // =============================================================================
+
+    /**
+     * @brief Scale one decoded source line
+     *
+     * Nearest mode emits a row when the line is the one sampled for it and
+     * skips all other lines. Box mode accumulates lines and emits a row once
+     * the last line of its box, or of the frame, has arrived.
+     *
+     * @param pixels Palette indices of the line
+     * @param palette RGB565 palette with 256 entries
+     * @param transparent Transparent palette index or -1 for none
+     * @param x Source column of the first pixel
+     * @param y Source row of the line
+     * @param width Number of pixels in the line
+     * @param lastLine true for the last line of the frame
+     * @param sink Receives the finished output rows
+     * @param user Passed through to the sink
+     */
+    void scaleLine(const uint8_t *pixels, const uint16_t *palette, int16_t transparent,
+                   int x, int y, int width, bool lastLine, LineSink sink,
+                   void *user = nullptr) {
+        scaleZonedLine(pixels, nullptr, palette, transparent, x, y, width, lastLine, sink, user);
+    }
+
+    /**
+     * @brief Scale one decoded source line onto a calibrated canvas
+     *
+     * Each output pixel is converted with the palette of the calibration
+     * zone it lands in.
+     *
+     * @param calibration Zones of the target canvas
+     * @param palettes Palettes filled by ColorCalibration::convertPalette()
+     * @see scaleLine() for the other parameters
+     */
+    void scaleLine(const uint8_t *pixels, const ColorCalibration &calibration,
+                   const uint16_t *palettes, int16_t transparent, int x, int y, int width,
+                   bool lastLine, LineSink sink, void *user = nullptr) {
+        scaleZonedLine(pixels, &calibration, palettes, transparent, x, y, width, lastLine,
+                       sink, user);
+    }
+
+private:
+    /**
+     * @brief Scale a line, switching palette by zone when a calibration is given
+     */
+    void scaleZonedLine(const uint8_t *pixels, const ColorCalibration *calibration,
+                        const uint16_t *palettes, int16_t transparent, int x, int y, int width,
+                        bool lastLine, LineSink sink, void *user);
+
+    /**
+     * @brief Range of output columns fed by source columns [x, x + width)
+     */
+    void outputColumns(int x, int width, int &first, int &last) const;
+
+    /**
+     * @brief Emit the accumulated box row and clear its accumulators
+     */
+    void flushBoxRow(LineSink sink, void *user);
+
+    ScaleMode mode = ScaleMode::NEAREST;  //< Configured mode
+    bool active = false;                  //< The open GIF is being scaled
+    int sourceWidth = 0;                  //< GIF logical screen width
+    int sourceHeight = 0;                 //< GIF logical screen height
+    int16_t outWidth = 0;                 //< Scaled image width
+    int16_t outHeight = 0;                //< Scaled image height
+    int16_t offsetX = 0;                  //< Left edge of the scaled image on the target
+    int16_t offsetY = 0;                  //< Top edge of the scaled image on the target
+
+    std::vector<uint16_t> columnStart;    //< First source column of each output column, plus the end
+    std::vector<uint16_t> columnPick;     //< Source column sampled by each output column
+    std::vector<uint16_t> colors;         //< Output row being built
+    std::vector<uint8_t> opaque;          //< Opacity of the output row being built
+
+    // Box accumulation for one output row
+    std::vector<uint32_t> sumRed;         //< Sum of 5-bit red of opaque samples
+    std::vector<uint32_t> sumGreen;       //< Sum of 6-bit green of opaque samples
+    std::vector<uint32_t> sumBlue;        //< Sum of 5-bit blue of opaque samples
+    std::vector<uint32_t> opaqueCount;    //< Opaque samples per output column
+    std::vector<uint32_t> sampleCount;    //< All samples per output column
+    int pendingRow = -1;                  //< Output row being accumulated, -1 if none
+    int pendingFirst = 0;                 //< First output column touched in pendingRow
+    int pendingLast = 0;                  //< One past the last output column touched
+};
+
+#endif // GIF_SCALER_H
@@ -0,0 +1,498 @@
+#include "GIFStagingCache.h"
+#include <string.h>
+
+#include "GIFMemory.h"
+#include "Logger.h"
+#include "RecordIO.h"
+
+namespace {
+
+const uint8_t MAGIC[4] = {'G', 'S', 'T', 'G'};
+
+/** @brief Magic, version, next file id and entry count */
+const size_t HEADER_BYTES = 12;
+
+/** @brief Largest state file accepted: every entry with a full-length path */
+const size_t MAX_STATE_BYTES =
+    HEADER_BYTES + STAGING_MAX_ENTRIES * (1 + UINT8_MAX + 16) + RECORD_CHECKSUM_BYTES;
+
+/** @brief Bytes copied per read while staging a GIF */
+const size_t COPY_CHUNK_BYTES = 4096;
+
+/** @brief Length of the copy allowance window */
+const uint32_t WINDOW_MS = 3600000;
+
+const char *COPY_SUFFIX = ".gif";
+const char *TEMP_SUFFIX = ".tmp";
+
+} // namespace
+
+void GIFStagingCache::configure(size_t budgetBytes, uint32_t writeBytesPerHour) {
+  std::lock_guard<std::mutex> lock(mutex);
+  budget = budgetBytes;
+  this->writeBytesPerHour = writeBytesPerHour;
+}
+
+size_t GIFStagingCache::begin(fs::FS &flash, fs::FS &source) {
+  std::lock_guard<std::mutex> lock(mutex);
+  this->flash = &flash;
+  entries.clear();
+  entries.reserve(STAGING_MAX_ENTRIES);
+  usedBytes = 0;
+  windowStartMs = millis();
+  windowBytes = 0;
+
+  if (!flash.exists(STAGING_DIR) && !flash.mkdir(STAGING_DIR)) {
+    LOG_ERROR("GIFStagingCache: Failed to create %s", STAGING_DIR);
+    this->flash = nullptr;
+    return 0;
+  }
+  if (budget > 0) {
+    load(source);
+  }
+  // Copies that were not restored only take up flash
+  removeOrphans();
+  return entries.size();
+}
+
+bool GIFStagingCache::acquire(const String &path, String &copyPath) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (budget == 0 || !flash) {
+    return false;
+  }
+
+  Entry *entry = track(path);
+  if (entry) {
+    entry->plays++;
+  }
+  // Halving all counts now and then lets a new favourite overtake old ones
+  if (++playsSinceAging >= STAGING_AGING_PLAYS) {
+    playsSinceAging = 0;
+    for (Entry &e : entries) {
+      e.plays /= 2;
+    }
+  }
+
+  if (entry && entry->id != 0 && !entry->stale) {
+    entry->pins++;
+    stats.hits++;
+    copyPath = stagedPath(entry->id);
+    return true;
+  }
+  stats.misses++;
+  return false;
+}
+
+void GIFStagingCache::release(const String &path) {
+  std::lock_guard<std::mutex> lock(mutex);
+  Entry *entry = find(path);
+  if (!entry || entry->pins == 0) {
+    return;
+  }
+  entry->pins--;
+  if (entry->pins == 0 && entry->stale) {
+    drop(*entry);
+    save();
+  }
+}
+
+bool GIFStagingCache::maintain(fs::FS &source) {
+  String path;
+  uint32_t id;
+  uint32_t seen;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (budget == 0 || !flash) {
+      return false;
+    }
+    uint32_t now = millis();
+    if (now - windowStartMs >= WINDOW_MS) {
+      windowStartMs = now;
+      windowBytes = 0;
+    }
+    Entry *candidate = pickCandidate();
+    if (!candidate) {
+      return false;
+    }
+    path = candidate->path;
+    seen = changes;
+  }
+
+  File file = source.open(path, FILE_READ);
+  std::unique_lock<std::mutex> lock(mutex);
+  Entry *entry = find(path);
+  if (!entry) {
+    return true;
+  }
+  if (!file || file.isDirectory()) {
+    // Gone from the card; counted again if it comes back
+    forget(*entry);
+    return true;
+  }
+  uint32_t size = file.size();
+  uint32_t mtime = (uint32_t)file.getLastWrite();
+  if (size == 0 || size > budget || size > writeBytesPerHour) {
+    entry->tooLarge = true;
+    file.close();
+    return true;
+  }
+  if (windowBytes + size > writeBytesPerHour) {
+    // Out of write allowance for this hour
+    file.close();
+    return false;
+  }
+  if (!makeRoom(*entry, size)) {
+    file.close();
+    return false;
+  }
+  id = nextId++;
+  windowBytes += size;
+  lock.unlock();
+
+  // Copied without the lock: plays go on while the card is read
+  String tempPath = String(STAGING_DIR "/") + id + TEMP_SUFFIX;
+  File copy = flash->open(tempPath, FILE_WRITE);
+  uint8_t *buffer = static_cast<uint8_t *>(GIFMemory::allocate(COPY_CHUNK_BYTES));
+  size_t copied = 0;
+  if (copy && buffer) {
+    size_t got;
+    while ((got = file.read(buffer, COPY_CHUNK_BYTES)) > 0) {
+      if (copy.write(buffer, got) != got) {
+        break;
+      }
+      copied += got;
+    }
+  }
+  GIFMemory::release(buffer);
+  file.close();
+  if (copy) {
+    copy.close();
+  }
+
+  lock.lock();
+  entry = find(path);
+  bool ok = copied == size && entry && entry->id == 0 && changes == seen &&
+            flash->rename(tempPath, stagedPath(id));
+  if (!ok) {
+    flash->remove(tempPath);
+    if (copied != size) {
+      LOG_WARNING("GIFStagingCache: Failed to copy %s into flash", path.c_str());
+    }
+    save();
+    return false;
+  }
+
+  entry->id = id;
+  entry->size = size;
+  entry->mtime = mtime;
+  entry->stale = false;
+  usedBytes += size;
+  stats.staged++;
+  stats.bytesStaged += size;
+  save();
+  LOG_INFO("GIFStagingCache: Staged %s (%u bytes, %u plays), %u of %u bytes used",
+           path.c_str(), (unsigned)size, (unsigned)entry->plays, (unsigned)usedBytes,
+           (unsigned)budget);
+  return true;
+}
+
+void GIFStagingCache::invalidate(const String &path) {
+  std::lock_guard<std::mutex> lock(mutex);
+  changes++;
+  Entry *entry = find(path);
+  if (!entry) {
+    return;
+  }
+  // A replaced GIF may fit now
+  entry->tooLarge = false;
+  if (entry->id == 0 || entry->stale) {
+    return;
+  }
+  stats.invalidated++;
+  if (entry->pins > 0) {
+    // Removed once the playing copy is closed
+    entry->stale = true;
+  } else {
+    drop(*entry);
+  }
+  save();
+}
+
+void GIFStagingCache::validate(const GIFCategoryIndex &index) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const size_t baseLength = strlen(GIFS_BASE_PATH "/");
+  bool dropped = false;
+  for (Entry &entry : entries) {
+    int slash = entry.path.lastIndexOf('/');
+    // Only GIFs inside a category are indexed
+    if (entry.id == 0 || entry.stale || !entry.path.startsWith(GIFS_BASE_PATH "/") ||
+        slash < (int)baseLength) {
+      continue;
+    }
+    String category = entry.path.substring(baseLength, slash);
+    const GIFMetadata *metadata =
+        index.find(category.c_str(), entry.path.c_str() + slash + 1);
+    if (metadata && metadata->size == entry.size && metadata->mtime == entry.mtime) {
+      continue;
+    }
+    changes++;
+    stats.invalidated++;
+    if (entry.pins > 0) {
+      entry.stale = true;
+    } else {
+      drop(entry);
+    }
+    dropped = true;
+  }
+  if (dropped) {
+    save();
+  }
+}
+
+StagingStats GIFStagingCache::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+size_t GIFStagingCache::getUsedBytes() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return usedBytes;
+}
+
+size_t GIFStagingCache::getStagedCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t count = 0;
+  for (const Entry &entry : entries) {
+    if (entry.id != 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+GIFStagingCache::Entry *GIFStagingCache::find(const String &path) {
+  for (Entry &entry : entries) {
+    if (entry.path == path) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+GIFStagingCache::Entry *GIFStagingCache::track(const String &path) {
+  Entry *entry = find(path);
+  if (entry) {
+    return entry;
+  }
+  if (entries.size() < STAGING_MAX_ENTRIES) {
+    entries.emplace_back();
+    entries.back().path = path;
+    return &entries.back();
+  }
+
+  // Make way by forgetting the least played GIF that has no copy
+  Entry *victim = nullptr;
+  for (Entry &e : entries) {
+    if (e.id == 0 && e.pins == 0 && (!victim || e.plays < victim->plays)) {
+      victim = &e;
+    }
+  }
+  if (victim) {
+    *victim = Entry();
+    victim->path = path;
+  }
+  return victim;
+}
+
+GIFStagingCache::Entry *GIFStagingCache::pickCandidate() {
+  Entry *best = nullptr;
+  for (Entry &entry : entries) {
+    if (entry.id == 0 && !entry.tooLarge && entry.plays >= STAGING_MIN_PLAYS &&
+        (!best || entry.plays > best->plays)) {
+      best = &entry;
+    }
+  }
+  return best;
+}
+
+bool GIFStagingCache::makeRoom(const Entry &candidate, uint32_t size) {
+  while (usedBytes + size > budget) {
+    Entry *victim = nullptr;
+    for (Entry &entry : entries) {
+      if (entry.id != 0 && entry.pins == 0 && (!victim || entry.plays < victim->plays)) {
+        victim = &entry;
+      }
+    }
+    // Swapping copies of similarly popular GIFs would only wear the flash
+    if (!victim || victim->plays * 2 >= candidate.plays) {
+      return false;
+    }
+    LOG_DEBUG("GIFStagingCache: Evicting %s (%u plays) for %s (%u plays)",
+              victim->path.c_str(), (unsigned)victim->plays, candidate.path.c_str(),
+              (unsigned)candidate.plays);
+    drop(*victim);
+    stats.evictions++;
+  }
+  return true;
+}
+
+void GIFStagingCache::drop(Entry &entry) {
+  flash->remove(stagedPath(entry.id));
+  usedBytes -= entry.size;
+  entry.id = 0;
+  entry.size = 0;
+  entry.mtime = 0;
+  entry.stale = false;
+}
+
+void GIFStagingCache::forget(Entry &entry) {
+  if (entry.id != 0) {
+    if (entry.pins > 0) {
+      entry.stale = true;
+      return;
+    }
+    drop(entry);
+    save();
+  }
+  entries.erase(entries.begin() + (&entry - entries.data()));
+}
+
+void GIFStagingCache::load(fs::FS &source) {
+  File file = flash->open(STAGING_STATE_PATH, FILE_READ);
+  if (!file) {
+    return;
+  }
+  size_t size = file.size();
+  if (size > MAX_STATE_BYTES) {
+    file.close();
+    LOG_WARNING("GIFStagingCache: %s is too large", STAGING_STATE_PATH);
+    return;
+  }
+  uint8_t *data = static_cast<uint8_t *>(GIFMemory::allocate(size));
+  if (!data) {
+    file.close();
+    return;
+  }
+  size_t got = file.read(data, size);
+  file.close();
+
+  if (got != size || !verifyRecordFile(data, size, MAGIC)) {
+    GIFMemory::release(data);
+    LOG_WARNING("GIFStagingCache: %s is corrupt", STAGING_STATE_PATH);
+    return;
+  }
+  RecordReader reader(data + sizeof(MAGIC), size - sizeof(MAGIC) - RECORD_CHECKSUM_BYTES);
+  uint16_t version = reader.get16();
+  if (version != VERSION) {
+    GIFMemory::release(data);
+    return;
+  }
+  nextId = reader.get32();
+  uint16_t count = reader.get16();
+
+  char name[UINT8_MAX + 1];
+  for (uint16_t i = 0; i < count && reader.isValid() && entries.size() < STAGING_MAX_ENTRIES;
+       i++) {
+    Entry entry;
+    entry.path = reader.getName(name);
+    entry.id = reader.get32();
+    entry.size = reader.get32();
+    entry.mtime = reader.get32();
+    entry.plays = reader.get32();
+    if (!reader.isValid() || entry.id == 0 || entry.id >= nextId) {
+      break;
+    }
+
+    // The copy must be whole and its source unchanged since it was made
+    File copy = flash->open(stagedPath(entry.id), FILE_READ);
+    bool intact = copy && copy.size() == entry.size;
+    if (copy) {
+      copy.close();
+    }
+    File original = source.open(entry.path, FILE_READ);
+    bool current = original && original.size() == entry.size &&
+                   (uint32_t)original.getLastWrite() == entry.mtime;
+    if (original) {
+      original.close();
+    }
+    if (!intact || !current || usedBytes + entry.size > budget) {
+      continue;
+    }
+    usedBytes += entry.size;
+    entries.push_back(entry);
+  }
+  GIFMemory::release(data);
+}
+
+bool GIFStagingCache::save() {
+  String tempPath = String(STAGING_STATE_PATH) + TEMP_SUFFIX;
+  File file = flash->open(tempPath, FILE_WRITE);
+  if (!file) {
+    LOG_ERROR("GIFStagingCache: Failed to create %s", tempPath.c_str());
+    return false;
+  }
+
+  uint16_t count = 0;
+  for (const Entry &entry : entries) {
+    if (entry.id != 0 && !entry.stale) {
+      count++;
+    }
+  }
+  RecordWriter writer(file);
+  writer.put(MAGIC, sizeof(MAGIC));
+  writer.put16(VERSION);
+  writer.put32(nextId);
+  writer.put16(count);
+  for (const Entry &entry : entries) {
+    if (entry.id == 0 || entry.stale) {
+      continue;
+    }
+    writer.putName(entry.path.c_str());
+    writer.put32(entry.id);
+    writer.put32(entry.size);
+    writer.put32(entry.mtime);
+    writer.put32(entry.plays);
+  }
+  bool ok = writer.finish();
+  file.close();
+
+  if (!ok || !replaceRecordFile(*flash, tempPath, STAGING_STATE_PATH)) {
+    LOG_ERROR("GIFStagingCache: Failed to write %s", STAGING_STATE_PATH);
+    flash->remove(tempPath);
+    return false;
+  }
+  return true;
+}
+
+void GIFStagingCache::removeOrphans() {
+  File dir = flash->open(STAGING_DIR);
+  if (!dir || !dir.isDirectory()) {
+    return;
+  }
+  std::vector<String> orphans;
+  File file = dir.openNextFile();
+  while (file) {
+    String path = String(STAGING_DIR "/") + file.name();
+    bool keep = budget > 0 && path == STAGING_STATE_PATH;
+    for (const Entry &entry : entries) {
+      keep = keep || (entry.id != 0 && path == stagedPath(entry.id));
+    }
+    if (!keep && !file.isDirectory()) {
+      orphans.push_back(path);
+    }
+    file = dir.openNextFile();
+  }
+  dir.close();
+
+  for (const String &path : orphans) {
+    flash->remove(path);
+  }
+  if (!orphans.empty()) {
+    LOG_INFO("GIFStagingCache: Removed %u stale files from %s", (unsigned)orphans.size(),
+             STAGING_DIR);
+  }
+}
+
+String GIFStagingCache::stagedPath(uint32_t id) {
+  return String(STAGING_DIR "/") + id + COPY_SUFFIX;
+}
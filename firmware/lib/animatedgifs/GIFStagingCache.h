@@ -0,0 +1,184 @@
+#ifndef GIF_STAGING_CACHE_H
+#define GIF_STAGING_CACHE_H
+
+/**
+ * @file GIFStagingCache.h
+ * @brief Copies of frequently played GIFs kept in internal flash
+ *
+ * Every GIF opened for playback is counted. GIFs that keep coming back are
+ * copied from the SD card into a directory on LittleFS by a background task,
+ * and later plays open the copy instead. Flash wears with every write, so
+ * copying is rationed: a GIF must have been played a few times first, a
+ * staged copy is only replaced by a GIF played at least twice as often, and
+ * no more than a configured number of bytes is written per hour.
+ *
+ * The staged files survive reboots. Their list is kept in a record file in
+ * the staging directory (STAGING_STATE_PATH):
+ *
+ *   "GSTG", version (u16), next file id (u32), entry count (u16)
+ *   per entry: source path length (u8), path, file id (u32), size (u32),
+ *              modification time (u32), plays (u32)
+ *   FNV-1a checksum of everything before it (u32)
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <mutex>
+#include <vector>
+
+#include "GIFCategoryIndex.h"
+#include "constants.h"
+
+/**
+ * @struct StagingStats
+ * @brief Staging cache counters
+ */
+struct StagingStats {
+    uint32_t hits = 0;              //< Opens served from a staged copy
+    uint32_t misses = 0;            //< Opens read from the SD card
+    uint32_t staged = 0;            //< Files copied into flash
+    uint32_t evictions = 0;         //< Staged copies removed to make room
+    uint32_t invalidated = 0;       //< Staged copies dropped because the source changed
+    uint64_t bytesStaged = 0;       //< Bytes written into flash since boot
+};
+
+/**
+ * @class GIFStagingCache
+ * @brief Play-count driven copies of SD card GIFs in flash
+ *
+ * Thread safe: the playback task acquires copies, the staging task copies
+ * files in, and the web and index tasks invalidate them.
+ */
+class GIFStagingCache {
+public:
+    /** @brief Format version written to the state file */
+    static const uint16_t VERSION = 1;
+
+    // =============================================================================
+    // Configuration
+    // =============================================================================
+
+    /**
+     * @brief Set the flash budget and write allowance
+     * @param budgetBytes Bytes of staged copies kept, 0 disables staging
+     * @param writeBytesPerHour Bytes copied into flash per hour at most
+     */
+    void configure(size_t budgetBytes, uint32_t writeBytesPerHour);
+
+    /**
+     * @brief Load the staged files left by the previous run
+     *
+     * Copies that are missing, or whose source was changed or removed while
+     * the device was off, are forgotten, and files in STAGING_DIR that are
+     * not listed are removed. With staging disabled every copy is removed.
+     *
+     * @param flash Filesystem holding the copies
+     * @param source Filesystem the GIFs are played from
+     * @return Number of staged copies restored
+     */
+    size_t begin(fs::FS &flash, fs::FS &source);
+
+    bool isEnabled() const { return budget > 0 && flash != nullptr; }
+
+    // =============================================================================
+    // Playback
+    // =============================================================================
+
+    /**
+     * @brief Count a play of a GIF and look for its staged copy
+     *
+     * A copy that is returned is kept until release() is called with the
+     * same path.
+     *
+     * @param path Path of the GIF on the SD card
+     * @param copyPath Receives the path of the copy in flash
+     * @return true if the GIF is staged
+     */
+    bool acquire(const String &path, String &copyPath);
+
+    /**
+     * @brief Allow a copy returned by acquire() to be evicted again
+     * @param path Path of the GIF on the SD card
+     */
+    void release(const String &path);
+
+    fs::FS &getFS() const { return *flash; }
+
+    // =============================================================================
+    // Maintenance
+    // =============================================================================
+
+    /**
+     * @brief Copy the most played GIF that is not staged yet (staging task)
+     *
+     * Makes room by evicting copies played less than half as often. Reads
+     * the SD card and writes flash for as long as the copy takes, without
+     * holding the lock.
+     *
+     * @param source Filesystem the GIFs are played from
+     * @return true if it should run again right away, false if there is nothing to do for now
+     */
+    bool maintain(fs::FS &source);
+
+    /**
+     * @brief Drop the copy of a GIF that was replaced or deleted
+     * @param path Path of the GIF on the SD card
+     */
+    void invalidate(const String &path);
+
+    /**
+     * @brief Drop copies whose source no longer matches the category index
+     * @param index Index of the GIFs on the card
+     */
+    void validate(const GIFCategoryIndex &index);
+
+    // =============================================================================
+    // Status
+    // =============================================================================
+    StagingStats getStats() const;
+    size_t getBudget() const { return budget; }
+    size_t getUsedBytes() const;
+    size_t getStagedCount() const;
+
+private:
+    /**
+     * @struct Entry
+     * @brief A GIF being counted, staged or not
+     */
+    struct Entry {
+        String path;                //< Path on the SD card
+        uint32_t plays = 0;         //< Plays, halved now and then so old favourites fade
+        uint32_t id = 0;            //< Name of the copy, 0 if not staged
+        uint32_t size = 0;          //< Size of the copy
+        uint32_t mtime = 0;         //< Modification time of the source when copied
+        uint16_t pins = 0;          //< Open plays of the copy
+        bool stale = false;         //< Source changed while the copy was open
+        bool tooLarge = false;      //< Source does not fit in the budget or hourly allowance
+    };
+
+    Entry *find(const String &path);
+    Entry *track(const String &path);
+    Entry *pickCandidate();
+    bool makeRoom(const Entry &candidate, uint32_t size);
+    void drop(Entry &entry);
+    void forget(Entry &entry);
+    void load(fs::FS &source);
+    bool save();
+    void removeOrphans();
+    static String stagedPath(uint32_t id);
+
+    mutable std::mutex mutex;           //< Guards everything below
+    fs::FS *flash = nullptr;            //< Filesystem holding the copies
+    size_t budget = 0;                  //< Bytes of copies kept
+    uint32_t writeBytesPerHour = 0;     //< Copy allowance per hour
+    uint32_t windowStartMs = 0;         //< Start of the current allowance hour
+    uint32_t windowBytes = 0;           //< Bytes copied in the current hour
+    size_t usedBytes = 0;               //< Bytes of staged copies
+    uint32_t nextId = 1;                //< Name of the next copy
+    uint32_t playsSinceAging = 0;       //< Plays counted since the counts were last halved
+    uint32_t changes = 0;               //< Bumped by every invalidation, to catch them during a copy
+    std::vector<Entry> entries;         //< Counted GIFs, at most STAGING_MAX_ENTRIES
+    StagingStats stats;                 //< Counters
+};
+
+#endif // GIF_STAGING_CACHE_H
@@ -0,0 +1,343 @@
+#include "GIFTranscoder.h"
+#include <new>
+#include "GIFMemory.h"
+#include "constants.h"
+#include "Logger.h"
+
+namespace {
+
+/** @brief Levels per channel of the color cube */
+const uint8_t RED_LEVELS = 6;
+const uint8_t GREEN_LEVELS = 7;
+const uint8_t BLUE_LEVELS = 6;
+
+/** @brief First palette entry after the cube, used for unchanged pixels */
+const uint8_t TRANSPARENT_INDEX = RED_LEVELS * GREEN_LEVELS * BLUE_LEVELS;
+
+/**
+ * @brief Nearest cube level of an 8-bit channel value
+ */
+inline uint8_t cubeLevel(uint8_t value, uint8_t levels) {
+  return (value * (levels - 1) + 127) / 255;
+}
+
+/**
+ * @brief Reader handed to the decoder by the next open callback
+ *
+ * AnimatedGIF's open callback has no user pointer, so the input is opened
+ * before the decoder and passed over here.
+ */
+GIFReadAhead *openingFile = nullptr;
+
+} // namespace
+
+GIFTranscoder::GIFTranscoder() {
+  scaler.setMode(ScaleMode::BOX);
+
+  for (int v = 0; v < 32; v++) {
+    uint8_t value8 = v << 3 | v >> 2;
+    redIndex[v] = cubeLevel(value8, RED_LEVELS) * GREEN_LEVELS * BLUE_LEVELS;
+    blueIndex[v] = cubeLevel(value8, BLUE_LEVELS);
+  }
+  for (int v = 0; v < 64; v++) {
+    greenIndex[v] = cubeLevel(v << 2 | v >> 4, GREEN_LEVELS) * BLUE_LEVELS;
+  }
+
+  memset(palette, 0, sizeof(palette));
+  uint8_t *entry = palette;
+  for (int r = 0; r < RED_LEVELS; r++) {
+    for (int g = 0; g < GREEN_LEVELS; g++) {
+      for (int b = 0; b < BLUE_LEVELS; b++) {
+        *entry++ = r * 255 / (RED_LEVELS - 1);
+        *entry++ = g * 255 / (GREEN_LEVELS - 1);
+        *entry++ = b * 255 / (BLUE_LEVELS - 1);
+      }
+    }
+  }
+}
+
+bool GIFTranscoder::transcode(const uint8_t *data, size_t size, std::vector<uint8_t> &output,
+                              int16_t targetWidth, int16_t targetHeight) {
+  uint32_t startUs = micros();
+  stats = TranscodeStats();
+  stats.inputBytes = size;
+  output.clear();
+
+  AnimatedGIF *gif = createDecoder();
+  if (!gif) {
+    return false;
+  }
+
+  bool ok = false;
+  if (!gif->open(const_cast<uint8_t *>(data), size, drawLine)) {
+    LOG_ERROR("GIFTranscoder: Failed to open GIF");
+  } else {
+    ok = encodeFrames(gif, output, nullptr, targetWidth, targetHeight);
+    gif->close();
+  }
+  destroyDecoder(gif);
+
+  if (!ok) {
+    output.clear();
+    return false;
+  }
+  stats.outputBytes = output.size();
+  logResult(startUs);
+  return true;
+}
+
+bool GIFTranscoder::transcode(fs::FS &fs, const char *inputPath, File &output,
+                              int16_t targetWidth, int16_t targetHeight) {
+  uint32_t startUs = micros();
+  stats = TranscodeStats();
+
+  ReadAheadStats readStats;
+  GIFReadAhead input;
+  if (!input.open(fs, inputPath, DEFAULT_READ_AHEAD_BYTES, readStats)) {
+    LOG_ERROR("GIFTranscoder: Failed to open %s", inputPath);
+    return false;
+  }
+  stats.inputBytes = input.size();
+
+  AnimatedGIF *gif = createDecoder();
+  if (!gif) {
+    return false;
+  }
+
+  // Only the encoded bytes of one frame are held before they go to the file
+  bool ok = false;
+  std::vector<uint8_t> pending;
+  openingFile = &input;
+  if (!gif->open(inputPath, openFile, closeFile, readFile, seekFile, drawLine)) {
+    LOG_ERROR("GIFTranscoder: Failed to open GIF");
+  } else {
+    ok = encodeFrames(gif, pending, &output, targetWidth, targetHeight);
+    gif->close();
+  }
+  openingFile = nullptr;
+  destroyDecoder(gif);
+
+  if (!ok) {
+    return false;
+  }
+  logResult(startUs);
+  return true;
+}
+
+AnimatedGIF *GIFTranscoder::createDecoder() {
+  // The decoder state is tens of KB; keep it off the internal heap when possible
+  void *decoderMemory = GIFMemory::allocate(sizeof(AnimatedGIF));
+  if (!decoderMemory) {
+    LOG_ERROR("GIFTranscoder: No memory for the decoder");
+    return nullptr;
+  }
+  AnimatedGIF *gif = new (decoderMemory) AnimatedGIF;
+  gif->begin(LITTLE_ENDIAN_PIXELS);
+  return gif;
+}
+
+void GIFTranscoder::destroyDecoder(AnimatedGIF *gif) {
+  gif->~AnimatedGIF();
+  GIFMemory::release(gif);
+}
+
+bool GIFTranscoder::encodeFrames(AnimatedGIF *gif, std::vector<uint8_t> &output, File *sink,
+                                 int16_t targetWidth, int16_t targetHeight) {
+  stats.sourceWidth = gif->getCanvasWidth();
+  stats.sourceHeight = gif->getCanvasHeight();
+
+  // Scaled GIFs are centered on a target-sized screen
+  if (scaler.begin(stats.sourceWidth, stats.sourceHeight, targetWidth, targetHeight)) {
+    width = targetWidth;
+    height = targetHeight;
+  } else {
+    width = min((int)stats.sourceWidth, (int)targetWidth);
+    height = min((int)stats.sourceHeight, (int)targetHeight);
+  }
+  stats.width = width;
+  stats.height = height;
+  stats.minFreeHeap = ESP.getFreeHeap();
+
+  size_t pixels = (size_t)width * height;
+  if (!compositor.begin(width, height)) {
+    return false;
+  }
+  current.assign(pixels, 0);
+  previous.assign(pixels, 0);
+  frame.resize(pixels);
+
+  GIFEncoder encoder;
+  bool ok = encoder.begin(output, width, height, palette) && drain(output, sink);
+  if (ok) {
+    int result;
+    do {
+      int delayMs = 0;
+      result = gif->playFrame(false, &delayMs, this);
+      if (result < 0) break;
+      writeFrame(encoder, delayMs, stats.frames == 0);
+      stats.minFreeHeap = min(stats.minFreeHeap, (uint32_t)ESP.getFreeHeap());
+      ok = drain(output, sink);
+    } while (result > 0 && ok);
+
+    encoder.end();
+    ok = ok && drain(output, sink) && result >= 0 && stats.frames > 0;
+    if (!ok) {
+      LOG_ERROR("GIFTranscoder: Transcoding failed after %u frames", (unsigned)stats.frames);
+    }
+  }
+
+  // Working buffers are only needed while transcoding
+  compositor.end();
+  std::vector<uint8_t>().swap(current);
+  std::vector<uint8_t>().swap(previous);
+  std::vector<uint8_t>().swap(frame);
+  return ok;
+}
+
+bool GIFTranscoder::drain(std::vector<uint8_t> &output, File *sink) {
+  if (!sink || output.empty()) {
+    return true;
+  }
+  size_t written = sink->write(output.data(), output.size());
+  stats.outputBytes += written;
+  bool ok = written == output.size();
+  output.clear();
+  if (!ok) {
+    LOG_ERROR("GIFTranscoder: Failed to write output");
+  }
+  return ok;
+}
+
+void GIFTranscoder::logResult(uint32_t startUs) {
+  stats.elapsedUs = micros() - startUs;
+  LOG_INFO("GIFTranscoder: %ux%u -> %ux%u, %u frames, %u -> %u bytes in %u ms",
+           stats.sourceWidth, stats.sourceHeight, stats.width, stats.height,
+           (unsigned)stats.frames, (unsigned)stats.inputBytes,
+           (unsigned)stats.outputBytes, (unsigned)(stats.elapsedUs / 1000));
+}
+
+void GIFTranscoder::writeFrame(GIFEncoder &encoder, int delayMs, bool first) {
+  size_t pixels = (size_t)width * height;
+  const uint16_t *canvas = compositor.getCanvas();
+  for (size_t i = 0; i < pixels; i++) {
+    current[i] = quantize(canvas[i]);
+  }
+
+  // Bounding box of the pixels that differ from the last frame written
+  int left = 0, top = 0, right = width - 1, bottom = height - 1;
+  if (!first) {
+    left = width;
+    top = height;
+    right = -1;
+    bottom = -1;
+    for (int y = 0; y < height; y++) {
+      const uint8_t *now = &current[y * width];
+      const uint8_t *before = &previous[y * width];
+      for (int x = 0; x < width; x++) {
+        if (now[x] != before[x]) {
+          left = min(left, x);
+          right = max(right, x);
+          top = min(top, y);
+          bottom = y;
+        }
+      }
+    }
+    // Nothing changed: a single transparent pixel carries the delay
+    if (right < 0) {
+      left = top = right = bottom = 0;
+    }
+  }
+
+  // Unchanged pixels inside the box become transparent, which compresses better
+  uint8_t *out = frame.data();
+  for (int y = top; y <= bottom; y++) {
+    for (int x = left; x <= right; x++) {
+      size_t i = y * width + x;
+      *out++ = !first && current[i] == previous[i] ? TRANSPARENT_INDEX : current[i];
+    }
+  }
+
+  encoder.addFrame(left, top, right - left + 1, bottom - top + 1, frame.data(),
+                   (delayMs + 5) / 10, first ? -1 : TRANSPARENT_INDEX);
+  previous.swap(current);
+  stats.frames++;
+  stats.durationMs += delayMs;
+}
+
+/**
+ * @brief AnimatedGIF open callback returning the reader opened by transcode()
+ */
+void *GIFTranscoder::openFile(const char *fname, int32_t *pSize) {
+  (void)fname;
+  GIFReadAhead *file = openingFile;
+  if (!file || !file->isOpen()) {
+    return nullptr;
+  }
+  *pSize = file->size();
+  return file;
+}
+
+void GIFTranscoder::closeFile(void *pHandle) {
+  // The reader belongs to transcode() and closes when it goes out of scope
+  (void)pHandle;
+}
+
+/**
+ * @brief AnimatedGIF read callback served from the read-ahead window
+ */
+int32_t GIFTranscoder::readFile(GIFFILE *pFile, uint8_t *pBuf, int32_t iLen) {
+  GIFReadAhead *file = static_cast<GIFReadAhead *>(pFile->fHandle);
+  int32_t bytesRead = file->read(pBuf, iLen);
+  pFile->iPos = file->position();
+  return bytesRead;
+}
+
+/**
+ * @brief AnimatedGIF seek callback; the reader defers the filesystem seek
+ */
+int32_t GIFTranscoder::seekFile(GIFFILE *pFile, int32_t iPosition) {
+  GIFReadAhead *file = static_cast<GIFReadAhead *>(pFile->fHandle);
+  pFile->iPos = file->seek(iPosition);
+  return pFile->iPos;
+}
+
+/**
+ * @brief AnimatedGIF draw callback composing lines into the canvas
+ *
+ * Mirrors AnimatedGIFPanel::GIFDraw: the first line of a frame disposes of
+ * the previous one, so the output matches what playback shows.
+ *
+ * @param pDraw Line being drawn; pUser is the transcoder
+ */
+void GIFTranscoder::drawLine(GIFDRAW *pDraw) {
+  GIFTranscoder *self = static_cast<GIFTranscoder *>(pDraw->pUser);
+  GIFCompositor &compositor = self->compositor;
+  GIFScaler &scaler = self->scaler;
+
+  if (pDraw->y == 0) {
+    int16_t x = pDraw->iX, y = pDraw->iY, width = pDraw->iWidth, height = pDraw->iHeight;
+    if (scaler.isActive()) {
+      scaler.mapRect(pDraw->iX, pDraw->iY, pDraw->iWidth, pDraw->iHeight, x, y, width, height);
+    }
+    compositor.beginFrame(x, y, width, height, pDraw->ucDisposalMethod);
+  }
+
+  int16_t transparent = pDraw->ucHasTransparency ? pDraw->ucTransparent : -1;
+  int y = pDraw->iY + pDraw->y;
+
+  if (scaler.isActive()) {
+    scaler.scaleLine(pDraw->pPixels, pDraw->pPalette, transparent, pDraw->iX, y,
+                     pDraw->iWidth, pDraw->y == pDraw->iHeight - 1, drawScaledLine, self);
+    return;
+  }
+  compositor.drawIndexedLine(pDraw->iX, y, pDraw->pPixels, pDraw->pPalette, pDraw->iWidth,
+                             transparent);
+}
+
+/**
+ * @brief Scaler sink composing output rows into the canvas
+ */
+void GIFTranscoder::drawScaledLine(int16_t x, int16_t y, const uint16_t *colors,
+                                   const uint8_t *opaque, int16_t length, void *user) {
+  static_cast<GIFTranscoder *>(user)->compositor.drawLine(x, y, colors, opaque, length);
+}
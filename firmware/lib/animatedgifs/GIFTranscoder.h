@@ -0,0 +1,153 @@
+#ifndef GIF_TRANSCODER_H
+#define GIF_TRANSCODER_H
+
+/**
+ * @file GIFTranscoder.h
+ * @brief Re-encodes uploaded GIFs at panel resolution
+ *
+ * Every frame is decoded, scaled to the target with GIFScaler and composed
+ * with GIFCompositor, so disposal is handled exactly as during playback,
+ * then quantized to a fixed 6x7x6 color cube and written back out with
+ * GIFEncoder. Only the bounding box of pixels that changed since the
+ * previous frame is encoded, with unchanged pixels inside it transparent,
+ * so the stored GIF is small and cheap to decode on every play.
+ */
+
+#include <Arduino.h>
+#include <AnimatedGIF.h>
+#include <FS.h>
+#include <vector>
+
+#include "GIFCompositor.h"
+#include "GIFEncoder.h"
+#include "GIFReadAhead.h"
+#include "GIFScaler.h"
+
+/**
+ * @struct TranscodeStats
+ * @brief Result of the last transcode
+ */
+struct TranscodeStats {
+    uint16_t sourceWidth = 0;       //< Logical screen of the input
+    uint16_t sourceHeight = 0;
+    uint16_t width = 0;             //< Logical screen of the output
+    uint16_t height = 0;
+    uint32_t frames = 0;            //< Frames written
+    uint32_t durationMs = 0;        //< Sum of frame delays
+    size_t inputBytes = 0;          //< Size of the input GIF
+    size_t outputBytes = 0;         //< Size of the output GIF
+    uint32_t elapsedUs = 0;         //< Time spent transcoding
+    uint32_t minFreeHeap = 0;       //< Lowest free heap seen between frames
+};
+
+/**
+ * @class GIFTranscoder
+ * @brief Decode, resample, quantize and re-encode a GIF from memory or a file
+ */
+class GIFTranscoder {
+public:
+    GIFTranscoder();
+
+    /**
+     * @brief Choose the resampling filter for GIFs larger than the target
+     * @param mode NEAREST or BOX; CROP keeps the top-left corner
+     */
+    void setScaleMode(ScaleMode mode) { scaler.setMode(mode); }
+
+    /**
+     * @brief Transcode a whole GIF
+     *
+     * GIFs larger than the target are scaled to fit and centered on a
+     * target-sized screen; smaller ones keep their size.
+     *
+     * @param data Input GIF
+     * @param size Size of the input in bytes
+     * @param output Receives the encoded GIF (replaced)
+     * @param targetWidth Largest output width
+     * @param targetHeight Largest output height
+     * @return true if every frame was decoded and written
+     */
+    bool transcode(const uint8_t *data, size_t size, std::vector<uint8_t> &output,
+                   int16_t targetWidth, int16_t targetHeight);
+
+    /**
+     * @brief Transcode a GIF file into another file
+     *
+     * The input is read through a read-ahead window and each encoded frame
+     * is written out as soon as it is complete, so neither file is held in
+     * memory.
+     *
+     * @param fs Filesystem holding the input
+     * @param inputPath Input GIF
+     * @param output Open file receiving the encoded GIF
+     * @param targetWidth Largest output width
+     * @param targetHeight Largest output height
+     * @return true if every frame was decoded and written
+     */
+    bool transcode(fs::FS &fs, const char *inputPath, File &output,
+                   int16_t targetWidth, int16_t targetHeight);
+
+    const TranscodeStats &getStats() const { return stats; }
+
+    /**
+     * @brief Palette index of an RGB565 color in the 6x7x6 cube
+     * @param color RGB565 color
+     * @return Index into the cube (0-251)
+     */
+    uint8_t quantize(uint16_t color) const {
+        return redIndex[color >> 11] + greenIndex[(color >> 5) & 0x3F] + blueIndex[color & 0x1F];
+    }
+
+private:
+    static void *openFile(const char *fname, int32_t *pSize);
+    static void closeFile(void *pHandle);
+    static int32_t readFile(GIFFILE *pFile, uint8_t *pBuf, int32_t iLen);
+    static int32_t seekFile(GIFFILE *pFile, int32_t iPosition);
+    static void drawLine(GIFDRAW *pDraw);
+    static void drawScaledLine(int16_t x, int16_t y, const uint16_t *colors,
+                               const uint8_t *opaque, int16_t length, void *user);
+
+    /**
+     * @brief Allocate a decoder, from PSRAM when present
+     */
+    AnimatedGIF *createDecoder();
+    void destroyDecoder(AnimatedGIF *gif);
+
+    /**
+     * @brief Decode every frame of an opened GIF and encode it
+     * @param gif Opened decoder
+     * @param output Encoded bytes; emptied into sink after each frame if given
+     * @param sink File receiving the output, or nullptr to keep it in output
+     */
+    bool encodeFrames(AnimatedGIF *gif, std::vector<uint8_t> &output, File *sink,
+                      int16_t targetWidth, int16_t targetHeight);
+
+    /**
+     * @brief Move encoded bytes to the sink, if there is one
+     * @return false if the sink did not take every byte
+     */
+    bool drain(std::vector<uint8_t> &output, File *sink);
+
+    void logResult(uint32_t startUs);
+
+    /**
+     * @brief Encode the changed part of the composed canvas as one frame
+     */
+    void writeFrame(GIFEncoder &encoder, int delayMs, bool first);
+
+    GIFScaler scaler;                     //< Maps source lines to the output
+    uint8_t redIndex[32];                 //< Cube offset of each 5-bit red
+    uint8_t greenIndex[64];               //< Cube offset of each 6-bit green
+    uint8_t blueIndex[32];                //< Cube offset of each 5-bit blue
+    uint8_t palette[256 * 3];             //< Output palette, cube then black
+
+    int16_t width = 0;                    //< Output width
+    int16_t height = 0;                   //< Output height
+    GIFCompositor compositor;             //< Composed RGB565 frame
+    std::vector<uint8_t> current;         //< Quantized canvas
+    std::vector<uint8_t> previous;        //< Quantized canvas of the last frame written
+    std::vector<uint8_t> frame;           //< Indices of the frame being encoded
+    TranscodeStats stats;                 //< Result of the last transcode
+};
+
+#endif // GIF_TRANSCODER_H
@@ -0,0 +1,81 @@
+#include "GIFUploadSessions.h"
+#include "Logger.h"
+
+UploadSession *GIFUploadSessions::open(const void *owner) {
+  // A request restarting its upload reuses its slot
+  UploadSession *session = find(owner);
+  if (session) {
+    release(*session);
+  }
+
+  for (UploadSession &candidate : sessions) {
+    if (!candidate.owner) {
+      candidate.owner = owner;
+      candidate.lastActivityMs = millis();
+      return &candidate;
+    }
+  }
+  return nullptr;
+}
+
+UploadSession *GIFUploadSessions::find(const void *owner) {
+  if (!owner) {
+    return nullptr;
+  }
+  for (UploadSession &session : sessions) {
+    if (session.owner == owner) {
+      return &session;
+    }
+  }
+  return nullptr;
+}
+
+bool GIFUploadSessions::isWriting(const String &path) const {
+  for (const UploadSession &session : sessions) {
+    if (session.owner && session.writer.isActive() && session.writer.getPath() == path) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void GIFUploadSessions::close(const void *owner) {
+  UploadSession *session = find(owner);
+  if (session) {
+    release(*session);
+  }
+}
+
+size_t GIFUploadSessions::expire(uint32_t timeoutMs) {
+  uint32_t now = millis();
+  size_t dropped = 0;
+  for (UploadSession &session : sessions) {
+    if (session.owner && now - session.lastActivityMs > timeoutMs) {
+      LOG_WARNING("GIFUploadSessions: Dropping upload to %s idle for %u ms",
+                  session.writer.getPath().c_str(), (unsigned)(now - session.lastActivityMs));
+      release(session);
+      dropped++;
+    }
+  }
+  return dropped;
+}
+
+size_t GIFUploadSessions::activeCount() const {
+  size_t count = 0;
+  for (const UploadSession &session : sessions) {
+    if (session.owner) {
+      count++;
+    }
+  }
+  return count;
+}
+
+void GIFUploadSessions::release(UploadSession &session) {
+  session.writer.abort();
+  session.owner = nullptr;
+  session.category = String();
+  session.rejected = false;
+  session.finished = false;
+  session.status = 0;
+  session.error = nullptr;
+}
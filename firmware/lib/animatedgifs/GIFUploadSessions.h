@@ -0,0 +1,102 @@
+#ifndef GIF_UPLOAD_SESSIONS_H
+#define GIF_UPLOAD_SESSIONS_H
+
+/**
+ * @file GIFUploadSessions.h
+ * @brief Fixed table of uploads in progress, one per request
+ *
+ * Every upload gets its own writer, keyed by the request that carries it,
+ * so several browsers can upload at once. The table has a fixed number of
+ * slots; a full table turns new uploads away instead of growing. Uploads
+ * whose client went quiet are aborted after a timeout, which also removes
+ * their part files.
+ *
+ * Chunks arrive on the network task while sessions may be expired or
+ * closed from elsewhere, so every call must be made with lock() held.
+ */
+
+#include <Arduino.h>
+#include <mutex>
+
+#include "GIFUploadWriter.h"
+#include "constants.h"
+
+/**
+ * @struct UploadSession
+ * @brief One upload in progress
+ */
+struct UploadSession {
+    const void *owner = nullptr;    //< Request the upload belongs to, nullptr if the slot is free
+    GIFUploadWriter writer;         //< Part file and validator
+    String category;                //< Category the GIF is stored in
+    uint32_t lastActivityMs = 0;    //< millis() of the last chunk
+    bool rejected = false;          //< Upload failed; remaining chunks are ignored
+    bool finished = false;          //< GIF stored
+    uint16_t status = 0;            //< HTTP status for a failure found before the writer started
+    const char *error = nullptr;    //< Reason for that failure
+};
+
+/**
+ * @class GIFUploadSessions
+ * @brief Bounded, lock-protected table of upload sessions
+ */
+class GIFUploadSessions {
+public:
+    GIFUploadSessions() = default;
+
+    GIFUploadSessions(const GIFUploadSessions&) = delete;
+    GIFUploadSessions& operator=(const GIFUploadSessions&) = delete;
+
+    /**
+     * @brief Take the table lock
+     * @return Lock held until it goes out of scope
+     */
+    std::unique_lock<std::mutex> lock() { return std::unique_lock<std::mutex>(mutex); }
+
+    /**
+     * @brief Claim a slot for a request
+     * @param owner Request starting an upload
+     * @return The new session, or nullptr if every slot is busy
+     */
+    UploadSession *open(const void *owner);
+
+    /**
+     * @brief Find the session of a request
+     * @param owner Request
+     * @return The session, or nullptr if the request has none
+     */
+    UploadSession *find(const void *owner);
+
+    /**
+     * @brief Check whether another session is writing a path
+     * @param path Final path of a GIF
+     * @return true if an unfinished upload targets the path
+     */
+    bool isWriting(const String &path) const;
+
+    /**
+     * @brief Free the slot of a request, aborting an unfinished upload
+     * @param owner Request
+     */
+    void close(const void *owner);
+
+    /**
+     * @brief Abort and free sessions idle for longer than the timeout
+     * @param timeoutMs Idle time allowed since the last chunk
+     * @return Number of sessions dropped
+     */
+    size_t expire(uint32_t timeoutMs = UPLOAD_SESSION_TIMEOUT_MS);
+
+    /**
+     * @brief Number of slots in use
+     */
+    size_t activeCount() const;
+
+private:
+    void release(UploadSession &session);
+
+    std::mutex mutex;                                //< Guards every slot
+    UploadSession sessions[MAX_UPLOAD_SESSIONS];     //< Fixed slots
+};
+
+#endif // GIF_UPLOAD_SESSIONS_H
@@ -0,0 +1,170 @@
+#include "GIFUploadWriter.h"
+#include "GIFTranscoder.h"
+#include "Logger.h"
+#include "constants.h"
+
+namespace {
+
+/** @brief Suffix of the file an upload is received into */
+const char *PART_SUFFIX = ".part";
+
+/** @brief Suffix of the transcoded copy of an oversized upload */
+const char *SCALED_SUFFIX = ".scaled";
+
+} // namespace
+
+bool GIFUploadWriter::begin(fs::FS &fs, const String &path, int16_t targetWidth,
+                            int16_t targetHeight) {
+  abort();
+
+  this->fs = &fs;
+  this->path = path;
+  this->targetWidth = targetWidth;
+  this->targetHeight = targetHeight;
+  partPath = path + PART_SUFFIX;
+  scaledPath = path + SCALED_SUFFIX;
+  validator.begin();
+  stats = UploadStats();
+  startMs = millis();
+  heapAtStart = heapFloor = ESP.getFreeHeap();
+
+  file = fs.open(partPath, FILE_WRITE);
+  if (!file) {
+    LOG_ERROR("GIFUploadWriter: Failed to create %s", partPath.c_str());
+    error = "Failed to create upload file";
+    storageError = true;
+    return false;
+  }
+  active = true;
+  return true;
+}
+
+bool GIFUploadWriter::write(const uint8_t *data, size_t length) {
+  if (!active) {
+    return false;
+  }
+  if (stats.bytes + length > MAX_UPLOAD_BYTES) {
+    return fail("File size exceeds 2MB limit", false);
+  }
+
+  // Parse before writing so a bad chunk never reaches the card
+  if (!validator.feed(data, length)) {
+    return fail(validator.getError(), false);
+  }
+  if (length > 0 && file.write(data, length) != length) {
+    return fail("Failed to write upload file", true);
+  }
+
+  stats.bytes += length;
+  sampleHeap();
+  return true;
+}
+
+bool GIFUploadWriter::finish() {
+  if (!active) {
+    return false;
+  }
+  file.close();
+
+  if (!validator.finish()) {
+    return fail(validator.getError(), false);
+  }
+
+  const GIFInfo &info = validator.getInfo();
+  if (info.width <= targetWidth && info.height <= targetHeight) {
+    if (!replaceFinal(partPath)) {
+      return fail("Failed to store upload", true);
+    }
+  } else {
+    if (!transcodePart()) {
+      return fail("Failed to resize GIF", true);
+    }
+    fs->remove(partPath);
+    if (!replaceFinal(scaledPath)) {
+      return fail("Failed to store upload", true);
+    }
+    stats.transcoded = true;
+  }
+
+  active = false;
+  sampleHeap();
+  stats.elapsedMs = millis() - startMs;
+  stats.peakHeapBytes = heapAtStart > heapFloor ? heapAtStart - heapFloor : 0;
+
+  File stored = fs->open(path, FILE_READ);
+  if (stored) {
+    stats.storedBytes = stored.size();
+    stored.close();
+  }
+
+  LOG_INFO("GIFUploadWriter: Stored %s (%u bytes, %.1f KB/s, peak heap %u bytes%s)",
+           path.c_str(), (unsigned)stats.storedBytes, stats.kbPerSecond(),
+           (unsigned)stats.peakHeapBytes, stats.transcoded ? ", transcoded" : "");
+  return true;
+}
+
+void GIFUploadWriter::abort() {
+  // A writer reused for the next upload must not report this one's failure
+  storageError = false;
+  error = "";
+  if (!active) {
+    return;
+  }
+  active = false;
+  if (file) {
+    file.close();
+  }
+  if (fs->exists(partPath)) {
+    fs->remove(partPath);
+  }
+  if (fs->exists(scaledPath)) {
+    fs->remove(scaledPath);
+  }
+}
+
+bool GIFUploadWriter::fail(const char *reason, bool storage) {
+  LOG_WARNING("GIFUploadWriter: Rejected %s after %u bytes: %s", path.c_str(),
+              (unsigned)stats.bytes, reason);
+  abort();
+  error = reason;
+  storageError = storage;
+  return false;
+}
+
+bool GIFUploadWriter::transcodePart() {
+  File output = fs->open(scaledPath, FILE_WRITE);
+  if (!output) {
+    LOG_ERROR("GIFUploadWriter: Failed to create %s", scaledPath.c_str());
+    return false;
+  }
+
+  GIFTranscoder transcoder;
+  bool ok = transcoder.transcode(*fs, partPath.c_str(), output, targetWidth, targetHeight);
+  output.close();
+
+  uint32_t minFreeHeap = transcoder.getStats().minFreeHeap;
+  if (minFreeHeap && minFreeHeap < heapFloor) {
+    heapFloor = minFreeHeap;
+  }
+  return ok;
+}
+
+bool GIFUploadWriter::replaceFinal(const String &from) {
+  // FAT cannot rename over an existing file, so an older upload goes first
+  if (fs->exists(path) && !fs->remove(path)) {
+    LOG_ERROR("GIFUploadWriter: Failed to replace %s", path.c_str());
+    return false;
+  }
+  if (!fs->rename(from, path)) {
+    LOG_ERROR("GIFUploadWriter: Failed to rename %s to %s", from.c_str(), path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void GIFUploadWriter::sampleHeap() {
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < heapFloor) {
+    heapFloor = freeHeap;
+  }
+}
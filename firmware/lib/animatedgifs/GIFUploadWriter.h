@@ -0,0 +1,125 @@
+#ifndef GIF_UPLOAD_WRITER_H
+#define GIF_UPLOAD_WRITER_H
+
+/**
+ * @file GIFUploadWriter.h
+ * @brief Streams an uploaded GIF straight to its final location
+ *
+ * Each chunk is validated and appended to "<path>.part" next to the final
+ * file, so the upload is written once and never held in memory. On success
+ * the part file is renamed over the final path; GIFs larger than the panel
+ * are first transcoded from the part file into a second temporary file,
+ * frame by frame. A failed or abandoned upload only ever leaves temporary
+ * files behind, which are removed.
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include "GIFValidator.h"
+
+/**
+ * @struct UploadStats
+ * @brief Cost of one upload
+ */
+struct UploadStats {
+    size_t bytes = 0;               //< Bytes received
+    size_t storedBytes = 0;         //< Size of the file stored
+    uint32_t elapsedMs = 0;         //< First chunk to stored file
+    uint32_t peakHeapBytes = 0;     //< Largest drop in free heap while uploading
+    bool transcoded = false;        //< Stored file was re-encoded at panel resolution
+
+    /**
+     * @brief Upload throughput
+     * @return KB received per second, first chunk to stored file
+     */
+    float kbPerSecond() const { return elapsedMs ? bytes * 1000.0f / 1024.0f / elapsedMs : 0.0f; }
+};
+
+/**
+ * @class GIFUploadWriter
+ * @brief Validating, chunked writer for one upload
+ */
+class GIFUploadWriter {
+public:
+    GIFUploadWriter() = default;
+    ~GIFUploadWriter() { abort(); }
+
+    // The open part file makes copies unsafe
+    GIFUploadWriter(const GIFUploadWriter&) = delete;
+    GIFUploadWriter& operator=(const GIFUploadWriter&) = delete;
+
+    /**
+     * @brief Start an upload
+     * @param fs Filesystem to store the GIF on
+     * @param path Final path of the GIF; its directory must exist
+     * @param targetWidth Largest width stored as uploaded
+     * @param targetHeight Largest height stored as uploaded
+     * @return false if the part file could not be created
+     */
+    bool begin(fs::FS &fs, const String &path, int16_t targetWidth, int16_t targetHeight);
+
+    /**
+     * @brief Validate a chunk and append it to the part file
+     * @param data Chunk bytes
+     * @param length Chunk size
+     * @return false if the upload was rejected; it is aborted
+     */
+    bool write(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Complete the upload and move it into place
+     * @return false if the file is incomplete or could not be stored; it is aborted
+     */
+    bool finish();
+
+    /**
+     * @brief Drop the upload, remove its temporary files and clear the last error
+     */
+    void abort();
+
+    bool isActive() const { return active; }
+
+    /**
+     * @brief Whether the last failure came from storage rather than the file
+     */
+    bool isStorageError() const { return storageError; }
+
+    const char *getError() const { return error; }
+    const GIFInfo &getInfo() const { return validator.getInfo(); }
+    const UploadStats &getStats() const { return stats; }
+    const String &getPath() const { return path; }
+
+private:
+    bool fail(const char *reason, bool storage);
+
+    /**
+     * @brief Store a transcoded copy of the part file in the scaled file
+     */
+    bool transcodePart();
+
+    /**
+     * @brief Rename a temporary file over the final path
+     */
+    bool replaceFinal(const String &from);
+
+    void sampleHeap();
+
+    fs::FS *fs = nullptr;             //< Filesystem being written
+    String path;                      //< Final path
+    String partPath;                  //< Upload being received
+    String scaledPath;                //< Transcoded upload
+    File file;                        //< Open part file
+    GIFValidator validator;           //< Parser fed with every chunk
+    int16_t targetWidth = 0;
+    int16_t targetHeight = 0;
+    bool active = false;              //< Upload started and not yet finished or aborted
+    bool storageError = false;
+    const char *error = "";
+    UploadStats stats;
+    uint32_t startMs = 0;             //< millis() at begin()
+    uint32_t heapAtStart = 0;         //< Free heap at begin()
+    uint32_t heapFloor = 0;           //< Lowest free heap sampled since begin()
+};
+
+#endif // GIF_UPLOAD_WRITER_H
@@ -0,0 +1,242 @@
+#include "GIFValidator.h"
+
+namespace {
+
+/** @brief Signature and logical screen descriptor */
+const uint8_t HEADER_SIZE = 13;
+
+/** @brief Image descriptor after the 0x2C introducer */
+const uint8_t IMAGE_DESCRIPTOR_SIZE = 9;
+
+const uint8_t EXTENSION_INTRODUCER = 0x21;
+const uint8_t IMAGE_SEPARATOR = 0x2C;
+const uint8_t TRAILER = 0x3B;
+const uint8_t GRAPHIC_CONTROL_LABEL = 0xF9;
+
+/**
+ * @brief Size in bytes of a color table from a packed field
+ */
+inline uint32_t colorTableBytes(uint8_t packed) {
+  return 3u << ((packed & 0x07) + 1);
+}
+
+} // namespace
+
+void GIFValidator::begin(uint16_t maxDimension) {
+  this->maxDimension = maxDimension;
+  state = State::HEADER;
+  afterSkip = State::BLOCK;
+  info = GIFInfo();
+  error = "";
+  buffered = 0;
+  remaining = 0;
+  inGraphicControl = false;
+  gceOffset = 0;
+  pendingDelayCs = 0;
+}
+
+bool GIFValidator::feed(const uint8_t *data, size_t length) {
+  size_t i = 0;
+  while (i < length) {
+    switch (state) {
+      case State::HEADER: {
+        buffer[buffered++] = data[i++];
+        // Check the signature as soon as it is in, so junk fails on byte 6
+        if (buffered == 6 &&
+            (memcmp(buffer, "GIF", 3) != 0 ||
+             (memcmp(buffer + 3, "87a", 3) != 0 && memcmp(buffer + 3, "89a", 3) != 0))) {
+          return fail("Not a GIF87a or GIF89a file");
+        }
+        if (buffered == HEADER_SIZE) {
+          parseHeader();
+        }
+        break;
+      }
+
+      case State::GLOBAL_TABLE:
+      case State::LOCAL_TABLE: {
+        size_t take = min((size_t)remaining, length - i);
+        i += take;
+        remaining -= take;
+        if (remaining == 0) {
+          state = afterSkip;
+        }
+        break;
+      }
+
+      case State::BLOCK: {
+        uint8_t introducer = data[i++];
+        if (introducer == EXTENSION_INTRODUCER) {
+          state = State::EXTENSION_LABEL;
+        } else if (introducer == IMAGE_SEPARATOR) {
+          buffered = 0;
+          state = State::IMAGE_DESCRIPTOR;
+        } else if (introducer == TRAILER) {
+          info.bytes += i;
+          state = State::DONE;
+          return true;
+        } else {
+          return fail("Unknown block type");
+        }
+        break;
+      }
+
+      case State::EXTENSION_LABEL: {
+        inGraphicControl = data[i++] == GRAPHIC_CONTROL_LABEL;
+        gceOffset = 0;
+        state = State::SUB_BLOCK_SIZE;
+        break;
+      }
+
+      case State::SUB_BLOCK_SIZE: {
+        remaining = data[i++];
+        if (remaining == 0) {
+          if (inGraphicControl && gceOffset < 4) {
+            return fail("Truncated graphic control extension");
+          }
+          inGraphicControl = false;
+          state = State::BLOCK;
+        } else {
+          state = State::SUB_BLOCK_DATA;
+        }
+        break;
+      }
+
+      case State::SUB_BLOCK_DATA: {
+        size_t take = min((size_t)remaining, length - i);
+        if (inGraphicControl) {
+          // Packed fields, delay (2 bytes), transparent index
+          for (size_t k = 0; k < take && gceOffset < 4; k++, gceOffset++) {
+            if (gceOffset == 1) {
+              pendingDelayCs = data[i + k];
+            } else if (gceOffset == 2) {
+              pendingDelayCs |= data[i + k] << 8;
+            }
+          }
+        }
+        i += take;
+        remaining -= take;
+        if (remaining == 0) {
+          state = State::SUB_BLOCK_SIZE;
+        }
+        break;
+      }
+
+      case State::IMAGE_DESCRIPTOR: {
+        buffer[buffered++] = data[i++];
+        if (buffered == IMAGE_DESCRIPTOR_SIZE) {
+          parseImageDescriptor();
+        }
+        break;
+      }
+
+      case State::CODE_SIZE: {
+        uint8_t codeSize = data[i++];
+        if (codeSize < 2 || codeSize > 8) {
+          return fail("Invalid LZW code size");
+        }
+        info.maxCodeSize = max(info.maxCodeSize, codeSize);
+        inGraphicControl = false;
+        state = State::SUB_BLOCK_SIZE;
+        break;
+      }
+
+      case State::DONE:
+        // Anything after the trailer is ignored
+        return true;
+
+      case State::FAILED:
+        return false;
+    }
+
+    if (state == State::FAILED) {
+      return false;
+    }
+  }
+
+  info.bytes += length;
+  return true;
+}
+
+bool GIFValidator::finish() {
+  if (state == State::DONE) {
+    return true;
+  }
+  // A missing trailer is common and harmless once the last image is complete
+  if (state == State::BLOCK && info.frames > 0) {
+    state = State::DONE;
+    return true;
+  }
+  if (state != State::FAILED) {
+    fail(info.frames == 0 ? "No image data" : "Truncated GIF");
+  }
+  return false;
+}
+
+bool GIFValidator::validate(const uint8_t *data, size_t size, GIFInfo &info,
+                            const char **error) {
+  GIFValidator validator;
+  bool ok = validator.feed(data, size) && validator.finish();
+  info = validator.getInfo();
+  if (error) {
+    *error = validator.getError();
+  }
+  return ok;
+}
+
+void GIFValidator::parseHeader() {
+  info.width = buffer[6] | (buffer[7] << 8);
+  info.height = buffer[8] | (buffer[9] << 8);
+  uint8_t packed = buffer[10];
+
+  if (info.width == 0 || info.height == 0) {
+    fail("Empty logical screen");
+    return;
+  }
+  if (info.width > maxDimension || info.height > maxDimension) {
+    fail("Logical screen too large");
+    return;
+  }
+
+  info.hasGlobalPalette = packed & 0x80;
+  if (info.hasGlobalPalette) {
+    remaining = colorTableBytes(packed);
+    afterSkip = State::BLOCK;
+    state = State::GLOBAL_TABLE;
+  } else {
+    state = State::BLOCK;
+  }
+}
+
+void GIFValidator::parseImageDescriptor() {
+  uint16_t width = buffer[4] | (buffer[5] << 8);
+  uint16_t height = buffer[6] | (buffer[7] << 8);
+  uint8_t packed = buffer[8];
+
+  if (width == 0 || height == 0) {
+    fail("Empty image");
+    return;
+  }
+  if (!info.hasGlobalPalette && !(packed & 0x80)) {
+    fail("Image without a color table");
+    return;
+  }
+
+  info.frames++;
+  info.durationMs += pendingDelayCs * 10;
+  pendingDelayCs = 0;
+
+  if (packed & 0x80) {
+    remaining = colorTableBytes(packed);
+    afterSkip = State::CODE_SIZE;
+    state = State::LOCAL_TABLE;
+  } else {
+    state = State::CODE_SIZE;
+  }
+}
+
+bool GIFValidator::fail(const char *reason) {
+  state = State::FAILED;
+  error = reason;
+  return false;
+}
@@ -0,0 +1,119 @@
+#ifndef GIF_VALIDATOR_H
+#define GIF_VALIDATOR_H
+
+/**
+ * @file GIFValidator.h
+ * @brief Incremental GIF structure parser for uploads
+ *
+ * Walks the GIF block structure - header, logical screen descriptor, color
+ * tables, extensions, image descriptors and image data sub-blocks - as bytes
+ * arrive, without buffering the file. Pixel data is skipped, not decoded, so
+ * a chunk costs a few comparisons per block and a malformed upload is
+ * rejected as soon as the offending byte is seen.
+ */
+
+#include <Arduino.h>
+
+#include "constants.h"
+
+/**
+ * @struct GIFInfo
+ * @brief What the validator learned about a GIF
+ */
+struct GIFInfo {
+    uint16_t width = 0;             //< Logical screen width
+    uint16_t height = 0;            //< Logical screen height
+    uint32_t frames = 0;            //< Image descriptors seen
+    uint32_t durationMs = 0;        //< Sum of graphic control extension delays
+    uint8_t maxCodeSize = 0;        //< Largest LZW minimum code size
+    bool hasGlobalPalette = false;  //< Logical screen has a global color table
+    size_t bytes = 0;               //< Bytes consumed up to and including the trailer
+};
+
+/**
+ * @class GIFValidator
+ * @brief Byte-driven GIF parser fed chunk by chunk
+ */
+class GIFValidator {
+public:
+    GIFValidator() { begin(); }
+
+    /**
+     * @brief Start a new file
+     * @param maxDimension Largest logical screen width or height accepted
+     */
+    void begin(uint16_t maxDimension = MAX_GIF_DIMENSION);
+
+    /**
+     * @brief Parse the next chunk of the file
+     * @param data Chunk bytes
+     * @param length Chunk size
+     * @return false once the file is known to be invalid
+     */
+    bool feed(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Check the file ended where a GIF may end
+     * @return true if the trailer, or the end of a complete image, was reached
+     */
+    bool finish();
+
+    bool isComplete() const { return state == State::DONE; }
+    bool hasFailed() const { return state == State::FAILED; }
+
+    /**
+     * @brief Reason the file was rejected
+     * @return Static message, empty while the file is valid
+     */
+    const char *getError() const { return error; }
+
+    const GIFInfo &getInfo() const { return info; }
+
+    /**
+     * @brief Validate a GIF held in memory
+     * @param data GIF data
+     * @param size Size of data
+     * @param info Receives the parsed info
+     * @param error Receives the reason on failure (optional)
+     * @return true if the whole file is well formed
+     */
+    static bool validate(const uint8_t *data, size_t size, GIFInfo &info,
+                         const char **error = nullptr);
+
+private:
+    enum class State : uint8_t {
+        HEADER,             //< Signature and logical screen descriptor
+        GLOBAL_TABLE,       //< Skipping the global color table
+        BLOCK,              //< Expecting an introducer
+        EXTENSION_LABEL,    //< Label byte after 0x21
+        SUB_BLOCK_SIZE,     //< Length of the next sub-block, 0 ends the list
+        SUB_BLOCK_DATA,     //< Inside a sub-block
+        IMAGE_DESCRIPTOR,   //< Nine bytes after 0x2C
+        LOCAL_TABLE,        //< Skipping a local color table
+        CODE_SIZE,          //< LZW minimum code size
+        DONE,               //< Trailer seen
+        FAILED
+    };
+
+    /**
+     * @brief Act on a fully collected header or image descriptor
+     */
+    void parseHeader();
+    void parseImageDescriptor();
+
+    bool fail(const char *reason);
+
+    State state = State::HEADER;
+    State afterSkip = State::BLOCK;  //< State entered once a color table is skipped
+    GIFInfo info;
+    const char *error = "";
+    uint16_t maxDimension = 0;
+    uint8_t buffer[13];              //< Fixed-size structure being collected
+    uint8_t buffered = 0;            //< Bytes in buffer
+    uint32_t remaining = 0;          //< Bytes left to skip in the current table or sub-block
+    bool inGraphicControl = false;   //< Sub-blocks belong to a graphic control extension
+    uint8_t gceOffset = 0;           //< Bytes of graphic control data seen, up to 4
+    uint16_t pendingDelayCs = 0;     //< Delay for the next image
+};
+
+#endif // GIF_VALIDATOR_H
@@ -0,0 +1,193 @@
+#ifndef RECORD_IO_H
+#define RECORD_IO_H
+
+/**
+ * @file RecordIO.h
+ * @brief Little-endian record files with a trailing FNV-1a checksum
+ *
+ * Shared by the binary files kept beside the GIFs (the category index and
+ * the playlist state). A file is written through RecordWriter to a
+ * temporary path and moved over the old one with replaceRecordFile(), and
+ * read back in one call and walked with RecordReader.
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <string.h>
+
+/** @brief FNV-1a starting value */
+const uint32_t RECORD_FNV_OFFSET = 2166136261u;
+
+/** @brief Trailing checksum */
+const size_t RECORD_CHECKSUM_BYTES = 4;
+
+/**
+ * @brief Extend an FNV-1a hash
+ * @param hash Hash so far, RECORD_FNV_OFFSET to start
+ * @param data Bytes to add
+ * @param length Number of bytes
+ * @return Updated hash
+ */
+inline uint32_t recordChecksum(uint32_t hash, const uint8_t *data, size_t length) {
+    const uint32_t prime = 16777619u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * prime;
+    }
+    return hash;
+}
+
+/**
+ * @class RecordWriter
+ * @brief Buffered little-endian writer that checksums what it writes
+ */
+class RecordWriter {
+public:
+    explicit RecordWriter(File &file) : file(file) {}
+
+    void put(const uint8_t *data, size_t length) {
+        checksum = recordChecksum(checksum, data, length);
+        while (length > 0) {
+            size_t take = min(length, sizeof(buffer) - used);
+            memcpy(buffer + used, data, take);
+            used += take;
+            data += take;
+            length -= take;
+            if (used == sizeof(buffer)) {
+                flush();
+            }
+        }
+    }
+
+    void put8(uint8_t value) { put(&value, 1); }
+
+    void put16(uint16_t value) {
+        uint8_t bytes[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+        put(bytes, sizeof(bytes));
+    }
+
+    void put32(uint32_t value) {
+        uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16),
+                            (uint8_t)(value >> 24)};
+        put(bytes, sizeof(bytes));
+    }
+
+    void putName(const char *name) {
+        // FAT long names are at most 255 characters
+        size_t length = min(strlen(name), (size_t)UINT8_MAX);
+        put8(length);
+        put((const uint8_t *)name, length);
+    }
+
+    /**
+     * @brief Append the checksum and write out the buffer
+     * @return false if any write came up short
+     */
+    bool finish() {
+        put32(checksum);
+        flush();
+        return ok;
+    }
+
+private:
+    void flush() {
+        if (used > 0 && file.write(buffer, used) != used) {
+            ok = false;
+        }
+        used = 0;
+    }
+
+    File &file;
+    uint8_t buffer[512];
+    size_t used = 0;
+    uint32_t checksum = RECORD_FNV_OFFSET;
+    bool ok = true;
+};
+
+/**
+ * @class RecordReader
+ * @brief Bounds-checked little-endian reader over a loaded file
+ */
+class RecordReader {
+public:
+    RecordReader(const uint8_t *data, size_t size) : data(data), end(data + size) {}
+
+    uint8_t get8() { return take(1) ? data[-1] : 0; }
+
+    uint16_t get16() { return take(2) ? data[-2] | (data[-1] << 8) : 0; }
+
+    uint32_t get32() {
+        return take(4) ? data[-4] | (data[-3] << 8) | (data[-2] << 16) | ((uint32_t)data[-1] << 24)
+                       : 0;
+    }
+
+    /**
+     * @brief Read a name into a NUL-terminated buffer
+     */
+    const char *getName(char (&name)[UINT8_MAX + 1]) {
+        uint8_t length = get8();
+        if (!take(length)) {
+            length = 0;
+        }
+        memcpy(name, data - length, length);
+        name[length] = '\0';
+        return name;
+    }
+
+    bool isValid() const { return valid; }
+    bool atEnd() const { return data == end; }
+    size_t remaining() const { return end - data; }
+
+private:
+    bool take(size_t length) {
+        if (!valid || (size_t)(end - data) < length) {
+            valid = false;
+            return false;
+        }
+        data += length;
+        return true;
+    }
+
+    const uint8_t *data;
+    const uint8_t *end;
+    bool valid = true;
+};
+
+/**
+ * @brief Check the magic and trailing checksum of a loaded record file
+ * @param data File contents
+ * @param size File size
+ * @param magic Four magic bytes the file starts with
+ * @return true if the file is intact
+ */
+inline bool verifyRecordFile(const uint8_t *data, size_t size, const uint8_t (&magic)[4]) {
+    if (size < sizeof(magic) + RECORD_CHECKSUM_BYTES || memcmp(data, magic, sizeof(magic)) != 0) {
+        return false;
+    }
+    size_t payload = size - RECORD_CHECKSUM_BYTES;
+    RecordReader trailer(data + payload, RECORD_CHECKSUM_BYTES);
+    return trailer.get32() == recordChecksum(RECORD_FNV_OFFSET, data, payload);
+}
+
+/**
+ * @brief Move a finished temporary file over a record file
+ * @param fs Filesystem holding both files
+ * @param tempPath Temporary file, removed on failure
+ * @param path File to replace
+ * @return false if the file could not be replaced
+ */
+inline bool replaceRecordFile(fs::FS &fs, const String &tempPath, const char *path) {
+    bool ok = true;
+    // FAT cannot rename over an existing file
+    if (fs.exists(path)) {
+        ok = fs.remove(path);
+    }
+    if (ok) {
+        ok = fs.rename(tempPath, String(path));
+    }
+    if (!ok) {
+        fs.remove(tempPath);
+    }
+    return ok;
+}
+
+#endif // RECORD_IO_H
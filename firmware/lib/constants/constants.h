@@ -19,6 +19,18 @@
 /** @brief Path for default GIF file */
 #define GIF_DEFAULT_PATH (GIFS_BASE_PATH "/current.gif")
 
+/** @brief Binary index of the GIF categories on the SD card */
+#define GIF_INDEX_PATH (GIFS_BASE_PATH "/.index.bin")
+
+/** @brief Saved playlist decks on the SD card */
+#define PLAYLIST_STATE_PATH (GIFS_BASE_PATH "/.playlist.bin")
+
+/** @brief LittleFS directory holding copies of frequently played GIFs */
+#define STAGING_DIR "/staged"
+
+/** @brief List of the staged copies in LittleFS */
+#define STAGING_STATE_PATH (STAGING_DIR "/.state.bin")
+
 /** @brief Path for configuration JSON file */
 #define CONFIG_FILE "/config.json"
 
@@ -32,16 +44,109 @@
 /** @brief Serial communication baud rate */
 #define SERIAL_BAUD_RATE 115200
 
-/** @brief Maximum time to play a single GIF in milliseconds */
+/** @brief Default time a GIF plays in category playback, rounded to whole loops, in milliseconds */
 #define MAX_GIF_PLAY_TIME 8000
 
-/** @brief LED matrix panel width & height in pixels */
+/** @brief Default LED matrix panel width & height in pixels */
 #define PANEL_WIDTH 64
 #define PANEL_HEIGHT 64
 
-/** @brief Number of LED matrix panels */
+/** @brief Default number of LED matrix panels in a row */
 #define PANELS_NUMBER 1
 
+/** @brief Longest pixel run converted in one pass by the span blitter */
+#define MAX_LINE_WIDTH 256
+
+/** @brief Default output gamma; the DMA driver applies CIE 1931 unless built with NO_CIE1931 */
+#ifdef NO_CIE1931
+#define DEFAULT_GAMMA 2.2f
+#else
+#define DEFAULT_GAMMA 1.0f
+#endif
+
+/** @brief Accepted output gamma range */
+#define MIN_GAMMA 0.5f
+#define MAX_GAMMA 3.0f
+
+/** @brief Most points in an uploaded channel response curve */
+#define MAX_CURVE_POINTS 64
+
+/** @brief Panels, counted along the chain, that can be given their own gain */
+#define MAX_CALIBRATED_PANELS 16
+
+/** @brief Distinct panel gains, each needing its own copy of every renderer palette */
+#define MAX_COLOR_ZONES 4
+
+// =============================================================================
+// Playback Configuration
+// =============================================================================
+
+/** @brief Default decoded frame cache budget in bytes (internal RAM) */
+#define DEFAULT_FRAME_CACHE_BYTES (64 * 1024)
+
+/** @brief Default decoded frame cache budget in bytes when PSRAM is present */
+#define DEFAULT_FRAME_CACHE_PSRAM_BYTES (1024 * 1024)
+
+/** @brief Maximum number of frames a GIF may have to be cached */
+#define GIF_FRAME_CACHE_MAX_FRAMES 40
+
+/** @brief Replaced or deleted GIFs remembered for the frame cache; more clear it whole */
+#define MAX_STALE_CACHE_PATHS 16
+
+/** @brief Default read-ahead window for GIF file reads in bytes */
+#define DEFAULT_READ_AHEAD_BYTES 8192
+
+/** @brief Smallest accepted read-ahead window in bytes */
+#define MIN_READ_AHEAD_BYTES 512
+
+/** @brief Default largest GIF loaded whole into memory for playback (internal RAM) */
+#define DEFAULT_MEMORY_PLAYBACK_BYTES (32 * 1024)
+
+/** @brief Default largest GIF loaded whole into memory when PSRAM is present */
+#define DEFAULT_MEMORY_PLAYBACK_PSRAM_BYTES (512 * 1024)
+
+/** @brief Default number of decoded frames buffered between decoder and presenter (0 = off) */
+#define DEFAULT_PIPELINE_DEPTH 3
+
+/** @brief Default fitting of GIFs larger than the panel ("crop", "nearest" or "box") */
+#define DEFAULT_SCALE_MODE "nearest"
+
+/** @brief Default longest time a GIF plays to finish its loops in milliseconds */
+#define DEFAULT_MAX_PLAY_TIME_MS 30000
+
+/** @brief Default LittleFS budget for staged GIF copies in bytes (0 = off) */
+#define DEFAULT_STAGING_CACHE_BYTES (256 * 1024)
+
+/** @brief Default bytes copied into LittleFS per hour at most */
+#define DEFAULT_STAGING_WRITE_BYTES_PER_HOUR (1024 * 1024)
+
+/** @brief GIFs tracked for staging, staged or not */
+#define STAGING_MAX_ENTRIES 64
+
+/** @brief Plays before a GIF is copied into LittleFS */
+#define STAGING_MIN_PLAYS 3
+
+/** @brief Plays after which all staging play counts are halved */
+#define STAGING_AGING_PLAYS 256
+
+/** @brief Highest playlist weight of a GIF; weight 0 leaves it out of shuffles */
+#define PLAYLIST_MAX_WEIGHT 16
+
+/** @brief Shortest interval between saves of moved playlist decks in milliseconds */
+#define PLAYLIST_SAVE_INTERVAL_MS 60000
+
+/** @brief Largest logical screen width or height accepted for upload */
+#define MAX_GIF_DIMENSION 1024
+
+/** @brief Longest single wait on the frame pipeline in milliseconds */
+#define PIPELINE_WAIT_MS 100
+
+/** @brief Deadline slack before a presented frame counts as late in milliseconds */
+#define FRAME_LATE_TOLERANCE_MS 2
+
+/** @brief Lateness after which the frame schedule is re-anchored in milliseconds */
+#define FRAME_RESYNC_MS 250
+
 // =============================================================================
 // Network Configuration
 // =============================================================================
@@ -55,6 +160,33 @@
 /** @brief Default file path */
 #define DEFAULT_FILE_PATH "/" DEFAULT_FILE
 
+/** @brief Largest GIF accepted by the upload endpoint in bytes */
+#define MAX_UPLOAD_BYTES (2 * 1024 * 1024)
+
+/** @brief Uploads received at the same time */
+#define MAX_UPLOAD_SESSIONS 4
+
+/**
+ * @brief Files kept open on the SD card besides uploads
+ *
+ * The playing GIF, the staging copy's source, the transcoder's input and
+ * output, the index scan's base directory, category directory and entry, and
+ * the index or playlist being saved.
+ */
+#define SD_BACKGROUND_FILES 8
+
+/** @brief SPI clock of the SD card, the driver's default */
+#define SD_SPI_FREQUENCY_HZ 4000000
+
+/** @brief Open files the SD card is mounted for, the driver's default of 5 is too few */
+#define SD_MAX_OPEN_FILES (MAX_UPLOAD_SESSIONS + SD_BACKGROUND_FILES)
+
+/** @brief Idle time after which an unfinished upload is dropped in milliseconds */
+#define UPLOAD_SESSION_TIMEOUT_MS 30000
+
+/** @brief Retry-After sent when every upload slot is busy, in seconds */
+#define UPLOAD_RETRY_AFTER_S 2
+
 /** @brief Maximum number of WiFi connection attempts */
 #define MAX_WIFI_CONNECTION_ATTEMPTS 20
 
@@ -68,12 +200,30 @@
 /** @brief Display task stack size in bytes */
 #define DISPLAY_TASK_STACK_SIZE 8192
 
+/** @brief GIF decoder task stack size in bytes */
+#define DECODE_TASK_STACK_SIZE 8192
+
+/** @brief Category index validation task stack size in bytes */
+#define INDEX_TASK_STACK_SIZE 6144
+
+/** @brief GIF staging task stack size in bytes */
+#define STAGING_TASK_STACK_SIZE 4096
+
 /** @brief OTA task priority (0-24, higher = more priority) */
 #define OTA_TASK_PRIORITY 2
 
 /** @brief Display task priority (0-24, higher = more priority) */
 #define DISPLAY_TASK_PRIORITY 1
 
+/** @brief GIF decoder task priority (0-24, higher = more priority) */
+#define DECODE_TASK_PRIORITY 1
+
+/** @brief Category index validation task priority, runs when playback is idle */
+#define INDEX_TASK_PRIORITY 0
+
+/** @brief GIF staging task priority, runs when playback is idle */
+#define STAGING_TASK_PRIORITY 0
+
 // =============================================================================
 // Timing Constants
 // =============================================================================
@@ -84,6 +234,15 @@
 /** @brief Display task update interval in milliseconds */
 #define DISPLAY_UPDATE_INTERVAL_MS 1000
 
+/** @brief Delay after boot before the category index is checked against the card */
+#define INDEX_VALIDATE_DELAY_MS 10000
+
+/** @brief Wait before repeating an index check that an upload interrupted */
+#define INDEX_RETRY_DELAY_MS 5000
+
+/** @brief Wait between looks for GIFs to stage when there was nothing to copy in milliseconds */
+#define STAGING_CHECK_INTERVAL_MS 10000
+
 /** @brief Test pattern delay between colors in milliseconds */
 #define TEST_PATTERN_DELAY_MS 1000
 
@@ -101,6 +260,9 @@
 #define STATE "state"
 #define SYSTEM "system"
 #define NETWORK "network"
+#define PLAYBACK "playback"
+#define DISPLAY_LAYOUT "display"
+#define COLOR "color"
 
 
 /** @brief Pins keys */
@@ -120,6 +282,44 @@
 #define WEB_SERVER_PORT "webServerPort"
 #define OTA_ENABLED "otaEnabled"
 
+/** @brief Playback keys */
+#define FRAME_CACHE_BYTES "frameCacheBytes"
+#define READ_AHEAD_BYTES "readAheadBytes"
+#define MEMORY_PLAYBACK_BYTES "memoryPlaybackBytes"
+#define PIPELINE_DEPTH "pipelineDepth"
+#define SCALE_MODE "scaleMode"
+#define TARGET_PLAY_TIME_MS "targetPlayTimeMs"
+#define MAX_PLAY_TIME_MS "maxPlayTimeMs"
+#define STAGING_CACHE_BYTES "stagingCacheBytes"
+#define STAGING_WRITE_BYTES_PER_HOUR "stagingWriteBytesPerHour"
+#define DIRTY_TRACKING "dirtyTracking"
+#define PLAYLISTS "playlists"
+
+/** @brief Display layout keys */
+#define LAYOUT_PANEL_WIDTH "panelWidth"
+#define LAYOUT_PANEL_HEIGHT "panelHeight"
+#define LAYOUT_PANELS_ACROSS "panelsAcross"
+#define LAYOUT_PANELS_DOWN "panelsDown"
+#define LAYOUT_CHAIN_START "chainStart"
+#define LAYOUT_SERPENTINE "serpentine"
+#define LAYOUT_ROTATION "rotation"
+
+/** @brief Color keys */
+#define COLOR_GAMMA "gamma"
+#define COLOR_CORRECTION "correction"
+#define COLOR_LEVEL "level"
+#define COLOR_CURVES "curves"
+#define COLOR_PANEL_GAIN "panelGain"
+#define CURVE_RED "red"
+#define CURVE_GREEN "green"
+#define CURVE_BLUE "blue"
+
+/** @brief Playlist keys */
+#define PLAYLIST_MODE "mode"
+#define PLAY_TIME_MS "playTimeMs"
+#define PLAYLIST_ITEMS "items"
+#define PLAYLIST_WEIGHT "weight"
+
 /** @brief Network keys */
 #define WIFI_SSID "ssid"
 #define WIFI_PASSWORD "password"
@@ -0,0 +1,148 @@
+#include "CanvasMapper.h"
+#include "Logger.h"
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+/**
+ * @brief Validate a layout and build its row tables
+ */
+bool CanvasMapper::configure(const CanvasLayout &next) {
+  if (next.panelWidth < 2 || next.panelHeight < 2 || next.panelsAcross == 0 ||
+      next.panelsDown == 0 || next.rotation > 3) {
+    LOG_WARNING("CanvasMapper: Invalid panel layout");
+    return false;
+  }
+
+  int wallWidth = next.panelWidth * next.panelsAcross;
+  int wallHeight = next.panelHeight * next.panelsDown;
+  if (wallWidth > MAX_LINE_WIDTH || wallHeight > MAX_LINE_WIDTH) {
+    LOG_WARNING("CanvasMapper: %dx%d wall is larger than %d pixels", wallWidth,
+                wallHeight, MAX_LINE_WIDTH);
+    return false;
+  }
+
+  bool quarterTurn = next.rotation & 1;
+  layout = next;
+  canvasWidth = quarterTurn ? wallHeight : wallWidth;
+  canvasHeight = quarterTurn ? wallWidth : wallHeight;
+
+  // A canvas row crosses panels every panel width, or every panel height
+  // when the picture is turned on its side
+  segmentLength = quarterTurn ? layout.panelHeight : layout.panelWidth;
+  segmentsPerRow = canvasWidth / segmentLength;
+
+  segments.assign((size_t)canvasHeight * segmentsPerRow, Segment());
+  identity = true;
+  for (int16_t y = 0; y < canvasHeight; y++) {
+    Segment *seg = &segments[(size_t)y * segmentsPerRow];
+    for (uint16_t s = 0; s < segmentsPerRow; s++) {
+      int16_t x = s * segmentLength;
+      int16_t nextX, nextY;
+      locate(x, y, seg[s].x, seg[s].y);
+      locate(x + 1, y, nextX, nextY);
+      seg[s].dx = nextX - seg[s].x;
+      seg[s].dy = nextY - seg[s].y;
+      if (seg[s].x != x || seg[s].y != y || seg[s].dx != 1 || seg[s].dy != 0) {
+        identity = false;
+      }
+    }
+  }
+
+  LOG_INFO("CanvasMapper: %dx%d canvas on %d panels of %dx%d%s", canvasWidth,
+           canvasHeight, layout.chainLength(), layout.panelWidth,
+           layout.panelHeight, identity ? "" : " (remapped)");
+  return true;
+}
+
+// ============================================================================
+// Mapping
+// ============================================================================
+
+/**
+ * @brief Turn canvas coordinates into wall coordinates, find the panel and
+ *        its place in the chain
+ */
+void CanvasMapper::locate(int16_t x, int16_t y, int16_t &chainX,
+                          int16_t &chainY) const {
+  const int pw = layout.panelWidth;
+  const int ph = layout.panelHeight;
+  const int wallWidth = pw * layout.panelsAcross;
+  const int wallHeight = ph * layout.panelsDown;
+
+  // Undo the rotation: (wx, wy) is the pixel on the wall as seen from the front
+  int wx, wy;
+  switch (layout.rotation) {
+    case 1:
+      wx = wallWidth - 1 - y;
+      wy = x;
+      break;
+    case 2:
+      wx = wallWidth - 1 - x;
+      wy = wallHeight - 1 - y;
+      break;
+    case 3:
+      wx = y;
+      wy = wallHeight - 1 - x;
+      break;
+    default:
+      wx = x;
+      wy = y;
+      break;
+  }
+
+  int column = wx / pw;
+  int panelRow = wy / ph;
+  int px = wx % pw;
+  int py = wy % ph;
+
+  bool fromRight = layout.chainStart == ChainStart::TOP_RIGHT ||
+                   layout.chainStart == ChainStart::BOTTOM_RIGHT;
+  bool fromBottom = layout.chainStart == ChainStart::BOTTOM_LEFT ||
+                    layout.chainStart == ChainStart::BOTTOM_RIGHT;
+
+  // Rows are counted from the start corner; in a snake every other row runs
+  // back the other way with its panels mounted upside down
+  int chainRow = fromBottom ? layout.panelsDown - 1 - panelRow : panelRow;
+  bool reversed = layout.serpentine && (chainRow & 1);
+  bool rightward = fromRight == reversed;
+  int position = chainRow * layout.panelsAcross +
+                 (rightward ? column : layout.panelsAcross - 1 - column);
+  if (reversed) {
+    px = pw - 1 - px;
+    py = ph - 1 - py;
+  }
+
+  // Pixels are shifted through the chain, so the first panel shows the end
+  // of the DMA row
+  chainX = (layout.chainLength() - 1 - position) * pw + px;
+  chainY = py;
+}
+
+// ============================================================================
+// Names
+// ============================================================================
+
+const char *CanvasMapper::getChainStartName(ChainStart start) {
+  switch (start) {
+    case ChainStart::TOP_LEFT: return "topLeft";
+    case ChainStart::TOP_RIGHT: return "topRight";
+    case ChainStart::BOTTOM_LEFT: return "bottomLeft";
+    case ChainStart::BOTTOM_RIGHT: return "bottomRight";
+  }
+  return "topRight";
+}
+
+bool CanvasMapper::parseChainStart(const char *name, ChainStart &start) {
+  if (!name) return false;
+  static const ChainStart all[] = {ChainStart::TOP_LEFT, ChainStart::TOP_RIGHT,
+                                   ChainStart::BOTTOM_LEFT, ChainStart::BOTTOM_RIGHT};
+  for (ChainStart candidate : all) {
+    if (strcasecmp(name, getChainStartName(candidate)) == 0) {
+      start = candidate;
+      return true;
+    }
+  }
+  return false;
+}
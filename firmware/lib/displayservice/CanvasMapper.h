@@ -0,0 +1,132 @@
+#ifndef CANVAS_MAPPER_H
+#define CANVAS_MAPPER_H
+
+/**
+ * @file CanvasMapper.h
+ * @brief Virtual canvas spanning a wall of chained HUB75 panels
+ *
+ * The DMA driver sees a chain of panels as one long row of pixels, with the
+ * panel wired to the ESP32 at the right end of that row. Walls that tile the
+ * panels in several rows, run the chain in a snake, or hang rotated need
+ * every canvas pixel moved to another place in the chain.
+ *
+ * The mapping is worked out once, when the layout is configured: every
+ * canvas row is cut into segments that fall on a single panel, and each
+ * segment stores the chain position of its first pixel and the step to the
+ * next one. Drawing a run then walks the row's segments instead of doing
+ * the tiling arithmetic per pixel.
+ */
+
+#include <Arduino.h>
+#include <vector>
+
+#include "constants.h"
+
+/**
+ * @enum ChainStart
+ * @brief Corner of the wall holding the panel wired to the ESP32
+ *
+ * The chain runs along the row of that corner, away from it, then moves to
+ * the next row towards the opposite side of the wall.
+ */
+enum class ChainStart {
+    TOP_LEFT,
+    TOP_RIGHT,
+    BOTTOM_LEFT,
+    BOTTOM_RIGHT
+};
+
+/**
+ * @struct CanvasLayout
+ * @brief How the panels of a wall are tiled and wired
+ */
+struct CanvasLayout {
+    uint16_t panelWidth = PANEL_WIDTH;      //< Width of one panel
+    uint16_t panelHeight = PANEL_HEIGHT;    //< Height of one panel
+    uint8_t panelsAcross = PANELS_NUMBER;   //< Panels per row of the wall
+    uint8_t panelsDown = 1;                 //< Rows of panels
+    ChainStart chainStart = ChainStart::TOP_RIGHT; //< Panel wired to the ESP32
+    bool serpentine = false;                //< Every other row runs back, its panels upside down
+    uint8_t rotation = 0;                   //< Quarter turns of the picture, clockwise
+
+    uint16_t chainLength() const { return panelsAcross * panelsDown; }
+};
+
+/**
+ * @class CanvasMapper
+ * @brief Row tables mapping canvas pixels onto the DMA chain
+ */
+class CanvasMapper {
+public:
+    /**
+     * @struct Segment
+     * @brief Part of a canvas row lying on one panel
+     */
+    struct Segment {
+        int16_t x;      //< Chain column of the first pixel
+        int16_t y;      //< Chain row of the first pixel
+        int8_t dx;      //< Chain column step per canvas pixel
+        int8_t dy;      //< Chain row step per canvas pixel
+    };
+
+    /**
+     * @brief Build the row tables for a layout
+     *
+     * The canvas must fit in MAX_LINE_WIDTH pixels either way, since rows
+     * and columns both go through line buffers of that size.
+     *
+     * @param layout Panel tiling and wiring
+     * @return false if the layout is invalid, the previous tables are kept
+     */
+    bool configure(const CanvasLayout &layout);
+
+    const CanvasLayout &getLayout() const { return layout; }
+
+    /** @brief Canvas size, after rotation */
+    int16_t width() const { return canvasWidth; }
+    int16_t height() const { return canvasHeight; }
+
+    /**
+     * @brief Check whether canvas and chain coordinates are the same
+     *
+     * True for a single row of panels chained from the right, not rotated,
+     * in which case callers can write straight to the display.
+     */
+    bool isIdentity() const { return identity; }
+
+    /** @brief Canvas pixels per segment */
+    int16_t getSegmentLength() const { return segmentLength; }
+
+    /**
+     * @brief Get the segments of a canvas row, left to right
+     * @param y Canvas row, 0 to height() - 1
+     * @return width() / getSegmentLength() segments
+     */
+    const Segment *row(int16_t y) const { return &segments[(size_t)y * segmentsPerRow]; }
+
+    /**
+     * @brief Map one canvas pixel with the tiling arithmetic
+     *
+     * Used to build the tables; renderers use row() instead.
+     *
+     * @param x Canvas column
+     * @param y Canvas row
+     * @param chainX Receives the chain column
+     * @param chainY Receives the chain row
+     */
+    void locate(int16_t x, int16_t y, int16_t &chainX, int16_t &chainY) const;
+
+    static const char *getChainStartName(ChainStart start);
+    static bool parseChainStart(const char *name, ChainStart &start);
+
+private:
+    CanvasLayout layout;                //< Current layout
+    int16_t canvasWidth = PANEL_WIDTH;  //< Canvas width, after rotation
+    int16_t canvasHeight = PANEL_HEIGHT; //< Canvas height, after rotation
+    int16_t segmentLength = PANEL_WIDTH; //< Canvas pixels per segment
+    uint16_t segmentsPerRow = 1;        //< Segments per canvas row
+    bool identity = true;               //< Canvas and chain coordinates match
+    std::vector<Segment> segments;      //< Row tables, segmentsPerRow per canvas row
+};
+
+#endif // CANVAS_MAPPER_H
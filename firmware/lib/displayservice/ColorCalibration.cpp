@@ -0,0 +1,141 @@
+#include "ColorCalibration.h"
+#include "Logger.h"
+
+namespace {
+
+/** @brief Last version handed out, shared so a swapped-in calibration never repeats one */
+uint32_t lastVersion = 0;
+
+} // namespace
+
+ColorCalibration::ColorCalibration() {
+  configure(CalibrationSettings(), nullptr);
+}
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+/**
+ * @brief Group the panels by gain and build a transform per group
+ */
+bool ColorCalibration::configure(const CalibrationSettings &next, const CanvasMapper *layout) {
+  uint8_t gains[MAX_COLOR_ZONES][3];
+  uint8_t zones[MAX_CALIBRATED_PANELS + 1];
+  uint8_t count = 0;
+
+  uint16_t chainLength = layout ? layout->getLayout().chainLength() : 1;
+  uint16_t positions = min((int)chainLength, MAX_CALIBRATED_PANELS + 1);
+  for (uint16_t position = 0; position < positions; position++) {
+    static const uint8_t fullGain[3] = {255, 255, 255};
+    const uint8_t *gain = position < next.panelCount ? next.panelGain[position] : fullGain;
+
+    uint8_t zone = 0;
+    while (zone < count && memcmp(gains[zone], gain, 3) != 0) {
+      zone++;
+    }
+    if (zone == count) {
+      if (count == MAX_COLOR_ZONES) {
+        LOG_WARNING("ColorCalibration: More than %d different panel gains", MAX_COLOR_ZONES);
+        return false;
+      }
+      memcpy(gains[count++], gain, 3);
+    }
+    zones[position] = zone;
+  }
+
+  settings = next;
+  mapper = layout;
+  zoneCount = count;
+  memcpy(panelZones, zones, positions);
+  for (uint8_t zone = 0; zone < zoneCount; zone++) {
+    ColorSettings color = settings.color;
+    for (int c = 0; c < 3; c++) {
+      color.correction[c] = (color.correction[c] * gains[zone][c] + 127) / 255;
+    }
+    transforms[zone].configure(color);
+  }
+  version = ++lastVersion;
+  return true;
+}
+
+bool ColorCalibration::parseSettings(JsonVariantConst config, CalibrationSettings &settings) {
+  if (!ColorTransform::parseSettings(config, settings.color)) {
+    return false;
+  }
+
+  JsonArrayConst gains = config[COLOR_PANEL_GAIN];
+  if (gains.isNull()) return true;
+  if (gains.size() > MAX_CALIBRATED_PANELS) {
+    LOG_WARNING("ColorCalibration: Gains for %d panels, at most %d are kept",
+                (int)gains.size(), MAX_CALIBRATED_PANELS);
+    return false;
+  }
+
+  settings.panelCount = gains.size();
+  for (size_t position = 0; position < gains.size(); position++) {
+    JsonVariantConst gain = gains[position];
+    for (size_t c = 0; c < 3; c++) {
+      settings.panelGain[position][c] = gain[c] | 255;
+    }
+  }
+  return true;
+}
+
+void ColorCalibration::writeSettings(const CalibrationSettings &settings, JsonObject config) {
+  ColorTransform::writeSettings(settings.color, config);
+  if (settings.panelCount == 0) return;
+
+  JsonArray gains = config[COLOR_PANEL_GAIN].to<JsonArray>();
+  for (uint8_t position = 0; position < settings.panelCount; position++) {
+    JsonArray gain = gains.add<JsonArray>();
+    for (int c = 0; c < 3; c++) {
+      gain.add(settings.panelGain[position][c]);
+    }
+  }
+}
+
+// ============================================================================
+// Conversion
+// ============================================================================
+
+void ColorCalibration::convertPalette(const uint16_t *source, uint16_t *palettes) const {
+  for (uint8_t zone = 0; zone < zoneCount; zone++) {
+    transforms[zone].convertPalette(source, palettes + 256 * zone);
+  }
+}
+
+/**
+ * @brief Walk the row's panel segments from x while they stay in one zone
+ */
+uint8_t ColorCalibration::zoneAt(int16_t x, int16_t y, int16_t &runEnd) const {
+  runEnd = INT16_MAX;
+  if (zoneCount == 1 || !mapper || y < 0 || y >= mapper->height() || x >= mapper->width()) {
+    return 0;
+  }
+  if (x < 0) {
+    runEnd = 0;
+    return 0;
+  }
+
+  const int16_t length = mapper->getSegmentLength();
+  const int16_t count = mapper->width() / length;
+  const CanvasMapper::Segment *segments = mapper->row(y);
+  int16_t segment = x / length;
+  uint8_t zone = segmentZone(segments[segment]);
+  segment++;
+  while (segment < count && segmentZone(segments[segment]) == zone) {
+    segment++;
+  }
+  if (segment < count) {
+    runEnd = segment * length;
+  }
+  return zone;
+}
+
+uint8_t ColorCalibration::segmentZone(const CanvasMapper::Segment &segment) const {
+  // Pixels are shifted through the chain, so the first panel holds the end of the DMA row
+  const CanvasLayout &layout = mapper->getLayout();
+  int position = layout.chainLength() - 1 - segment.x / layout.panelWidth;
+  return panelZones[min(position, MAX_CALIBRATED_PANELS)];
+}
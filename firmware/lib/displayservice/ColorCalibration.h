@@ -0,0 +1,121 @@
+#ifndef COLOR_CALIBRATION_H
+#define COLOR_CALIBRATION_H
+
+/**
+ * @file ColorCalibration.h
+ * @brief Color calibration of a wall of panels
+ *
+ * Every panel shares the gamma or response curves, white point and level of
+ * the "color" configuration section, and may have its own gain to match
+ * panels from different batches. Panels with the same gain form a zone with
+ * one ColorTransform. Renderers keep one palette per zone and switch palette
+ * where a canvas row crosses into a panel of another zone, so calibration
+ * adds no work per pixel beyond the palette lookup.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "CanvasMapper.h"
+#include "ColorTransform.h"
+#include "constants.h"
+
+/**
+ * @struct CalibrationSettings
+ * @brief Calibration shared by the wall and the gain of each panel
+ */
+struct CalibrationSettings {
+    ColorSettings color;                            //< Response, white point and level of every panel
+    uint8_t panelGain[MAX_CALIBRATED_PANELS][3] = {}; //< Red, green and blue gain by chain position
+    uint8_t panelCount = 0;                         //< Panels with a gain, the rest use 255
+};
+
+/**
+ * @class ColorCalibration
+ * @brief Calibration zones of the canvas and their color transforms
+ */
+class ColorCalibration {
+public:
+    ColorCalibration();
+
+    /**
+     * @brief Build the zones for new settings
+     * @param settings Calibration to apply
+     * @param mapper Layout of the wall, null for a single zone
+     * @return false if the panels need more than MAX_COLOR_ZONES zones
+     */
+    bool configure(const CalibrationSettings &settings, const CanvasMapper *mapper);
+
+    /**
+     * @brief Read a "color" configuration section
+     * @param config Section, may be null
+     * @param settings Receives the calibration, defaults for missing keys
+     * @return false if the section is malformed
+     */
+    static bool parseSettings(JsonVariantConst config, CalibrationSettings &settings);
+
+    /**
+     * @brief Write a calibration in the form parseSettings() reads
+     * @param settings Calibration to write
+     * @param config Object receiving the keys
+     */
+    static void writeSettings(const CalibrationSettings &settings, JsonObject config);
+
+    const CalibrationSettings &getSettings() const { return settings; }
+
+    /**
+     * @brief Bumped by every configure() of any calibration, so renderers know to rebuild
+     */
+    uint32_t getVersion() const { return version; }
+
+    uint8_t getZoneCount() const { return zoneCount; }
+    const ColorTransform &getTransform(uint8_t zone) const { return transforms[zone]; }
+
+    /**
+     * @brief Correct a color as shown on a zone
+     */
+    uint16_t apply(uint16_t color, uint8_t zone) const { return transforms[zone].apply(color); }
+
+    /**
+     * @brief Correct a palette for every zone
+     * @param source RGB565 palette with 256 entries
+     * @param palettes Receives getZoneCount() corrected palettes of 256 entries, back to back
+     */
+    void convertPalette(const uint16_t *source, uint16_t *palettes) const;
+
+    /**
+     * @brief Find the zone of a canvas pixel and how far along the row it extends
+     * @param x Canvas column
+     * @param y Canvas row
+     * @param runEnd Receives the first column past x in another zone, INT16_MAX if none
+     * @return Zone of the pixel, 0 outside the canvas
+     */
+    uint8_t zoneAt(int16_t x, int16_t y, int16_t &runEnd) const;
+
+    /**
+     * @brief Palette of a canvas pixel, for renderers walking a row run by run
+     * @param palettes Palettes filled by convertPalette()
+     * @param x Canvas column
+     * @param y Canvas row
+     * @param runEnd Receives the first column past x needing another palette
+     */
+    const uint16_t *paletteAt(const uint16_t *palettes, int16_t x, int16_t y,
+                              int16_t &runEnd) const {
+        return palettes + 256 * zoneAt(x, y, runEnd);
+    }
+
+private:
+    /**
+     * @brief Zone of the panel a row segment lies on
+     */
+    uint8_t segmentZone(const CanvasMapper::Segment &segment) const;
+
+    CalibrationSettings settings;                   //< Current calibration
+    ColorTransform transforms[MAX_COLOR_ZONES];     //< Transform of each zone
+    uint8_t zoneCount = 1;                          //< Zones in use
+    uint8_t panelZones[MAX_CALIBRATED_PANELS + 1] = {}; //< Zone by chain position, the last for the rest
+    const CanvasMapper *mapper = nullptr;           //< Layout the zones were built for
+    uint32_t version = 0;                           //< Version of the current calibration
+};
+
+#endif // COLOR_CALIBRATION_H
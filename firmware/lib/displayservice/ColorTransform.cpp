@@ -0,0 +1,157 @@
+#include "ColorTransform.h"
+#include "Logger.h"
+
+#include <math.h>
+
+ColorTransform::ColorTransform() {
+  configure(ColorSettings());
+}
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+void ColorTransform::configure(const ColorSettings &next) {
+  settings = next;
+  if (!(settings.gamma >= MIN_GAMMA && settings.gamma <= MAX_GAMMA)) {
+    LOG_WARNING("ColorTransform: Gamma %.2f out of range, using %.2f", settings.gamma,
+                (double)DEFAULT_GAMMA);
+    settings.gamma = DEFAULT_GAMMA;
+  }
+
+  for (int c = 0; c < 3; c++) {
+    if (settings.curvePoints[c] == 1 || settings.curvePoints[c] > MAX_CURVE_POINTS) {
+      settings.curvePoints[c] = 0;
+    }
+  }
+
+  buildChannel(red, 5, 11, 0);
+  buildChannel(green, 6, 5, 1);
+  buildChannel(blue, 5, 0, 2);
+
+  identity = true;
+  for (uint16_t i = 0; i < 32 && identity; i++) {
+    identity = red[i] == (i << 11) && blue[i] == i;
+  }
+  for (uint16_t i = 0; i < 64 && identity; i++) {
+    identity = green[i] == (i << 5);
+  }
+  version++;
+}
+
+bool ColorTransform::parseSettings(JsonVariantConst config, ColorSettings &settings) {
+  if (config.isNull()) return true;
+
+  settings.gamma = config[COLOR_GAMMA] | settings.gamma;
+  settings.level = config[COLOR_LEVEL] | settings.level;
+  JsonVariantConst correction = config[COLOR_CORRECTION];
+  for (size_t i = 0; i < 3; i++) {
+    settings.correction[i] = correction[i] | settings.correction[i];
+  }
+
+  JsonVariantConst curves = config[COLOR_CURVES];
+  if (curves.isNull()) return true;
+
+  static const char *const names[3] = {CURVE_RED, CURVE_GREEN, CURVE_BLUE};
+  bool valid = true;
+  for (int c = 0; c < 3; c++) {
+    JsonArrayConst points = curves[names[c]];
+    settings.curvePoints[c] = 0;
+    if (points.isNull()) continue;
+    if (points.size() < 2 || points.size() > MAX_CURVE_POINTS) {
+      LOG_WARNING("ColorTransform: The %s curve needs 2 to %d points", names[c], MAX_CURVE_POINTS);
+      valid = false;
+      continue;
+    }
+    for (size_t i = 0; i < points.size(); i++) {
+      int level = points[i] | 0;
+      settings.curve[c][i] = min(max(level, 0), 255);
+    }
+    settings.curvePoints[c] = points.size();
+  }
+  return valid;
+}
+
+void ColorTransform::writeSettings(const ColorSettings &settings, JsonObject config) {
+  config[COLOR_GAMMA] = settings.gamma;
+  JsonArray correction = config[COLOR_CORRECTION].to<JsonArray>();
+  for (int c = 0; c < 3; c++) {
+    correction.add(settings.correction[c]);
+  }
+  config[COLOR_LEVEL] = settings.level;
+
+  static const char *const names[3] = {CURVE_RED, CURVE_GREEN, CURVE_BLUE};
+  for (int c = 0; c < 3; c++) {
+    if (settings.curvePoints[c] == 0) continue;
+    JsonArray points = config[COLOR_CURVES][names[c]].to<JsonArray>();
+    for (uint8_t i = 0; i < settings.curvePoints[c]; i++) {
+      points.add(settings.curve[c][i]);
+    }
+  }
+}
+
+// ============================================================================
+// Conversion
+// ============================================================================
+
+void ColorTransform::convertPalette(const uint16_t *source, uint16_t *output,
+                                    size_t count) const {
+  if (identity) {
+    memcpy(output, source, count * sizeof(uint16_t));
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    output[i] = apply(source[i]);
+  }
+}
+
+void ColorTransform::applyRGB888(uint8_t &r, uint8_t &g, uint8_t &b) const {
+  r = correctChannel(0, r, 255);
+  g = correctChannel(1, g, 255);
+  b = correctChannel(2, b, 255);
+}
+
+/**
+ * @brief Map every channel value through its response, gain and level
+ */
+void ColorTransform::buildChannel(uint16_t *table, uint8_t bits, uint8_t shift,
+                                  uint8_t channel) const {
+  const uint16_t maxValue = (1 << bits) - 1;
+  for (uint16_t i = 0; i <= maxValue; i++) {
+    table[i] = correctChannel(channel, i, maxValue) << shift;
+  }
+}
+
+/**
+ * @brief Correct one channel value
+ *
+ * A channel that is lit stays lit, so dark colors keep their hue instead of
+ * rounding to black.
+ */
+uint16_t ColorTransform::correctChannel(uint8_t channel, uint16_t value,
+                                        uint16_t maxValue) const {
+  const float scale = (settings.correction[channel] / 255.0f) * (settings.level / 255.0f);
+  float linear = response(channel, (float)value / maxValue) * scale;
+  uint16_t output = (uint16_t)lroundf(linear * maxValue);
+  if (output == 0 && value > 0 && scale > 0) output = 1;
+  return output > maxValue ? maxValue : output;
+}
+
+/**
+ * @brief Gamma curve, or the uploaded curve interpolated between its points
+ */
+float ColorTransform::response(uint8_t channel, float input) const {
+  uint8_t points = settings.curvePoints[channel];
+  if (points == 0) {
+    return powf(input, settings.gamma);
+  }
+
+  const uint8_t *curve = settings.curve[channel];
+  float position = input * (points - 1);
+  int index = (int)position;
+  if (index >= points - 1) {
+    return curve[points - 1] / 255.0f;
+  }
+  float fraction = position - index;
+  return (curve[index] + (curve[index + 1] - curve[index]) * fraction) / 255.0f;
+}
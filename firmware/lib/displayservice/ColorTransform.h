@@ -0,0 +1,140 @@
+#ifndef COLOR_TRANSFORM_H
+#define COLOR_TRANSFORM_H
+
+/**
+ * @file ColorTransform.h
+ * @brief Output color correction folded into per-channel tables
+ *
+ * Gamma, or a measured response curve per channel, color correction and a
+ * brightness level are combined into one table per RGB565 channel, so correcting a color is three table loads and
+ * correcting a 256-entry palette is cheap enough to do once per GIF or per
+ * frame. Renderers look pixels up in corrected palettes and never correct
+ * individual pixels.
+ *
+ * The DMA driver applies its own CIE 1931 luminance curve to every pixel
+ * unless the firmware is built with NO_CIE1931. In that build the default
+ * gamma takes over the curve here, at the cost of the 5 and 6-bit precision
+ * of RGB565 in the darkest levels.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "constants.h"
+
+/**
+ * @struct ColorSettings
+ * @brief Parameters of the output color transform
+ */
+struct ColorSettings {
+    float gamma = DEFAULT_GAMMA;            //< Exponent applied to each channel
+    uint8_t correction[3] = {255, 255, 255}; //< Red, green and blue gain, 255 for full
+    uint8_t level = 255;                    //< Brightness scale of all channels, 255 for full
+    uint8_t curvePoints[3] = {0, 0, 0};     //< Points in each channel's curve, 0 to use gamma
+    uint8_t curve[3][MAX_CURVE_POINTS] = {}; //< Output level 0-255 for evenly spaced inputs, black to full
+};
+
+/**
+ * @class ColorTransform
+ * @brief Per-channel lookup tables mapping RGB565 colors to output colors
+ */
+class ColorTransform {
+public:
+    ColorTransform();
+
+    /**
+     * @brief Rebuild the tables for new settings
+     * @param settings Gamma, correction and level
+     */
+    void configure(const ColorSettings &settings);
+
+    /**
+     * @brief Read settings from a "color" configuration section
+     * @param config Section, may be null
+     * @param settings Receives the settings, defaults for missing keys
+     * @return false if a curve is malformed; it is then left out
+     */
+    static bool parseSettings(JsonVariantConst config, ColorSettings &settings);
+
+    /**
+     * @brief Write settings in the form parseSettings() reads
+     * @param settings Settings to write
+     * @param config Object receiving the keys
+     */
+    static void writeSettings(const ColorSettings &settings, JsonObject config);
+
+    const ColorSettings &getSettings() const { return settings; }
+
+    /**
+     * @brief Check whether colors pass through unchanged
+     */
+    bool isIdentity() const { return identity; }
+
+    /**
+     * @brief Bumped by every configure(), so renderers know to rebuild their palettes
+     */
+    uint32_t getVersion() const { return version; }
+
+    /**
+     * @brief Correct one RGB565 color
+     */
+    uint16_t apply(uint16_t color) const {
+        return red[color >> 11] | green[(color >> 5) & 0x3F] | blue[color & 0x1F];
+    }
+
+    /**
+     * @brief Correct one color at 8 bits per channel
+     *
+     * Computed rather than looked up, for palettes kept at the depth of the
+     * DMA buffer and rebuilt only now and then, like the plasma palette.
+     *
+     * @param r Red, corrected in place
+     * @param g Green, corrected in place
+     * @param b Blue, corrected in place
+     */
+    void applyRGB888(uint8_t &r, uint8_t &g, uint8_t &b) const;
+
+    /**
+     * @brief Correct a palette into an output-ready copy
+     * @param source RGB565 palette
+     * @param output Receives the corrected palette, may not alias source
+     * @param count Number of entries
+     */
+    void convertPalette(const uint16_t *source, uint16_t *output, size_t count = 256) const;
+
+private:
+    /**
+     * @brief Fill one channel table
+     * @param table Table to fill, 1 << bits entries, shifted into place
+     * @param bits Channel width in RGB565
+     * @param shift Channel position in RGB565
+     * @param channel 0 for red, 1 for green, 2 for blue
+     */
+    void buildChannel(uint16_t *table, uint8_t bits, uint8_t shift, uint8_t channel) const;
+
+    /**
+     * @brief Map one channel value through its response, gain and level
+     * @param channel 0 for red, 1 for green, 2 for blue
+     * @param value Channel value
+     * @param maxValue Largest channel value, 31, 63 or 255
+     * @return Output value, up to maxValue
+     */
+    uint16_t correctChannel(uint8_t channel, uint16_t value, uint16_t maxValue) const;
+
+    /**
+     * @brief Response of a channel before gain and level
+     * @param channel 0 for red, 1 for green, 2 for blue
+     * @param input Channel value, 0 to 1
+     * @return Output, 0 to 1
+     */
+    float response(uint8_t channel, float input) const;
+
+    ColorSettings settings;     //< Current settings
+    uint16_t red[32];           //< Output red for each 5-bit input, in place
+    uint16_t green[64];         //< Output green for each 6-bit input, in place
+    uint16_t blue[32];          //< Output blue for each 5-bit input, in place
+    bool identity = true;       //< Every table maps its input to itself
+    uint32_t version = 0;       //< Incremented by configure()
+};
+
+#endif // COLOR_TRANSFORM_H
@@ -51,7 +51,15 @@ bool DisplayService::initialize() {
        pins[PIN_CLK].as<int8_t>()
    };
 
-   HUB75_I2S_CFG mxconfig(PANEL_HEIGHT, PANEL_WIDTH, PANELS_NUMBER, _pins);
+   CanvasLayout layout;
+   loadLayout(layout);
+   if (!mapper.configure(layout)) {
+     LOG_WARNING("DisplayService: Falling back to a single %dx%d panel", PANEL_WIDTH, PANEL_HEIGHT);
+     layout = CanvasLayout();
+     mapper.configure(layout);
+   }
+
+   HUB75_I2S_CFG mxconfig(layout.panelWidth, layout.panelHeight, layout.chainLength(), _pins);
 
    display = new MatrixPanel_I2S_DMA(mxconfig);
    if (not display->begin()) {
@@ -59,9 +67,108 @@ bool DisplayService::initialize() {
      return false;
    }
    display->setBrightness(DEFAULT_BRIGHTNESS); // Set initial brightness
+   blitter.setDisplay(display, &mapper);
+
+   CalibrationSettings calibration;
+   if (!ColorCalibration::parseSettings(ConfigManager::getInstance().getConfig()[COLOR], calibration) ||
+       !setCalibration(calibration)) {
+     LOG_WARNING("DisplayService: Invalid color calibration, colors are shown uncorrected");
+     setCalibration(CalibrationSettings());
+   }
+   return true;
+}
+
+void DisplayService::loadLayout(CanvasLayout &layout) {
+   JsonVariantConst config = ConfigManager::getInstance().getConfig()[DISPLAY_LAYOUT];
+   if (config.isNull()) return;
+
+   layout.panelWidth = config[LAYOUT_PANEL_WIDTH] | layout.panelWidth;
+   layout.panelHeight = config[LAYOUT_PANEL_HEIGHT] | layout.panelHeight;
+   layout.panelsAcross = config[LAYOUT_PANELS_ACROSS] | layout.panelsAcross;
+   layout.panelsDown = config[LAYOUT_PANELS_DOWN] | layout.panelsDown;
+   layout.serpentine = config[LAYOUT_SERPENTINE] | layout.serpentine;
+
+   const char *start = config[LAYOUT_CHAIN_START] | CanvasMapper::getChainStartName(layout.chainStart);
+   if (!CanvasMapper::parseChainStart(start, layout.chainStart)) {
+     LOG_WARNING("DisplayService: Unknown chain start '%s', using %s", start,
+                 CanvasMapper::getChainStartName(layout.chainStart));
+   }
+
+   // Rotation is given in degrees
+   int rotation = config[LAYOUT_ROTATION] | 0;
+   if (rotation % 90 != 0) {
+     LOG_WARNING("DisplayService: Rotation %d is not a multiple of 90, ignored", rotation);
+     rotation = 0;
+   }
+   layout.rotation = ((rotation / 90) % 4 + 4) % 4;
+}
+
+// ============================================================================
+// Color Calibration
+// ============================================================================
+
+bool DisplayService::setCalibration(const CalibrationSettings &settings) {
+   std::lock_guard<std::mutex> lock(calibrationMutex);
+
+   // Renderers may still be reading the active tables or the ones they took
+   // before an earlier update, so neither is rebuilt
+   uint8_t active = activeCalibration;
+   uint8_t acquired = acquiredCalibration;
+   uint8_t spare = 0;
+   while (spare == active || spare == acquired) {
+     spare++;
+   }
+   if (!calibrations[spare].configure(settings, &mapper)) {
+     return false;
+   }
+   activeCalibration = spare;
+
+   JsonObject config = ConfigManager::getInstance().getConfig()[COLOR].to<JsonObject>();
+   ColorCalibration::writeSettings(settings, config);
+
+   const ColorCalibration &calibration = calibrations[spare];
+   LOG_INFO("DisplayService: Calibration %u with gamma %.2f, white point %d/%d/%d, level %d, %d zone(s)",
+            (unsigned)calibration.getVersion(), settings.color.gamma,
+            settings.color.correction[0], settings.color.correction[1],
+            settings.color.correction[2], settings.color.level, calibration.getZoneCount());
    return true;
 }
 
+const ColorCalibration &DisplayService::acquireCalibration() {
+   // Checked again after it is recorded, so a swap in between is retried
+   // rather than leaving the recorded calibration free to be rebuilt
+   uint8_t slot;
+   do {
+     slot = activeCalibration;
+     acquiredCalibration = slot;
+   } while (activeCalibration != slot);
+   return calibrations[slot];
+}
+
+void DisplayService::fillCalibrated(uint8_t r, uint8_t g, uint8_t b) {
+   const ColorCalibration &calibration = acquireCalibration();
+   uint16_t color = MatrixPanel_I2S_DMA::color565(r, g, b);
+   uint16_t line[MAX_LINE_WIDTH];
+   int16_t width = blitter.width();
+
+   // Chains wider than the line buffer are filled a buffer at a time
+   blitter.beginFrame();
+   for (int16_t y = 0; y < blitter.height(); y++) {
+     for (int16_t start = 0; start < width; start += MAX_LINE_WIDTH) {
+       int16_t chunkEnd = min((int)width, start + MAX_LINE_WIDTH);
+       for (int16_t x = start; x < chunkEnd;) {
+         int16_t runEnd;
+         uint16_t corrected = calibration.apply(color, calibration.zoneAt(x, y, runEnd));
+         int16_t end = min(runEnd, chunkEnd);
+         for (; x < end; x++) {
+           line[x - start] = corrected;
+         }
+       }
+       blitter.blitSpan(start, y, line, chunkEnd - start);
+     }
+   }
+}
+
 uint8_t DisplayService::getBrightness() {
     if (!display) {
         LOG_ERROR("Display not initialized");
@@ -94,16 +201,16 @@ void DisplayService::runTestPattern() {
    LOG_INFO("Running test pattern");
 
    if (display) {
-     // Run the test pattern
-     display->fillScreenRGB888(127, 0, 0);
+     // Run the test pattern, calibrated so panels of a wall can be compared
+     fillCalibrated(127, 0, 0);
      delay(TEST_PATTERN_DELAY_MS);
-     display->fillScreenRGB888(0, 127, 0);
+     fillCalibrated(0, 127, 0);
      delay(TEST_PATTERN_DELAY_MS);
-     display->fillScreenRGB888(0, 0, 127);
+     fillCalibrated(0, 0, 127);
      delay(TEST_PATTERN_DELAY_MS);
-     display->fillScreenRGB888(127, 127, 127);
+     fillCalibrated(127, 127, 127);
      delay(TEST_PATTERN_DELAY_MS);
-     display->fillScreenRGB888(0, 0, 0);
+     fillCalibrated(0, 0, 0);
      LOG_INFO("Test pattern completed");
    }
 }
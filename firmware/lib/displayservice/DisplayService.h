@@ -6,11 +6,22 @@
  * @brief LED matrix display service for ESP32 HUB75 LED Matrix
  *
  * Manages the LED matrix display hardware, including initialization,
- * brightness control, power management, and test patterns.
+ * brightness control, power management, and test patterns. The panels may
+ * be chained and tiled into a wall described by the "display" section of
+ * config.json; renderers draw on the virtual canvas through the blitter.
+ * Gamma, white point and per-panel gain from the "color" section are folded
+ * into the palettes renderers convert pixels with, and can be replaced at
+ * run time.
  */
 
 #include <Arduino.h>
 #include <ESP32-HUB75-MatrixPanel-I2S-DMA.h>
+#include <atomic>
+#include <mutex>
+
+#include "CanvasMapper.h"
+#include "ColorCalibration.h"
+#include "SpanBlitter.h"
 
 class DisplayService {
 public:
@@ -48,7 +59,64 @@ public:
     // =============================================================================
     MatrixPanel_I2S_DMA *getDisplay() { return display; };
 
+    /**
+     * @brief Get the span blitter writing into the display framebuffer
+     * @return Reference to the blitter
+     */
+    SpanBlitter &getBlitter() { return blitter; }
+
+    /**
+     * @brief Get the mapping from the virtual canvas onto the panel chain
+     * @return Reference to the mapper
+     */
+    const CanvasMapper &getMapper() const { return mapper; }
+
+    // =============================================================================
+    // Color Calibration
+    // =============================================================================
+
+    /**
+     * @brief Get the active calibration, to read its settings or version
+     * @return Reference to the active calibration
+     */
+    const ColorCalibration &getCalibration() const { return calibrations[activeCalibration]; }
+
+    /**
+     * @brief Take the calibration to render with
+     *
+     * Renderers take it once per frame, compare its version with the one
+     * their palettes were built for, and read it until their next call. The
+     * calibration is not rebuilt before then, however many updates arrive.
+     *
+     * @return Reference to the active calibration
+     */
+    const ColorCalibration &acquireCalibration();
+
+    /**
+     * @brief Replace the calibration without restarting playback
+     *
+     * The new tables are built beside the active ones and the ones renderers
+     * last acquired, then swapped in, so a renderer never sees a half-built
+     * calibration. The "color" section of the configuration is updated to
+     * match.
+     *
+     * @param settings New calibration
+     * @return false if the calibration cannot be applied; the old one stays
+     */
+    bool setCalibration(const CalibrationSettings &settings);
+
 private:
+    /**
+     * @brief Read the panel layout from the "display" configuration section
+     * @param layout Receives the layout, defaults for missing keys
+     */
+    void loadLayout(CanvasLayout &layout);
+
+    /**
+     * @brief Fill the canvas with one color, calibrated panel by panel
+     */
+    void fillCalibrated(uint8_t r, uint8_t g, uint8_t b);
+
     // =============================================================================
     // Private Members
     // =============================================================================
@@ -62,6 +130,12 @@ private:
 
     MatrixPanel_I2S_DMA *display;  //< Pointer to LED matrix display object
     uint8_t currentBrightness;     //< Current display brightness level
+    CanvasMapper mapper;           //< Canvas to panel chain mapping
+    SpanBlitter blitter;           //< Span writer bound to the display
+    ColorCalibration calibrations[3];           //< Active calibration, the one renderers hold and the next one
+    std::atomic<uint8_t> activeCalibration{0};  //< Index of the active calibration
+    std::atomic<uint8_t> acquiredCalibration{0}; //< Index of the calibration renderers last acquired
+    std::mutex calibrationMutex;                //< Serializes calibration updates
 };
 
 #endif // DISPLAY_SERVICE_H
\ No newline at end of file
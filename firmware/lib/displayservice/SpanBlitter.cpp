@@ -0,0 +1,261 @@
+#include "SpanBlitter.h"
+#include "Logger.h"
+
+#include <new>
+
+SpanBlitter::~SpanBlitter() {
+  setTracking(false);
+}
+
+// ============================================================================
+// Setup
+// ============================================================================
+
+void SpanBlitter::setDisplay(MatrixPanel_I2S_DMA *disp, const CanvasMapper *map) {
+  display = disp;
+  // Identity layouts skip the tables and write straight to the chain
+  mapper = (map && !map->isIdentity()) ? map : nullptr;
+  if (shadow) {
+    setTracking(true);
+  }
+}
+
+int16_t SpanBlitter::width() const {
+  if (!display) return 0;
+  return mapper ? mapper->width() : display->width();
+}
+
+int16_t SpanBlitter::height() const {
+  if (!display) return 0;
+  return mapper ? mapper->height() : display->height();
+}
+
+// ============================================================================
+// Change Tracking
+// ============================================================================
+
+/**
+ * @brief Allocate or free the panel copy, sized for the current canvas
+ */
+bool SpanBlitter::setTracking(bool enable) {
+  delete[] shadow;
+  delete[] rowFresh;
+  shadow = nullptr;
+  rowFresh = nullptr;
+  if (!enable || !display) return !enable;
+
+  size_t pixels = (size_t)width() * height();
+  shadow = new (std::nothrow) uint16_t[pixels];
+  rowFresh = new (std::nothrow) uint8_t[height()];
+  if (!shadow || !rowFresh) {
+    delete[] shadow;
+    delete[] rowFresh;
+    shadow = nullptr;
+    rowFresh = nullptr;
+    LOG_WARNING("SpanBlitter: No memory to track a %dx%d canvas", width(), height());
+    return false;
+  }
+  invalidate();
+  return true;
+}
+
+void SpanBlitter::invalidate() {
+  if (rowFresh) {
+    memset(rowFresh, 0, height());
+  }
+}
+
+/**
+ * @brief Write only the runs that differ from what the panel shows
+ */
+void SpanBlitter::writeChanged(int16_t x, int16_t y, const uint16_t *colors,
+                               int16_t length) {
+  uint16_t *copy = shadow + (size_t)y * width() + x;
+
+  if (!rowFresh[y]) {
+    // Unknown panel contents: write everything, and trust the row once all of it is known
+    writeSpan(x, y, colors, length);
+    memcpy(copy, colors, length * sizeof(uint16_t));
+    if (x == 0 && length == width()) {
+      rowFresh[y] = 1;
+    }
+    return;
+  }
+
+  // Unchanged lines of static backgrounds take one compare
+  if (memcmp(copy, colors, length * sizeof(uint16_t)) == 0) {
+    stats.skippedPixels += length;
+    stats.frameSkippedPixels += length;
+    return;
+  }
+
+  int16_t i = 0;
+  while (i < length) {
+    int16_t start = i;
+    while (i < length && copy[i] == colors[i]) i++;
+    int16_t skipped = i - start;
+    stats.skippedPixels += skipped;
+    stats.frameSkippedPixels += skipped;
+
+    start = i;
+    while (i < length && copy[i] != colors[i]) {
+      copy[i] = colors[i];
+      i++;
+    }
+    if (i > start) {
+      writeSpan(x + start, y, colors + start, i - start);
+    }
+  }
+}
+
+// ============================================================================
+// Drawing
+// ============================================================================
+
+/**
+ * @brief Write a run of RGB565 pixels, clipped to the display
+ */
+void SpanBlitter::blitSpan(int16_t x, int16_t y, const uint16_t *colors,
+                           int16_t length) {
+  if (!display || !colors || y < 0 || y >= height()) return;
+
+  if (x < 0) {
+    colors -= x;
+    length += x;
+    x = 0;
+  }
+  int16_t maxWidth = width();
+  if (x + length > maxWidth) length = maxWidth - x;
+  if (length <= 0) return;
+
+  if (shadow) {
+    writeChanged(x, y, colors, length);
+  } else {
+    writeSpan(x, y, colors, length);
+  }
+}
+
+/**
+ * @brief Split a clipped run along the row's segments on a tiled wall
+ */
+template <typename Put>
+void SpanBlitter::walkSegments(int16_t x, int16_t y, int16_t length, Put put) {
+  if (!mapper) {
+    put(x, y, 1, 0, 0, length);
+    return;
+  }
+
+  // Each segment is a straight line on one panel
+  const int16_t segmentLength = mapper->getSegmentLength();
+  const CanvasMapper::Segment *seg = mapper->row(y) + x / segmentLength;
+  int16_t offset = x % segmentLength;
+  int16_t done = 0;
+  while (done < length) {
+    int16_t run = segmentLength - offset;
+    if (run > length - done) run = length - done;
+    put(seg->x + offset * seg->dx, seg->y + offset * seg->dy, seg->dx, seg->dy, done, run);
+    done += run;
+    offset = 0;
+    seg++;
+  }
+}
+
+/**
+ * @brief Visit the pixels of a clipped run at their chain positions
+ */
+template <typename Put>
+void SpanBlitter::walkSpan(int16_t x, int16_t y, int16_t length, Put put) {
+  walkSegments(x, y, length, [&](int16_t px, int16_t py, int16_t dx, int16_t dy,
+                                 int16_t start, int16_t run) {
+    for (int16_t i = 0; i < run; i++) {
+      put(px, py, start + i);
+      px += dx;
+      py += dy;
+    }
+  });
+}
+
+void SpanBlitter::countSpan(int16_t x, int16_t y, int16_t length) {
+  stats.spans++;
+  stats.pixels += length;
+  stats.frameSpans++;
+  stats.framePixels += length;
+  stats.frameDirty.addSpan(x, y, length);
+}
+
+/**
+ * @brief Push a clipped run into the DMA framebuffer
+ */
+void SpanBlitter::writeSpan(int16_t x, int16_t y, const uint16_t *colors,
+                            int16_t length) {
+  // A stretch of one color takes one line fill, which updates the DMA
+  // buffer for the whole stretch; lone pixels skip the GFX dispatch chain
+  walkSegments(x, y, length, [&](int16_t px, int16_t py, int16_t dx, int16_t dy,
+                                 int16_t start, int16_t run) {
+    const uint16_t *segment = colors + start;
+    int16_t i = 0;
+    while (i < run) {
+      uint16_t color = segment[i];
+      int16_t same = 1;
+      while (i + same < run && segment[i + same] == color) same++;
+
+      int16_t sx = px + i * dx;
+      int16_t sy = py + i * dy;
+      if (same == 1) {
+        display->drawPixelRGB565(sx, sy, color);
+      } else if (dy == 0) {
+        display->drawFastHLine(dx < 0 ? sx - same + 1 : sx, sy, same, color);
+      } else {
+        display->drawFastVLine(sx, dy < 0 ? sy - same + 1 : sy, same, color);
+      }
+      i += same;
+    }
+  });
+  countSpan(x, y, length);
+}
+
+/**
+ * @brief Write a run of RGB888 pixels, clipped to the display
+ */
+void SpanBlitter::blitSpanRGB888(int16_t x, int16_t y, const uint8_t *rgb, int16_t length) {
+  if (!display || !rgb || y < 0 || y >= height()) return;
+
+  if (x < 0) {
+    rgb -= x * 3;
+    length += x;
+    x = 0;
+  }
+  int16_t maxWidth = width();
+  if (x + length > maxWidth) length = maxWidth - x;
+  if (length <= 0) return;
+
+  // The RGB565 copy cannot describe these pixels
+  if (rowFresh) {
+    rowFresh[y] = 0;
+  }
+  walkSpan(x, y, length, [&](int16_t px, int16_t py, int16_t i) {
+    const uint8_t *pixel = rgb + i * 3;
+    display->drawPixelRGB888(px, py, pixel[0], pixel[1], pixel[2]);
+  });
+  countSpan(x, y, length);
+}
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+void SpanBlitter::beginFrame() {
+  stats.lastFrameSpans = stats.frameSpans;
+  stats.lastFramePixels = stats.framePixels;
+  stats.lastFrameSkippedPixels = stats.frameSkippedPixels;
+  stats.lastFrameDirty = stats.frameDirty;
+  stats.frameSpans = 0;
+  stats.framePixels = 0;
+  stats.frameSkippedPixels = 0;
+  stats.frameDirty = DirtyRect();
+  stats.frames++;
+}
+
+void SpanBlitter::resetStats() {
+  stats = BlitStats();
+}
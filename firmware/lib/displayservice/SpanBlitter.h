@@ -0,0 +1,223 @@
+#ifndef SPAN_BLITTER_H
+#define SPAN_BLITTER_H
+
+/**
+ * @file SpanBlitter.h
+ * @brief Span-oriented pixel writer for the HUB75 DMA framebuffer
+ *
+ * Renderers hand whole horizontal runs of pixels to the blitter instead of
+ * issuing one virtual drawPixel() call per pixel. The DMA driver has no call
+ * taking a run of different colors, so each run is split where its color
+ * changes: stretches of one color go to the driver as a single line fill,
+ * lone pixels through its non-virtual RGB565 entry point. Coordinates are on the virtual canvas; on a tiled wall each run is split
+ * along the precomputed segments of its row in the CanvasMapper.
+ *
+ * With tracking enabled the blitter keeps a copy of what the panel shows.
+ * Incoming runs are compared with it and only the pixels that differ are
+ * written, so static backgrounds cost a compare instead of a DMA buffer
+ * update. Rows drawn past the blitter are stale until fully rewritten.
+ */
+
+#include <Arduino.h>
+#include <ESP32-HUB75-MatrixPanel-I2S-DMA.h>
+
+#include "CanvasMapper.h"
+#include "constants.h"
+
+/**
+ * @struct DirtyRect
+ * @brief Bounding box of the pixels written, end coordinates exclusive
+ */
+struct DirtyRect {
+    int16_t x0 = 0;     //< First column
+    int16_t y0 = 0;     //< First row
+    int16_t x1 = 0;     //< Column past the last
+    int16_t y1 = 0;     //< Row past the last
+
+    bool isEmpty() const { return x1 <= x0 || y1 <= y0; }
+    int16_t width() const { return isEmpty() ? 0 : x1 - x0; }
+    int16_t height() const { return isEmpty() ? 0 : y1 - y0; }
+
+    /**
+     * @brief Grow the box to cover a run of pixels on one row
+     */
+    void addSpan(int16_t x, int16_t y, int16_t length) {
+        if (isEmpty()) {
+            x0 = x;
+            y0 = y;
+            x1 = x + length;
+            y1 = y + 1;
+            return;
+        }
+        if (x < x0) x0 = x;
+        if (x + length > x1) x1 = x + length;
+        if (y < y0) y0 = y;
+        if (y + 1 > y1) y1 = y + 1;
+    }
+};
+
+/**
+ * @struct BlitStats
+ * @brief Counters describing the work done by the blitter
+ */
+struct BlitStats {
+    uint32_t frames = 0;           //< Frames started since last reset
+    uint32_t spans = 0;            //< Spans written since last reset
+    uint32_t pixels = 0;           //< Pixels written since last reset
+    uint32_t frameSpans = 0;       //< Spans written in the frame in progress
+    uint32_t framePixels = 0;      //< Pixels written in the frame in progress
+    uint32_t lastFrameSpans = 0;   //< Spans written in the last completed frame
+    uint32_t lastFramePixels = 0;  //< Pixels written in the last completed frame
+    uint32_t skippedPixels = 0;    //< Pixels left alone since last reset, the panel already showed them
+    uint32_t frameSkippedPixels = 0;     //< Pixels left alone in the frame in progress
+    uint32_t lastFrameSkippedPixels = 0; //< Pixels left alone in the last completed frame
+    DirtyRect frameDirty;          //< Area written in the frame in progress
+    DirtyRect lastFrameDirty;      //< Area written in the last completed frame
+};
+
+/**
+ * @class SpanBlitter
+ * @brief Writes horizontal pixel runs into the LED matrix framebuffer
+ */
+class SpanBlitter {
+public:
+    SpanBlitter() = default;
+    ~SpanBlitter();
+
+    SpanBlitter(const SpanBlitter&) = delete;
+    SpanBlitter& operator=(const SpanBlitter&) = delete;
+
+    // =============================================================================
+    // Setup
+    // =============================================================================
+
+    /**
+     * @brief Attach the blitter to a display
+     * @param display Pointer to the LED matrix display (may be nullptr)
+     * @param mapper Canvas layout of the display, nullptr to draw on the chain directly
+     */
+    void setDisplay(MatrixPanel_I2S_DMA *display, const CanvasMapper *mapper = nullptr);
+
+    /**
+     * @brief Get the drawable width in pixels
+     * @return Width of the canvas, 0 if no display is attached
+     */
+    int16_t width() const;
+
+    /**
+     * @brief Get the drawable height in pixels
+     * @return Height of the canvas, 0 if no display is attached
+     */
+    int16_t height() const;
+
+    // =============================================================================
+    // Change Tracking
+    // =============================================================================
+
+    /**
+     * @brief Keep a copy of the panel and skip pixels that did not change
+     *
+     * Call after setDisplay(). The copy starts out stale, so the first frame
+     * is written in full.
+     *
+     * @param enable true to track, false to write every pixel
+     * @return false if the copy could not be allocated, tracking is then off
+     */
+    bool setTracking(bool enable);
+
+    bool isTracking() const { return shadow != nullptr; }
+
+    /**
+     * @brief Forget what the panel shows after it was drawn past the blitter
+     */
+    void invalidate();
+
+    // =============================================================================
+    // Drawing
+    // =============================================================================
+
+    /**
+     * @brief Write a run of RGB565 pixels starting at (x, y)
+     *
+     * When tracking, only the pixels that differ from the panel are written.
+     *
+     * @param x Start column (may be negative, the run is clipped)
+     * @param y Row
+     * @param colors RGB565 pixels
+     * @param length Number of pixels in the run
+     */
+    void blitSpan(int16_t x, int16_t y, const uint16_t *colors, int16_t length);
+
+    /**
+     * @brief Write a run of 8-bit per channel pixels starting at (x, y)
+     *
+     * For renderers whose colors would band at RGB565, as the DMA buffer
+     * keeps 8 bits per channel. Every pixel is written; when tracking, the
+     * row's copy is marked stale.
+     *
+     * @param x Start column (may be negative, the run is clipped)
+     * @param y Row
+     * @param rgb Red, green and blue bytes of each pixel
+     * @param length Number of pixels in the run
+     */
+    void blitSpanRGB888(int16_t x, int16_t y, const uint8_t *rgb, int16_t length);
+
+    // =============================================================================
+    // Statistics
+    // =============================================================================
+
+    /**
+     * @brief Mark the start of a new frame for per-frame counters
+     */
+    void beginFrame();
+
+    /**
+     * @brief Get the blit counters
+     * @return Reference to the current statistics
+     */
+    const BlitStats &getStats() const { return stats; }
+
+    /**
+     * @brief Reset all blit counters
+     */
+    void resetStats();
+
+private:
+    /**
+     * @brief Write a clipped run to the display and count it
+     */
+    void writeSpan(int16_t x, int16_t y, const uint16_t *colors, int16_t length);
+
+    /**
+     * @brief Call put(px, py, dx, dy, start, run) for each straight piece of a clipped run
+     *
+     * Pixels start to start + run - 1 of the run lie on the chain from
+     * (px, py) onwards, one (dx, dy) step apart.
+     */
+    template <typename Put>
+    void walkSegments(int16_t x, int16_t y, int16_t length, Put put);
+
+    /**
+     * @brief Call put(px, py, i) for pixel i of a clipped run at its chain position
+     */
+    template <typename Put>
+    void walkSpan(int16_t x, int16_t y, int16_t length, Put put);
+
+    /**
+     * @brief Add a written run to the counters
+     */
+    void countSpan(int16_t x, int16_t y, int16_t length);
+
+    /**
+     * @brief Write the pixels of a clipped run that differ from the panel copy
+     */
+    void writeChanged(int16_t x, int16_t y, const uint16_t *colors, int16_t length);
+
+    MatrixPanel_I2S_DMA *display = nullptr;   //< Target display
+    const CanvasMapper *mapper = nullptr;     //< Canvas layout, nullptr when it matches the chain
+    uint16_t *shadow = nullptr;               //< What the panel shows, width() * height(), when tracking
+    uint8_t *rowFresh = nullptr;              //< Non-zero for rows whose copy matches the panel
+    BlitStats stats;                          //< Work counters
+};
+
+#endif // SPAN_BLITTER_H
@@ -3,6 +3,7 @@
 #include <cstdarg>
 #include <ArduinoJson.h>
 #include "ConfigManager.h"
+#include "constants.h"
 
 // Initialize static members
 bool FSUtils::_littlefsInitialized = false;
@@ -50,7 +51,8 @@ bool FSUtils::begin(FSType fsType) {
       int8_t sckPin = pins[PIN_SCK].as<int8_t>();
 
       SPI.begin(sckPin, misoPin, cmosiPin, csPin);
-      if (!SD.begin(csPin, SPI)) {
+      // Uploads and background tasks keep files open at the same time
+      if (!SD.begin(csPin, SPI, SD_SPI_FREQUENCY_HZ, "/sd", SD_MAX_OPEN_FILES)) {
         LOG_ERROR("Failed to initialize SD card");
         return false;
       }
@@ -1,5 +1,6 @@
 #include "PlasmaEffect.h"
 #include <FastLED.h>
+#include "DisplayService.h"
 #include "Logger.h"
 
 PlasmaEffect::PlasmaEffect()
@@ -14,6 +15,21 @@ void PlasmaEffect::initPalettes() {
     palettes[3] = RainbowStripeColors_p;
     palettes[4] = CloudColors_p;
     currentPalette = palettes[0];
+    lutVersion = 0;
+}
+
+void PlasmaEffect::buildPaletteLUT(const ColorCalibration &calibration) {
+    for (int i = 0; i < 256; i++) {
+        CRGB color = ColorFromPalette(currentPalette, i);
+        for (uint8_t zone = 0; zone < calibration.getZoneCount(); zone++) {
+            uint8_t *entry = paletteLUT[zone][i];
+            entry[0] = color.r;
+            entry[1] = color.g;
+            entry[2] = color.b;
+            calibration.getTransform(zone).applyRGB888(entry[0], entry[1], entry[2]);
+        }
+    }
+    lutVersion = calibration.getVersion();
 }
 
 void PlasmaEffect::setup() {
@@ -23,29 +39,62 @@ void PlasmaEffect::setup() {
 void PlasmaEffect::loop(MatrixPanel_I2S_DMA *display) {
     if (!display) return;
 
-    for (int x = 0; x < display->width(); x++) {
-        for (int y = 0; y < display->height(); y++) {
-            int16_t v = 128;
-            uint8_t wibble = sin8(time_counter);
-            v += sin16(x * wibble * 3 + time_counter);
-            v += cos16(y * (128 - wibble) + time_counter);
-            v += sin16(y * x * cos8(-time_counter) / 8);
+    // Draw on the virtual canvas, which may span several tiled panels
+    blitter.setDisplay(display, &DisplayService::getInstance().getMapper());
+    int width = min((int)blitter.width(), MAX_LINE_WIDTH);
+    int height = blitter.height();
+
+    // Calibration is folded into a palette per zone, rebuilt when it changes
+    const ColorCalibration &calibration = DisplayService::getInstance().acquireCalibration();
+    if (lutVersion != calibration.getVersion()) {
+        buildPaletteLUT(calibration);
+    }
+
+    // v = 128 + sin16(x * wibble * 3 + t) + cos16(y * (128 - wibble) + t) + sin16(x * y * cos8(-t) / 8)
+    // The first two terms depend on only one axis, so they are evaluated once per column or row
+    uint8_t wibble = sin8(time_counter);
+    uint8_t crossScale = cos8(-time_counter);
+    for (int x = 0; x < width; x++) {
+        columnTerms[x] = sin16(x * wibble * 3 + time_counter);
+    }
 
-            currentColor = ColorFromPalette(currentPalette, (v >> 8));
-            display->drawPixelRGB888(x, y, currentColor.r, currentColor.g, currentColor.b);
+    blitter.beginFrame();
+    for (int y = 0; y < height; y++) {
+        uint16_t rowTerm = 128 + cos16(y * (128 - wibble) + time_counter);
+        uint32_t crossStep = y * crossScale;
+        uint32_t cross = 0;  // x * y * cos8(-t), stepped along the row
+
+        for (int x = 0; x < width;) {
+            // One palette per run of panels sharing a calibration
+            int16_t runEnd;
+            const uint8_t (*lut)[3] = paletteLUT[calibration.zoneAt(x, y, runEnd)];
+            int end = min((int)runEnd, width);
+            for (; x < end; x++) {
+                // Summed modulo 2^16, like the int16_t accumulator; the palette index is the high byte
+                uint16_t v = rowTerm + columnTerms[x] + sin16(cross >> 3);
+                memcpy(lineBuffer + x * 3, lut[v >> 8], 3);
+                cross += crossStep;
+            }
         }
+        blitter.blitSpanRGB888(0, y, lineBuffer, width);
     }
 
     ++time_counter;
 
     if (time_counter >= 1024) {
         time_counter = 0;
-        currentPalette = palettes[random(0, sizeof(palettes) / sizeof(palettes[0]))];
+        // Any palette but the current one, so the colors always change
+        const uint8_t count = sizeof(palettes) / sizeof(palettes[0]);
+        currentPaletteIndex = (currentPaletteIndex + 1 + random(0, count - 1)) % count;
+        currentPalette = palettes[currentPaletteIndex];
+        lutVersion = 0;
     }
 }
 
 void PlasmaEffect::setPalette(uint8_t paletteIndex) {
     if (paletteIndex < sizeof(palettes) / sizeof(palettes[0])) {
+        currentPaletteIndex = paletteIndex;
         currentPalette = palettes[paletteIndex];
+        lutVersion = 0;
     }
-}
\ No newline at end of file
+}
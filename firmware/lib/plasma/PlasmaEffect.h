@@ -7,10 +7,18 @@
  *
  * Handles plasma effect rendering capabilities for the LED matrix,
  * including color palettes and animation loops.
+ *
+ * Frames are rendered from per-column and per-row terms evaluated once per
+ * frame and a 256-entry expansion of the current palette, then pushed row by
+ * row through a SpanBlitter. The palette keeps the 8 bits per channel of the
+ * DMA buffer, as its gradients band visibly at RGB565.
  */
 
 #include <ESP32-HUB75-MatrixPanel-I2S-DMA.h>
 #include <FastLED.h>
+#include "ColorCalibration.h"
+#include "SpanBlitter.h"
+#include "constants.h"
 
 class PlasmaEffect {
 public:
@@ -56,10 +64,18 @@ private:
     // Initialize color palettes
     void initPalettes();
 
+    // Expand currentPalette into paletteLUT, calibrated for each zone
+    void buildPaletteLUT(const ColorCalibration &calibration);
+
     uint16_t time_counter;              //< Animation time counter
-    CRGB currentColor;                  //< Current color for effects
     CRGBPalette16 palettes[5];          //< Available color palettes
     CRGBPalette16 currentPalette;       //< Currently selected palette
+    uint8_t currentPaletteIndex = 0;    //< Index of currentPalette in palettes
+    uint8_t paletteLUT[MAX_COLOR_ZONES][256][3]; //< currentPalette as RGB888 for each calibration zone
+    uint32_t lutVersion = 0;            //< Calibration version of paletteLUT, 0 when stale
+    int16_t columnTerms[MAX_LINE_WIDTH];    //< Per-column sine term of the current frame
+    uint8_t lineBuffer[MAX_LINE_WIDTH * 3]; //< Row being rendered, RGB888
+    SpanBlitter blitter;                //< Writes finished rows to the display
 };
 
 #endif // PLASMA_EFFECT_H
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include <Arduino.h>
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <random>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace {
+
+const auto startTime = std::chrono::steady_clock::now();
+std::atomic<uint64_t> skippedUs{0};  // Advanced by the presenter while the decoder reads the clock
+bool psramAvailable = false;
+bool serialMuted = false;
+std::mt19937 randomEngine;
+
+/** @brief Internal heap of an ESP32-WROOM with WiFi running */
+const uint32_t HEAP_SIZE = 320 * 1024;
+
+size_t heapInUse() {
+#ifdef __GLIBC__
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+/** @brief Host heap in use at startup, counted as the firmware's own */
+const size_t heapBaseline = heapInUse();
+
+uint64_t elapsedUs() {
+  auto elapsed = std::chrono::steady_clock::now() - startTime;
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + skippedUs;
+}
+
+String formatNumber(unsigned long long number, unsigned char base, bool negative) {
+  if (base < 2 || base > 36) base = 10;
+  char buffer[72];
+  char *p = buffer + sizeof(buffer) - 1;
+  *p = 0;
+  do {
+    unsigned digit = number % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    number /= base;
+  } while (number);
+  if (negative) *--p = '-';
+  return String(p);
+}
+
+} // namespace
+
+// =============================================================================
+// Timing
+// =============================================================================
+
+unsigned long millis() { return elapsedUs() / 1000; }
+
+unsigned long micros() { return elapsedUs(); }
+
+void delay(unsigned long ms) { skippedUs += (uint64_t)ms * 1000; }
+
+void delayMicroseconds(unsigned int us) { skippedUs += us; }
+
+void yield() {}
+
+// =============================================================================
+// Random Numbers
+// =============================================================================
+
+long random(long howBig) {
+  if (howBig <= 0) return 0;
+  return randomEngine() % howBig;
+}
+
+long random(long howSmall, long howBig) {
+  if (howSmall >= howBig) return howSmall;
+  return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) { randomEngine.seed(seed); }
+
+// =============================================================================
+// Memory
+// =============================================================================
+
+bool psramFound() { return psramAvailable; }
+
+void *ps_malloc(size_t size) { return psramAvailable ? malloc(size) : nullptr; }
+
+uint32_t EspClass::getHeapSize() { return HEAP_SIZE; }
+
+uint32_t EspClass::getFreeHeap() {
+  size_t used = heapInUse();
+  used = used > heapBaseline ? used - heapBaseline : 0;
+  return used < HEAP_SIZE ? HEAP_SIZE - used : 0;
+}
+
+// =============================================================================
+// Print and Stream
+// =============================================================================
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t written = 0;
+  while (size--) {
+    if (!write(*buffer++)) break;
+    written++;
+  }
+  return written;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len >= sizeof(buffer)) len = sizeof(buffer) - 1;
+  return write((const uint8_t *)buffer, len);
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = read();
+    if (c < 0) break;
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+String Stream::readString() {
+  String result;
+  int c;
+  while ((c = read()) >= 0) {
+    result += (char)c;
+  }
+  return result;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (!serialMuted) fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  if (!serialMuted) fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+void HardwareSerial::flush() { fflush(stdout); }
+
+// =============================================================================
+// String
+// =============================================================================
+
+String::String(int number, unsigned char base)
+    : String(formatNumber(number < 0 ? -(long long)number : number, base, number < 0)) {}
+
+String::String(unsigned int number, unsigned char base)
+    : String(formatNumber(number, base, false)) {}
+
+String::String(long number, unsigned char base)
+    : String(formatNumber(number < 0 ? -(long long)number : number, base, number < 0)) {}
+
+String::String(unsigned long number, unsigned char base)
+    : String(formatNumber(number, base, false)) {}
+
+String::String(long long number, unsigned char base)
+    : String(formatNumber(number < 0 ? -(unsigned long long)number : number, base, number < 0)) {}
+
+String::String(unsigned long long number, unsigned char base)
+    : String(formatNumber(number, base, false)) {}
+
+String::String(float number, unsigned int decimals)
+    : String((double)number, decimals) {}
+
+String::String(double number, unsigned int decimals) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+  value = buffer;
+}
+
+bool String::equalsIgnoreCase(const String &str) const {
+  if (value.size() != str.value.size()) return false;
+  for (size_t i = 0; i < value.size(); i++) {
+    if (tolower((unsigned char)value[i]) != tolower((unsigned char)str.value[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+  if (offset > value.size()) return false;
+  return value.compare(offset, prefix.value.size(), prefix.value) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  if (suffix.value.size() > value.size()) return false;
+  return value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+}
+
+String String::substring(unsigned int begin, unsigned int end) const {
+  if (begin > end) std::swap(begin, end);
+  if (begin >= value.size()) return String();
+  if (end > value.size()) end = value.size();
+  return String(value.substr(begin, end - begin));
+}
+
+void String::replace(char find, char replacement) {
+  std::replace(value.begin(), value.end(), find, replacement);
+}
+
+void String::replace(const String &find, const String &replacement) {
+  if (find.value.empty()) return;
+  size_t pos = 0;
+  while ((pos = value.find(find.value, pos)) != std::string::npos) {
+    value.replace(pos, find.value.size(), replacement.value);
+    pos += replacement.value.size();
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index >= value.size()) return;
+  value.erase(index, count);
+}
+
+void String::toLowerCase() {
+  for (char &c : value) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+  for (char &c : value) c = toupper((unsigned char)c);
+}
+
+void String::trim() {
+  size_t begin = value.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    value.clear();
+    return;
+  }
+  size_t end = value.find_last_not_of(" \t\r\n");
+  value = value.substr(begin, end - begin + 1);
+}
+
+long String::toInt() const { return atol(value.c_str()); }
+
+float String::toFloat() const { return (float)atof(value.c_str()); }
+
+double String::toDouble() const { return atof(value.c_str()); }
+
+StringSumHelper operator+(const StringSumHelper &lhs, const String &rhs) {
+  StringSumHelper &sum = const_cast<StringSumHelper &>(lhs);
+  sum.concat(rhs);
+  return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &lhs, const char *rhs) {
+  StringSumHelper &sum = const_cast<StringSumHelper &>(lhs);
+  sum.concat(rhs);
+  return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &lhs, char rhs) {
+  StringSumHelper &sum = const_cast<StringSumHelper &>(lhs);
+  sum.concat(rhs);
+  return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &lhs, int rhs) {
+  StringSumHelper &sum = const_cast<StringSumHelper &>(lhs);
+  sum.concat(rhs);
+  return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &lhs, unsigned int rhs) {
+  StringSumHelper &sum = const_cast<StringSumHelper &>(lhs);
+  sum.concat(rhs);
+  return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &lhs, long rhs) {
+  StringSumHelper &sum = const_cast<StringSumHelper &>(lhs);
+  sum.concat(rhs);
+  return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &lhs, unsigned long rhs) {
+  StringSumHelper &sum = const_cast<StringSumHelper &>(lhs);
+  sum.concat(rhs);
+  return sum;
+}
+
+// =============================================================================
+// Native Environment Controls
+// =============================================================================
+
+namespace native {
+
+void setPsram(bool available) { psramAvailable = available; }
+
+uint64_t simulatedDelayMs() { return skippedUs / 1000; }
+
+void setSerialMuted(bool muted) { serialMuted = muted; }
+
+} // namespace native
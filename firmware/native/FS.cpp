@@ -0,0 +1,252 @@
+#include <FS.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace fs {
+
+/**
+ * @class FileImpl
+ * @brief Host file or directory behind a File handle
+ */
+class FileImpl {
+public:
+  FileImpl(const std::string &fsRoot, const std::string &logicalPath,
+           const std::string &host)
+      : root(fsRoot), logical(logicalPath), hostFile(host) {
+    size_t slash = logical.find_last_of('/');
+    base = slash == std::string::npos ? logical : logical.substr(slash + 1);
+  }
+
+  ~FileImpl() { close(); }
+
+  void close() {
+    if (stream) {
+      fclose(stream);
+      stream = nullptr;
+    }
+    if (dir) {
+      closedir(dir);
+      dir = nullptr;
+    }
+  }
+
+  std::string root;       //< Host root of the owning filesystem
+  std::string logical;    //< Path on the filesystem
+  std::string base;       //< Last path component
+  std::string hostFile;   //< Path on the host
+  FILE *stream = nullptr; //< Open file
+  DIR *dir = nullptr;     //< Open directory
+};
+
+namespace {
+
+std::string joinLogical(const std::string &dir, const char *name) {
+  if (dir.empty() || dir.back() != '/') return dir + "/" + name;
+  return dir + name;
+}
+
+} // namespace
+
+// =============================================================================
+// File
+// =============================================================================
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t *buf, size_t size) {
+  if (!impl || !impl->stream) return 0;
+  return fwrite(buf, 1, size, impl->stream);
+}
+
+int File::available() {
+  if (!impl || !impl->stream) return 0;
+  return (int)(size() - position());
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  if (!impl || !impl->stream) return -1;
+  int c = fgetc(impl->stream);
+  if (c != EOF) ungetc(c, impl->stream);
+  return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+  if (impl && impl->stream) fflush(impl->stream);
+}
+
+size_t File::read(uint8_t *buf, size_t size) {
+  if (!impl || !impl->stream) return 0;
+  return fread(buf, 1, size, impl->stream);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!impl || !impl->stream) return false;
+  int whence = mode == SeekCur ? SEEK_CUR : mode == SeekEnd ? SEEK_END : SEEK_SET;
+  return fseek(impl->stream, pos, whence) == 0;
+}
+
+size_t File::position() const {
+  if (!impl || !impl->stream) return 0;
+  long pos = ftell(impl->stream);
+  return pos < 0 ? 0 : pos;
+}
+
+size_t File::size() const {
+  if (!impl || !impl->stream) return 0;
+  fflush(impl->stream);
+  struct stat st;
+  if (fstat(fileno(impl->stream), &st) != 0) return 0;
+  return st.st_size;
+}
+
+void File::close() {
+  if (impl) {
+    impl->close();
+    impl.reset();
+  }
+}
+
+File::operator bool() const { return impl && (impl->stream || impl->dir); }
+
+time_t File::getLastWrite() {
+  struct stat st;
+  if (!impl || stat(impl->hostFile.c_str(), &st) != 0) return 0;
+  return st.st_mtime;
+}
+
+const char *File::path() const { return impl ? impl->logical.c_str() : nullptr; }
+
+const char *File::name() const { return impl ? impl->base.c_str() : nullptr; }
+
+bool File::isDirectory() { return impl && impl->dir; }
+
+File File::openNextFile(const char *mode) {
+  if (!impl || !impl->dir) return File();
+
+  struct dirent *entry;
+  while ((entry = readdir(impl->dir)) != nullptr) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+    std::string logical = joinLogical(impl->logical, entry->d_name);
+    FS owner(impl->root);
+    return owner.open(logical.c_str(), mode);
+  }
+  return File();
+}
+
+void File::rewindDirectory() {
+  if (impl && impl->dir) rewinddir(impl->dir);
+}
+
+// =============================================================================
+// FS
+// =============================================================================
+
+std::string FS::hostPath(const char *path) const {
+  std::string host = root;
+  if (!path || path[0] != '/') host += '/';
+  if (path) host += path;
+  return host;
+}
+
+File FS::open(const char *path, const char *mode, const bool create) {
+  std::string host = hostPath(path);
+  FileImplPtr file = std::make_shared<FileImpl>(root, path ? path : "", host);
+
+  struct stat st;
+  bool existing = stat(host.c_str(), &st) == 0;
+  if (existing && S_ISDIR(st.st_mode)) {
+    file->dir = opendir(host.c_str());
+    return file->dir ? File(file) : File();
+  }
+
+  bool reading = mode == nullptr || mode[0] == 'r';
+  if (reading && !existing) {
+    return File();
+  }
+
+  if (!reading && create) {
+    // Create missing parent directories, as the device does on request
+    for (size_t slash = host.find('/', root.size() + 1); slash != std::string::npos;
+         slash = host.find('/', slash + 1)) {
+      ::mkdir(host.substr(0, slash).c_str(), 0755);
+    }
+  }
+
+  // Binary mode always; "r" maps to "rb", "w" to "wb", "a" to "ab"
+  std::string hostMode = mode ? mode : "r";
+  hostMode += 'b';
+  file->stream = fopen(host.c_str(), hostMode.c_str());
+  return file->stream ? File(file) : File();
+}
+
+bool FS::exists(const char *path) {
+  struct stat st;
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) { return ::unlink(hostPath(path).c_str()) == 0; }
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+  return ::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+  return ::mkdir(hostPath(path).c_str(), 0755) == 0 || exists(path);
+}
+
+bool FS::rmdir(const char *path) { return ::rmdir(hostPath(path).c_str()) == 0; }
+
+bool FS::mountRoot() {
+  for (size_t slash = root.find('/', 1); ; slash = root.find('/', slash + 1)) {
+    ::mkdir(root.substr(0, slash).c_str(), 0755);
+    if (slash == std::string::npos) break;
+  }
+  struct stat st;
+  return stat(root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+uint64_t FS::usedHostBytes() const {
+  uint64_t total = 0;
+  std::vector<std::string> pending{root};
+  while (!pending.empty()) {
+    std::string dirPath = pending.back();
+    pending.pop_back();
+    DIR *dir = opendir(dirPath.c_str());
+    if (!dir) continue;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+        continue;
+      }
+      std::string child = dirPath + "/" + entry->d_name;
+      struct stat st;
+      if (stat(child.c_str(), &st) != 0) continue;
+      if (S_ISDIR(st.st_mode)) {
+        pending.push_back(child);
+      } else {
+        total += st.st_size;
+      }
+    }
+    closedir(dir);
+  }
+  return total;
+}
+
+std::string defaultHostRoot(const char *name) {
+  const char *base = getenv("NATIVE_FS_ROOT");
+  std::string root = base && base[0] ? base : "native_fs";
+  return root + "/" + name;
+}
+
+} // namespace fs
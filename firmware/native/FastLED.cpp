@@ -0,0 +1,104 @@
+#include <FastLED.h>
+
+// =============================================================================
+// Palettes
+// =============================================================================
+
+const TProgmemRGBPalette16 CloudColors_p = {
+    0x0000FF, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B,
+    0x0000FF, 0x00008B, 0x87CEEB, 0x87CEEB, 0xADD8E6, 0xFFFFFF, 0xADD8E6, 0x87CEEB};
+
+const TProgmemRGBPalette16 LavaColors_p = {
+    0x000000, 0x800000, 0x000000, 0x800000, 0x8B0000, 0x8B0000, 0x800000, 0x8B0000,
+    0x8B0000, 0x8B0000, 0xFF0000, 0xFFA500, 0xFFFFFF, 0xFFA500, 0xFF0000, 0x8B0000};
+
+const TProgmemRGBPalette16 OceanColors_p = {
+    0x191970, 0x00008B, 0x191970, 0x000080, 0x00008B, 0x0000CD, 0x2E8B57, 0x008080,
+    0x5F9EA0, 0x0000FF, 0x008B8B, 0x6495ED, 0x7FFFD4, 0x2E8B57, 0x00FFFF, 0x87CEFA};
+
+const TProgmemRGBPalette16 ForestColors_p = {
+    0x006400, 0x006400, 0x556B2F, 0x006400, 0x008000, 0x228B22, 0x6B8E23, 0x008000,
+    0x2E8B57, 0x66CDAA, 0x32CD32, 0x9ACD32, 0x90EE90, 0x7CFC00, 0x66CDAA, 0x228B22};
+
+const TProgmemRGBPalette16 RainbowColors_p = {
+    0xFF0000, 0xD52A00, 0xAB5500, 0xAB7F00, 0xABAB00, 0x56D500, 0x00FF00, 0x00D52A,
+    0x00AB55, 0x0056AA, 0x0000FF, 0x2A00D5, 0x5500AB, 0x7F0081, 0xAB0055, 0xD5002B};
+
+const TProgmemRGBPalette16 RainbowStripeColors_p = {
+    0xFF0000, 0x000000, 0xAB5500, 0x000000, 0xABAB00, 0x000000, 0x00FF00, 0x000000,
+    0x00AB55, 0x000000, 0x0000FF, 0x000000, 0x5500AB, 0x000000, 0xAB0055, 0x000000};
+
+const TProgmemRGBPalette16 PartyColors_p = {
+    0x5500AB, 0x84007C, 0xB5004B, 0xE5001B, 0xE81700, 0xB84700, 0xAB7700, 0xABAB00,
+    0xAB5500, 0xDD2200, 0xF2000E, 0xC2003E, 0x8F0071, 0x5F00A1, 0x2F00D0, 0x0007F9};
+
+const TProgmemRGBPalette16 HeatColors_p = {
+    0x000000, 0x330000, 0x660000, 0x990000, 0xCC0000, 0xFF0000, 0xFF3300, 0xFF6600,
+    0xFF9900, 0xFFCC00, 0xFFFF00, 0xFFFF33, 0xFFFF66, 0xFFFF99, 0xFFFFCC, 0xFFFFFF};
+
+// =============================================================================
+// lib8tion
+// =============================================================================
+
+uint8_t sin8(uint8_t theta) {
+  static const uint8_t interleave[] = {0, 49, 49, 41, 90, 27, 117, 10};
+
+  uint8_t offset = theta;
+  if (theta & 0x40) offset = 255 - offset;
+  offset &= 0x3F;
+
+  uint8_t secoffset = offset & 0x0F;
+  if (theta & 0x40) secoffset++;
+
+  const uint8_t *p = interleave + (offset >> 4) * 2;
+  uint8_t b = p[0];
+  uint8_t m16 = p[1];
+  uint8_t mx = (m16 * secoffset) >> 4;
+
+  int8_t y = mx + b;
+  if (theta & 0x80) y = -y;
+  return y + 128;
+}
+
+int16_t sin16(uint16_t theta) {
+  static const uint16_t base[] = {0, 6393, 12539, 18204, 23170, 27245, 30273, 32137};
+  static const uint8_t slope[] = {49, 48, 44, 38, 31, 23, 14, 4};
+
+  uint16_t offset = (theta & 0x3FFF) >> 3;
+  if (theta & 0x4000) offset = 2047 - offset;
+
+  uint8_t section = offset / 256;
+  uint8_t secoffset8 = (uint8_t)offset / 2;
+  uint16_t mx = slope[section] * secoffset8;
+
+  int16_t y = mx + base[section];
+  if (theta & 0x8000) y = -y;
+  return y;
+}
+
+CRGB ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t brightness,
+                      TBlendType blendType) {
+  uint8_t hi4 = index >> 4;
+  uint8_t lo4 = index & 0x0F;
+
+  const CRGB &entry = pal[hi4];
+  uint8_t red = entry.r;
+  uint8_t green = entry.g;
+  uint8_t blue = entry.b;
+
+  if (lo4 && blendType != NOBLEND) {
+    const CRGB &next = pal[(hi4 + 1) & 0x0F];
+    uint8_t f2 = lo4 << 4;
+    uint8_t f1 = 255 - f2;
+    red = scale8(red, f1) + scale8(next.r, f2);
+    green = scale8(green, f1) + scale8(next.g, f2);
+    blue = scale8(blue, f1) + scale8(next.b, f2);
+  }
+
+  if (brightness != 255) {
+    red = scale8(red, brightness);
+    green = scale8(green, brightness);
+    blue = scale8(blue, brightness);
+  }
+  return CRGB(red, green, blue);
+}
@@ -0,0 +1,32 @@
+#include <LittleFS.h>
+
+#include <string>
+
+namespace fs {
+
+/** @brief Partition size of the default 4 MB flash layout */
+static const size_t LITTLEFS_PARTITION_BYTES = 1408 * 1024;
+
+LittleFSFS::LittleFSFS() : FS(defaultHostRoot("littlefs")) {}
+
+bool LittleFSFS::begin(bool formatOnFail, const char *basePath,
+                       uint8_t maxOpenFiles, const char *partitionLabel) {
+  (void)formatOnFail;
+  (void)basePath;
+  (void)maxOpenFiles;
+  (void)partitionLabel;
+  return mountRoot();
+}
+
+bool LittleFSFS::format() {
+  std::string command = "rm -rf '" + root + "'";
+  return system(command.c_str()) == 0 && mountRoot();
+}
+
+size_t LittleFSFS::totalBytes() { return LITTLEFS_PARTITION_BYTES; }
+
+size_t LittleFSFS::usedBytes() { return usedHostBytes(); }
+
+} // namespace fs
+
+fs::LittleFSFS LittleFS;
@@ -0,0 +1,33 @@
+#include <SD.h>
+
+SPIClass SPI;
+
+namespace fs {
+
+/** @brief Capacity reported for the emulated card */
+static const uint64_t SD_CARD_BYTES = 4ULL * 1024 * 1024 * 1024;
+
+SDFS::SDFS() : FS(defaultHostRoot("sd")) {}
+
+bool SDFS::begin(uint8_t ssPin, SPIClass &spi, uint32_t frequency,
+                 const char *mountpoint, uint8_t maxFiles, bool formatIfEmpty) {
+  (void)ssPin;
+  (void)spi;
+  (void)frequency;
+  (void)mountpoint;
+  (void)maxFiles;
+  (void)formatIfEmpty;
+  return mountRoot();
+}
+
+sdcard_type_t SDFS::cardType() { return CARD_SDHC; }
+
+uint64_t SDFS::cardSize() { return SD_CARD_BYTES; }
+
+uint64_t SDFS::totalBytes() { return SD_CARD_BYTES; }
+
+uint64_t SDFS::usedBytes() { return usedHostBytes(); }
+
+} // namespace fs
+
+fs::SDFS SD;
@@ -0,0 +1,162 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the ESP32 Arduino core used by the native environment
+ *
+ * Provides the subset of the core the firmware libraries rely on. Time comes
+ * from the host's monotonic clock, except that delay() advances a simulated
+ * offset instead of sleeping, so paced playback runs at decode speed.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "WString.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define memcpy_P memcpy
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+using std::max;
+using std::min;
+
+// =============================================================================
+// Timing
+// =============================================================================
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// =============================================================================
+// Random Numbers
+// =============================================================================
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+// =============================================================================
+// Memory
+// =============================================================================
+bool psramFound();
+void *ps_malloc(size_t size);
+
+/**
+ * @class EspClass
+ * @brief Heap figures of the ESP32 core
+ *
+ * The host heap is reported as a heap of ESP32 size, less what the process
+ * allocated since startup (glibc only; elsewhere it stays free).
+ */
+class EspClass {
+public:
+    uint32_t getHeapSize();
+    uint32_t getFreeHeap();
+};
+
+extern EspClass ESP;
+
+// =============================================================================
+// Print and Stream
+// =============================================================================
+
+/**
+ * @class Print
+ * @brief Byte sink with text helpers
+ */
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n) { return print(String(n)); }
+    size_t print(unsigned int n) { return print(String(n)); }
+    size_t print(long n) { return print(String(n)); }
+    size_t print(unsigned long n) { return print(String(n)); }
+    size_t print(double n, int digits = 2) { return print(String(n, digits)); }
+    size_t println() { return write((uint8_t)'\n'); }
+    template <typename T>
+    size_t println(const T &value) { return print(value) + println(); }
+    size_t printf(const char *format, ...);
+    virtual void flush() {}
+};
+
+/**
+ * @class Stream
+ * @brief Byte source with bulk reads, as consumed by ArduinoJson
+ */
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    String readString();
+};
+
+/**
+ * @class HardwareSerial
+ * @brief Serial port writing to the host's standard output
+ */
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    void flush() override;
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// =============================================================================
+// Native Environment Controls
+// =============================================================================
+namespace native {
+
+/**
+ * @brief Make psramFound() report PSRAM, as on WROVER boards
+ * @param available true to emulate a board with PSRAM
+ */
+void setPsram(bool available);
+
+/**
+ * @brief Total time skipped by delay() calls so far
+ * @return Simulated milliseconds
+ */
+uint64_t simulatedDelayMs();
+
+/**
+ * @brief Suppress Serial output, e.g. while a benchmark is timing
+ * @param muted true to drop everything written to Serial
+ */
+void setSerialMuted(bool muted);
+
+} // namespace native
+
+#endif // NATIVE_ARDUINO_H
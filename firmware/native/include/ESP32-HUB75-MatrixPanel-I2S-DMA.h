@@ -0,0 +1,178 @@
+#ifndef NATIVE_MATRIX_PANEL_H
+#define NATIVE_MATRIX_PANEL_H
+
+/**
+ * @file ESP32-HUB75-MatrixPanel-I2S-DMA.h
+ * @brief In-memory MatrixPanel_I2S_DMA for the native environment
+ *
+ * Mirrors the drawing API of the HUB75 DMA library but records into an
+ * RGB565 framebuffer, so rendering code can be profiled and its output
+ * inspected on the host. Pixel writes and drawing calls are counted to
+ * compare draw paths.
+ * The driver keeps 8 bits per channel, so an RGB888 copy is recorded too,
+ * with RGB565 writes expanded by color565to888().
+ */
+
+#include <Arduino.h>
+#include <vector>
+
+/**
+ * @struct HUB75_I2S_CFG
+ * @brief Panel geometry and wiring, as passed to the real driver
+ */
+struct HUB75_I2S_CFG {
+    struct i2s_pins {
+        int8_t r1, g1, b1, r2, g2, b2, a, b, c, d, e, lat, oe, clk;
+    };
+
+    enum shift_driver { SHIFTREG = 0, FM6124, FM6126A, ICN2038S, MBI5124, SM5266P, DP3246_SM5368 };
+    enum clk_speed { HZ_8M = 8000000, HZ_10M = 10000000, HZ_15M = 15000000, HZ_20M = 20000000 };
+
+    uint16_t mx_width;          //< Width of one panel
+    uint16_t mx_height;         //< Height of one panel
+    uint16_t chain_length;      //< Number of chained panels
+    i2s_pins gpio;              //< Pin mapping
+    shift_driver driver;        //< Panel shift register type
+    bool double_buff;           //< Double buffering
+    clk_speed i2sspeed;         //< Output clock
+    uint8_t latch_blanking;     //< Blanking cycles around latch
+    bool clkphase;              //< Clock phase
+    uint16_t min_refresh_rate;  //< Minimum refresh rate
+
+    HUB75_I2S_CFG(uint16_t width = 64, uint16_t height = 32, uint16_t chain = 1,
+                  i2s_pins pinmap = {},
+                  shift_driver drv = SHIFTREG, bool dbuff = false,
+                  clk_speed speed = HZ_8M, uint8_t latblk = 2, bool phase = true,
+                  uint16_t minRefresh = 60)
+        : mx_width(width), mx_height(height), chain_length(chain), gpio(pinmap),
+          driver(drv), double_buff(dbuff), i2sspeed(speed), latch_blanking(latblk),
+          clkphase(phase), min_refresh_rate(minRefresh) {}
+};
+
+/**
+ * @class MatrixPanel_I2S_DMA
+ * @brief HUB75 panel rendering into host memory
+ */
+class MatrixPanel_I2S_DMA {
+public:
+    explicit MatrixPanel_I2S_DMA(const HUB75_I2S_CFG &opts)
+        : config(opts),
+          panelWidth(opts.mx_width * opts.chain_length),
+          panelHeight(opts.mx_height) {}
+    virtual ~MatrixPanel_I2S_DMA() = default;
+
+    // =============================================================================
+    // Lifecycle
+    // =============================================================================
+    bool begin() {
+        framebuffer.assign((size_t)panelWidth * panelHeight, 0);
+        framebuffer888.assign((size_t)panelWidth * panelHeight, 0);
+        return true;
+    }
+
+    void setBrightness(uint8_t b) { brightness = b; }
+    void setBrightness8(uint8_t b) { brightness = b; }
+    void flipDMABuffer() {}
+
+    // =============================================================================
+    // Drawing
+    // =============================================================================
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) { drawPixelRGB565(x, y, color); }
+
+    inline void drawPixelRGB565(int16_t x, int16_t y, uint16_t color) {
+        drawCalls++;
+        store(x, y, color, to888(color));
+    }
+
+    inline void drawPixelRGB888(int16_t x, int16_t y, uint8_t r, uint8_t g, uint8_t b) {
+        drawCalls++;
+        store(x, y, color565(r, g, b), pack888(r, g, b));
+    }
+
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+        drawCalls++;
+        uint32_t color888 = to888(color);
+        for (int16_t i = 0; i < w; i++) store(x + i, y, color, color888);
+    }
+
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+        drawCalls++;
+        uint32_t color888 = to888(color);
+        for (int16_t i = 0; i < h; i++) store(x, y + i, color, color888);
+    }
+
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        drawCalls++;
+        uint32_t color888 = to888(color);
+        for (int16_t j = 0; j < h; j++) {
+            for (int16_t i = 0; i < w; i++) store(x + i, y + j, color, color888);
+        }
+    }
+
+    void fillScreen(uint16_t color) {
+        uint8_t r, g, b;
+        color565to888(color, r, g, b);
+        std::fill(framebuffer.begin(), framebuffer.end(), color);
+        std::fill(framebuffer888.begin(), framebuffer888.end(), pack888(r, g, b));
+    }
+    void fillScreenRGB888(uint8_t r, uint8_t g, uint8_t b) {
+        std::fill(framebuffer.begin(), framebuffer.end(), color565(r, g, b));
+        std::fill(framebuffer888.begin(), framebuffer888.end(), pack888(r, g, b));
+    }
+    void clearScreen() { fillScreen(0); }
+
+    static uint16_t color565(uint8_t r, uint8_t g, uint8_t b) {
+        return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    }
+
+    static void color565to888(uint16_t color, uint8_t &r, uint8_t &g, uint8_t &b) {
+        r = ((color >> 11) & 0x1F) << 3;
+        g = ((color >> 5) & 0x3F) << 2;
+        b = (color & 0x1F) << 3;
+    }
+
+    int16_t width() const { return panelWidth; }
+    int16_t height() const { return panelHeight; }
+    const HUB75_I2S_CFG &getCfg() const { return config; }
+
+    // =============================================================================
+    // Native Environment Controls
+    // =============================================================================
+    const uint16_t *getFramebuffer() const { return framebuffer.data(); }
+    uint16_t getPixel(int16_t x, int16_t y) const { return framebuffer[(size_t)y * panelWidth + x]; }
+    const uint32_t *getFramebufferRGB888() const { return framebuffer888.data(); }
+    uint8_t getBrightness() const { return brightness; }
+    uint64_t getPixelWrites() const { return pixelWrites; }
+    uint64_t getDrawCalls() const { return drawCalls; }
+    void resetPixelWrites() {
+        pixelWrites = 0;
+        drawCalls = 0;
+    }
+
+private:
+    static uint32_t pack888(uint8_t r, uint8_t g, uint8_t b) { return (r << 16) | (g << 8) | b; }
+
+    static uint32_t to888(uint16_t color) {
+        uint8_t r, g, b;
+        color565to888(color, r, g, b);
+        return pack888(r, g, b);
+    }
+
+    void store(int16_t x, int16_t y, uint16_t color, uint32_t color888) {
+        pixelWrites++;
+        if (x < 0 || y < 0 || x >= panelWidth || y >= panelHeight || framebuffer.empty()) return;
+        framebuffer[(size_t)y * panelWidth + x] = color;
+        framebuffer888[(size_t)y * panelWidth + x] = color888;
+    }
+
+    HUB75_I2S_CFG config;               //< Configuration passed at construction
+    int16_t panelWidth;                 //< Width of the whole chain
+    int16_t panelHeight;                //< Height of the chain
+    std::vector<uint16_t> framebuffer;  //< RGB565 pixels, row-major
+    std::vector<uint32_t> framebuffer888; //< The same pixels at the driver's depth, 0xRRGGBB
+    uint8_t brightness = 0;             //< Last brightness set
+    uint64_t pixelWrites = 0;           //< Pixel writes, including clipped ones
+    uint64_t drawCalls = 0;             //< Drawing calls, a line or fill counting once
+};
+
+#endif // NATIVE_MATRIX_PANEL_H
@@ -0,0 +1,154 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+/**
+ * @file FS.h
+ * @brief POSIX-backed implementation of the ESP32 fs::FS and fs::File classes
+ *
+ * Each filesystem maps its paths onto a directory of the host, so LittleFS
+ * and SD content can be prepared with ordinary tools before a native run.
+ */
+
+#include <Arduino.h>
+#include <ctime>
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+/**
+ * @class File
+ * @brief Open file or directory handle
+ *
+ * Copies share the same underlying handle, as on the device.
+ */
+class File : public Stream {
+public:
+    File(FileImplPtr p = FileImplPtr()) : impl(p) {}
+
+    // =============================================================================
+    // Stream Interface
+    // =============================================================================
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+
+    size_t read(uint8_t *buf, size_t size);
+    size_t readBytes(char *buffer, size_t length) { return read((uint8_t *)buffer, length); }
+
+    // =============================================================================
+    // File Interface
+    // =============================================================================
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char *path() const;
+    const char *name() const;
+
+    // =============================================================================
+    // Directory Interface
+    // =============================================================================
+    bool isDirectory();
+    File openNextFile(const char *mode = FILE_READ);
+    void rewindDirectory();
+
+private:
+    FileImplPtr impl;   //< Shared host handle
+};
+
+/**
+ * @class FS
+ * @brief Filesystem rooted at a host directory
+ */
+class FS {
+public:
+    explicit FS(const std::string &hostRoot = std::string()) : root(hostRoot) {}
+
+    File open(const char *path, const char *mode = FILE_READ, const bool create = false);
+    File open(const String &path, const char *mode = FILE_READ, const bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+
+    bool rename(const char *pathFrom, const char *pathTo);
+    bool rename(const String &pathFrom, const String &pathTo) {
+        return rename(pathFrom.c_str(), pathTo.c_str());
+    }
+
+    bool mkdir(const char *path);
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+
+    bool rmdir(const char *path);
+    bool rmdir(const String &path) { return rmdir(path.c_str()); }
+
+    // =============================================================================
+    // Native Environment Controls
+    // =============================================================================
+
+    /**
+     * @brief Point the filesystem at another host directory
+     * @param hostRoot Host directory that holds the filesystem's root
+     */
+    void setRoot(const std::string &hostRoot) { root = hostRoot; }
+    const std::string &getRoot() const { return root; }
+
+protected:
+    /**
+     * @brief Translate a filesystem path to a host path
+     * @param path Absolute path on this filesystem
+     * @return Path on the host
+     */
+    std::string hostPath(const char *path) const;
+
+    /**
+     * @brief Create the root directory and report usage of the host tree
+     * @return true if the root exists
+     */
+    bool mountRoot();
+    uint64_t usedHostBytes() const;
+
+    std::string root;   //< Host directory backing this filesystem
+};
+
+/**
+ * @brief Default host directory for a filesystem, below $NATIVE_FS_ROOT or ./native_fs
+ * @param name Subdirectory name
+ * @return Host directory
+ */
+std::string defaultHostRoot(const char *name);
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
+
+#endif // NATIVE_FS_H
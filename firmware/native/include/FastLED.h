@@ -0,0 +1,78 @@
+#ifndef NATIVE_FASTLED_H
+#define NATIVE_FASTLED_H
+
+/**
+ * @file FastLED.h
+ * @brief Colour and lib8tion subset of FastLED for the native environment
+ *
+ * The trigonometry uses the same piecewise-linear approximations as
+ * FastLED's portable C versions, so effect code does the same amount of
+ * work per pixel as on the device. Palette colours are close approximations.
+ */
+
+#include <Arduino.h>
+
+/**
+ * @struct CRGB
+ * @brief 24-bit RGB colour
+ */
+struct CRGB {
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+
+    CRGB() = default;
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+    CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+
+    bool operator==(const CRGB &rhs) const { return r == rhs.r && g == rhs.g && b == rhs.b; }
+};
+
+typedef uint32_t TProgmemRGBPalette16[16];
+
+/**
+ * @class CRGBPalette16
+ * @brief 16-entry gradient palette
+ */
+class CRGBPalette16 {
+public:
+    CRGBPalette16() = default;
+    CRGBPalette16(const TProgmemRGBPalette16 &rhs) {
+        for (uint8_t i = 0; i < 16; i++) entries[i] = CRGB(rhs[i]);
+    }
+
+    CRGB &operator[](uint8_t i) { return entries[i]; }
+    const CRGB &operator[](uint8_t i) const { return entries[i]; }
+
+    CRGB entries[16];   //< Palette colours
+};
+
+enum TBlendType {
+    NOBLEND = 0,
+    LINEARBLEND = 1
+};
+
+extern const TProgmemRGBPalette16 CloudColors_p;
+extern const TProgmemRGBPalette16 LavaColors_p;
+extern const TProgmemRGBPalette16 OceanColors_p;
+extern const TProgmemRGBPalette16 ForestColors_p;
+extern const TProgmemRGBPalette16 RainbowColors_p;
+extern const TProgmemRGBPalette16 RainbowStripeColors_p;
+extern const TProgmemRGBPalette16 PartyColors_p;
+extern const TProgmemRGBPalette16 HeatColors_p;
+
+// =============================================================================
+// lib8tion
+// =============================================================================
+
+inline uint8_t scale8(uint8_t i, uint8_t scale) { return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8; }
+
+uint8_t sin8(uint8_t theta);
+int16_t sin16(uint16_t theta);
+inline uint8_t cos8(uint8_t theta) { return sin8(theta + 64); }
+inline int16_t cos16(uint16_t theta) { return sin16(theta + 16384); }
+
+CRGB ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t brightness = 255,
+                      TBlendType blendType = LINEARBLEND);
+
+#endif // NATIVE_FASTLED_H
@@ -0,0 +1,33 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+/**
+ * @file LittleFS.h
+ * @brief Host-directory LittleFS for the native environment
+ */
+
+#include "FS.h"
+
+namespace fs {
+
+/**
+ * @class LittleFSFS
+ * @brief LittleFS partition backed by a host directory
+ */
+class LittleFSFS : public FS {
+public:
+    LittleFSFS();
+
+    bool begin(bool formatOnFail = false, const char *basePath = "/littlefs",
+               uint8_t maxOpenFiles = 10, const char *partitionLabel = "spiffs");
+    bool format();
+    size_t totalBytes();
+    size_t usedBytes();
+    void end() {}
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif // NATIVE_LITTLEFS_H
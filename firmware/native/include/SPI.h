@@ -0,0 +1,27 @@
+#ifndef NATIVE_SPI_H
+#define NATIVE_SPI_H
+
+/**
+ * @file SPI.h
+ * @brief No-op SPI bus for the native environment
+ */
+
+#include <Arduino.h>
+
+#define SS 5
+
+/**
+ * @class SPIClass
+ * @brief SPI bus whose pin setup is accepted and ignored
+ */
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+        (void)sck; (void)miso; (void)mosi; (void)ss;
+    }
+    void end() {}
+};
+
+extern SPIClass SPI;
+
+#endif // NATIVE_SPI_H
@@ -0,0 +1,152 @@
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+/**
+ * @file WString.h
+ * @brief Host implementation of the Arduino String class
+ *
+ * Backed by std::string. Only the members used by the firmware libraries
+ * and by ArduinoJson's String adapter are provided.
+ */
+
+#include <cstddef>
+#include <string>
+
+class StringSumHelper;
+
+/**
+ * @class String
+ * @brief Arduino-compatible dynamic string
+ */
+class String {
+public:
+    // =============================================================================
+    // Construction
+    // =============================================================================
+    String(const char *cstr = "") : value(cstr ? cstr : "") {}
+    String(const char *cstr, size_t length) : value(cstr ? std::string(cstr, length) : "") {}
+    String(const std::string &str) : value(str) {}
+    explicit String(char c) : value(1, c) {}
+    explicit String(int number, unsigned char base = 10);
+    explicit String(unsigned int number, unsigned char base = 10);
+    explicit String(long number, unsigned char base = 10);
+    explicit String(unsigned long number, unsigned char base = 10);
+    explicit String(long long number, unsigned char base = 10);
+    explicit String(unsigned long long number, unsigned char base = 10);
+    explicit String(float number, unsigned int decimals = 2);
+    explicit String(double number, unsigned int decimals = 2);
+
+    String &operator=(const char *cstr) { value = cstr ? cstr : ""; return *this; }
+
+    // =============================================================================
+    // Access
+    // =============================================================================
+    const char *c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.size(); }
+    bool isEmpty() const { return value.empty(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+    char charAt(unsigned int index) const { return index < value.size() ? value[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if (index < value.size()) value[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index) { return value[index]; }
+
+    // =============================================================================
+    // Concatenation
+    // =============================================================================
+    bool concat(const String &str) { value += str.value; return true; }
+    bool concat(const char *cstr) { if (!cstr) return false; value += cstr; return true; }
+    bool concat(const char *cstr, unsigned int length) { if (!cstr) return false; value.append(cstr, length); return true; }
+    bool concat(char c) { value += c; return true; }
+    bool concat(int number) { return concat(String(number)); }
+    bool concat(unsigned int number) { return concat(String(number)); }
+    bool concat(long number) { return concat(String(number)); }
+    bool concat(unsigned long number) { return concat(String(number)); }
+    bool concat(double number) { return concat(String(number)); }
+
+    template <typename T>
+    String &operator+=(const T &rhs) { concat(rhs); return *this; }
+
+    friend StringSumHelper operator+(const StringSumHelper &lhs, const String &rhs);
+    friend StringSumHelper operator+(const StringSumHelper &lhs, const char *rhs);
+    friend StringSumHelper operator+(const StringSumHelper &lhs, char rhs);
+    friend StringSumHelper operator+(const StringSumHelper &lhs, int rhs);
+    friend StringSumHelper operator+(const StringSumHelper &lhs, unsigned int rhs);
+    friend StringSumHelper operator+(const StringSumHelper &lhs, long rhs);
+    friend StringSumHelper operator+(const StringSumHelper &lhs, unsigned long rhs);
+
+    // =============================================================================
+    // Comparison
+    // =============================================================================
+    int compareTo(const String &str) const { return value.compare(str.value); }
+    bool equals(const String &str) const { return value == str.value; }
+    bool equals(const char *cstr) const { return value == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String &str) const;
+    bool startsWith(const String &prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+    bool startsWith(const String &prefix, unsigned int offset) const;
+    bool endsWith(const String &suffix) const;
+
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+    bool operator>(const String &rhs) const { return compareTo(rhs) > 0; }
+    bool operator<=(const String &rhs) const { return compareTo(rhs) <= 0; }
+    bool operator>=(const String &rhs) const { return compareTo(rhs) >= 0; }
+
+    // =============================================================================
+    // Search
+    // =============================================================================
+    int indexOf(char c, unsigned int from = 0) const { return toIndex(value.find(c, from)); }
+    int indexOf(const String &str, unsigned int from = 0) const { return toIndex(value.find(str.value, from)); }
+    int lastIndexOf(char c) const { return toIndex(value.rfind(c)); }
+    int lastIndexOf(char c, unsigned int from) const { return toIndex(value.rfind(c, from)); }
+    int lastIndexOf(const String &str) const { return toIndex(value.rfind(str.value)); }
+    int lastIndexOf(const String &str, unsigned int from) const { return toIndex(value.rfind(str.value, from)); }
+
+    String substring(unsigned int begin) const { return substring(begin, value.size()); }
+    String substring(unsigned int begin, unsigned int end) const;
+
+    // =============================================================================
+    // Modification
+    // =============================================================================
+    void replace(char find, char replacement);
+    void replace(const String &find, const String &replacement);
+    void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    // =============================================================================
+    // Conversion
+    // =============================================================================
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    std::string value;  //< Character storage
+};
+
+/**
+ * @class StringSumHelper
+ * @brief Temporary produced by String concatenation, as in the Arduino core
+ */
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String &s) : String(s) {}
+    StringSumHelper(const char *p) : String(p) {}
+    StringSumHelper(char c) : String(c) {}
+    StringSumHelper(int num) : String(num) {}
+    StringSumHelper(unsigned int num) : String(num) {}
+    StringSumHelper(long num) : String(num) {}
+    StringSumHelper(unsigned long num) : String(num) {}
+};
+
+inline bool operator==(const char *lhs, const String &rhs) { return rhs == lhs; }
+inline bool operator!=(const char *lhs, const String &rhs) { return rhs != lhs; }
+
+#endif // NATIVE_WSTRING_H
@@ -46,6 +46,9 @@
  */
 TaskHandle_t arduinoOTATaskHandle = nullptr;
 TaskHandle_t displayTaskHandle = nullptr;
+TaskHandle_t decoderTaskHandle = nullptr;
+TaskHandle_t indexTaskHandle = nullptr;
+TaskHandle_t stagingTaskHandle = nullptr;
 
 // Service class constructor and destructor
 Service::Service() : webServer(nullptr) {
@@ -66,6 +69,24 @@ Service::~Service() {
         LOG_INFO("Display task cleaned up");
     }
 
+    if (decoderTaskHandle != nullptr) {
+        vTaskDelete(decoderTaskHandle);
+        decoderTaskHandle = nullptr;
+        LOG_INFO("Decoder task cleaned up");
+    }
+
+    if (indexTaskHandle != nullptr) {
+        vTaskDelete(indexTaskHandle);
+        indexTaskHandle = nullptr;
+        LOG_INFO("Index task cleaned up");
+    }
+
+    if (stagingTaskHandle != nullptr) {
+        vTaskDelete(stagingTaskHandle);
+        stagingTaskHandle = nullptr;
+        LOG_INFO("Staging task cleaned up");
+    }
+
     // Clean up web server if it was allocated
     if (webServer != nullptr) {
         delete webServer;
@@ -98,7 +119,9 @@ void Service::arduinoOTATask(void* parameter) {
  * This FreeRTOS task runs continuously to update the LED matrix display
  * with GIF animations. It reads state from state.json and uses those values
  * to control playback. It runs on CPU core 1 with higher priority for
- * smooth animation performance.
+ * smooth animation performance. When the frame pipeline is enabled it starts
+ * the decoder task once the state is loaded and only presents the frames it
+ * produces; if the decoder cannot be started it plays GIFs itself.
  *
  * @param parameter Unused task parameter
  */
@@ -115,10 +138,79 @@ void Service::displayTask(void* pvParameters) {
   // Load state from file using the AnimatedGIFPanel method
   gifPanel.loadStateFromFile();
 
+  // The decoder starts only now, so it never picks a GIF before the state is applied
+  if (gifPanel.isPipelineEnabled() &&
+      createBackgroundTask(decoderTask, "DECODER_Task", DECODE_TASK_STACK_SIZE, NULL,
+                           DECODE_TASK_PRIORITY, &decoderTaskHandle, 0)) {
+    while (true) {
+      gifPanel.presentTask();
+    }
+  }
+
+  while (true) {
+    if (!gifPanel.playbackTask()) {
+      // Display off or nothing playable - check again later
+      vTaskDelay(DISPLAY_UPDATE_INTERVAL_MS / portTICK_PERIOD_MS);
+    }
+  }
+}
+
+/**
+ * @brief GIF decoder background task
+ *
+ * Decodes GIF frames ahead of time into the frame pipeline on CPU core 0,
+ * leaving core 1 free to present them at their deadlines. Started by the
+ * display task, and the only task that opens or closes GIFs while it runs.
+ *
+ * @param parameter Unused task parameter
+ */
+void Service::decoderTask(void* pvParameters) {
+  AnimatedGIFPanel& gifPanel = AnimatedGIFPanel::getInstance();
+
+  while (true) {
+    if (!gifPanel.decodeTask()) {
+      // Display off or nothing playable - check again later
+      vTaskDelay(DISPLAY_UPDATE_INTERVAL_MS / portTICK_PERIOD_MS);
+    }
+  }
+}
+
+/**
+ * @brief Category index validation task
+ *
+ * Waits for boot and the first GIFs to settle, then runs rescan jobs as they
+ * are queued: the boot-time check first, then rescans requested through the
+ * web API. A check is repeated if GIFs were uploaded or deleted while it ran.
+ *
+ * @param parameter Unused task parameter
+ */
+void Service::indexTask(void* pvParameters) {
+  AnimatedGIFPanel& gifPanel = AnimatedGIFPanel::getInstance();
+
+  vTaskDelay(INDEX_VALIDATE_DELAY_MS / portTICK_PERIOD_MS);
+  while (true) {
+    gifPanel.waitForRescan();
+    while (!gifPanel.maintainIndex()) {
+      vTaskDelay(INDEX_RETRY_DELAY_MS / portTICK_PERIOD_MS);
+    }
+  }
+}
+
+/**
+ * @brief GIF staging task
+ *
+ * Copies the most played GIFs from the SD card into flash one at a time,
+ * and looks again every few seconds once there is nothing left to copy.
+ *
+ * @param parameter Unused task parameter
+ */
+void Service::stagingTask(void* pvParameters) {
+  AnimatedGIFPanel& gifPanel = AnimatedGIFPanel::getInstance();
+
   while (true) {
-    gifPanel.playbackTask();
-    // The playback is now handled internally by AnimatedGIFPanel
-    vTaskDelay(DISPLAY_UPDATE_INTERVAL_MS / portTICK_PERIOD_MS);
+    if (!gifPanel.maintainStaging()) {
+      vTaskDelay(STAGING_CHECK_INTERVAL_MS / portTICK_PERIOD_MS);
+    }
   }
 }
 
@@ -187,6 +279,19 @@ bool Service::setupBackgroundTasks() {
                            &displayTaskHandle, 1)) {
     return false;
   }
+
+  // Check the category index against the card and run requested rescans on core 0 at idle priority
+  if (!createBackgroundTask(indexTask, "INDEX_Task", INDEX_TASK_STACK_SIZE, NULL, INDEX_TASK_PRIORITY,
+                            &indexTaskHandle, 0)) {
+    return false;
+  }
+
+  // Copy frequently played GIFs into flash on core 0 at idle priority
+  if (AnimatedGIFPanel::getInstance().isStagingEnabled() &&
+      !createBackgroundTask(stagingTask, "STAGING_Task", STAGING_TASK_STACK_SIZE, NULL,
+                            STAGING_TASK_PRIORITY, &stagingTaskHandle, 0)) {
+    return false;
+  }
   return true;
 }
 
@@ -36,12 +36,15 @@ private:
 
     // Background task setup
     bool setupBackgroundTasks();
-    bool createBackgroundTask(TaskFunction_t taskFunction, const char* taskName,
+    static bool createBackgroundTask(TaskFunction_t taskFunction, const char* taskName,
                             uint32_t stackSize, void* taskParameter, UBaseType_t priority,
                             TaskHandle_t* taskHandle, BaseType_t coreId);
     void taskStatus(BaseType_t displayResult);
     static void arduinoOTATask(void *parameter);
     static void displayTask(void *parameter);
+    static void decoderTask(void *parameter);
+    static void indexTask(void *parameter);
+    static void stagingTask(void *parameter);
 };
 
 #endif // SERVICE_H
\ No newline at end of file
@@ -1,6 +1,9 @@
+#include <AsyncJson.h>
+
 #include "AnimatedGIFPanel.h"
 #include "constants.h"
 #include "FSUtils.h"
+#include "GIFUploadSessions.h"
 #include "WebService.h"
 #include "Logger.h"
 
@@ -9,6 +12,8 @@ AsyncWebServer server(DEFAULT_WEB_PORT);
 fs::FS *imageFS;  // For GIF storage (SD card)
 fs::FS *uiFS;     // For web UI files (LittleFS)
 
+GIFUploadSessions uploadSessions;  // Uploads in progress, one per request
+
 bool startWebServer() {
     // Initialize filesystems
     imageFS = &FSUtils::getFS(FSType::SD);
@@ -78,57 +83,132 @@ void setupSpaRouting() {
 }
 
 void onGifUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final) {
-    static File uploadFile;
-    static String uploadPath;
-    static String destination;
-    static String category;
-
-    if (index == 0) {
-        // First chunk - get parameters and create temp file
-        destination = request->arg("destination");
-        category = request->arg("category");
+    AnimatedGIFPanel& gifPanel = AnimatedGIFPanel::getInstance();
+    auto guard = uploadSessions.lock();
 
-        // Create temp file path
-        uploadPath = "/temp/" + filename;
+    // Uploads whose client went quiet give their slot back
+    uploadSessions.expire();
 
-        // Create temp directory if it doesn't exist
-        if (!imageFS->exists("/temp")) {
-            imageFS->mkdir("/temp");
+    UploadSession *session = uploadSessions.find(request);
+    if (index == 0) {
+        // First chunk - claim a slot and start writing in place
+        session = uploadSessions.open(request);
+        if (!session) {
+            LOG_WARNING("Upload of %s turned away: %d uploads in progress", filename.c_str(), MAX_UPLOAD_SESSIONS);
+            return;
+        }
+        request->onDisconnect([request]() {
+            auto guard = uploadSessions.lock();
+            uploadSessions.close(request);
+        });
+
+        String destination = request->arg("destination");
+        if (destination == "current") {
+            session->category = "current";
+        } else if (destination == "category") {
+            session->category = request->arg("category");
+        } else {
+            session->rejected = true;
+            session->status = 400;
+            session->error = "Invalid destination specified";
+            return;
         }
 
-        // Open file for writing (use imageFS for temp file)
-        uploadFile = imageFS->open(uploadPath, "w");
-        if (!uploadFile) {
-            request->send(500, "application/json", "{\"success\":false,\"message\":\"Failed to create upload file\"}");
+        String path = gifPanel.getUploadPath(session->category, filename);
+        if (uploadSessions.isWriting(path)) {
+            session->rejected = true;
+            session->status = 409;
+            session->error = "The same file is already being uploaded";
+            return;
+        }
+        if (!gifPanel.beginUpload(session->writer, session->category, filename)) {
+            // Either the category directory or the part file could not be created
+            const char *error = session->writer.getError();
+            session->rejected = true;
+            session->status = 500;
+            session->error = *error ? error : "Failed to create category directory";
             return;
         }
     }
 
-    if (uploadFile && len > 0) {
-        // Write data to file
-        uploadFile.write(data, len);
+    // Chunks of turned-away or rejected uploads are drained without touching the card.
+    // A rejected upload keeps its slot until it is answered, so draining counts as activity.
+    if (!session) {
+        return;
+    }
+    session->lastActivityMs = millis();
+    if (session->rejected) {
+        return;
     }
 
+    // Chunks are validated before they are written, so a bad file is dropped early.
+    // Writes are synchronous: the chunk is acknowledged to the client only after
+    // this returns, so a slow card slows the senders down instead of queueing data.
+    if (!session->writer.write(data, len) ||
+        (final && !gifPanel.finishUpload(session->writer, session->category))) {
+        session->rejected = true;
+        return;
+    }
     if (final) {
-        if (uploadFile) {
-            uploadFile.close();
-
-            // Process the uploaded file
-            bool success = processUploadedGif(uploadPath, destination, category);
+        session->finished = true;
+        session->lastActivityMs = millis();
+    }
+}
 
-            if (success) {
-                // Clean up temp file
-                imageFS->remove(uploadPath);
-                request->send(200, "application/json", "{\"success\":true,\"message\":\"GIF uploaded and processed successfully\"}");
+/**
+ * @brief Answer an upload request once its body has been received
+ * @param request The upload request
+ */
+void respondToUpload(AsyncWebServerRequest *request) {
+    JsonDocument doc;
+    int status = 200;
+    {
+        auto guard = uploadSessions.lock();
+        UploadSession *session = uploadSessions.find(request);
+
+        if (!session) {
+            status = 503;
+            doc["success"] = false;
+            doc["message"] = "Too many uploads in progress";
+        } else if (!session->finished) {
+            const GIFUploadWriter &writer = session->writer;
+            if (session->status) {
+                status = session->status;
+            } else if (session->rejected) {
+                status = writer.isStorageError() ? 500 : 400;
             } else {
-                // Clean up temp file
-                imageFS->remove(uploadPath);
-                request->send(500, "application/json", "{\"success\":false,\"message\":\"Failed to process GIF\"}");
+                status = 400;
             }
+            doc["success"] = false;
+            doc["message"] = session->error ? session->error
+                           : session->rejected ? writer.getError() : "Incomplete upload";
         } else {
-            request->send(500, "application/json", "{\"success\":false,\"message\":\"Upload failed\"}");
+            const GIFInfo &info = session->writer.getInfo();
+            const UploadStats &stats = session->writer.getStats();
+            doc["success"] = true;
+            doc["message"] = "GIF uploaded and processed successfully";
+            doc["width"] = info.width;
+            doc["height"] = info.height;
+            doc["frames"] = info.frames;
+            doc["duration_ms"] = info.durationMs;
+            doc["max_code_size"] = info.maxCodeSize;
+            doc["bytes"] = stats.bytes;
+            doc["stored_bytes"] = stats.storedBytes;
+            doc["transcoded"] = stats.transcoded;
+            doc["elapsed_ms"] = stats.elapsedMs;
+            doc["kb_per_sec"] = stats.kbPerSecond();
+            doc["peak_heap_bytes"] = stats.peakHeapBytes;
         }
+        uploadSessions.close(request);
+    }
+
+    String response;
+    serializeJson(doc, response);
+    AsyncWebServerResponse *reply = request->beginResponse(status, "application/json", response);
+    if (status == 503) {
+        reply->addHeader("Retry-After", String(UPLOAD_RETRY_AFTER_S));
     }
+    request->send(reply);
 }
 
 String getFilenameFromPath(const String& path) {
@@ -152,64 +232,6 @@ AnimatedGIFPanel* getGifPanelWithError(AsyncWebServerRequest *request) {
     return &gifPanel;
 }
 
-bool processUploadedGif(const String& tempPath, const String& destination, const String& category) {
-    // Open the uploaded file
-    File gifFile = imageFS->open(tempPath, "r");
-    if (!gifFile) {
-        LOG_ERROR("Failed to open uploaded GIF file");
-        return false;
-    }
-
-    // Check file size (max 2MB)
-    const size_t MAX_FILE_SIZE = 2 * 1024 * 1024; // 2MB
-    if (gifFile.size() > MAX_FILE_SIZE) {
-        LOG_ERROR("File size exceeds 2MB limit");
-        gifFile.close();
-        return false;
-    }
-
-    // Read the file data into memory
-    size_t fileSize = gifFile.size();
-    uint8_t* fileData = new uint8_t[fileSize];
-    if (!fileData) {
-        LOG_ERROR("Failed to allocate memory for GIF data");
-        gifFile.close();
-        return false;
-    }
-
-    gifFile.read(fileData, fileSize);
-    gifFile.close();
-
-    // Get the AnimatedGIFPanel instance
-    AnimatedGIFPanel& gifPanel = AnimatedGIFPanel::getInstance();
-    if (!&gifPanel) {
-        LOG_ERROR("GIF panel not initialized");
-        delete[] fileData;
-        return false;
-    }
-
-    // Process and save the GIF using the new methods
-    // Extract filename from path
-    int lastSlash = tempPath.lastIndexOf('/');
-    String filename = lastSlash == -1 ? tempPath : tempPath.substring(lastSlash + 1);
-
-    if (destination == "current") {
-        // Save as current GIF
-        bool success = gifPanel.processAndSaveGif("current", filename, fileData, fileSize);
-        delete[] fileData;
-        return success;
-    } else if (destination == "category") {
-        // Save to specific category
-        bool success = gifPanel.processAndSaveGif(category, filename, fileData, fileSize);
-        delete[] fileData;
-        return success;
-    } else {
-        LOG_ERROR("Invalid destination specified");
-        delete[] fileData;
-        return false;
-    }
-}
-
 void setupApiEndpoints() {
 
     server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
@@ -271,7 +293,77 @@ void setupApiEndpoints() {
         request->send(200, "application/json", response);
     });
 
+    // Color calibration endpoints
+    server.on("/api/calibration", HTTP_GET, [](AsyncWebServerRequest *request) {
+        const ColorCalibration &calibration = DisplayService::getInstance().getCalibration();
+        JsonDocument doc;
+        ColorCalibration::writeSettings(calibration.getSettings(), doc.to<JsonObject>());
+        doc["version"] = calibration.getVersion();
+        doc["zones"] = calibration.getZoneCount();
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // The body is a "color" configuration section; the tables are rebuilt and
+    // swapped in while playback continues
+    AsyncCallbackJsonWebHandler *calibrationHandler = new AsyncCallbackJsonWebHandler(
+        "/api/calibration", [](AsyncWebServerRequest *request, JsonVariant &json) {
+            DisplayService &displayService = DisplayService::getInstance();
+
+            // Keys left out keep their current values
+            CalibrationSettings settings = displayService.getCalibration().getSettings();
+            if (!json.is<JsonObject>() || !ColorCalibration::parseSettings(json, settings)) {
+                request->send(400, "application/json", "{\"success\":false,\"message\":\"Invalid calibration\"}");
+                return;
+            }
+            if (!displayService.setCalibration(settings)) {
+                request->send(400, "application/json", "{\"success\":false,\"message\":\"Too many different panel gains\"}");
+                return;
+            }
+
+            const ColorCalibration &calibration = displayService.getCalibration();
+            JsonDocument doc;
+            doc["success"] = true;
+            doc["version"] = calibration.getVersion();
+            doc["zones"] = calibration.getZoneCount();
+            String response;
+            serializeJson(doc, response);
+            request->send(200, "application/json", response);
+        });
+    calibrationHandler->setMethod(HTTP_POST);
+    server.addHandler(calibrationHandler);
+
     // Category endpoints
+    // Registered before /api/categories, which also matches its subpaths
+    server.on("/api/categories/rescan", HTTP_POST, [](AsyncWebServerRequest *request) {
+        AnimatedGIFPanel* gifPanel = getGifPanelWithError(request);
+        if (!gifPanel) {
+            return;
+        }
+
+        uint32_t jobId = gifPanel->requestRescan();
+        request->send(202, "application/json", gifPanel->getRescanJson(jobId));
+    });
+
+    server.on("/api/categories/rescan", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AnimatedGIFPanel* gifPanel = getGifPanelWithError(request);
+        if (!gifPanel) {
+            return;
+        }
+
+        uint32_t jobId = 0;
+        if (request->hasParam("job")) {
+            jobId = request->getParam("job")->value().toInt();
+        }
+        String response = gifPanel->getRescanJson(jobId);
+        if (response == "{}") {
+            request->send(404, "application/json", "{\"error\":\"Unknown rescan job\"}");
+            return;
+        }
+        request->send(200, "application/json", response);
+    });
+
     server.on("/api/categories", HTTP_GET, [](AsyncWebServerRequest *request) {
         JsonDocument doc;
         JsonArray categories = doc["categories"].to<JsonArray>();
@@ -298,12 +390,16 @@ void setupApiEndpoints() {
     server.on("/api/upload", HTTP_POST,
         [](AsyncWebServerRequest *request) {
             if (!request->hasParam("destination", true)) {
+                {
+                    auto guard = uploadSessions.lock();
+                    uploadSessions.close(request);
+                }
                 request->send(400, "application/json", "{\"success\":false,\"message\":\"Missing destination parameter\"}");
                 return;
             }
 
-            // Handle file upload
-            request->send(200);
+            // The upload handler has stored or rejected the file by now
+            respondToUpload(request);
         },
         onGifUpload
     );
@@ -18,12 +18,13 @@ void setupApiEndpoints();
 void setupLegacyEndpoints();
 void onUpload(AsyncWebServerRequest *request, String filename, size_t index,
               uint8_t *data, size_t len, bool final);
+void onGifUpload(AsyncWebServerRequest *request, String filename, size_t index,
+                 uint8_t *data, size_t len, bool final);
+void respondToUpload(AsyncWebServerRequest *request);
 void getImage(AsyncWebServerRequest *request);
 
 String getFilenameFromPath(const String& path);
 AnimatedGIFPanel* getGifPanelWithError(AsyncWebServerRequest *request);
 bool downloadAndProcessGif(const String &url, const String &destination,
                            const String &category);
-bool processUploadedGif(const String &tempPath, const String &destination,
-                        const String &category);
 #endif  // WEBSERVICE_H
\ No newline at end of file